@@ -9,6 +9,7 @@
 #include <ldk_common.h>
 #include <module/ldk_entity.h>
 #include <module/ldk_component.h>
+#include <editor/ldk_component_metadata.h>
 #include <stdx/stdx_math.h>
 
 #include <stdbool.h>
@@ -45,6 +46,7 @@ extern "C" {
 
 #ifdef LDK_ENGINE
   LDK_API LDKComponentDesc ldk_camera_component_desc(u32 initial_capacity);
+  LDK_API const LDKComponentMeta* ldk_camera_component_meta(void);
 #endif // LDK_ENGINE
 
 LDK_API bool ldk_camera_look_at(LDKEntity entity, Vec3 target);
@@ -15,6 +15,7 @@
 #include <ldk_common.h>
 #include <module/ldk_entity.h>
 #include <module/ldk_component.h>
+#include <editor/ldk_component_metadata.h>
 #include <stdx/stdx_math.h>
 
 #ifdef __cplusplus
@@ -56,6 +57,15 @@ extern "C" {
 
 #ifdef LDK_ENGINE
   LDK_API LDKComponentDesc ldk_transform_component_desc(u32 initial_capacity);
+  LDK_API const LDKComponentMeta* ldk_transform_component_meta(void);
+
+  /**
+   * LDKComponentSortKeyFn that orders transforms by hierarchy depth, with
+   * siblings next to each other. Parents always come before their children.
+   * Each key walks the ancestors of owner, so a pass costs O(transforms * depth).
+   */
+  LDK_API u64 ldk_transform_sort_key_hierarchy(void* user, LDKEntityRegistry* entity_registry,
+      LDKComponentRegistry* component_registry, LDKEntity owner);
 #endif // LDK_ENGINE
 
 #ifdef __cplusplus
@@ -48,6 +48,7 @@ extern "C" {
     LDK_MODULE_ASSET_MANAGER,
     LDK_MODULE_ECS,
     LDK_MODULE_EVENT,
+    LDK_MODULE_JOBS,
     LDK_MODULE_LOG,
     LDK_MODULE_RENDERER,
   } LDKModuleType;
@@ -68,6 +69,8 @@ extern "C" {
     i32       height;
     i32       initial_ui_index_capacity;
     i32       initial_ui_vertex_capacity;
+    i32       job_worker_count; // 0 uses one worker per CPU
+    i32       transform_sort_budget; // Transform swaps per frame spent keeping the store in hierarchy order. 0, the default, disables it.
     bool      fullscreen;
   } LDKConfig;
 
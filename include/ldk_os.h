@@ -33,6 +33,20 @@ extern "C" {
   LDK_API void    ldk_os_memory_free(void* memory);
   LDK_API void*   ldk_os_memory_resize(void* memory, size_t size);
 
+  // ---------------------------------------------------------------------------
+  // Memory mapped files
+  // ---------------------------------------------------------------------------
+  typedef struct LDKFileMapping
+  {
+    const void* data;
+    size_t size;
+    void* file;
+    void* mapping;
+  } LDKFileMapping;
+
+  LDK_API bool ldk_os_file_map(const char* path, LDKFileMapping* out_mapping); // Maps the whole file, read only. Empty files can not be mapped.
+  LDK_API void ldk_os_file_unmap(LDKFileMapping* mapping);
+
   // ---------------------------------------------------------------------------
   // Time
   // ---------------------------------------------------------------------------
@@ -41,6 +55,36 @@ extern "C" {
   LDK_API double  ldk_os_time_ticks_interval_get_milliseconds(u64 start, u64 end);
   LDK_API double  ldk_os_time_ticks_interval_get_nanoseconds(u64 start, u64 end);
 
+  // ---------------------------------------------------------------------------
+  // Threads
+  // ---------------------------------------------------------------------------
+  typedef void* LDKThread;
+  typedef void* LDKSemaphore;
+  typedef u32 (*LDKThreadFn)(void* user);
+
+  LDK_API LDKThread     ldk_os_thread_create(LDKThreadFn fn, void* user);
+  LDK_API void          ldk_os_thread_join(LDKThread thread); // Waits for the thread to finish and releases it
+  LDK_API void          ldk_os_thread_yield(void);
+  LDK_API u32           ldk_os_cpu_count(void);
+  LDK_API LDKSemaphore  ldk_os_semaphore_create(u32 initial_count);
+  LDK_API void          ldk_os_semaphore_destroy(LDKSemaphore semaphore);
+  LDK_API void          ldk_os_semaphore_wait(LDKSemaphore semaphore);
+  LDK_API void          ldk_os_semaphore_signal(LDKSemaphore semaphore, u32 count);
+
+  // ---------------------------------------------------------------------------
+  // Atomics
+  // All operations are sequentially consistent: stores and read-modify-writes
+  // are full barriers and loads are never reordered before them. Add returns
+  // the new value.
+  // ---------------------------------------------------------------------------
+  LDK_API i32   ldk_os_atomic_load_i32(volatile i32* value);
+  LDK_API void  ldk_os_atomic_store_i32(volatile i32* value, i32 desired);
+  LDK_API i32   ldk_os_atomic_add_i32(volatile i32* value, i32 amount);
+  LDK_API bool  ldk_os_atomic_cas_i32(volatile i32* value, i32 expected, i32 desired);
+  LDK_API i64   ldk_os_atomic_load_i64(volatile i64* value);
+  LDK_API void  ldk_os_atomic_store_i64(volatile i64* value, i64 desired);
+  LDK_API bool  ldk_os_atomic_cas_i64(volatile i64* value, i64 expected, i64 desired);
+
   // ---------------------------------------------------------------------------
   // Windowing
   // ---------------------------------------------------------------------------
@@ -0,0 +1,136 @@
+/**
+ * @file   ldk_archetype.h
+ * @brief  Archetype chunk storage for components
+ *
+ * An archetype groups every entity that owns exactly the same set of
+ * archetype-stored component types. Rows of an archetype live in fixed size
+ * chunks laid out as structure-of-arrays: one entity column followed by one
+ * column per component type, so iterating a component inside a chunk is a
+ * linear walk over tightly packed memory.
+ *
+ * Adding or removing an archetype-stored component moves the entity row to
+ * the neighbour archetype. Neighbours are cached as edges so repeated
+ * transitions do not search the archetype list.
+ *
+ * Archetypes are owned by the component registry. Components only use this
+ * storage when registered with LDK_COMPONENT_STORAGE_ARCHETYPE.
+ */
+
+#ifndef LDK_ARCHETYPE_H
+#define LDK_ARCHETYPE_H
+
+#include <ldk_common.h>
+#include <module/ldk_entity.h>
+#include <stdx/stdx_array.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LDK_ARCHETYPE_CHUNK_SIZE
+#define LDK_ARCHETYPE_CHUNK_SIZE (16 * 1024)
+#endif
+
+#define LDK_ARCHETYPE_COLUMN_ALIGN 16
+#define LDK_ARCHETYPE_NONE  UINT32_MAX
+#define LDK_ARCHETYPE_EMPTY 0 // Root archetype. Has no columns and never stores rows.
+
+typedef struct LDKArchetypeChunk
+{
+  u8* data;
+  u32 count;
+} LDKArchetypeChunk;
+
+typedef struct LDKArchetypeEdge
+{
+  u32 component_type;
+  u32 add;
+  u32 remove;
+} LDKArchetypeEdge;
+
+typedef struct LDKArchetype
+{
+  u32 id;
+  u32 column_count;
+  u32* component_types;  // sorted ascending
+  u32* column_sizes;
+  u32* column_offsets;   // byte offset of each column inside a chunk
+  u32 chunk_capacity;    // rows per chunk
+  u32 chunk_bytes;
+  u32 entity_count;
+  XArray* chunks;        // LDKArchetypeChunk
+  XArray* edges;         // LDKArchetypeEdge
+} LDKArchetype;
+
+typedef struct LDKArchetypeTable
+{
+  XArray* archetypes;    // LDKArchetype*
+} LDKArchetypeTable;
+
+LDK_API bool ldk_archetype_table_initialize(LDKArchetypeTable* table);
+LDK_API void ldk_archetype_table_terminate(LDKArchetypeTable* table);
+LDK_API u32 ldk_archetype_count(const LDKArchetypeTable* table);
+LDK_API LDKArchetype* ldk_archetype_get(const LDKArchetypeTable* table, u32 archetype_id);
+
+/**
+ * Returns the archetype with exactly the given component set, creating it if needed.
+ * Types do not need to be sorted. Returns LDK_ARCHETYPE_NONE on failure.
+ */
+LDK_API u32 ldk_archetype_find_or_create(LDKArchetypeTable* table, const u32* component_types,
+    const u32* component_sizes, u32 count);
+
+/**
+ * Returns the archetype reached by adding (or removing) one component type to (from) the given archetype.
+ * LDK_ARCHETYPE_NONE is accepted as a source and means "no archetype components".
+ * Removing the last component yields LDK_ARCHETYPE_NONE.
+ */
+LDK_API u32 ldk_archetype_transition_add(LDKArchetypeTable* table, u32 archetype_id, u32 component_type, u32 component_size);
+LDK_API u32 ldk_archetype_transition_remove(LDKArchetypeTable* table, u32 archetype_id, u32 component_type);
+
+LDK_API u32 ldk_archetype_column_find(const LDKArchetype* archetype, u32 component_type);
+LDK_API bool ldk_archetype_has_all(const LDKArchetype* archetype, const u32* component_types, u32 count);
+
+/**
+ * Appends a zeroed row owned by entity. Returns the row index or LDK_ENTITY_INVALID_COMPONENT_INDEX.
+ */
+LDK_API u32 ldk_archetype_row_alloc(LDKArchetype* archetype, LDKEntity entity);
+
+/**
+ * Swap-removes a row. If another row was moved into its place, the moved
+ * entity is written to out_moved and true is returned.
+ */
+LDK_API bool ldk_archetype_row_free(LDKArchetype* archetype, u32 row, LDKEntity* out_moved);
+
+/**
+ * Moves a row between archetypes, copying the columns both share.
+ * Columns only present in dst are zeroed. Returns the new row in dst.
+ */
+LDK_API u32 ldk_archetype_row_move(LDKArchetype* src, u32 src_row, LDKArchetype* dst, LDKEntity* out_moved);
+
+LDK_API void* ldk_archetype_row_component_get(const LDKArchetype* archetype, u32 column, u32 row);
+LDK_API LDKEntity ldk_archetype_row_entity_get(const LDKArchetype* archetype, u32 row);
+
+/**
+ * Raw copy of the rows of every archetype. Archetypes created after the capture
+ * are emptied on restore, they are never destroyed. Zero initialize before use.
+ */
+typedef struct LDKArchetypeSnapshot
+{
+  XArray* entity_counts;  // u32 per archetype
+  XArray* chunks;         // u8, the used chunks of every archetype back to back
+} LDKArchetypeSnapshot;
+
+LDK_API bool ldk_archetype_table_snapshot_capture(const LDKArchetypeTable* table, LDKArchetypeSnapshot* snapshot);
+LDK_API bool ldk_archetype_table_snapshot_restore(LDKArchetypeTable* table, const LDKArchetypeSnapshot* snapshot);
+LDK_API void ldk_archetype_table_snapshot_release(LDKArchetypeSnapshot* snapshot);
+
+LDK_API u32 ldk_archetype_chunk_count(const LDKArchetype* archetype);
+LDK_API LDKArchetypeChunk* ldk_archetype_chunk_get(const LDKArchetype* archetype, u32 chunk_index);
+LDK_API LDKEntity* ldk_archetype_chunk_entities(const LDKArchetypeChunk* chunk);
+LDK_API void* ldk_archetype_chunk_column(const LDKArchetype* archetype, const LDKArchetypeChunk* chunk, u32 column);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDK_ARCHETYPE_H
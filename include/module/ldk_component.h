@@ -3,6 +3,29 @@
  * @brief  Component registry and storage
  *
  * Manages component type registration and packed storage for entities.
+ * Component types registered with LDK_COMPONENT_STORAGE_ARCHETYPE are stored
+ * in archetype chunks instead (see ldk_archetype.h).
+ *
+ * Component types registered with LDK_COMPONENT_STORAGE_TAG have no data. A tag
+ * is only a bit in the entity component mask: it costs nothing per entity and
+ * takes part in queries like any other component.
+ *
+ * Component types registered with LDK_COMPONENT_STORAGE_PAGED keep their data in
+ * fixed size pages that never move, so a component pointer stays valid for as
+ * long as the component exists. Their store holds one pointer per component in
+ * the same dense order a packed store would have, and removals move pointers
+ * instead of data. Everything keyed by the dense index (owners, ticks, disabled
+ * bits, queries) works the same as for packed types.
+ *
+ * Packed and paged components can be disabled without being removed. A disabled component
+ * keeps its data and its place in the store, it is only skipped by queries and
+ * ldk_component_foreach_parallel. Each store keeps one disabled bit per index.
+ *
+ * Packed and paged components carry change ticks. The registry keeps a tick counter and
+ * each component remembers the tick it was added at and the tick it was last
+ * changed at. A component is changed by a mutable get or an explicit mark.
+ * A consumer remembers the value returned by ldk_component_tick_advance() and
+ * asks for components changed or added since that tick on its next run.
  */
 
 #ifndef LDK_COMPONENT_H
@@ -10,6 +33,8 @@
 
 #include <ldk_common.h>
 #include <module/ldk_entity.h>
+#include <module/ldk_archetype.h>
+#include <module/ldk_query.h>
 #include <stdx/stdx_array.h>
 #include <stdx/stdx_hashtable.h>
 
@@ -17,10 +42,40 @@
 extern "C" {
 #endif
 
+#ifndef LDK_COMPONENT_DIRECT_TYPES
+#define LDK_COMPONENT_DIRECT_TYPES  256 // Type ids below this resolve to a slot without hashing
+#endif
+
+#ifndef LDK_COMPONENT_PAGE_CAPACITY
+#define LDK_COMPONENT_PAGE_CAPACITY 256 // Components per page of paged storage
+#endif
+
+#define LDK_COMPONENT_BUILTIN_TYPES 16  // Type ids above (UINT32_MAX - this) are reserved for engine components
+#define LDK_COMPONENT_INVALID_SLOT  UINT32_MAX
+
   typedef bool (*LDKComponentAttachFn)(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry, LDKEntity entity, void* component, u32 component_index, const void* initial_value, void* user);
 
   typedef void (*LDKComponentDestroyFn)( LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry, LDKEntity entity, void* component, u32 component_index, void* user);
 
+  /**
+   * Called with a contiguous run of count components from a packed store and their owners.
+   * Paged stores are split into runs of components that happen to be adjacent in a page.
+   */
+  typedef void (*LDKComponentForeachFn)(void* user, void* components, const LDKEntity* owners, u32 count, u32 worker_index);
+
+  struct LDKJobSystem;
+
+  /**
+   * How instances of a component type are laid out in memory.
+   */
+  typedef enum LDKComponentStorage
+  {
+    LDK_COMPONENT_STORAGE_PACKED = 0,   // One dense array per component type. This is the default.
+    LDK_COMPONENT_STORAGE_ARCHETYPE,    // SoA chunks grouped by the entity's set of archetype components.
+    LDK_COMPONENT_STORAGE_TAG,          // No data. entry_size must be 0 and attach/destroy are never called.
+    LDK_COMPONENT_STORAGE_PAGED,        // Stable addresses in fixed size pages, iterated through a dense pointer array.
+  } LDKComponentStorage;
+
   /**
    * A descriptor that identifies a Component.
    * Components are plain data structures that can be attached to entities.
@@ -35,20 +90,65 @@ extern "C" {
     LDKComponentAttachFn attach;
     LDKComponentDestroyFn destroy;
     void* user;
+    LDKComponentStorage storage;
   } LDKComponentDesc;
 
+  typedef struct LDKComponentTicks
+  {
+    u32 added;
+    u32 changed;
+  } LDKComponentTicks;
+
   typedef struct LDKRegisteredComponent
   {
     LDKComponentDesc desc;
-    XArray* store;
+    XArray* store;    // Components, or void* to them for paged storage
     XArray* owners;
+    XArray* ticks;    // LDKComponentTicks, parallel to store
+    XArray* disabled; // u64 words, one bit per store index. Bits past the store count are always clear.
+    XArray* pages;    // u8*, LDK_COMPONENT_PAGE_CAPACITY components each. Paged storage only.
+    XArray* free_slots; // void*, released components of the pages. Paged storage only.
+    u32 disabled_count;
+    u32 layout_version; // Bumped whenever components are added to or removed from the store
+    u32 slot;         // Dense index of this type. Also its bit in LDKComponentMask.
   } LDKRegisteredComponent;
 
-  X_HASHTABLE_TYPE_NAMED(u32, LDKRegisteredComponent, u32_registered_component);
+  /* Disabled bits of entry, or NULL when none of its components is disabled */
+  static X_INLINE const u64* ldk_component_entry_disabled_bits(const LDKRegisteredComponent* entry)
+  {
+    return (entry && entry->disabled_count) ? (const u64*)x_array_data(entry->disabled) : NULL;
+  }
+
+  static X_INLINE bool ldk_component_bits_test(const u64* bits, u32 index)
+  {
+    return (bits[index >> 6] & ((u64)1 << (index & 63))) != 0;
+  }
+
+  /* Component at index of a packed or paged store. index must be in range. */
+  static X_INLINE void* ldk_component_entry_data(const LDKRegisteredComponent* entry, u32 index)
+  {
+    void* element = x_array_get(entry->store, index);
+    return entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED ? *(void**)element : element;
+  }
+
+  X_HASHTABLE_TYPE_NAMED(u32, u32, u32_component_slot);
 
+  /**
+   * Registered types are assigned dense slots in registration order and stored
+   * in a slot indexed array. Type ids are resolved to slots through direct
+   * tables for small user ids and builtin ids, and through a hashtable otherwise.
+   */
   typedef struct LDKComponentRegistry
   {
-    XHashtable_u32_registered_component* table;
+    LDKRegisteredComponent* entries;  // [LDK_COMPONENT_MAX_TYPES], indexed by slot
+    u32 count;
+    XHashtable_u32_component_slot* slots;
+    u32 direct_slots[LDK_COMPONENT_DIRECT_TYPES];
+    u32 builtin_slots[LDK_COMPONENT_BUILTIN_TYPES];
+    LDKArchetypeTable archetypes;
+    LDKQueryRegistry queries;
+    u32 tick;         // Current change tick, starts at 1
+    LDKComponentMask tag_mask;  // Slots of tag components. Tags have no entity directory entry.
   } LDKComponentRegistry;
 
   LDK_API bool ldk_component_registry_initialize(LDKComponentRegistry* registry);
@@ -65,9 +165,24 @@ extern "C" {
   LDK_API void ldk_component_registry_remove_all(LDKComponentRegistry* registry,
       LDKEntityRegistry* entity_system, LDKEntity entity);
   LDK_API void* ldk_component_create(LDKComponentRegistry* module, u32 component_type, u32* component_index);
+  /**
+   * Appends count zeroed components with null owners to the store of component_type,
+   * growing the store once. Returns the first component and its index in first_index.
+   * Components are contiguous. Callers are expected to set owners and directory entries.
+   */
+  LDK_API void* ldk_component_create_batch(LDKComponentRegistry* module, u32 component_type, u32 count, u32* first_index);
   LDK_API void* ldk_component_get(LDKComponentRegistry* module, u32 component_type, u32 component_index);
   LDK_API bool ldk_component_destroy(LDKComponentRegistry* module,
       LDKEntityRegistry* entity_module, u32 component_type, u32 component_index);
+  /**
+   * Removes many components of a packed store at once. The destroy callback runs
+   * for all of them first, then the store is compacted from the tail. Owners of
+   * moved components get their directory entries updated, the owners of removed
+   * ones are left to the caller. component_indices is sorted in place. Returns
+   * how many components were removed.
+   */
+  LDK_API u32 ldk_component_destroy_batch(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+      u32 component_type, u32* component_indices, u32 count);
   LDK_API bool ldk_component_register(LDKComponentRegistry* registry, const LDKComponentDesc* desc);
   LDK_API bool ldk_component_attach(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
       LDKEntity entity, u32 component_type, u32 component_index, const void* initial_value);
@@ -75,6 +190,178 @@ extern "C" {
       LDKEntity entity, u32 component_type, u32 component_index);
 
   LDK_API const char* ldk_component_name_get(LDKComponentRegistry* registry, u32 type);
+  LDK_API LDKComponentStorage ldk_component_storage_get(LDKComponentRegistry* registry, u32 type);
+  LDK_API bool ldk_component_is_tag(LDKComponentRegistry* registry, u32 type);
+
+  /**
+   * Slot based access. Resolve the slot of a type once and use it on hot paths
+   * to skip the type id lookup.
+   */
+  LDK_API u32 ldk_component_slot_get(LDKComponentRegistry* registry, u32 type);
+  LDK_API u32 ldk_component_slot_count(LDKComponentRegistry* registry);
+  LDK_API LDKRegisteredComponent* ldk_component_entry_get(LDKComponentRegistry* registry, u32 slot);
+  LDK_API XArray* ldk_component_store_get_by_slot(LDKComponentRegistry* registry, u32 slot);
+  LDK_API void* ldk_component_get_by_slot(LDKComponentRegistry* registry, u32 slot, u32 component_index);
+
+  /**
+   * Change ticks. Packed and paged components are tracked; archetype and tag
+   * types have no ticks and return NULL/false.
+   * A tick is "since" another when it is strictly greater.
+   */
+  LDK_API u32 ldk_component_tick_get(LDKComponentRegistry* registry);
+
+  /**
+   * Starts a new tick and returns the one that just ended. Changes made after
+   * this call are reported as changed since the returned tick.
+   */
+  LDK_API u32 ldk_component_tick_advance(LDKComponentRegistry* registry);
+  LDK_API void ldk_component_mark_changed(LDKComponentRegistry* registry, u32 component_type, u32 component_index);
+  LDK_API void ldk_component_mark_changed_by_slot(LDKComponentRegistry* registry, u32 slot, u32 component_index);
+  LDK_API const LDKComponentTicks* ldk_component_ticks_get(LDKComponentRegistry* registry, u32 component_type, u32 component_index);
+  LDK_API bool ldk_component_changed_since(LDKComponentRegistry* registry, u32 component_type, u32 component_index, u32 tick);
+  LDK_API bool ldk_component_added_since(LDKComponentRegistry* registry, u32 component_type, u32 component_index, u32 tick);
+
+  /**
+   * Enabled state of packed and paged components. Components are created enabled.
+   * Toggling does not move data nor run attach/destroy callbacks.
+   * Returns false for unknown indices; archetype and tag types return false.
+   */
+  LDK_API bool ldk_component_enabled_set(LDKComponentRegistry* registry, u32 component_type, u32 component_index, bool enabled);
+  LDK_API bool ldk_component_is_enabled(LDKComponentRegistry* registry, u32 component_type, u32 component_index);
+
+  /**
+   * Splits the packed store of component_type into runs of grain components and
+   * processes them on the job system. A grain of 0 picks one based on the worker
+   * count. With a NULL job system the whole store is processed on the caller as worker 0.
+   * Disabled components are skipped, fn only sees runs of enabled ones.
+   * The store must not change structurally until it returns: record structural
+   * changes on an ECS command buffer instead.
+   * Returns false for unknown and archetype-stored types.
+   */
+  LDK_API bool ldk_component_foreach_parallel(LDKComponentRegistry* registry, struct LDKJobSystem* jobs,
+      u32 component_type, LDKComponentForeachFn fn, void* user, u32 grain);
+
+  /**
+   * Store sorting.
+   * Swap-remove scatters a packed store over time. A sort reorders the store,
+   * its owners, ticks and disabled bits by a key and fixes the component index
+   * in the owners' directories. It runs incrementally: every step performs at
+   * most max_moves swaps, so it can be spread over frames. A pass that sees the
+   * store change structurally between steps starts over.
+   * Component pointers are invalidated by a step like by any structural change.
+   */
+  typedef enum LDKComponentSortKey
+  {
+    LDK_COMPONENT_SORT_ENTITY_INDEX = 0,  // Owner entity index
+    LDK_COMPONENT_SORT_COMPONENT_ORDER,   // Store order of the owner's packed or paged order_type component. Owners without it go last.
+    LDK_COMPONENT_SORT_CUSTOM             // key_fn
+  } LDKComponentSortKey;
+
+  typedef u64 (*LDKComponentSortKeyFn)(void* user, LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry, LDKEntity owner);
+
+  typedef struct LDKComponentSortDesc
+  {
+    u32 component_type;
+    LDKComponentSortKey key;
+    u32 order_type;               // LDK_COMPONENT_SORT_COMPONENT_ORDER only
+    LDKComponentSortKeyFn key_fn; // LDK_COMPONENT_SORT_CUSTOM only
+    void* user;
+  } LDKComponentSortDesc;
+
+  typedef struct LDKComponentSort
+  {
+    LDKComponentSortDesc desc;
+    XArray* order;      // u32, original index of the component that goes to each position
+    XArray* at;         // u32, original index of the component currently at each position
+    XArray* where;      // u32, current position of each original index
+    u32 cursor;
+    u32 count;
+    u32 layout_version;
+    bool active;        // A pass is in progress
+    bool failed;        // The last pass could not start for lack of memory
+  } LDKComponentSort;
+
+  /**
+   * Returns false unless component_type, and order_type for
+   * LDK_COMPONENT_SORT_COMPONENT_ORDER, are registered packed or paged types.
+   * Archetype rows and tags have no store order to sort by.
+   */
+  LDK_API bool ldk_component_sort_initialize(LDKComponentRegistry* registry, LDKComponentSort* sort, const LDKComponentSortDesc* desc);
+  LDK_API void ldk_component_sort_terminate(LDKComponentSort* sort);
+
+  /**
+   * Starts a pass if none is in progress and performs up to max_moves swaps.
+   * Returns the number of swaps performed. Zero means the store is sorted,
+   * unless sort->failed is set: the pass could not allocate its order and the
+   * next step starts it again.
+   */
+  LDK_API u32 ldk_component_sort_step(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+      LDKComponentSort* sort, u32 max_moves);
+
+  /**
+   * Sorts the whole store at once. Returns false if desc is rejected by
+   * ldk_component_sort_initialize() or the pass could not allocate its order.
+   */
+  LDK_API bool ldk_component_sort(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+      const LDKComponentSortDesc* desc);
+
+  /**
+   * Archetype storage.
+   * Archetype-stored components have no per-type store: ldk_component_store_get(),
+   * ldk_component_create() and ldk_component_get() return NULL for them.
+   * They are addressed through the owning entity (archetype + row).
+   */
+  LDK_API LDKArchetypeTable* ldk_component_archetypes_get(LDKComponentRegistry* registry);
+  LDK_API void* ldk_component_archetype_data_get(LDKComponentRegistry* registry, u32 archetype_id, u32 row, u32 component_type);
+
+  /**
+   * Moves the entity to the archetype that also contains component_type and
+   * returns the new (zeroed) component. Does not touch the entity component directory.
+   */
+  LDK_API void* ldk_component_archetype_insert(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+      LDKEntity entity, u32 component_type);
+
+  /**
+   * Moves the entity to the archetype without component_type, dropping its data.
+   * Does not call the destroy callback nor touch the entity component directory.
+   */
+  LDK_API bool ldk_component_archetype_erase(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+      LDKEntity entity, u32 component_type);
+
+  /**
+   * Snapshots.
+   * A snapshot is a raw copy of every packed store and every archetype chunk.
+   * It is meant to be restored together with the entity snapshot taken at the
+   * same time (see ldk_entity_snapshot_capture()), so component indices and
+   * owner handles stay valid as they are. Attach and destroy callbacks are not
+   * called. Restored components are reported as added and changed at the
+   * current tick, stores of types registered after the capture are emptied and
+   * every query is rebuilt. Paged components are restored into the page slots
+   * they were captured from, so pointers taken before the capture stay valid
+   * for every component that existed at capture time. Zero initialize a snapshot before its first capture.
+   * Capturing again into the same snapshot reuses its memory.
+   */
+  typedef struct LDKComponentStoreSnapshot
+  {
+    XArray* store;
+    XArray* owners;
+    XArray* ticks;
+    XArray* disabled;
+    XArray* slots;    // u32 page slot of each component. Paged storage only.
+    u32 disabled_count;
+  } LDKComponentStoreSnapshot;
+
+  typedef struct LDKComponentSnapshot
+  {
+    LDKComponentStoreSnapshot* stores; // [LDK_COMPONENT_MAX_TYPES], indexed by slot
+    u32 slot_count;
+    LDKArchetypeSnapshot archetypes;
+  } LDKComponentSnapshot;
+
+  LDK_API bool ldk_component_snapshot_capture(LDKComponentRegistry* registry, LDKComponentSnapshot* snapshot);
+  LDK_API bool ldk_component_snapshot_restore(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+      const LDKComponentSnapshot* snapshot);
+  LDK_API void ldk_component_snapshot_release(LDKComponentSnapshot* snapshot);
 
 #ifdef __cplusplus
 }
@@ -14,6 +14,10 @@
 #include <module/ldk_entity.h>
 #include <module/ldk_component.h>
 #include <module/ldk_system.h>
+#include <module/ldk_ecs_command.h>
+#include <module/ldk_prefab.h>
+#include <module/ldk_scene.h>
+#include <module/ldk_scenegraph.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,8 +28,20 @@ extern "C" {
     LDKEntityRegistry entity;
     LDKComponentRegistry component;
     LDKSystemRegistry system;
+    LDKECSCommandBuffer commands[LDK_ECS_COMMAND_BUFFER_COUNT]; // One per recording thread
+    LDKScenegraph scenegraph;
   } LDKECS;
 
+  /**
+   * In-memory copy of the whole world, e.g. taken when the editor enters play
+   * mode and restored when it stops. Zero initialize before the first capture.
+   */
+  typedef struct LDKECSSnapshot
+  {
+    LDKEntitySnapshot entity;
+    LDKComponentSnapshot component;
+  } LDKECSSnapshot;
+
   // ---------------------------------------------------------------------------
   // ECS lifecycle
   // ---------------------------------------------------------------------------
@@ -36,17 +52,151 @@ extern "C" {
   // Entity lifecycle
   // ---------------------------------------------------------------------------
   LDK_API LDKEntity ldk_ecs_entity_create(void);
+  LDK_API u32 ldk_ecs_entity_create_batch(LDKEntity* out_entities, u32 count);
+
+  /**
+   * Destruction is deferred: entities are marked and stay alive, with all their
+   * components, until the end-of-frame sweep after the POST_UPDATE systems,
+   * where all of them are destroyed in one batch. The handle stays valid until
+   * then, so ldk_entity_is_alive() keeps returning true for the rest of the
+   * frame. See ldk_entity_destroy_pending().
+   */
   LDK_API void ldk_ecs_entity_destroy(LDKEntity entity);
+  LDK_API void ldk_ecs_entity_destroy_batch(const LDKEntity* entities, u32 count);
+
+  /**
+   * Sweeps the marked entities now instead of waiting for the end of the frame.
+   * Returns how many were destroyed.
+   */
+  LDK_API u32 ldk_ecs_entity_destroy_flush(void);
 
   // ---------------------------------------------------------------------------
   // Component management
   // ---------------------------------------------------------------------------
   LDK_API void* ldk_ecs_component_add(LDKEntity entity, u32 component_type, const void* initial_value);
+
+  /**
+   * Adds component_type to every entity, see ldk_entity_component_add_batch().
+   * Every entity already owns a Transform, so LDK_COMPONENT_TYPE_TRANSFORM is
+   * rejected with an error and 0 is returned.
+   */
+  LDK_API u32 ldk_ecs_component_add_batch(const LDKEntity* entities, u32 count, u32 component_type, const void* initial_values);
   LDK_API void* ldk_ecs_component_get(LDKEntity entity, u32 component_type);
   LDK_API const void* ldk_ecs_component_get_const(LDKEntity entity, u32 component_type);
+  LDK_API void ldk_ecs_component_mark_changed(LDKEntity entity, u32 component_type);
+
+  /**
+   * Disabling keeps the component in place and skips it in queries. Cheaper
+   * than remove + add for frequent toggles. Packed and paged components only.
+   */
+  LDK_API bool ldk_ecs_component_enable(LDKEntity entity, u32 component_type, bool enabled);
+  LDK_API bool ldk_ecs_component_is_enabled(LDKEntity entity, u32 component_type);
+  LDK_API u32 ldk_ecs_tick_get(void);
+  LDK_API u32 ldk_ecs_tick_advance(void);
   LDK_API bool ldk_ecs_component_remove(LDKEntity entity, u32 component_type);
   LDK_API bool ldk_ecs_component_register(const LDKComponentDesc* desc);
 
+  /**
+   * Tags are components registered with LDK_COMPONENT_STORAGE_TAG. They have
+   * no data and can be used as query terms.
+   */
+  LDK_API bool ldk_ecs_tag_add(LDKEntity entity, u32 tag_type);
+  LDK_API bool ldk_ecs_tag_remove(LDKEntity entity, u32 tag_type);
+  LDK_API bool ldk_ecs_tag_has(LDKEntity entity, u32 tag_type);
+
+  /**
+   * Processes every component of a packed or paged type in contiguous runs on the job
+   * workers and waits for them. See ldk_component_foreach_parallel().
+   */
+  LDK_API bool ldk_ecs_component_foreach_parallel(u32 component_type, LDKComponentForeachFn fn, void* user, u32 grain);
+
+  // ---------------------------------------------------------------------------
+  // Queries
+  // ---------------------------------------------------------------------------
+  LDK_API LDKQuery ldk_ecs_query_create(const u32* component_types, u32 component_count);
+  LDK_API void ldk_ecs_query_destroy(LDKQuery query);
+  LDK_API u32 ldk_ecs_query_count(LDKQuery query);
+  LDK_API LDKQueryIter ldk_ecs_query_iter_begin(LDKQuery query);
+  LDK_API bool ldk_ecs_query_iter_next(LDKQueryIter* iter, LDKQueryBatch* out_batch);
+
+  // ---------------------------------------------------------------------------
+  // Prefabs
+  // ---------------------------------------------------------------------------
+  /**
+   * Captures entity and its Transform descendants into prefab. See ldk_prefab.h.
+   */
+  LDK_API bool ldk_ecs_prefab_capture(LDKPrefab* prefab, LDKEntity entity);
+  LDK_API u32 ldk_ecs_prefab_instantiate(const LDKPrefab* prefab, u32 count, LDKEntity* out_roots);
+
+  // ---------------------------------------------------------------------------
+  // Scenes
+  // ---------------------------------------------------------------------------
+  /**
+   * Saves every alive entity with the components described by the engine and
+   * game component metadata. Entities waiting to be destroyed are left out.
+   * See ldk_scene.h.
+   */
+  LDK_API bool ldk_ecs_scene_save(const char* path);
+
+  /**
+   * Loads a scene file on top of the current world. out_entities (LDKEntity) is
+   * optional and receives the new entities in scene order.
+   */
+  LDK_API bool ldk_ecs_scene_load(const char* path, XArray* out_entities);
+
+  // ---------------------------------------------------------------------------
+  // Snapshots
+  // ---------------------------------------------------------------------------
+  /**
+   * Restoring brings back every entity with its exact handle and every
+   * component value. No attach or destroy callback is called and pending
+   * deferred commands are dropped. Systems, component types and queries stay
+   * as they are. See ldk_entity_snapshot_capture() and ldk_component_snapshot_capture().
+   */
+  LDK_API bool ldk_ecs_snapshot_capture(LDKECSSnapshot* snapshot);
+  LDK_API bool ldk_ecs_snapshot_restore(LDKECSSnapshot* snapshot);
+  LDK_API void ldk_ecs_snapshot_release(LDKECSSnapshot* snapshot);
+
+  // ---------------------------------------------------------------------------
+  // Worlds
+  // ---------------------------------------------------------------------------
+  /**
+   * Creates a world independent from the engine one, with the builtin
+   * components registered. Creating, populating and destroying a world touches
+   * no engine state, so it can be done on any thread as long as a world is only
+   * used by one thread at a time.
+   */
+  LDK_API LDKECS* ldk_ecs_world_create(u32 entity_page_capacity, u32 entity_initial_pages);
+  LDK_API void ldk_ecs_world_destroy(LDKECS* world);
+
+  /**
+   * Makes every ldk_ecs_* call (and the Transform helpers built on them) on the
+   * calling thread operate on world. NULL goes back to the engine world.
+   * Returns the previously bound world.
+   */
+  LDK_API LDKECS* ldk_ecs_world_bind(LDKECS* world);
+  LDK_API LDKECS* ldk_ecs_world_get(void);
+
+  /**
+   * Copies every entity of world into the world bound on the calling thread in
+   * one batch, the same way a scene is loaded. Entity handles stored in fields
+   * described by component metadata are remapped. Other components are copied
+   * as they are. Every component type of world must be registered with the
+   * same size in the target world. Entities waiting to be destroyed are left
+   * out. world itself is left untouched.
+   * out_entities (LDKEntity) is optional and receives the new entities.
+   */
+  LDK_API bool ldk_ecs_world_merge(LDKECS* world, XArray* out_entities);
+
+  // ---------------------------------------------------------------------------
+  // Deferred commands
+  // ---------------------------------------------------------------------------
+  /**
+   * Returns the command buffer of a recording thread. Buffers are played back in
+   * index order after each system bucket.
+   */
+  LDK_API LDKECSCommandBuffer* ldk_ecs_command_buffer_get(u32 thread_index);
+
   // ---------------------------------------------------------------------------
   // System management
   // ---------------------------------------------------------------------------
@@ -61,10 +211,13 @@ extern "C" {
   LDK_API LDKEntityRegistry* ldk_ecs_entity_registry_get(void);
   LDK_API LDKComponentRegistry* ldk_ecs_component_registry_get(void);
   LDK_API LDKSystemRegistry* ldk_ecs_system_registry_get(void);
+  LDK_API LDKScenegraph* ldk_ecs_scenegraph_get(void);
 
   LDK_API bool ldk_ecs_system_registry_start(LDKECS* context);
   LDK_API bool ldk_ecs_system_bucket_run(LDKECS* context, LDKSystemBucket bucket, float delta_time);
   LDK_API bool ldk_ecs_system_registry_stop(LDKECS* context);
+  LDK_API bool ldk_ecs_command_buffers_playback(LDKECS* context);
+  LDK_API u32 ldk_ecs_entity_destroy_pending(LDKECS* context);
 #endif
 
 #ifdef __cplusplus
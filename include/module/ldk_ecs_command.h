@@ -0,0 +1,105 @@
+/**
+ * @file   ldk_ecs_command.h
+ * @brief  Deferred ECS command buffers
+ *
+ * A command buffer records structural changes (entity create/destroy and
+ * component add/remove/set) and applies them later, at a sync point, where no
+ * system is iterating component stores.
+ *
+ * Component values are copied into the buffer arena when the command is
+ * recorded, so callers may pass stack values.
+ *
+ * Entities created through a command buffer get a pending handle that is only
+ * meaningful to commands recorded on the same buffer. It is resolved to a real
+ * entity during playback.
+ *
+ * A command buffer has a single writer. To record from several threads use one
+ * buffer per thread: the ECS owns LDK_ECS_COMMAND_BUFFER_COUNT buffers that are
+ * played back in index order after each system bucket.
+ */
+
+#ifndef LDK_ECS_COMMAND_H
+#define LDK_ECS_COMMAND_H
+
+#include <ldk_common.h>
+#include <module/ldk_entity.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_arena.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LDK_ECS_COMMAND_BUFFER_COUNT
+#define LDK_ECS_COMMAND_BUFFER_COUNT 16
+#endif
+
+#ifndef LDK_ECS_COMMAND_ARENA_SIZE
+#define LDK_ECS_COMMAND_ARENA_SIZE (16 * 1024)
+#endif
+
+#define LDK_ECS_COMMAND_PENDING_VERSION UINT32_MAX
+
+struct LDKECS;
+
+typedef enum LDKECSCommandType
+{
+  LDK_ECS_COMMAND_ENTITY_CREATE = 0,
+  LDK_ECS_COMMAND_ENTITY_DESTROY,
+  LDK_ECS_COMMAND_COMPONENT_ADD,
+  LDK_ECS_COMMAND_COMPONENT_REMOVE,
+  LDK_ECS_COMMAND_COMPONENT_SET
+} LDKECSCommandType;
+
+typedef struct LDKECSCommand
+{
+  u32 type;             // LDKECSCommandType
+  u32 component_type;
+  LDKEntity entity;     // Real or pending entity
+  void* value;          // Arena copy of the component value, may be NULL
+} LDKECSCommand;
+
+typedef struct LDKECSCommandBuffer
+{
+  LDKComponentRegistry* components; // Used to size component values
+  XArena* arena;
+  XArray* commands;     // LDKECSCommand
+  XArray* created;      // LDKEntity, pending index -> real entity. Used during playback.
+  u32 pending_count;
+} LDKECSCommandBuffer;
+
+LDK_API bool ldk_ecs_command_buffer_initialize(LDKECSCommandBuffer* buffer, LDKComponentRegistry* components);
+LDK_API void ldk_ecs_command_buffer_terminate(LDKECSCommandBuffer* buffer);
+LDK_API void ldk_ecs_command_buffer_clear(LDKECSCommandBuffer* buffer);
+LDK_API u32 ldk_ecs_command_buffer_count(LDKECSCommandBuffer* buffer);
+
+/**
+ * Applies all recorded commands in order and clears the buffer.
+ * Commands that can not be applied (dead entity, missing component...) are skipped.
+ * Returns false if any command was skipped.
+ */
+LDK_API bool ldk_ecs_command_buffer_playback(LDKECSCommandBuffer* buffer, struct LDKECS* context);
+
+/**
+ * Records the creation of an entity with a Transform and returns its pending handle.
+ */
+LDK_API LDKEntity ldk_ecs_command_entity_create(LDKECSCommandBuffer* buffer);
+LDK_API bool ldk_ecs_command_entity_is_pending(LDKEntity entity);
+/**
+ * Records the destruction of an entity. Playback marks it like
+ * ldk_ecs_entity_destroy(), it stays alive until the end-of-frame sweep.
+ */
+LDK_API bool ldk_ecs_command_entity_destroy(LDKECSCommandBuffer* buffer, LDKEntity entity);
+
+/**
+ * Tag types are accepted too. Pass a NULL initial_value for them.
+ */
+LDK_API bool ldk_ecs_command_component_add(LDKECSCommandBuffer* buffer, LDKEntity entity, u32 component_type, const void* initial_value);
+LDK_API bool ldk_ecs_command_component_remove(LDKECSCommandBuffer* buffer, LDKEntity entity, u32 component_type);
+LDK_API bool ldk_ecs_command_component_set(LDKECSCommandBuffer* buffer, LDKEntity entity, u32 component_type, const void* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDK_ECS_COMMAND_H
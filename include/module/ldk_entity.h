@@ -11,20 +11,28 @@
 #include <ldk_common.h>
 #include <stdx/stdx_common.h>
 #include <stdx/stdx_hpool.h>
+#include <stdx/stdx_array.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#ifndef LDK_ENTITY_MAX_COMPONENTS
-#define LDK_ENTITY_MAX_COMPONENTS 16
+#ifndef LDK_ENTITY_INLINE_COMPONENTS
+#define LDK_ENTITY_INLINE_COMPONENTS 8 // Directory entries stored inline before spilling to the heap
 #endif
 
 #ifndef LDK_ENTITY_NAME_MAX_LEN
 #define LDK_ENTITY_NAME_MAX_LEN   32
 #endif
 
+#ifndef LDK_COMPONENT_MAX_TYPES
+#define LDK_COMPONENT_MAX_TYPES   256
+#endif
+
+#define LDK_COMPONENT_MASK_WORDS  ((LDK_COMPONENT_MAX_TYPES + 63) / 64)
+
 #define LDK_ENTITY_INVALID_COMPONENT_INDEX UINT32_MAX
+#define LDK_ENTITY_ARCHETYPE_COMPONENT_INDEX (UINT32_MAX - 1) // Directory index of archetype-stored components. The actual row lives in LDKEntityInfo.
 
 typedef XHandle LDKEntity;
 typedef struct LDKComponentRegistry LDKComponentRegistry;
@@ -54,15 +62,113 @@ typedef enum LDKBuiltinComponentType
 
 /**
  * A list of all components and component types in an entity.
+ * Entries are kept sorted by component slot so the position of a component is
+ * the number of signature bits below its slot. There is no upper limit on the
+ * number of components; entries spill to the heap once the inline storage is full.
+ * Use ldk_component_directory_types/indices to access the entries.
  */
 typedef struct LDKComponentDirectory
 {
-  u32 component_type[LDK_ENTITY_MAX_COMPONENTS];
-  u32 component_index[LDK_ENTITY_MAX_COMPONENTS];
+  u32 inline_type[LDK_ENTITY_INLINE_COMPONENTS];
+  u32 inline_index[LDK_ENTITY_INLINE_COMPONENTS];
+  u32* heap;              // [capacity types][capacity indices], NULL while inline
+  u16 capacity;
   u16 component_count;
   u16 version;
 } LDKComponentDirectory;
 
+static X_INLINE u32* ldk_component_directory_types(LDKComponentDirectory* directory)
+{
+  return directory->heap ? directory->heap : directory->inline_type;
+}
+
+static X_INLINE u32* ldk_component_directory_indices(LDKComponentDirectory* directory)
+{
+  return directory->heap ? directory->heap + directory->capacity : directory->inline_index;
+}
+
+/**
+ * One bit per component slot. Used as the entity signature and
+ * as the required set of a query.
+ */
+typedef struct LDKComponentMask
+{
+  u64 bits[LDK_COMPONENT_MASK_WORDS];
+} LDKComponentMask;
+
+static X_INLINE void ldk_component_mask_set(LDKComponentMask* mask, u32 bit)
+{
+  mask->bits[bit >> 6] |= (u64)1 << (bit & 63);
+}
+
+static X_INLINE void ldk_component_mask_clear(LDKComponentMask* mask, u32 bit)
+{
+  mask->bits[bit >> 6] &= ~((u64)1 << (bit & 63));
+}
+
+static X_INLINE bool ldk_component_mask_test(const LDKComponentMask* mask, u32 bit)
+{
+  return (mask->bits[bit >> 6] & ((u64)1 << (bit & 63))) != 0;
+}
+
+static X_INLINE u32 ldk_popcount64(u64 value)
+{
+#if defined(X_COMPILER_GCC) || defined(X_COMPILER_CLANG)
+  return (u32)__builtin_popcountll(value);
+#else
+  value = value - ((value >> 1) & 0x5555555555555555ull);
+  value = (value & 0x3333333333333333ull) + ((value >> 2) & 0x3333333333333333ull);
+  value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+  return (u32)((value * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+/* Number of bits set below bit */
+static X_INLINE u32 ldk_component_mask_rank(const LDKComponentMask* mask, u32 bit)
+{
+  u32 word = bit >> 6;
+  u32 rank = ldk_popcount64(mask->bits[word] & (((u64)1 << (bit & 63)) - 1));
+  u32 i;
+
+  for (i = 0; i < word; ++i)
+  {
+    rank += ldk_popcount64(mask->bits[i]);
+  }
+
+  return rank;
+}
+
+/* Number of bits set below bit, ignoring the bits set in exclude */
+static X_INLINE u32 ldk_component_mask_rank_excluding(const LDKComponentMask* mask, const LDKComponentMask* exclude, u32 bit)
+{
+  u32 word = bit >> 6;
+  u32 rank = ldk_popcount64(mask->bits[word] & ~exclude->bits[word] & (((u64)1 << (bit & 63)) - 1));
+  u32 i;
+
+  for (i = 0; i < word; ++i)
+  {
+    rank += ldk_popcount64(mask->bits[i] & ~exclude->bits[i]);
+  }
+
+  return rank;
+}
+
+/* True if every bit of required is also set in mask */
+static X_INLINE bool ldk_component_mask_contains(const LDKComponentMask* mask, const LDKComponentMask* required)
+{
+  u32 i;
+
+  for (i = 0; i < LDK_COMPONENT_MASK_WORDS; ++i)
+  {
+    if ((mask->bits[i] & required->bits[i]) != required->bits[i])
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 /**
  * Stable reference to a component through its owning entity.
  */
@@ -73,22 +179,43 @@ typedef struct LDKComponentRef
   u16 slot_index;
 } LDKComponentRef;
 
+/**
+ * Hot per-entity data. Lives in the entity pool and is what iteration and
+ * queries touch, so keep it small.
+ */
 typedef struct LDKEntityInfo
 {
-  LDKComponentDirectory components;
+  LDKComponentMask mask; // Bit per component slot (see ldk_component_slot_get)
   u32 transform_index; // Transform is a special component. An entity always have a transform.
+  u32 archetype;       // LDK_ARCHETYPE_NONE when the entity has no archetype-stored components
+  u32 archetype_row;
   u16 internal_flags;
   u16 flags;
+} LDKEntityInfo;
+
+/**
+ * Cold per-entity data. Only needed to resolve a component index or a name, so
+ * it is kept out of the entity pool in pages indexed by the entity handle index.
+ */
+typedef struct LDKEntityColdInfo
+{
+  LDKComponentDirectory components;
 #if defined(_DEBUG) || defined(LDK_EDITOR)
   u8 name[LDK_ENTITY_NAME_MAX_LEN];
 #endif
-} LDKEntityInfo;
+} LDKEntityColdInfo;
 
 typedef bool (*LDKEntityIterFn)(LDKEntity entity, LDKEntityInfo* info, void* user);
 
 typedef struct LDKEntityRegistry
 {
   XHPool pool;
+  LDKEntityColdInfo** cold_pages;   // Same page capacity as the pool. Pages never move.
+  u32 cold_page_count;
+  LDKComponentRegistry* components; // Bound on first component add. Resolves component types to slots.
+  XArray* pending_destroy;          // LDKEntity, marked by ldk_entity_destroy_deferred()
+  XArray* sweep_entities;           // LDKEntity, the list being swept by ldk_entity_destroy_pending()
+  XArray* sweep_indices;            // u32 scratch of ldk_entity_destroy_pending()
 } LDKEntityRegistry;
 
 typedef struct LDKTransform LDKTransform;
@@ -98,9 +225,39 @@ LDK_API void ldk_entity_module_terminate(LDKEntityRegistry* system);
 LDK_API void ldk_entity_module_clear(LDKEntityRegistry* system);
 LDK_API LDKEntity ldk_entity_create(LDKEntityRegistry* system);
 LDK_API void ldk_entity_destroy(LDKEntityRegistry* system, LDKEntity entity);
+
+/**
+ * Creates count entities. The cold info page table is grown once for the whole
+ * batch; entity slots still come from the pool one at a time.
+ * Returns how many were created.
+ */
+LDK_API u32 ldk_entity_create_batch(LDKEntityRegistry* system, LDKEntity* out_entities, u32 count);
+
+/**
+ * Convenience loop over ldk_entity_destroy(). Dead handles are skipped.
+ * Components are not removed, see ldk_entity_destroy_pending() for that.
+ */
+LDK_API void ldk_entity_destroy_batch(LDKEntityRegistry* system, const LDKEntity* entities, u32 count);
+
+/**
+ * Marks entity with LDK_ENTITY_INTERNAL_PENDING_DELETE. It stays alive, with
+ * all its components, until the next ldk_entity_destroy_pending(). Returns
+ * false if it is not alive or already marked.
+ */
+LDK_API bool ldk_entity_destroy_deferred(LDKEntityRegistry* system, LDKEntity entity);
+LDK_API u32 ldk_entity_pending_destroy_count(LDKEntityRegistry* system);
+
+/**
+ * Destroys every marked entity with all its components. Removals are grouped
+ * per component type, from the highest slot down: all destroy callbacks of a
+ * type run first, then its store is compacted once. Entities marked while the
+ * sweep runs are left for the next one. Returns how many entities were destroyed.
+ */
+LDK_API u32 ldk_entity_destroy_pending(LDKEntityRegistry* system, LDKComponentRegistry* component_system);
 LDK_API bool ldk_entity_is_alive(LDKEntityRegistry* system, LDKEntity entity);
 LDK_API LDKEntityInfo* ldk_entity_info_get(LDKEntityRegistry* system, LDKEntity entity);
 LDK_API const LDKEntityInfo* ldk_entity_get_info_const(LDKEntityRegistry* system, LDKEntity entity);
+LDK_API LDKEntityColdInfo* ldk_entity_cold_info_get(LDKEntityRegistry* system, LDKEntity entity);
 LDK_API u32 ldk_entity_alive_count(LDKEntityRegistry* system);
 LDK_API void ldk_entity_flags_set(LDKEntityRegistry* system, LDKEntity entity, u16 flags);
 LDK_API u16 ldk_entity_flags_get(LDKEntityRegistry* system, LDKEntity entity);
@@ -120,15 +277,55 @@ LDK_API LDKTransform* ldk_entity_transform_get(LDKEntityRegistry* entity_module,
 LDK_API const LDKTransform* ldk_entity_transform_get_const(LDKEntityRegistry* entity_module,
     LDKComponentRegistry* component_module, LDKEntity entity);
 
+/**
+ * True for any component the entity owns, tags included.
+ */
 LDK_API bool ldk_entity_component_has(LDKEntityRegistry* system, LDKEntity entity, u32 component_type);
 LDK_API bool ldk_component_ref_is_valid(LDKEntityRegistry* system, LDKComponentRef ref);
 LDK_API void ldk_entity_foreach(LDKEntityRegistry* system, LDKEntityIterFn fn, void* user);
 LDK_API bool ldk_entity_component_ref_get(LDKEntityRegistry* system, LDKEntity entity, u32 component_type, LDKComponentRef* out_ref);
+/**
+ * Resolves the directory position and the component index. Tags have no
+ * directory entry so this returns false for them.
+ */
 LDK_API bool ldk_entity_component_find(LDKEntityRegistry* system, LDKEntity entity, u32 component_type, u32* out_slot, u32* out_component_index);
 LDK_API void* ldk_component_ref_get(LDKEntityRegistry* entity_system, struct LDKComponentRegistry* component_registry, LDKComponentRef ref);
 LDK_API const void* ldk_component_ref_get_const(LDKEntityRegistry* entity_system, struct LDKComponentRegistry* component_registry, LDKComponentRef ref);
+/**
+ * Returns NULL for tag types, they have no data. Use ldk_entity_tag_add.
+ */
 LDK_API void* ldk_entity_component_add(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type, const void* initial_value);
+
+/**
+ * Sets or clears the bit of a tag component. ldk_entity_component_remove also
+ * removes tags. Returns false if the type is not a tag or nothing changed.
+ */
+LDK_API bool ldk_entity_tag_add(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 tag_type);
+LDK_API bool ldk_entity_tag_remove(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 tag_type);
+/**
+ * Mutable access marks the component as changed (see ldk_component.h). Use the
+ * const variant to read without touching the change tick.
+ */
 LDK_API void* ldk_entity_component_get(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type);
+LDK_API const void* ldk_entity_component_get_const(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type);
+
+/**
+ * Enables or disables a packed or paged component in place (see ldk_component.h).
+ * Disabled components are still owned and accessible but skipped by queries.
+ * Archetype and tag types return false.
+ */
+LDK_API bool ldk_entity_component_enabled_set(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type, bool enabled);
+LDK_API bool ldk_entity_component_is_enabled(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type);
+
+/**
+ * Adds component_type to every entity. The store grows once and initial_values,
+ * when not NULL, holds count packed values. Attach callbacks run after all
+ * components were added. Dead entities and entities that already own the
+ * component are skipped. Tag types only set the bit on every entity.
+ * Returns the number of components added.
+ */
+LDK_API u32 ldk_entity_component_add_batch(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module,
+    const LDKEntity* entities, u32 count, u32 component_type, const void* initial_values);
 LDK_API bool ldk_entity_component_remove(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type);
 
 typedef struct LDKEntityIterator
@@ -143,10 +340,34 @@ LDK_API LDKEntityIterator ldk_entity_iterator_begin(LDKEntityRegistry* registry)
 LDK_API bool ldk_entity_iterator_next(LDKEntityIterator* iterator, LDKEntity* out_entity);
 LDK_API void ldk_entity_iterator_end(LDKEntityIterator* iterator);
 
+/**
+ * Raw copy of the entity pool and cold pages. Restoring brings back the exact
+ * same handles and versions, so handles stored in components stay valid.
+ * Zero initialize before the first capture. Capturing again reuses its memory.
+ */
+typedef struct LDKEntitySnapshot
+{
+  XHPool pool;
+  LDKEntityColdInfo** cold_pages;   // Directories spilled to the heap are deep copies
+  u32 cold_page_count;
+} LDKEntitySnapshot;
+
+LDK_API bool ldk_entity_snapshot_capture(LDKEntityRegistry* registry, LDKEntitySnapshot* snapshot);
+
+/**
+ * Brings the registry back to the captured state. Nothing is called for the
+ * entities that go away or come back. Cached queries must be rebuilt after.
+ */
+LDK_API bool ldk_entity_snapshot_restore(LDKEntityRegistry* registry, LDKEntitySnapshot* snapshot);
+LDK_API void ldk_entity_snapshot_release(LDKEntitySnapshot* snapshot);
+
 #ifdef LDK_ENGINE
 LDK_API void ldk_entity_internal_flags_set(LDKEntityRegistry* system, LDKEntity entity, u16 flags);
 LDK_API void ldk_entity_internal_flags_add(LDKEntityRegistry* system, LDKEntity entity, u16 flags);
 LDK_API void ldk_entity_internal_flags_remove(LDKEntityRegistry* system, LDKEntity entity, u16 flags);
+
+/* Points the directory entry of component_type to a new store index. Used when a store moves components. */
+LDK_API bool ldk_entity_component_index_set(LDKEntityRegistry* system, LDKEntity entity, u32 component_type, u32 component_index);
 #endif// LDK_ENGINE
 
 #ifdef __cplusplus
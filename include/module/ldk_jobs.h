@@ -0,0 +1,111 @@
+/**
+ * @file   ldk_jobs.h
+ * @brief  Work-stealing job system
+ *
+ * A fixed pool of workers, each owning a job deque. A worker pushes and pops
+ * jobs at the bottom of its own deque (LIFO) and, when it runs dry, steals
+ * from the top of the other deques (FIFO).
+ *
+ * Worker 0 is the thread that initialized the job system (the main thread).
+ * It has no dedicated OS thread: it runs jobs while it waits on a counter.
+ *
+ * Jobs may only be submitted from the main thread or from inside a job. Jobs
+ * submitted from any other thread run immediately on the caller.
+ *
+ * The worker index is stable for the duration of a job and is always lower
+ * than LDK_JOBS_MAX_WORKERS, so it can be used to pick per-thread resources
+ * such as the ECS command buffers.
+ */
+
+#ifndef LDK_JOBS_H
+#define LDK_JOBS_H
+
+#include <ldk_common.h>
+#include <ldk_os.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LDK_JOBS_MAX_WORKERS
+#define LDK_JOBS_MAX_WORKERS 16
+#endif
+
+// Must be a power of two. Jobs pushed to a full deque run immediately.
+#ifndef LDK_JOBS_QUEUE_CAPACITY
+#define LDK_JOBS_QUEUE_CAPACITY 4096
+#endif
+
+#define LDK_JOBS_INVALID_WORKER UINT32_MAX
+
+typedef void (*LDKJobFn)(void* user, u32 worker_index);
+typedef void (*LDKJobRangeFn)(void* user, u32 begin, u32 end, u32 worker_index);
+
+/**
+ * Counts unfinished jobs. Incremented when jobs are submitted and decremented
+ * as each of them finishes. Zero initialize before use.
+ */
+typedef struct LDKJobCounter
+{
+  volatile i32 value;
+} LDKJobCounter;
+
+typedef struct LDKJobDesc
+{
+  LDKJobFn fn;
+  void* user;
+  LDKJobCounter* dependency;  // Optional. The job does not start before this counter reaches zero.
+} LDKJobDesc;
+
+struct LDKJobQueue;
+
+typedef struct LDKJobSystem
+{
+  struct LDKJobQueue* queues;   // One per worker
+  LDKThread threads[LDK_JOBS_MAX_WORKERS];
+  LDKSemaphore wake;
+  u32 worker_count;             // Including the main thread
+  volatile i32 running;
+  volatile i32 sleeping;        // Workers waiting on the wake semaphore
+} LDKJobSystem;
+
+/**
+ * Starts worker_count - 1 worker threads. A worker_count of 0 uses one worker per CPU.
+ */
+LDK_API bool ldk_jobs_initialize(LDKJobSystem* system, u32 worker_count);
+
+/**
+ * Runs any job still queued, then stops and joins the worker threads.
+ */
+LDK_API void ldk_jobs_terminate(LDKJobSystem* system);
+LDK_API u32 ldk_jobs_worker_count(const LDKJobSystem* system);
+
+/**
+ * Returns the worker index of the calling thread or LDK_JOBS_INVALID_WORKER if
+ * the thread does not belong to this job system.
+ */
+LDK_API u32 ldk_jobs_worker_index(const LDKJobSystem* system);
+
+/**
+ * Queues count jobs on the calling worker. When counter is not NULL, it is
+ * incremented by count before any job is queued.
+ */
+LDK_API void ldk_jobs_run(LDKJobSystem* system, const LDKJobDesc* jobs, u32 count, LDKJobCounter* counter);
+LDK_API bool ldk_jobs_is_done(const LDKJobCounter* counter);
+
+/**
+ * Runs queued jobs on the calling thread until counter reaches zero.
+ */
+LDK_API void ldk_jobs_wait(LDKJobSystem* system, LDKJobCounter* counter);
+
+/**
+ * Splits [0, count) into ranges of batch_size indices, runs them as jobs and
+ * waits for all of them. A batch_size of 0 picks one based on the worker count.
+ */
+LDK_API void ldk_jobs_parallel_for(LDKJobSystem* system, u32 count, u32 batch_size, LDKJobRangeFn fn, void* user);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDK_JOBS_H
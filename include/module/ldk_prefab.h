@@ -0,0 +1,87 @@
+/**
+ * @file   ldk_prefab.h
+ * @brief  Prefab templates
+ *
+ * A prefab is a small tree of nodes, each with a set of components and their
+ * initial values. Instantiating a prefab N times creates every entity in one
+ * batch and fills each component type with a single batched add, so values are
+ * copied in bulk and attach callbacks run back to back per type.
+ *
+ * Values are grouped in one column per component type, ordered by slot, so new
+ * entities get their directory entries appended in order.
+ *
+ * Nodes with a Transform are linked to the Transform of their parent node. The
+ * parent, child and sibling handles of captured transforms are never copied.
+ */
+
+#ifndef LDK_PREFAB_H
+#define LDK_PREFAB_H
+
+#include <ldk_common.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <stdx/stdx_array.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LDK_PREFAB_NO_PARENT UINT32_MAX
+
+typedef struct LDKPrefabColumn
+{
+  u32 component_type;
+  u32 slot;
+  u32 entry_size;     // 0 for tags
+  XArray* nodes;      // u32, ascending node indices that own this component
+  XArray* values;     // entry_size bytes per node, parallel to nodes. NULL for tags.
+} LDKPrefabColumn;
+
+typedef struct LDKPrefab
+{
+  XArray* parents;    // u32 per node. Parents always come before their children.
+  XArray* flags;      // u16 per node, user entity flags
+  XArray* columns;    // LDKPrefabColumn, ordered by slot
+} LDKPrefab;
+
+LDK_API bool ldk_prefab_initialize(LDKPrefab* prefab);
+LDK_API void ldk_prefab_terminate(LDKPrefab* prefab);
+LDK_API void ldk_prefab_clear(LDKPrefab* prefab);
+LDK_API u32 ldk_prefab_node_count(const LDKPrefab* prefab);
+
+/**
+ * Appends a node and returns its index. parent_node must be an existing node
+ * or LDK_PREFAB_NO_PARENT. Returns LDK_PREFAB_NO_PARENT on failure.
+ */
+LDK_API u32 ldk_prefab_node_add(LDKPrefab* prefab, u32 parent_node, u16 flags);
+
+/**
+ * Sets the initial value of a component on a node, adding the component if
+ * needed. value is copied. A NULL value zero fills it, or for a Transform sets
+ * the default transform. Tags take no value.
+ */
+LDK_API bool ldk_prefab_component_set(LDKPrefab* prefab, LDKComponentRegistry* component_registry,
+    u32 node, u32 component_type, const void* value);
+
+/**
+ * Clears the prefab and captures root, its components and, following its
+ * Transform, all of its descendants. Returns false if root is not alive.
+ */
+LDK_API bool ldk_prefab_capture(LDKPrefab* prefab, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, LDKEntity root);
+
+/**
+ * Creates count instances of the prefab. out_roots is optional and receives the
+ * entity of node 0 of each instance. Returns how many instances were created.
+ * If any component can not be added, e.g. its type is not registered or its
+ * attach callback fails, every entity created by the call is destroyed and 0
+ * is returned.
+ */
+LDK_API u32 ldk_prefab_instantiate(const LDKPrefab* prefab, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, u32 count, LDKEntity* out_roots);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDK_PREFAB_H
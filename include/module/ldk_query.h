@@ -0,0 +1,126 @@
+/**
+ * @file   ldk_query.h
+ * @brief  Cached multi-component queries
+ *
+ * A query matches every entity that owns all of its component types. Matching
+ * is done with component bitsets: each entity keeps a signature mask and each
+ * query keeps the mask of its terms.
+ *
+ * Queries are cached by term list and reference counted. Queries with the
+ * same terms in a different order share one matched entity list, which is
+ * updated incrementally whenever an entity gains or loses a component, so
+ * iterating a query only touches matching entities. The list also caches the
+ * store index of each packed or paged term; iteration revalidates it against
+ * the store owners and refreshes it, so a query must not be iterated from
+ * several threads at once.
+ *
+ * Iteration yields batches of up to LDK_QUERY_BATCH_SIZE entities with one
+ * array of component pointers (and component indices) per term, in the order
+ * the terms were given at creation.
+ *
+ * Entities with a disabled component in any term stay matched, so they are
+ * counted by ldk_query_count, but iteration skips them.
+ *
+ * An iterator can be filtered on the change ticks of one term to only yield
+ * entities whose component was changed or added since a given tick.
+ *
+ * Queries are owned by the component registry.
+ */
+
+#ifndef LDK_QUERY_H
+#define LDK_QUERY_H
+
+#include <ldk_common.h>
+#include <module/ldk_entity.h>
+#include <stdx/stdx_array.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LDK_QUERY_MAX_TERMS
+#define LDK_QUERY_MAX_TERMS   8
+#endif
+
+#ifndef LDK_QUERY_BATCH_SIZE
+#define LDK_QUERY_BATCH_SIZE  64
+#endif
+
+#define LDK_QUERY_INVALID UINT32_MAX
+
+typedef u32 LDKQuery;
+
+typedef enum LDKQueryFilter
+{
+  LDK_QUERY_FILTER_NONE = 0,
+  LDK_QUERY_FILTER_CHANGED,   // Component of the filter term changed since the filter tick
+  LDK_QUERY_FILTER_ADDED      // Component of the filter term added since the filter tick
+} LDKQueryFilter;
+
+typedef struct LDKQueryBatch
+{
+  u32 count;
+  u32 term_count;
+  LDKEntity entities[LDK_QUERY_BATCH_SIZE];
+  void* components[LDK_QUERY_MAX_TERMS][LDK_QUERY_BATCH_SIZE];
+  u32 indices[LDK_QUERY_MAX_TERMS][LDK_QUERY_BATCH_SIZE]; // Store index (packed) or archetype row
+} LDKQueryBatch;
+
+typedef struct LDKQueryIter
+{
+  LDKEntityRegistry* entity_registry;
+  LDKComponentRegistry* component_registry;
+  LDKQuery query;
+  u32 cursor;
+  LDKQueryFilter filter;
+  u32 filter_term;
+  u32 filter_tick;
+} LDKQueryIter;
+
+typedef struct LDKQueryRegistry
+{
+  XArray* queries;      // LDKQueryState*, indexed by LDKQuery. NULL for released queries.
+  XArray* matches;      // LDKQueryMatch*, matched entities shared by queries with the same set of terms
+} LDKQueryRegistry;
+
+LDK_API bool ldk_query_registry_initialize(LDKQueryRegistry* registry);
+LDK_API void ldk_query_registry_terminate(LDKQueryRegistry* registry);
+
+/**
+ * Keeps every live query in sync with the entity signature.
+ * Called by the entity module whenever a component is added or removed.
+ */
+LDK_API void ldk_query_registry_entity_changed(LDKQueryRegistry* registry, LDKEntity entity, const LDKComponentMask* mask);
+
+/**
+ * Repopulates every live query from scratch. Used after the entity registry was
+ * replaced wholesale, e.g. when a snapshot is restored.
+ */
+LDK_API void ldk_query_registry_rebuild(LDKQueryRegistry* registry, LDKEntityRegistry* entity_registry);
+
+/**
+ * Returns a query matching all component_types. If an identical query already
+ * exists its reference count is incremented and it is returned instead.
+ * Returns LDK_QUERY_INVALID if a type is not registered or there are too many terms.
+ */
+LDK_API LDKQuery ldk_query_create(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const u32* component_types, u32 component_count);
+LDK_API void ldk_query_destroy(LDKComponentRegistry* component_registry, LDKQuery query);
+LDK_API u32 ldk_query_count(LDKComponentRegistry* component_registry, LDKQuery query);
+LDK_API const LDKEntity* ldk_query_entities(LDKComponentRegistry* component_registry, LDKQuery query);
+
+LDK_API LDKQueryIter ldk_query_iter_begin(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry, LDKQuery query);
+LDK_API bool ldk_query_iter_next(LDKQueryIter* iter, LDKQueryBatch* out_batch);
+
+/**
+ * Restricts the iterator to entities whose component at term (index in the
+ * query term list) passes filter since tick. Packed and paged terms carry
+ * change ticks: archetype and tag terms never pass a filter.
+ */
+LDK_API void ldk_query_iter_filter_set(LDKQueryIter* iter, LDKQueryFilter filter, u32 term, u32 tick);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDK_QUERY_H
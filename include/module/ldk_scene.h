@@ -0,0 +1,103 @@
+/**
+ * @file   ldk_scene.h
+ * @brief  Binary scene files
+ *
+ * A scene file stores a set of entities and their components so it can be
+ * memory mapped and copied into the component stores in bulk.
+ *
+ * Components are grouped in one block per component type. A block holds the
+ * scene index of every owner, then their values packed back to back exactly
+ * as they are laid out in memory. A table of contents at the end of the file
+ * lists every block. Blocks are ordered by component slot, and owners by scene
+ * index, so entities get their directory entries appended in order on load.
+ *
+ * Component metadata decides what is saved: only types with an LDKComponentMeta
+ * are written, and their LDK_FIELD_ENTITY fields are listed in the block as a
+ * handle remapping table. Entity handles are stored as scene indices and turned
+ * back into live handles on load. Handles to entities outside the scene are
+ * saved as null. Blocks without entity fields are added straight from the file.
+ *
+ * Every section starts at a multiple of LDK_SCENE_ALIGNMENT bytes from the start
+ * of the file. Values are stored in the byte order of the machine that saved them.
+ */
+
+#ifndef LDK_SCENE_H
+#define LDK_SCENE_H
+
+#include <ldk_common.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <editor/ldk_component_metadata.h>
+#include <stdx/stdx_array.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LDK_SCENE_MAGIC     0x534B444Cu // "LDKS"
+#define LDK_SCENE_VERSION   1
+#define LDK_SCENE_ALIGNMENT 16
+
+typedef struct LDKSceneHeader
+{
+  u32 magic;
+  u32 version;
+  u32 entity_count;
+  u32 block_count;
+  u64 size;           // Size of the whole file
+  u64 flags_offset;   // u16 per entity, user entity flags
+  u64 toc_offset;     // LDKSceneBlock per block
+} LDKSceneHeader;
+
+typedef struct LDKSceneBlock
+{
+  u32 component_type;
+  u32 entry_size;     // 0 for tags
+  u32 count;
+  u32 fixup_count;
+  u64 owners_offset;  // u32 per component, ascending scene indices of the owners
+  u64 data_offset;    // count * entry_size bytes. Unused for tags.
+  u64 fixups_offset;  // u32 per LDK_FIELD_ENTITY field, its byte offset inside an entry
+} LDKSceneBlock;
+
+/**
+ * Serializes entities into out (u8), replacing its contents. The position of an
+ * entity in entities is its scene index. Only components of types listed in
+ * metas are written. Fails if a meta size does not match the registered type.
+ */
+LDK_API bool ldk_scene_write(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const LDKEntity* entities, u32 entity_count, const LDKComponentMeta* const* metas, u32 meta_count, XArray* out);
+
+LDK_API bool ldk_scene_save(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const LDKEntity* entities, u32 entity_count, const LDKComponentMeta* const* metas, u32 meta_count, const char* path);
+
+/**
+ * Checks that data holds a scene of this version and that every section and
+ * index lies inside it. Loading validates first.
+ */
+LDK_API bool ldk_scene_validate(const void* data, size_t size);
+
+/**
+ * Creates the entities of the scene and adds their components. out_entities
+ * (LDKEntity) is optional and receives the new entities in scene order.
+ * Blocks of types that are not registered or whose size changed are skipped
+ * with a warning. Saved flags are restored with ldk_entity_flags_set(); the
+ * internal flags of loaded entities always start cleared. Attach callbacks run
+ * as usual and see remapped entity handles. Returns false when a block could not be added; the
+ * entities are still created and listed in out_entities so the caller can
+ * destroy them.
+ */
+LDK_API bool ldk_scene_load_memory(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const void* data, size_t size, XArray* out_entities);
+
+/**
+ * Maps the file and loads it with ldk_scene_load_memory().
+ */
+LDK_API bool ldk_scene_load(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const char* path, XArray* out_entities);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDK_SCENE_H
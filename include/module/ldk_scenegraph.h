@@ -1,19 +1,148 @@
+/**
+ * @file   ldk_scenegraph.h
+ * @brief  Transform hierarchy update.
+ *
+ * The scenegraph keeps a flat array of transform nodes in which every parent
+ * comes before its children, with each node pointing at its parent by array
+ * index. A full update walks that array one depth level at a time, so it
+ * never follows first_child/next_sibling links or resolves parent handles.
+ *
+ * The array is kept up to date incrementally: Transform attach appends a root,
+ * Transform destroy leaves a hole that is compacted later, and reparenting
+ * only moves the reparented subtree when its new parent comes after it.
+ * Links that do not match the array (scene loads, snapshots) are detected on
+ * the nodes the update visits and the array is rebuilt once from the links.
+ * Code that writes the links directly must call ldk_scenegraph_invalidate().
+ *
+ * Transforms whose local state changed are queued on a dirty list by the
+ * Transform helpers. Usually only the subtrees of those transforms are
+ * updated. New or rebuilt arrays and long dirty lists update every node.
+ *
+ * With a job system and at least LDK_SCENEGRAPH_PARALLEL_MIN nodes each level
+ * is split across the workers. A node only reads its parent, which belongs to
+ * the previous level, so the result does not depend on the scheduling.
+ *
+ * Nodes of the same depth are gathered and their world matrices computed in
+ * batches by ldk_scenegraph_compose(), which takes its inputs as separate
+ * component arrays and uses SSE2 when available.
+ */
+
 #ifndef LDK_MODULE_SCENEGRAPH_H
 #define LDK_MODULE_SCENEGRAPH_H
 
 #include <ldk_common.h>
 #include <module/ldk_entity.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_math.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define LDK_SCENEGRAPH_NO_PARENT UINT32_MAX
+
+#ifndef LDK_SCENEGRAPH_PARALLEL_MIN
+#define LDK_SCENEGRAPH_PARALLEL_MIN 4096  // Smaller hierarchies are updated on the calling thread
+#endif
+
+#ifndef LDK_SCENEGRAPH_JOB_BATCH
+#define LDK_SCENEGRAPH_JOB_BATCH 512      // Nodes per job. Smaller levels run on the calling thread
+#endif
+
+#ifndef LDK_SCENEGRAPH_COMPOSE_BATCH
+#define LDK_SCENEGRAPH_COMPOSE_BATCH 64   // Transforms gathered before a batch is composed
+#endif
+
+  struct LDKJobSystem;
+
+  typedef struct LDKScenegraphNode
+  {
+    LDKEntity entity;     // Null for a removed node waiting to be compacted
+    u32 parent;           // Node index of the parent or LDK_SCENEGRAPH_NO_PARENT
+    u32 transform_index;  // Cached Transform store index, checked against the store owners before use
+    u32 flags;
+  } LDKScenegraphNode;
+
+  typedef struct LDKScenegraphStats
+  {
+    u32 dirty_count;      // Transforms queued since the previous update
+    u32 matrices_updated; // World matrices recomputed
+    bool full_pass;       // Every node was visited
+  } LDKScenegraphStats;
+
+  typedef struct LDKScenegraph
+  {
+    XArray* nodes;        // LDKScenegraphNode, parents before children
+    XArray* node_of;      // u32 node index per entity index
+    XArray* remap;        // u32 scratch for compaction and node depths
+    XArray* levels;       // u32 live node indices grouped by depth, in node order within a level
+    XArray* level_ends;   // u32 end of each depth level in levels
+    XArray* dirty;        // LDKEntity whose local state changed since the last update
+    XArray* stack;        // u32 scratch for subtree walks
+    LDKScenegraphStats stats; // Of the last update
+    u32 live_count;
+    u32 dead_count;
+    bool rebuild;         // The links changed behind the scenegraph, rebuild before the next update
+    bool levels_dirty;    // The node array changed since levels was built
+  } LDKScenegraph;
+
+  /**
+   * Inputs of ldk_scenegraph_compose(), one array per component with an entry
+   * per transform.
+   */
+  typedef struct LDKScenegraphCompose
+  {
+    const float* position[3];         // x, y, z
+    const float* rotation[4];         // x, y, z, w. Normalized by the kernel
+    const float* scale[3];            // x, y, z
+    const Mat4* const* parent_world;  // NULL entries for roots
+    Mat4* const* world;               // Receives parent_world * translate * rotate * scale
+  } LDKScenegraphCompose;
+
   LDK_API bool ldk_scenegraph_update(float dt);
   LDK_API bool ldk_scenegraph_update_entity(LDKEntity entity);
 
   LDK_API bool ldk_scenegraph_set_parent(LDKEntity child_entity, LDKEntity parent_entity);
   LDK_API bool ldk_scenegraph_detach(LDKEntity entity);
   LDK_API LDKEntity ldk_scenegraph_get_parent(LDKEntity entity);
+  LDK_API LDKScenegraphStats ldk_scenegraph_stats_get(void);
+
+  /* Forces a rebuild from the Transform links before the next update */
+  LDK_API void ldk_scenegraph_invalidate(LDKScenegraph* scenegraph);
+
+  /**
+   * Updates the world matrices of the transforms in the given registries.
+   * jobs is optional. ldk_scenegraph_update() uses the engine job system.
+   */
+  LDK_API bool ldk_scenegraph_update_world(LDKScenegraph* scenegraph, LDKEntityRegistry* entity_registry,
+      LDKComponentRegistry* component_registry, struct LDKJobSystem* jobs);
+
+  /**
+   * Computes count world matrices. Gives the same results as
+   * mat4_mul(parent_world, mat4_compose(position, rotation, scale)).
+   */
+  LDK_API void ldk_scenegraph_compose(const LDKScenegraphCompose* batch, u32 count);
+
+#ifdef LDK_ENGINE
+  LDK_API bool ldk_scenegraph_initialize(LDKScenegraph* scenegraph);
+  LDK_API void ldk_scenegraph_terminate(LDKScenegraph* scenegraph);
+
+  /**
+   * Keep the node array in sync with the Transform component. node_add is
+   * called when a Transform is attached, node_remove when it is destroyed and
+   * node_parent_set after the links of entity were changed to parent.
+   */
+  LDK_API void ldk_scenegraph_node_add(LDKScenegraph* scenegraph, LDKEntity entity, LDKEntity parent, u32 transform_index);
+  LDK_API void ldk_scenegraph_node_remove(LDKScenegraph* scenegraph, LDKEntity entity);
+  LDK_API void ldk_scenegraph_node_parent_set(LDKScenegraph* scenegraph, LDKEntityRegistry* entity_registry,
+      LDKComponentRegistry* component_registry, LDKEntity entity, LDKEntity parent);
+
+  /**
+   * Queues entity for the next update, which recomputes its subtree. The
+   * caller sets LDK_TRANSFORM_FLAG_WORLD_DIRTY on its transform.
+   */
+  LDK_API void ldk_scenegraph_node_dirty(LDKScenegraph* scenegraph, LDKEntity entity);
+#endif // LDK_ENGINE
 
 #ifdef __cplusplus
 }
@@ -8,6 +8,16 @@
  *
  * System execution order is determined per bucket using order values,
  * with registration order as a stable tie-breaker.
+ *
+ * Systems flagged LDK_SYSTEM_FLAG_PARALLEL declare the component types they
+ * read and write. On start, each bucket is split into waves: a system runs in
+ * the first wave after every earlier (by order) system it conflicts with.
+ * Systems in the same wave may run concurrently through the registry executor.
+ * Systems without the flag are exclusive and always run alone.
+ * Parallel systems must not make structural changes directly, they should
+ * record them on an ECS command buffer instead. The engine runs waves on the
+ * job system, so ldk_jobs_worker_index() picks a buffer no other system in the
+ * wave is writing to.
  * 
  * Systems are not meant to be passed around or referenced by pointer.
  * They are registered as descriptors and owned by the registry.
@@ -63,9 +73,22 @@ typedef enum LDKSystemFlags
   LDK_SYSTEM_FLAG_NONE             = 0,
   LDK_SYSTEM_FLAG_ENABLED          = 1 << 0,
   LDK_SYSTEM_FLAG_ENGINE_NATIVE    = 1 << 1,
-  LDK_SYSTEM_FLAG_RUN_WHEN_PAUSED  = 1 << 2
+  LDK_SYSTEM_FLAG_RUN_WHEN_PAUSED  = 1 << 2,
+  LDK_SYSTEM_FLAG_PARALLEL         = 1 << 3   // Only touches the components declared in LDKSystemDesc.access
 } LDKSystemFlags;
 
+#ifndef LDK_SYSTEM_MAX_ACCESS
+#define LDK_SYSTEM_MAX_ACCESS 8
+#endif
+
+typedef struct LDKSystemAccess
+{
+  u32 reads[LDK_SYSTEM_MAX_ACCESS];   // Component types
+  u32 writes[LDK_SYSTEM_MAX_ACCESS];  // Component types
+  u32 read_count;
+  u32 write_count;
+} LDKSystemAccess;
+
 struct LDKRoot;
 
 typedef int  (*LDKSystemInitializeFn)(void** userdata);
@@ -95,8 +118,16 @@ typedef struct LDKSystemDesc
   i32 post_update_order;
   i32 render_order;
   LDKSystemCallbacks callbacks;
+  LDKSystemAccess access;     // Only used with LDK_SYSTEM_FLAG_PARALLEL
 } LDKSystemDesc;
 
+/**
+ * Runs task(task_user, i) for every i in [0, count) and returns when all of them
+ * finished. Used to run the systems of a wave concurrently.
+ */
+typedef void (*LDKSystemTaskFn)(void* task_user, u32 index);
+typedef void (*LDKSystemExecutorFn)(void* executor_user, u32 count, LDKSystemTaskFn task, void* task_user);
+
 typedef struct LDKSystemRegistry
 {
   void* internal;
@@ -116,6 +147,12 @@ LDK_API bool ldk_system_registry_stop(LDKSystemRegistry* registry);
 LDK_API bool ldk_system_registry_run_bucket(LDKSystemRegistry* registry, LDKSystemBucket bucket, float dt);
 LDK_API bool ldk_system_registry_has(const LDKSystemRegistry* registry, u64 id);
 
+/**
+ * Sets the executor used to run the systems of a wave. A NULL executor runs them serially.
+ */
+LDK_API void ldk_system_registry_executor_set(LDKSystemRegistry* registry, LDKSystemExecutorFn executor, void* executor_user);
+LDK_API u32 ldk_system_registry_wave_count(const LDKSystemRegistry* registry, LDKSystemBucket bucket);
+
 #ifdef __cplusplus
 }
 #endif
@@ -198,6 +198,23 @@ extern "C" {
    */
   X_ARRAY_API uint32_t x_array_capacity(XArray* arr);
 
+  /**
+   * @brief Ensure the array can hold at least capacity elements without resizing.
+   * @param arr Pointer to the array.
+   * @param capacity Minimum number of elements the array must be able to hold.
+   * @return Error code indicating success or failure.
+   */
+  X_ARRAY_API XArrayError x_array_reserve(XArray* arr, size_t capacity);
+
+  /**
+   * @brief Set the number of elements in the array.
+   * Growing the array leaves the new elements uninitialized.
+   * @param arr Pointer to the array.
+   * @param count New number of elements.
+   * @return Error code indicating success or failure.
+   */
+  X_ARRAY_API XArrayError x_array_resize(XArray* arr, size_t count);
+
   /**
    * @brief Push an element onto the end of the array.
    * @param array Pointer to the array.
@@ -530,6 +547,54 @@ extern "C" {
     return (uint32_t) arr->capacity;
   }
 
+  XArrayError x_array_reserve(XArray* arr, size_t capacity)
+  {
+    void* new_array;
+
+    X_ASSERT(arr != NULL);
+
+    if (capacity <= arr->capacity)
+    {
+      return XARRAY_OK;
+    }
+
+    new_array = X_ARRAY_REALLOC(arr->array, capacity * arr->elementSize);
+    if (new_array == NULL)
+    {
+      return XARRAY_MEMORY_ALLOCATION_FAILED;
+    }
+
+    arr->array = new_array;
+    arr->capacity = capacity;
+    return XARRAY_OK;
+  }
+
+  XArrayError x_array_resize(XArray* arr, size_t count)
+  {
+    X_ASSERT(arr != NULL);
+
+    if (count > arr->capacity)
+    {
+      // Keep the amortized growth of x_array_add
+      size_t capacity = arr->capacity == 0 ? 1 : arr->capacity * 2;
+      XArrayError error;
+
+      while (capacity < count)
+      {
+        capacity *= 2;
+      }
+
+      error = x_array_reserve(arr, capacity);
+      if (error != XARRAY_OK)
+      {
+        return error;
+      }
+    }
+
+    arr->size = count;
+    return XARRAY_OK;
+  }
+
   void x_array_delete_at(XArray* arr, unsigned int index)
   {
     X_ASSERT(arr != NULL);
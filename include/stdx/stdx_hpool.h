@@ -205,6 +205,9 @@ extern "C" {
   X_HPOOL_API XHandle x_hpool_alloc(XHPool* p);
   X_HPOOL_API void x_hpool_free(XHPool* p, XHandle h);
   X_HPOOL_API void x_hpool_clear(XHPool* p);
+  /* Makes dst an exact copy of src: same handles, versions, free list and raw items.
+   * dst must be zeroed or initialized. Its memory is reused. No ctor or dtor is called. */
+  X_HPOOL_API int x_hpool_copy(XHPool* dst, const XHPool* src);
   X_HPOOL_API void* x_hpool_iter_begin(XHPool* p, XHPoolIter* it, XHandle* out_h);
   X_HPOOL_API void* x_hpool_iter_next(XHPool* p, XHPoolIter* it, XHandle* out_h);
 
@@ -929,6 +932,77 @@ extern "C" {
     }
   }
 
+  X_HPOOL_API int x_hpool_copy(XHPool* dst, const XHPool* src)
+  {
+    uint32_t i;
+    size_t bytes;
+
+    if (dst == NULL || src == NULL)
+    {
+      return 0;
+    }
+
+    /* Pages of a different layout can not be reused */
+    if (dst->page_count > 0u && (dst->item_size != src->item_size || dst->page_capacity != src->page_capacity))
+    {
+      for (i = 0u; i < dst->page_count; i += 1u)
+      {
+        X_HPOOL_FREE(dst->pages[i]);
+      }
+
+      dst->page_count = 0u;
+    }
+
+    dst->item_size = src->item_size;
+    dst->page_capacity = src->page_capacity;
+    dst->page_shift = src->page_shift;
+    dst->page_mask = src->page_mask;
+
+    if (x_hpool_ensure_pages_array(dst, src->page_count) == 0 ||
+        x_hpool_alive_reserve(dst, src->alive_count) == 0)
+    {
+      return 0;
+    }
+
+    while (dst->page_count > src->page_count)
+    {
+      dst->page_count = dst->page_count - 1u;
+      X_HPOOL_FREE(dst->pages[dst->page_count]);
+    }
+
+    bytes = (size_t)src->page_capacity * x_hpool_slot_stride(src);
+
+    for (i = 0u; i < src->page_count; i += 1u)
+    {
+      if (i >= dst->page_count)
+      {
+        dst->pages[i] = X_HPOOL_ALLOC(bytes);
+        if (dst->pages[i] == NULL)
+        {
+          return 0;
+        }
+
+        dst->page_count = i + 1u;
+      }
+
+      memcpy(dst->pages[i], src->pages[i], bytes);
+    }
+
+    if (src->alive_count > 0u)
+    {
+      memcpy(dst->alive, src->alive, (size_t)src->alive_count * sizeof(uint32_t));
+    }
+
+    dst->alive_count = src->alive_count;
+    dst->free_head = src->free_head;
+    dst->next_index = src->next_index;
+    dst->ctor = src->ctor;
+    dst->dtor = src->dtor;
+    dst->user = src->user;
+
+    return 1;
+  }
+
   /* Iteration: returns pointer to item, optionally outputs handle */
   X_HPOOL_API void* x_hpool_iter_begin(XHPool* p, XHPoolIter* it, XHandle* out_h)
   {
@@ -7,6 +7,7 @@
 #include <component/ldk_camera.h>
 #include <module/ldk_ecs.h>
 #include <stdx/stdx_math.h>
+#include <stddef.h>
 
 static LDKCamera s_camera_make_default(void)
 {
@@ -88,6 +89,31 @@ LDKComponentDesc ldk_camera_component_desc(u32 initial_capacity)
   return desc;
 }
 
+const LDKComponentMeta* ldk_camera_component_meta(void)
+{
+  static const LDKComponentFieldMeta fields[] =
+  {
+    { "projection",          LDK_FIELD_ENUM,  offsetof(LDKCamera, projection),          LDK_FIELD_FLAG_NONE, LDK_FIELD_WIDGET_ENUM,     0.0f, 0.0f },
+    { "role",                LDK_FIELD_ENUM,  offsetof(LDKCamera, role),                LDK_FIELD_FLAG_NONE, LDK_FIELD_WIDGET_ENUM,     0.0f, 0.0f },
+    { "fov_y",               LDK_FIELD_FLOAT, offsetof(LDKCamera, fov_y),               LDK_FIELD_FLAG_NONE, LDK_FIELD_WIDGET_FLOAT,    0.0f, 0.0f },
+    { "orthographic_height", LDK_FIELD_FLOAT, offsetof(LDKCamera, orthographic_height), LDK_FIELD_FLAG_NONE, LDK_FIELD_WIDGET_FLOAT,    0.0f, 0.0f },
+    { "near_plane",          LDK_FIELD_FLOAT, offsetof(LDKCamera, near_plane),          LDK_FIELD_FLAG_NONE, LDK_FIELD_WIDGET_FLOAT,    0.0f, 0.0f },
+    { "far_plane",           LDK_FIELD_FLOAT, offsetof(LDKCamera, far_plane),           LDK_FIELD_FLAG_NONE, LDK_FIELD_WIDGET_FLOAT,    0.0f, 0.0f },
+    { "enabled",             LDK_FIELD_BOOL,  offsetof(LDKCamera, enabled),             LDK_FIELD_FLAG_NONE, LDK_FIELD_WIDGET_CHECKBOX, 0.0f, 0.0f },
+  };
+
+  static const LDKComponentMeta meta =
+  {
+    "Camera",
+    LDK_COMPONENT_TYPE_CAMERA,
+    sizeof(LDKCamera),
+    fields,
+    sizeof(fields) / sizeof(fields[0])
+  };
+
+  return &meta;
+}
+
 #endif // LDK_ENGINE
 
 bool ldk_camera_look_at(LDKEntity entity, Vec3 target)
@@ -159,7 +185,7 @@ bool ldk_camera_get_projection_matrix(LDKEntity entity, float aspect, Mat4* out_
     return false;
   }
 
-  LDKCamera* camera = (LDKCamera*)ldk_ecs_component_get(
+  const LDKCamera* camera = (const LDKCamera*)ldk_ecs_component_get_const(
       entity,
       LDK_COMPONENT_TYPE_CAMERA);
 
@@ -5,6 +5,7 @@
 
 #include <component/ldk_transform.h>
 #include <module/ldk_ecs.h>
+#include <stddef.h>
 
 static int s_entity_eq(LDKEntity a, LDKEntity b)
 {
@@ -21,7 +22,8 @@ static const LDKTransform* s_transform_get_ptr_const(LDKEntity entity)
   return (const LDKTransform*)ldk_ecs_component_get_const(entity, LDK_COMPONENT_TYPE_TRANSFORM);
 }
 
-static bool s_transform_mark_subtree_dirty(LDKEntity entity)
+/* The scenegraph recomputes the subtree of entity on its next update */
+static bool s_transform_mark_dirty(LDKEntity entity)
 {
   LDKTransform* transform = s_transform_get_ptr(entity);
 
@@ -31,22 +33,7 @@ static bool s_transform_mark_subtree_dirty(LDKEntity entity)
   }
 
   transform->flags |= LDK_TRANSFORM_FLAG_WORLD_DIRTY;
-
-  LDKEntity child = transform->first_child;
-  while (!x_handle_is_null(child))
-  {
-    const LDKTransform* child_transform = s_transform_get_ptr_const(child);
-
-    if (!child_transform)
-    {
-      break;
-    }
-
-    LDKEntity next_child = child_transform->next_sibling;
-    s_transform_mark_subtree_dirty(child);
-    child = next_child;
-  }
-
+  ldk_scenegraph_node_dirty(ldk_ecs_scenegraph_get(), entity);
   return true;
 }
 
@@ -123,7 +110,7 @@ static bool s_transform_unlink_from_parent(LDKTransform* child)
   return true;
 }
 
-static bool s_transform_orphan_children(LDKTransform* transform)
+static bool s_transform_orphan_children(LDKTransform* transform, LDKScenegraph* scenegraph)
 {
   if (!transform)
   {
@@ -147,7 +134,8 @@ static bool s_transform_orphan_children(LDKTransform* transform)
     child_transform->prev_sibling = x_handle_null();
     child_transform->next_sibling = x_handle_null();
     child_transform->flags |= LDK_TRANSFORM_FLAG_WORLD_DIRTY;
-    s_transform_mark_subtree_dirty(child);
+    ldk_scenegraph_node_parent_set(scenegraph, NULL, NULL, child, x_handle_null());
+    ldk_scenegraph_node_dirty(scenegraph, child);
     child = next_child;
   }
 
@@ -160,8 +148,6 @@ static bool s_transform_attach(LDKEntityRegistry* entity_registry, LDKComponentR
   LDKTransform* transform = (LDKTransform*)component;
 
   (void)component_registry;
-  (void)component_index;
-  (void)user;
 
   if (!entity_registry || !transform)
   {
@@ -174,6 +160,7 @@ static bool s_transform_attach(LDKEntityRegistry* entity_registry, LDKComponentR
   }
 
   ldk_entity_internal_flags_add(entity_registry, entity, LDK_ENTITY_INTERNAL_HAS_TRANSFORM);
+  ldk_scenegraph_node_add((LDKScenegraph*)user, entity, transform->parent, component_index);
   return true;
 }
 
@@ -184,7 +171,6 @@ static void s_transform_destroy(LDKEntityRegistry* entity_registry, LDKComponent
 
   (void)component_registry;
   (void)component_index;
-  (void)user;
 
   if (!entity_registry || !transform)
   {
@@ -192,7 +178,8 @@ static void s_transform_destroy(LDKEntityRegistry* entity_registry, LDKComponent
   }
 
   s_transform_unlink_from_parent(transform);
-  s_transform_orphan_children(transform);
+  s_transform_orphan_children(transform, (LDKScenegraph*)user);
+  ldk_scenegraph_node_remove((LDKScenegraph*)user, entity);
   ldk_entity_internal_flags_remove(entity_registry, entity, LDK_ENTITY_INTERNAL_HAS_TRANSFORM);
 }
 
@@ -219,7 +206,7 @@ bool ldk_transform_set_local_position(LDKEntity entity, Vec3 position)
   LDK_ASSERT(transform);
 
   transform->local_position = position;
-  return s_transform_mark_subtree_dirty(entity);
+  return s_transform_mark_dirty(entity);
 }
 
 bool ldk_transform_set_local_rotation(LDKEntity entity, Quat rotation)
@@ -232,7 +219,7 @@ bool ldk_transform_set_local_rotation(LDKEntity entity, Quat rotation)
   }
 
   transform->local_rotation = rotation;
-  return s_transform_mark_subtree_dirty(entity);
+  return s_transform_mark_dirty(entity);
 }
 
 bool ldk_transform_set_local_scale(LDKEntity entity, Vec3 scale)
@@ -245,7 +232,7 @@ bool ldk_transform_set_local_scale(LDKEntity entity, Vec3 scale)
   }
 
   transform->local_scale = scale;
-  return s_transform_mark_subtree_dirty(entity);
+  return s_transform_mark_dirty(entity);
 }
 
 bool ldk_transform_get_local_position(LDKEntity entity, Vec3* out_position)
@@ -389,12 +376,15 @@ bool ldk_transform_set_parent(LDKEntity child_entity, LDKEntity parent_entity)
     parent_transform->first_child = child_entity;
   }
 
-  return s_transform_mark_subtree_dirty(child_entity);
+  ldk_scenegraph_node_parent_set(ldk_ecs_scenegraph_get(), ldk_ecs_entity_registry_get(),
+      ldk_ecs_component_registry_get(), child_entity, parent_entity);
+
+  return s_transform_mark_dirty(child_entity);
 }
 
 bool ldk_transform_mark_dirty(LDKEntity entity)
 {
-  return s_transform_mark_subtree_dirty(entity);
+  return s_transform_mark_dirty(entity);
 }
 
 #ifdef LDK_ENGINE
@@ -411,4 +401,50 @@ LDKComponentDesc ldk_transform_component_desc(u32 initial_capacity)
   desc.user = NULL;
   return desc;
 }
+
+const LDKComponentMeta* ldk_transform_component_meta(void)
+{
+  static const LDKComponentFieldMeta fields[] =
+  {
+    { "local_position", LDK_FIELD_VEC3,   offsetof(LDKTransform, local_position), LDK_FIELD_FLAG_NONE,     LDK_FIELD_WIDGET_VEC3,    0.0f, 0.0f },
+    { "local_rotation", LDK_FIELD_QUAT,   offsetof(LDKTransform, local_rotation), LDK_FIELD_FLAG_NONE,     LDK_FIELD_WIDGET_QUAT,    0.0f, 0.0f },
+    { "local_scale",    LDK_FIELD_VEC3,   offsetof(LDKTransform, local_scale),    LDK_FIELD_FLAG_NONE,     LDK_FIELD_WIDGET_VEC3,    0.0f, 0.0f },
+    { "world_matrix",   LDK_FIELD_MAT4,   offsetof(LDKTransform, world_matrix),   LDK_FIELD_FLAG_RUNTIME,  LDK_FIELD_WIDGET_MAT4,    0.0f, 0.0f },
+    { "parent",         LDK_FIELD_ENTITY, offsetof(LDKTransform, parent),         LDK_FIELD_FLAG_READONLY, LDK_FIELD_WIDGET_ENTITY,  0.0f, 0.0f },
+    { "first_child",    LDK_FIELD_ENTITY, offsetof(LDKTransform, first_child),    LDK_FIELD_FLAG_READONLY, LDK_FIELD_WIDGET_ENTITY,  0.0f, 0.0f },
+    { "next_sibling",   LDK_FIELD_ENTITY, offsetof(LDKTransform, next_sibling),   LDK_FIELD_FLAG_READONLY, LDK_FIELD_WIDGET_ENTITY,  0.0f, 0.0f },
+    { "prev_sibling",   LDK_FIELD_ENTITY, offsetof(LDKTransform, prev_sibling),   LDK_FIELD_FLAG_READONLY, LDK_FIELD_WIDGET_ENTITY,  0.0f, 0.0f },
+    { "flags",          LDK_FIELD_U32,    offsetof(LDKTransform, flags),          LDK_FIELD_FLAG_RUNTIME,  LDK_FIELD_WIDGET_U32,     0.0f, 0.0f },
+  };
+
+  static const LDKComponentMeta meta =
+  {
+    "Transform",
+    LDK_COMPONENT_TYPE_TRANSFORM,
+    sizeof(LDKTransform),
+    fields,
+    sizeof(fields) / sizeof(fields[0])
+  };
+
+  return &meta;
+}
+
+u64 ldk_transform_sort_key_hierarchy(void* user, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, LDKEntity owner)
+{
+  const LDKTransform* transform = ldk_entity_transform_get_const(entity_registry, component_registry, owner);
+  LDKEntity parent = transform ? transform->parent : x_handle_null();
+  u64 depth = 0;
+
+  (void)user;
+
+  while (transform && !x_handle_is_null(transform->parent))
+  {
+    transform = ldk_entity_transform_get_const(entity_registry, component_registry, transform->parent);
+    depth++;
+  }
+
+  // Roots come first, then each level grouped by parent
+  return (depth << 32) | (x_handle_is_null(parent) ? owner.index : parent.index);
+}
 #endif // LDK_ENGINE
@@ -47,6 +47,7 @@
 #include <module/ldk_component.h>
 #include <module/ldk_ecs.h>
 #include <module/ldk_entity.h>
+#include <module/ldk_jobs.h>
 #include <module/ldk_renderer.h>
 #include <module/ldk_scenegraph.h>
 
@@ -64,6 +65,7 @@ struct LDKRoot
   LDKConfig             config;
   LDKEventQueue         event_queue;
   LDKGame               game;
+  LDKJobSystem          jobs;
   LDKRHIContext         rhi;
   LDKRenderer           renderer;
   XLogger               logger;
@@ -72,6 +74,8 @@ struct LDKRoot
   LDKWindow             window;
   LDKGCtx               graphics;
   u64                   previous_ticks;
+  LDKQuery              mesh_query; // Transform + MeshSource
+  LDKComponentSort      transform_sort; // Incremental hierarchy sort of the transform store
 };
 
 static LDKRoot g_engine;
@@ -119,10 +123,35 @@ static void s_on_signal(i32 signal)
   g_signal_requested_stop = 1;
 }
 
+typedef struct LDKSystemWave
+{
+  LDKSystemTaskFn task;
+  void* task_user;
+} LDKSystemWave;
+
+static void s_system_wave_range(void* user, u32 begin, u32 end, u32 worker_index)
+{
+  LDKSystemWave* wave = (LDKSystemWave*) user;
+
+  for (u32 i = begin; i < end; ++i)
+  {
+    wave->task(wave->task_user, i);
+  }
+}
+
+// Runs the systems of a wave on the job workers
+static void s_system_wave_execute(void* executor_user, u32 count, LDKSystemTaskFn task, void* task_user)
+{
+  LDKSystemWave wave = { task, task_user };
+  ldk_jobs_parallel_for((LDKJobSystem*) executor_user, count, 1, s_system_wave_range, &wave);
+}
+
 static void s_terminate_all_modules(LDKRoot* e)
 {
   ldk_ecs_system_registry_stop(&e->ecs);
 
+  ldk_jobs_terminate(&e->jobs);
+  ldk_component_sort_terminate(&e->transform_sort);
   ldk_ecs_terminate();
   ldk_event_queue_terminate(&e->event_queue);
   ldk_asset_manager_terminate(&e->asset_manager);
@@ -321,6 +350,8 @@ bool ldk_engine_config_from_ini(LDKConfig* out_config, XIni* ini, const char* co
   // scetion: general
   out_config->initial_ui_index_capacity = x_ini_get_i32(ini, "general", "initial_ui_index_capacity", 256);
   out_config->initial_ui_vertex_capacity = x_ini_get_i32(ini, "general", "initial_ui_vertex_capacity", 256);
+  out_config->job_worker_count = x_ini_get_i32(ini, "general", "job_worker_count", 0);
+  out_config->transform_sort_budget = x_ini_get_i32(ini, "general", "transform_sort_budget", 0);
   const char* asset_root = x_ini_get(ini, "general", "asset_root", "assets");
   const char* log_file = x_ini_get(ini, "general", "log_file", "ldk.log");
   const char* game_dll = x_ini_get(ini, "general", "game_dll", "");
@@ -435,6 +466,9 @@ void* ldk_module_get(LDKModuleType module_type)
     case LDK_MODULE_EVENT:
       return &g_engine.event_queue;
 
+    case LDK_MODULE_JOBS:
+      return &g_engine.jobs;
+
     case LDK_MODULE_LOG:
       return &g_engine.logger;
 
@@ -527,6 +561,12 @@ bool ldk_engine_initialize_with_config(const LDKConfig* config)
   ldk_os_window_icon_set(e->window, e->config.icon_path.buf);
   ldk_os_graphics_context_make_current(e->window, e->graphics);
 
+  if (!ldk_jobs_initialize(&e->jobs, config->job_worker_count > 0 ? (u32) config->job_worker_count : 0))
+  {
+    ldk_log_error("Failed to initialize module: Jobs.");
+    engine_init_failed = true;
+  }
+
   if (!ldk_event_queue_initialize(&e->event_queue))
   {
     ldk_log_error("Failed to initialize module: Event Queue.");
@@ -544,6 +584,18 @@ bool ldk_engine_initialize_with_config(const LDKConfig* config)
     ldk_log_error("Failed to initialize module: ECS.");
     engine_init_failed = true;
   }
+  else
+  {
+    const u32 mesh_query_types[] = { LDK_COMPONENT_TYPE_TRANSFORM, LDK_COMPONENT_TYPE_MESH_SOURCE };
+    e->mesh_query = ldk_query_create(&e->ecs.entity, &e->ecs.component, mesh_query_types, 2);
+    ldk_system_registry_executor_set(&e->ecs.system, s_system_wave_execute, &e->jobs);
+
+    LDKComponentSortDesc transform_sort = {0};
+    transform_sort.component_type = LDK_COMPONENT_TYPE_TRANSFORM;
+    transform_sort.key = LDK_COMPONENT_SORT_CUSTOM;
+    transform_sort.key_fn = ldk_transform_sort_key_hierarchy;
+    ldk_component_sort_initialize(&e->ecs.component, &e->transform_sort, &transform_sort);
+  }
 
   LDKRendererConfig renderer_config;
   renderer_config.rhi = &e->rhi;
@@ -639,6 +691,9 @@ void ldk_engine_frame(void)
     ldk_scenegraph_update(delta_time); // Update scenegraph
     ldk_ecs_system_bucket_run(&e->ecs, LDK_SYSTEM_BUCKET_UPDATE, delta_time);
     ldk_ecs_system_bucket_run(&e->ecs, LDK_SYSTEM_BUCKET_POST_UPDATE, delta_time);
+
+    // Entities destroyed during the update are swept in one batch
+    ldk_ecs_entity_destroy_pending(&e->ecs);
   }
   s_broadcast_frame_event(LDK_FRAME_EVENT_UPDATE_AFTER, current_ticks, delta_time); 
 
@@ -682,57 +737,56 @@ void ldk_engine_frame(void)
     }
 
     // Mesh sources
-    XArray* all_mesh = ldk_component_store_get(component_registry, LDK_COMPONENT_TYPE_MESH_SOURCE);
-    XArray* mesh_owners = ldk_component_owners_get(component_registry, LDK_COMPONENT_TYPE_MESH_SOURCE);
-    u32 mesh_count = x_array_count(all_mesh);
+    LDKQueryIter mesh_iter = ldk_query_iter_begin(entity_registry, component_registry, e->mesh_query);
+    LDKQueryBatch mesh_batch;
 
-    for (u32 i = 0; i < mesh_count; i++)
+    while (ldk_query_iter_next(&mesh_iter, &mesh_batch))
     {
-      LDKMeshSource* mesh = x_array_get(all_mesh, i);
-      LDKEntity* entity = x_array_get(mesh_owners, i);
-
-      if (!mesh || !entity)
+      for (u32 i = 0; i < mesh_batch.count; i++)
       {
-        continue;
+        LDKTransform* transform = mesh_batch.components[0][i];
+        LDKMeshSource* mesh = mesh_batch.components[1][i];
+
+        if (!mesh || !transform)
+        {
+          continue;
+        }
+
+        Mat4 mesh_world = transform->world_matrix;
+        LDKAssetMeshData* mesh_data = ldk_asset_manager_mesh_get(&e->asset_manager, mesh->source_asset);
+        if (mesh_data == NULL)
+        {
+          continue;
+        }
+
+        LDKRendererMeshDesc mesh_desc = {0};
+        mesh_desc.vertices = mesh_data->mesh.vertices;
+        mesh_desc.vertex_count = mesh_data->mesh.vertex_count;
+        mesh_desc.indices = mesh_data->mesh.indices;
+        mesh_desc.index_count = mesh_data->mesh.index_count;
+
+        if (!ldk_renderer_mesh_is_valid(&e->renderer, mesh->renderer_mesh))
+        {
+          mesh->renderer_mesh = ldk_renderer_mesh_create(&e->renderer, &mesh_desc);
+          mesh->dirty = false;
+        }
+        else if (mesh->dirty)
+        {
+          ldk_renderer_mesh_update(&e->renderer, mesh->renderer_mesh, &mesh_desc);
+          mesh->dirty = false;
+        }
+
+        if (!ldk_renderer_mesh_is_valid(&e->renderer, mesh->renderer_mesh))
+        {
+          continue;
+        }
+
+        ldk_renderer_submit_mesh(&e->renderer, mesh->renderer_mesh, mesh_world);
       }
-
-      Mat4 mesh_world = mat4_identity();
-
-      if (!ldk_transform_get_world_matrix(*entity, &mesh_world))
-      {
-        continue;
-      }
-
-      LDKAssetMeshData* mesh_data = ldk_asset_manager_mesh_get(&e->asset_manager, mesh->source_asset);
-      if (mesh_data == NULL)
-      {
-        continue;
-      }
-
-      LDKRendererMeshDesc mesh_desc = {0};
-      mesh_desc.vertices = mesh_data->mesh.vertices;
-      mesh_desc.vertex_count = mesh_data->mesh.vertex_count;
-      mesh_desc.indices = mesh_data->mesh.indices;
-      mesh_desc.index_count = mesh_data->mesh.index_count;
-
-      if (!ldk_renderer_mesh_is_valid(&e->renderer, mesh->renderer_mesh))
-      {
-        mesh->renderer_mesh = ldk_renderer_mesh_create(&e->renderer, &mesh_desc);
-        mesh->dirty = false;
-      }
-      else if (mesh->dirty)
-      {
-        ldk_renderer_mesh_update(&e->renderer, mesh->renderer_mesh, &mesh_desc);
-        mesh->dirty = false;
-      }
-
-      if (!ldk_renderer_mesh_is_valid(&e->renderer, mesh->renderer_mesh))
-      {
-        continue;
-      }
-
-      ldk_renderer_submit_mesh(&e->renderer, mesh->renderer_mesh, mesh_world);
     }
+
+    // One change tick per frame for change filters
+    ldk_component_tick_advance(component_registry);
   }
   s_broadcast_frame_event(LDK_FRAME_EVENT_SUBMIT_AFTER, current_ticks, delta_time); 
 
@@ -749,6 +803,16 @@ void ldk_engine_frame(void)
     ldk_os_window_buffers_swap(e->window);
   }
   s_broadcast_frame_event(LDK_FRAME_EVENT_RENDER_AFTER, current_ticks, delta_time); 
+
+  // Undo the scattering swap-remove causes on the transform store, a few moves per frame
+  if (e->config.transform_sort_budget > 0)
+  {
+    if (ldk_component_sort_step(&e->ecs.component, &e->ecs.entity, &e->transform_sort, (u32) e->config.transform_sort_budget) == 0 &&
+        e->transform_sort.failed)
+    {
+      ldk_log_error("Failed to start a transform store sort pass. Retrying next frame.");
+    }
+  }
 }
 
 void ldk_engine_terminate(void)
@@ -70,6 +70,8 @@ typedef struct LDKEditor
   LDKEditorState editor_state;
   XFSPath engine_runtree;
   LDKGameUpdateFunc original_game_update_fn;
+  LDKECSSnapshot play_snapshot;   // World as it was when PLAY was pressed
+  bool has_play_snapshot;
 
   LDKResourceTexture ui_atlas;
 
@@ -636,16 +638,16 @@ static void s_editor_entity_list_window(LDKEditor *editor, LDKECS *ecs)
 
   while (ldk_entity_iterator_next(&it, &e))
   {
-    LDKEntityInfo *info = ldk_entity_info_get(&ecs->entity, e);
+    LDKEntityColdInfo *cold = ldk_entity_cold_info_get(&ecs->entity, e);
     u64 id = *((u64 *)&e);
-    snprintf((char *const)&info->name, LDK_ENTITY_NAME_MAX_LEN,
-             "0x%08" PRIu64 "(%d)", id, info->components.component_count);
+    snprintf((char *const)&cold->name, LDK_ENTITY_NAME_MAX_LEN,
+             "0x%08" PRIu64 "(%d)", id, cold->components.component_count);
 
-    ldk_ui_label(ui, (const char *)info->name);
-    for (u32 i = 0; i < info->components.component_count; i++)
+    ldk_ui_label(ui, (const char *)cold->name);
+    for (u32 i = 0; i < cold->components.component_count; i++)
     {
       const char *name = ldk_component_name_get(
-        &ecs->component, info->components.component_type[i]);
+        &ecs->component, ldk_component_directory_types(&cold->components)[i]);
       ldk_ui_label(ui, name);
     }
   }
@@ -847,9 +849,15 @@ static bool s_editor_state_set_play(LDKEditor *editor)
   if (editor->editor_state == LDK_EDITOR_STATE_PLAYING)
     return true;
 
+  // Keep the edited world so STOP can bring it back
+  editor->has_play_snapshot = ldk_ecs_snapshot_capture(&editor->play_snapshot);
+  if (!editor->has_play_snapshot)
+    ldk_log_warning("Failed to capture the world before PLAY. It will not be restored on STOP.\n");
+
   LDKGame *game = ldk_game_get();
   if (!game->start(game))
   {
+    editor->has_play_snapshot = false;
     return false;
   }
 
@@ -868,6 +876,11 @@ static void s_editor_state_set_stop(LDKEditor *editor)
   LDKGame *game = ldk_game_get();
   game->stop(game);
   editor->editor_state = LDK_EDITOR_STATE_STOPED;
+
+  if (editor->has_play_snapshot && !ldk_ecs_snapshot_restore(&editor->play_snapshot))
+    ldk_log_error("Failed to restore the world captured before PLAY\n");
+
+  editor->has_play_snapshot = false;
 }
 
 static void s_editor_state_set_pause(LDKEditor *editor)
@@ -939,6 +952,8 @@ static void s_editor_terminate(LDKEditor *editor)
   ldk_event_handler_remove(eq, on_event_frame);
   ldk_event_handler_remove(eq, on_event_keyboard);
   ldk_event_handler_remove(eq, on_event_window);
+  ldk_ecs_snapshot_release(&editor->play_snapshot);
+  editor->has_play_snapshot = false;
 }
 
 //----------------------------------------------------------
@@ -569,6 +569,72 @@ void* ldk_os_memory_resize(void* memory, size_t size)
   return mem;
 }
 
+// ---------------------------------------------------------------------------
+// Memory mapped files
+// ---------------------------------------------------------------------------
+
+bool ldk_os_file_map(const char* path, LDKFileMapping* out_mapping)
+{
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = NULL;
+  LARGE_INTEGER size;
+  void* data = NULL;
+
+  if (!path || !out_mapping)
+    return false;
+
+  memset(out_mapping, 0, sizeof(*out_mapping));
+
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || (u64) size.QuadPart > (u64) SIZE_MAX)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapping)
+  {
+    CloseHandle(file);
+    return false;
+  }
+
+  data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!data)
+  {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  out_mapping->data = data;
+  out_mapping->size = (size_t) size.QuadPart;
+  out_mapping->file = (void*) file;
+  out_mapping->mapping = (void*) mapping;
+  return true;
+}
+
+void ldk_os_file_unmap(LDKFileMapping* mapping)
+{
+  if (!mapping)
+    return;
+
+  if (mapping->data)
+    UnmapViewOfFile(mapping->data);
+
+  if (mapping->mapping)
+    CloseHandle((HANDLE) mapping->mapping);
+
+  if (mapping->file)
+    CloseHandle((HANDLE) mapping->file);
+
+  memset(mapping, 0, sizeof(*mapping));
+}
+
 // ---------------------------------------------------------------------------
 // Time
 // ---------------------------------------------------------------------------
@@ -597,6 +663,160 @@ double ldk_os_time_ticks_interval_get_nanoseconds(u64 start, u64 end)
   return (difference / s_oswin32.frequency.QuadPart);
 }
 
+// ---------------------------------------------------------------------------
+// Threads
+// ---------------------------------------------------------------------------
+
+typedef struct LDKWin32ThreadStart
+{
+  LDKThreadFn fn;
+  void* user;
+} LDKWin32ThreadStart;
+
+static DWORD WINAPI s_thread_proc(LPVOID param)
+{
+  LDKWin32ThreadStart start = *(LDKWin32ThreadStart*) param;
+  free(param);
+  return (DWORD) start.fn(start.user);
+}
+
+LDKThread ldk_os_thread_create(LDKThreadFn fn, void* user)
+{
+  LDKWin32ThreadStart* start;
+  HANDLE thread;
+
+  if (!fn)
+  {
+    return NULL;
+  }
+
+  start = (LDKWin32ThreadStart*) malloc(sizeof(LDKWin32ThreadStart));
+  if (!start)
+  {
+    return NULL;
+  }
+
+  start->fn = fn;
+  start->user = user;
+
+  thread = CreateThread(NULL, 0, s_thread_proc, start, 0, NULL);
+  if (!thread)
+  {
+    ldk_log_error("Failed to create thread");
+    free(start);
+    return NULL;
+  }
+
+  return (LDKThread) thread;
+}
+
+void ldk_os_thread_join(LDKThread thread)
+{
+  if (!thread)
+  {
+    return;
+  }
+
+  WaitForSingleObject((HANDLE) thread, INFINITE);
+  CloseHandle((HANDLE) thread);
+}
+
+void ldk_os_thread_yield(void)
+{
+  SwitchToThread();
+}
+
+u32 ldk_os_cpu_count(void)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (u32) info.dwNumberOfProcessors : 1;
+}
+
+LDKSemaphore ldk_os_semaphore_create(u32 initial_count)
+{
+  return (LDKSemaphore) CreateSemaphore(NULL, (LONG) initial_count, MAXLONG, NULL);
+}
+
+void ldk_os_semaphore_destroy(LDKSemaphore semaphore)
+{
+  if (semaphore)
+  {
+    CloseHandle((HANDLE) semaphore);
+  }
+}
+
+void ldk_os_semaphore_wait(LDKSemaphore semaphore)
+{
+  WaitForSingleObject((HANDLE) semaphore, INFINITE);
+}
+
+void ldk_os_semaphore_signal(LDKSemaphore semaphore, u32 count)
+{
+  if (count > 0)
+  {
+    ReleaseSemaphore((HANDLE) semaphore, (LONG) count, NULL);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Atomics
+// ---------------------------------------------------------------------------
+
+// Stores and read-modify-writes go through interlocked operations, which are
+// full barriers. On x86/x64 a plain load is then already sequentially
+// consistent and only has to stop the compiler from reordering. ARM64 loads
+// need load-acquire, and 32-bit x86 can not load 64 bits in one plain access.
+
+i32 ldk_os_atomic_load_i32(volatile i32* value)
+{
+#if defined(_M_ARM64)
+  return (i32) __ldar32((volatile unsigned __int32*) value);
+#else
+  i32 result = *value;
+  _ReadWriteBarrier();
+  return result;
+#endif
+}
+
+void ldk_os_atomic_store_i32(volatile i32* value, i32 desired)
+{
+  InterlockedExchange((volatile LONG*) value, (LONG) desired);
+}
+
+i32 ldk_os_atomic_add_i32(volatile i32* value, i32 amount)
+{
+  return (i32) InterlockedExchangeAdd((volatile LONG*) value, (LONG) amount) + amount;
+}
+
+bool ldk_os_atomic_cas_i32(volatile i32* value, i32 expected, i32 desired)
+{
+  return InterlockedCompareExchange((volatile LONG*) value, (LONG) desired, (LONG) expected) == (LONG) expected;
+}
+
+i64 ldk_os_atomic_load_i64(volatile i64* value)
+{
+#if defined(_M_ARM64)
+  return (i64) __ldar64((volatile unsigned __int64*) value);
+#elif defined(_M_IX86)
+  return (i64) InterlockedCompareExchange64((volatile LONG64*) value, 0, 0);
+#else
+  i64 result = *value;
+  _ReadWriteBarrier();
+  return result;
+#endif
+}
+
+void ldk_os_atomic_store_i64(volatile i64* value, i64 desired)
+{
+  InterlockedExchange64((volatile LONG64*) value, (LONG64) desired);
+}
+
+bool ldk_os_atomic_cas_i64(volatile i64* value, i64 expected, i64 desired)
+{
+  return InterlockedCompareExchange64((volatile LONG64*) value, (LONG64) desired, (LONG64) expected) == (LONG64) expected;
+}
+
 
 // ---------------------------------------------------------------------------
 // Windowing
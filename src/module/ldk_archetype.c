@@ -0,0 +1,862 @@
+#include <ldk_common.h>
+#include <module/ldk_archetype.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_hpool.h>
+
+#ifndef LDK_ALLOC
+#include <stdlib.h>
+#define LDK_ALLOC(size) malloc(size)
+#define LDK_FREE(ptr) free(ptr)
+#endif
+
+#include <string.h>
+
+static u32 s_archetype_align(u32 value, u32 alignment)
+{
+  return (value + (alignment - 1)) & ~(alignment - 1);
+}
+
+/* Computes column offsets for a given row capacity and returns the total chunk size in bytes */
+static u32 s_archetype_layout(LDKArchetype* archetype, u32 rows)
+{
+  u32 offset = rows * (u32)sizeof(LDKEntity);
+  u32 i = 0;
+
+  for (i = 0; i < archetype->column_count; ++i)
+  {
+    offset = s_archetype_align(offset, LDK_ARCHETYPE_COLUMN_ALIGN);
+    archetype->column_offsets[i] = offset;
+    offset += rows * archetype->column_sizes[i];
+  }
+
+  return offset;
+}
+
+static void s_archetype_destroy(LDKArchetype* archetype)
+{
+  u32 i = 0;
+
+  if (!archetype)
+  {
+    return;
+  }
+
+  if (archetype->chunks)
+  {
+    for (i = 0; i < x_array_count(archetype->chunks); ++i)
+    {
+      LDKArchetypeChunk* chunk = (LDKArchetypeChunk*)x_array_get(archetype->chunks, i);
+      LDK_FREE(chunk->data);
+    }
+
+    x_array_destroy(archetype->chunks);
+  }
+
+  if (archetype->edges)
+  {
+    x_array_destroy(archetype->edges);
+  }
+
+  LDK_FREE(archetype->component_types);
+  LDK_FREE(archetype->column_sizes);
+  LDK_FREE(archetype->column_offsets);
+  LDK_FREE(archetype);
+}
+
+static LDKArchetype* s_archetype_create(u32 id, const u32* component_types, const u32* component_sizes, u32 count)
+{
+  LDKArchetype* archetype = (LDKArchetype*)LDK_ALLOC(sizeof(LDKArchetype));
+  u32 row_bytes = (u32)sizeof(LDKEntity);
+  u32 rows = 0;
+  u32 i = 0;
+
+  if (!archetype)
+  {
+    return NULL;
+  }
+
+  memset(archetype, 0, sizeof(*archetype));
+  archetype->id = id;
+  archetype->column_count = count;
+
+  if (count > 0)
+  {
+    archetype->component_types = (u32*)LDK_ALLOC(sizeof(u32) * count);
+    archetype->column_sizes = (u32*)LDK_ALLOC(sizeof(u32) * count);
+    archetype->column_offsets = (u32*)LDK_ALLOC(sizeof(u32) * count);
+
+    if (!archetype->component_types || !archetype->column_sizes || !archetype->column_offsets)
+    {
+      s_archetype_destroy(archetype);
+      return NULL;
+    }
+
+    memcpy(archetype->component_types, component_types, sizeof(u32) * count);
+    memcpy(archetype->column_sizes, component_sizes, sizeof(u32) * count);
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    row_bytes += component_sizes[i];
+  }
+
+  rows = LDK_ARCHETYPE_CHUNK_SIZE / row_bytes;
+
+  while (rows > 1 && s_archetype_layout(archetype, rows) > LDK_ARCHETYPE_CHUNK_SIZE)
+  {
+    rows--;
+  }
+
+  if (rows == 0)
+  {
+    rows = 1;
+  }
+
+  archetype->chunk_capacity = rows;
+  archetype->chunk_bytes = s_archetype_layout(archetype, rows);
+  archetype->chunks = x_array_create(sizeof(LDKArchetypeChunk), 4);
+  archetype->edges = x_array_create(sizeof(LDKArchetypeEdge), 4);
+
+  if (!archetype->chunks || !archetype->edges)
+  {
+    s_archetype_destroy(archetype);
+    return NULL;
+  }
+
+  return archetype;
+}
+
+static LDKArchetypeEdge* s_archetype_edge_get(LDKArchetype* archetype, u32 component_type, bool create)
+{
+  LDKArchetypeEdge edge = {0};
+  u32 count = x_array_count(archetype->edges);
+  u32 i = 0;
+
+  for (i = 0; i < count; ++i)
+  {
+    LDKArchetypeEdge* e = (LDKArchetypeEdge*)x_array_get(archetype->edges, i);
+
+    if (e->component_type == component_type)
+    {
+      return e;
+    }
+  }
+
+  if (!create)
+  {
+    return NULL;
+  }
+
+  edge.component_type = component_type;
+  edge.add = LDK_ARCHETYPE_NONE;
+  edge.remove = LDK_ARCHETYPE_NONE;
+  x_array_push(archetype->edges, &edge);
+  return (LDKArchetypeEdge*)x_array_get(archetype->edges, count);
+}
+
+bool ldk_archetype_table_initialize(LDKArchetypeTable* table)
+{
+  LDKArchetype* root = NULL;
+
+  if (!table)
+  {
+    return false;
+  }
+
+  memset(table, 0, sizeof(*table));
+
+  table->archetypes = x_array_create(sizeof(LDKArchetype*), 16);
+  if (!table->archetypes)
+  {
+    return false;
+  }
+
+  root = s_archetype_create(LDK_ARCHETYPE_EMPTY, NULL, NULL, 0);
+  if (!root)
+  {
+    x_array_destroy(table->archetypes);
+    table->archetypes = NULL;
+    return false;
+  }
+
+  x_array_push(table->archetypes, &root);
+  return true;
+}
+
+void ldk_archetype_table_terminate(LDKArchetypeTable* table)
+{
+  u32 i = 0;
+
+  if (!table || !table->archetypes)
+  {
+    return;
+  }
+
+  for (i = 0; i < x_array_count(table->archetypes); ++i)
+  {
+    s_archetype_destroy(*(LDKArchetype**)x_array_get(table->archetypes, i));
+  }
+
+  x_array_destroy(table->archetypes);
+  memset(table, 0, sizeof(*table));
+}
+
+u32 ldk_archetype_count(const LDKArchetypeTable* table)
+{
+  if (!table || !table->archetypes)
+  {
+    return 0;
+  }
+
+  return x_array_count(table->archetypes);
+}
+
+LDKArchetype* ldk_archetype_get(const LDKArchetypeTable* table, u32 archetype_id)
+{
+  if (!table || !table->archetypes || archetype_id >= x_array_count(table->archetypes))
+  {
+    return NULL;
+  }
+
+  return *(LDKArchetype**)x_array_get(table->archetypes, archetype_id);
+}
+
+u32 ldk_archetype_find_or_create(LDKArchetypeTable* table, const u32* component_types,
+    const u32* component_sizes, u32 count)
+{
+  u32* types = NULL;
+  u32* sizes = NULL;
+  LDKArchetype* archetype = NULL;
+  u32 result = LDK_ARCHETYPE_NONE;
+  u32 archetype_count = 0;
+  u32 i = 0;
+  u32 j = 0;
+
+  if (!table || !table->archetypes || (count > 0 && (!component_types || !component_sizes)))
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  if (count == 0)
+  {
+    return LDK_ARCHETYPE_EMPTY;
+  }
+
+  types = (u32*)LDK_ALLOC(sizeof(u32) * count * 2);
+  if (!types)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  sizes = types + count;
+  memcpy(types, component_types, sizeof(u32) * count);
+  memcpy(sizes, component_sizes, sizeof(u32) * count);
+
+  // Keep a canonical (sorted) order so the same set always maps to the same archetype
+  for (i = 1; i < count; ++i)
+  {
+    u32 type = types[i];
+    u32 size = sizes[i];
+
+    for (j = i; j > 0 && types[j - 1] > type; --j)
+    {
+      types[j] = types[j - 1];
+      sizes[j] = sizes[j - 1];
+    }
+
+    types[j] = type;
+    sizes[j] = size;
+  }
+
+  archetype_count = x_array_count(table->archetypes);
+
+  for (i = 0; i < archetype_count; ++i)
+  {
+    LDKArchetype* candidate = *(LDKArchetype**)x_array_get(table->archetypes, i);
+
+    if (candidate->column_count == count &&
+        memcmp(candidate->component_types, types, sizeof(u32) * count) == 0)
+    {
+      result = i;
+      break;
+    }
+  }
+
+  if (result == LDK_ARCHETYPE_NONE)
+  {
+    archetype = s_archetype_create(archetype_count, types, sizes, count);
+    if (archetype)
+    {
+      x_array_push(table->archetypes, &archetype);
+      result = archetype_count;
+    }
+  }
+
+  LDK_FREE(types);
+  return result;
+}
+
+u32 ldk_archetype_transition_add(LDKArchetypeTable* table, u32 archetype_id, u32 component_type, u32 component_size)
+{
+  LDKArchetype* source = NULL;
+  LDKArchetypeEdge* edge = NULL;
+  u32* types = NULL;
+  u32* sizes = NULL;
+  u32 target = LDK_ARCHETYPE_NONE;
+  u32 source_id = archetype_id == LDK_ARCHETYPE_NONE ? LDK_ARCHETYPE_EMPTY : archetype_id;
+  u32 count = 0;
+
+  source = ldk_archetype_get(table, source_id);
+  if (!source)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  edge = s_archetype_edge_get(source, component_type, false);
+  if (edge && edge->add != LDK_ARCHETYPE_NONE)
+  {
+    return edge->add;
+  }
+
+  if (ldk_archetype_column_find(source, component_type) != LDK_ENTITY_INVALID_COMPONENT_INDEX)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  count = source->column_count + 1;
+  types = (u32*)LDK_ALLOC(sizeof(u32) * count * 2);
+  if (!types)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  sizes = types + count;
+  if (source->column_count > 0)
+  {
+    memcpy(types, source->component_types, sizeof(u32) * source->column_count);
+    memcpy(sizes, source->column_sizes, sizeof(u32) * source->column_count);
+  }
+  types[count - 1] = component_type;
+  sizes[count - 1] = component_size;
+
+  target = ldk_archetype_find_or_create(table, types, sizes, count);
+  LDK_FREE(types);
+
+  if (target == LDK_ARCHETYPE_NONE)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  edge = s_archetype_edge_get(source, component_type, true);
+  if (edge)
+  {
+    edge->add = target;
+  }
+
+  edge = s_archetype_edge_get(ldk_archetype_get(table, target), component_type, true);
+  if (edge)
+  {
+    edge->remove = source_id;
+  }
+
+  return target;
+}
+
+u32 ldk_archetype_transition_remove(LDKArchetypeTable* table, u32 archetype_id, u32 component_type)
+{
+  LDKArchetype* source = NULL;
+  LDKArchetypeEdge* edge = NULL;
+  u32* types = NULL;
+  u32* sizes = NULL;
+  u32 target = LDK_ARCHETYPE_NONE;
+  u32 column = 0;
+  u32 count = 0;
+  u32 i = 0;
+
+  if (archetype_id == LDK_ARCHETYPE_NONE || archetype_id == LDK_ARCHETYPE_EMPTY)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  source = ldk_archetype_get(table, archetype_id);
+  if (!source)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  edge = s_archetype_edge_get(source, component_type, false);
+  if (edge && edge->remove != LDK_ARCHETYPE_NONE)
+  {
+    return edge->remove == LDK_ARCHETYPE_EMPTY ? LDK_ARCHETYPE_NONE : edge->remove;
+  }
+
+  column = ldk_archetype_column_find(source, component_type);
+  if (column == LDK_ENTITY_INVALID_COMPONENT_INDEX)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  count = source->column_count - 1;
+
+  if (count > 0)
+  {
+    types = (u32*)LDK_ALLOC(sizeof(u32) * count * 2);
+    if (!types)
+    {
+      return LDK_ARCHETYPE_NONE;
+    }
+
+    sizes = types + count;
+    for (i = 0; i < column; ++i)
+    {
+      types[i] = source->component_types[i];
+      sizes[i] = source->column_sizes[i];
+    }
+
+    for (i = column + 1; i < source->column_count; ++i)
+    {
+      types[i - 1] = source->component_types[i];
+      sizes[i - 1] = source->column_sizes[i];
+    }
+  }
+
+  target = ldk_archetype_find_or_create(table, types, sizes, count);
+  LDK_FREE(types);
+
+  if (target == LDK_ARCHETYPE_NONE)
+  {
+    return LDK_ARCHETYPE_NONE;
+  }
+
+  edge = s_archetype_edge_get(source, component_type, true);
+  if (edge)
+  {
+    edge->remove = target;
+  }
+
+  edge = s_archetype_edge_get(ldk_archetype_get(table, target), component_type, true);
+  if (edge)
+  {
+    edge->add = archetype_id;
+  }
+
+  return target == LDK_ARCHETYPE_EMPTY ? LDK_ARCHETYPE_NONE : target;
+}
+
+u32 ldk_archetype_column_find(const LDKArchetype* archetype, u32 component_type)
+{
+  u32 low = 0;
+  u32 high = 0;
+
+  if (!archetype)
+  {
+    return LDK_ENTITY_INVALID_COMPONENT_INDEX;
+  }
+
+  high = archetype->column_count;
+
+  while (low < high)
+  {
+    u32 mid = low + (high - low) / 2;
+    u32 type = archetype->component_types[mid];
+
+    if (type == component_type)
+    {
+      return mid;
+    }
+
+    if (type < component_type)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+
+  return LDK_ENTITY_INVALID_COMPONENT_INDEX;
+}
+
+bool ldk_archetype_has_all(const LDKArchetype* archetype, const u32* component_types, u32 count)
+{
+  u32 i = 0;
+
+  if (!archetype)
+  {
+    return false;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    if (ldk_archetype_column_find(archetype, component_types[i]) == LDK_ENTITY_INVALID_COMPONENT_INDEX)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+u32 ldk_archetype_row_alloc(LDKArchetype* archetype, LDKEntity entity)
+{
+  LDKArchetypeChunk* chunk = NULL;
+  u32 row = 0;
+  u32 chunk_index = 0;
+  u32 slot = 0;
+  u32 i = 0;
+
+  if (!archetype || archetype->id == LDK_ARCHETYPE_EMPTY)
+  {
+    return LDK_ENTITY_INVALID_COMPONENT_INDEX;
+  }
+
+  row = archetype->entity_count;
+  chunk_index = row / archetype->chunk_capacity;
+  slot = row % archetype->chunk_capacity;
+
+  if (chunk_index >= x_array_count(archetype->chunks))
+  {
+    LDKArchetypeChunk new_chunk = {0};
+
+    new_chunk.data = (u8*)LDK_ALLOC(archetype->chunk_bytes);
+    if (!new_chunk.data)
+    {
+      return LDK_ENTITY_INVALID_COMPONENT_INDEX;
+    }
+
+    x_array_push(archetype->chunks, &new_chunk);
+  }
+
+  chunk = (LDKArchetypeChunk*)x_array_get(archetype->chunks, chunk_index);
+  ldk_archetype_chunk_entities(chunk)[slot] = entity;
+
+  for (i = 0; i < archetype->column_count; ++i)
+  {
+    u32 size = archetype->column_sizes[i];
+    memset(chunk->data + archetype->column_offsets[i] + (size_t)slot * size, 0, size);
+  }
+
+  chunk->count = slot + 1;
+  archetype->entity_count = row + 1;
+  return row;
+}
+
+bool ldk_archetype_row_free(LDKArchetype* archetype, u32 row, LDKEntity* out_moved)
+{
+  LDKArchetypeChunk* dst_chunk = NULL;
+  LDKArchetypeChunk* src_chunk = NULL;
+  u32 last = 0;
+  u32 dst_slot = 0;
+  u32 src_slot = 0;
+  bool moved = false;
+  u32 i = 0;
+
+  if (out_moved)
+  {
+    *out_moved = x_handle_null();
+  }
+
+  if (!archetype || row >= archetype->entity_count)
+  {
+    return false;
+  }
+
+  last = archetype->entity_count - 1;
+  dst_slot = row % archetype->chunk_capacity;
+  src_slot = last % archetype->chunk_capacity;
+  dst_chunk = (LDKArchetypeChunk*)x_array_get(archetype->chunks, row / archetype->chunk_capacity);
+  src_chunk = (LDKArchetypeChunk*)x_array_get(archetype->chunks, last / archetype->chunk_capacity);
+
+  if (row != last)
+  {
+    LDKEntity* dst_entities = ldk_archetype_chunk_entities(dst_chunk);
+    LDKEntity* src_entities = ldk_archetype_chunk_entities(src_chunk);
+
+    for (i = 0; i < archetype->column_count; ++i)
+    {
+      u32 size = archetype->column_sizes[i];
+      u32 offset = archetype->column_offsets[i];
+
+      memcpy(dst_chunk->data + offset + (size_t)dst_slot * size,
+          src_chunk->data + offset + (size_t)src_slot * size,
+          size);
+    }
+
+    dst_entities[dst_slot] = src_entities[src_slot];
+    moved = true;
+
+    if (out_moved)
+    {
+      *out_moved = dst_entities[dst_slot];
+    }
+  }
+
+  src_chunk->count = src_slot;
+  archetype->entity_count = last;
+  return moved;
+}
+
+u32 ldk_archetype_row_move(LDKArchetype* src, u32 src_row, LDKArchetype* dst, LDKEntity* out_moved)
+{
+  u32 dst_row = 0;
+  u32 src_column = 0;
+  u32 dst_column = 0;
+
+  if (out_moved)
+  {
+    *out_moved = x_handle_null();
+  }
+
+  if (!src || !dst || src_row >= src->entity_count)
+  {
+    return LDK_ENTITY_INVALID_COMPONENT_INDEX;
+  }
+
+  dst_row = ldk_archetype_row_alloc(dst, ldk_archetype_row_entity_get(src, src_row));
+  if (dst_row == LDK_ENTITY_INVALID_COMPONENT_INDEX)
+  {
+    return LDK_ENTITY_INVALID_COMPONENT_INDEX;
+  }
+
+  // Both type lists are sorted so shared columns can be matched in a single pass
+  while (src_column < src->column_count && dst_column < dst->column_count)
+  {
+    u32 src_type = src->component_types[src_column];
+    u32 dst_type = dst->component_types[dst_column];
+
+    if (src_type == dst_type)
+    {
+      memcpy(ldk_archetype_row_component_get(dst, dst_column, dst_row),
+          ldk_archetype_row_component_get(src, src_column, src_row),
+          dst->column_sizes[dst_column]);
+      src_column++;
+      dst_column++;
+    }
+    else if (src_type < dst_type)
+    {
+      src_column++;
+    }
+    else
+    {
+      dst_column++;
+    }
+  }
+
+  ldk_archetype_row_free(src, src_row, out_moved);
+  return dst_row;
+}
+
+void* ldk_archetype_row_component_get(const LDKArchetype* archetype, u32 column, u32 row)
+{
+  LDKArchetypeChunk* chunk = NULL;
+  u32 size = 0;
+
+  if (!archetype || column >= archetype->column_count || row >= archetype->entity_count)
+  {
+    return NULL;
+  }
+
+  chunk = (LDKArchetypeChunk*)x_array_get(archetype->chunks, row / archetype->chunk_capacity);
+  size = archetype->column_sizes[column];
+  return chunk->data + archetype->column_offsets[column] + (size_t)(row % archetype->chunk_capacity) * size;
+}
+
+LDKEntity ldk_archetype_row_entity_get(const LDKArchetype* archetype, u32 row)
+{
+  LDKArchetypeChunk* chunk = NULL;
+
+  if (!archetype || row >= archetype->entity_count)
+  {
+    return x_handle_null();
+  }
+
+  chunk = (LDKArchetypeChunk*)x_array_get(archetype->chunks, row / archetype->chunk_capacity);
+  return ldk_archetype_chunk_entities(chunk)[row % archetype->chunk_capacity];
+}
+
+u32 ldk_archetype_chunk_count(const LDKArchetype* archetype)
+{
+  if (!archetype || archetype->entity_count == 0)
+  {
+    return 0;
+  }
+
+  // Trailing chunks may be allocated but empty; only report the occupied ones
+  return (archetype->entity_count + archetype->chunk_capacity - 1) / archetype->chunk_capacity;
+}
+
+LDKArchetypeChunk* ldk_archetype_chunk_get(const LDKArchetype* archetype, u32 chunk_index)
+{
+  if (!archetype || chunk_index >= ldk_archetype_chunk_count(archetype))
+  {
+    return NULL;
+  }
+
+  return (LDKArchetypeChunk*)x_array_get(archetype->chunks, chunk_index);
+}
+
+LDKEntity* ldk_archetype_chunk_entities(const LDKArchetypeChunk* chunk)
+{
+  if (!chunk)
+  {
+    return NULL;
+  }
+
+  return (LDKEntity*)chunk->data;
+}
+
+void* ldk_archetype_chunk_column(const LDKArchetype* archetype, const LDKArchetypeChunk* chunk, u32 column)
+{
+  if (!archetype || !chunk || column >= archetype->column_count)
+  {
+    return NULL;
+  }
+
+  return chunk->data + archetype->column_offsets[column];
+}
+
+static u32 s_archetype_used_chunks(const LDKArchetype* archetype)
+{
+  return (archetype->entity_count + archetype->chunk_capacity - 1) / archetype->chunk_capacity;
+}
+
+bool ldk_archetype_table_snapshot_capture(const LDKArchetypeTable* table, LDKArchetypeSnapshot* snapshot)
+{
+  u32 count = ldk_archetype_count(table);
+  size_t bytes = 0;
+  u8* data = NULL;
+  u32 i = 0;
+
+  if (!table || !snapshot)
+  {
+    return false;
+  }
+
+  if (!snapshot->entity_counts)
+  {
+    snapshot->entity_counts = x_array_create(sizeof(u32), 16);
+    snapshot->chunks = x_array_create(1, 1024);
+  }
+
+  if (!snapshot->entity_counts || !snapshot->chunks)
+  {
+    return false;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    const LDKArchetype* archetype = ldk_archetype_get(table, i);
+    bytes += (size_t)s_archetype_used_chunks(archetype) * archetype->chunk_bytes;
+  }
+
+  if (x_array_resize(snapshot->entity_counts, count) != XARRAY_OK ||
+      x_array_resize(snapshot->chunks, bytes) != XARRAY_OK)
+  {
+    return false;
+  }
+
+  data = (u8*)x_array_data(snapshot->chunks);
+
+  for (i = 0; i < count; ++i)
+  {
+    const LDKArchetype* archetype = ldk_archetype_get(table, i);
+    u32 used = s_archetype_used_chunks(archetype);
+    u32 c = 0;
+
+    *(u32*)x_array_get(snapshot->entity_counts, i) = archetype->entity_count;
+
+    for (c = 0; c < used; ++c)
+    {
+      memcpy(data, ldk_archetype_chunk_get(archetype, c)->data, archetype->chunk_bytes);
+      data += archetype->chunk_bytes;
+    }
+  }
+
+  return true;
+}
+
+bool ldk_archetype_table_snapshot_restore(LDKArchetypeTable* table, const LDKArchetypeSnapshot* snapshot)
+{
+  u32 count = ldk_archetype_count(table);
+  u32 captured = 0;
+  const u8* data = NULL;
+  u32 i = 0;
+
+  if (!table || !snapshot || !snapshot->entity_counts)
+  {
+    return false;
+  }
+
+  captured = x_array_count(snapshot->entity_counts);
+  data = (const u8*)x_array_data(snapshot->chunks);
+
+  // The archetype list only grows, so captured ids still name the same component sets
+  if (captured > count)
+  {
+    return false;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    LDKArchetype* archetype = ldk_archetype_get(table, i);
+    u32 entity_count = i < captured ? *(u32*)x_array_get(snapshot->entity_counts, i) : 0;
+    u32 c = 0;
+
+    archetype->entity_count = entity_count;
+
+    // Chunks past the restored entity count are kept for reuse but emptied
+    for (c = 0; c < x_array_count(archetype->chunks); ++c)
+    {
+      ((LDKArchetypeChunk*)x_array_get(archetype->chunks, c))->count = 0;
+    }
+
+    for (c = 0; c < s_archetype_used_chunks(archetype); ++c)
+    {
+      LDKArchetypeChunk* chunk = NULL;
+      u32 rows = entity_count - c * archetype->chunk_capacity;
+
+      if (c >= x_array_count(archetype->chunks))
+      {
+        LDKArchetypeChunk new_chunk = {0};
+
+        new_chunk.data = (u8*)LDK_ALLOC(archetype->chunk_bytes);
+        if (!new_chunk.data)
+        {
+          archetype->entity_count = c * archetype->chunk_capacity;
+          return false;
+        }
+
+        x_array_push(archetype->chunks, &new_chunk);
+      }
+
+      chunk = ldk_archetype_chunk_get(archetype, c);
+      memcpy(chunk->data, data, archetype->chunk_bytes);
+      chunk->count = rows < archetype->chunk_capacity ? rows : archetype->chunk_capacity;
+      data += archetype->chunk_bytes;
+    }
+  }
+
+  return true;
+}
+
+void ldk_archetype_table_snapshot_release(LDKArchetypeSnapshot* snapshot)
+{
+  if (!snapshot)
+  {
+    return;
+  }
+
+  if (snapshot->entity_counts)
+  {
+    x_array_destroy(snapshot->entity_counts);
+  }
+
+  if (snapshot->chunks)
+  {
+    x_array_destroy(snapshot->chunks);
+  }
+
+  snapshot->entity_counts = NULL;
+  snapshot->chunks = NULL;
+}
@@ -1,100 +1,282 @@
 #include <ldk_common.h>
 #include <module/ldk_entity.h>
 #include <module/ldk_component.h>
+#include <module/ldk_jobs.h>
 #include <stdx/stdx_array.h>
 #include <stdx/stdx_hashtable.h>
 
+#ifndef LDK_ALLOC
+#include <stdlib.h>
+#define LDK_ALLOC(size) malloc(size)
+#define LDK_FREE(ptr) free(ptr)
+#endif
+
+#include <stdlib.h>
 #include <string.h>
 
-bool ldk_component_registry_initialize(LDKComponentRegistry* registry)
+static u32 s_component_slot_resolve(LDKComponentRegistry* registry, u32 type)
 {
-  if (!registry)
+  u32 slot = LDK_COMPONENT_INVALID_SLOT;
+
+  if (type < LDK_COMPONENT_DIRECT_TYPES)
   {
-    return false;
+    return registry->direct_slots[type];
   }
 
-  memset(registry, 0, sizeof(*registry));
+  if (type > UINT32_MAX - LDK_COMPONENT_BUILTIN_TYPES)
+  {
+    return registry->builtin_slots[UINT32_MAX - type];
+  }
 
-  registry->table = x_hashtable_u32_registered_component_create();
+  if (!x_hashtable_u32_component_slot_get(registry->slots, type, &slot))
+  {
+    return LDK_COMPONENT_INVALID_SLOT;
+  }
 
-  return registry->table != NULL;
+  return slot;
 }
 
-void ldk_component_registry_terminate(LDKComponentRegistry* registry)
+static LDKRegisteredComponent* s_component_entry_get(LDKComponentRegistry* registry, u32 type)
 {
-  XHashtableIter it;
-  void* key;
-  void* value;
+  u32 slot = 0;
 
-  if (!registry || !registry->table)
+  if (!registry || !registry->entries)
   {
-    return;
+    return NULL;
+  }
+
+  slot = s_component_slot_resolve(registry, type);
+  if (slot == LDK_COMPONENT_INVALID_SLOT)
+  {
+    return NULL;
+  }
+
+  return &registry->entries[slot];
+}
+
+/* Resolves component data for both packed and archetype storage */
+static void* s_component_data_get(LDKComponentRegistry* registry, const LDKRegisteredComponent* registered_component,
+    LDKEntityRegistry* entity_registry, LDKEntity entity, u32 component_index)
+{
+  const LDKEntityInfo* info = NULL;
+
+  if (registered_component->desc.storage != LDK_COMPONENT_STORAGE_ARCHETYPE)
+  {
+    return ldk_component_get_by_slot(registry, registered_component->slot, component_index);
   }
 
-  if (x_hashtable_iter_begin((XHashtable*)registry->table, &it))
+  info = ldk_entity_info_get(entity_registry, entity);
+  if (!info)
+  {
+    return NULL;
+  }
+
+  return ldk_component_archetype_data_get(registry, info->archetype, info->archetype_row, registered_component->desc.type);
+}
+
+/* Size of one store element: the component itself, or a pointer to it for paged storage */
+static u32 s_component_store_stride(const LDKRegisteredComponent* entry)
+{
+  return entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED ? (u32)sizeof(void*) : entry->desc.entry_size;
+}
+
+/* Takes a zeroed component from the pages of entry, adding a page when none is free */
+static void* s_component_paged_alloc(LDKRegisteredComponent* entry)
+{
+  void* component = NULL;
+  u32 count = x_array_count(entry->free_slots);
+
+  if (count == 0)
   {
-    while (x_hashtable_iter_next(&it, &key, &value))
+    u8* page = (u8*)LDK_ALLOC((size_t)entry->desc.entry_size * LDK_COMPONENT_PAGE_CAPACITY);
+    u32 i = 0;
+
+    if (!page)
     {
-      LDKRegisteredComponent* comp = (LDKRegisteredComponent*)value;
+      return NULL;
+    }
 
-      if (comp->store)
-      {
-        x_array_destroy(comp->store);
-      }
+    x_array_push(entry->pages, &page);
 
-      if (comp->owners)
-      {
-        x_array_destroy(comp->owners);
-      }
+    // Pushed backwards so components are handed out in address order
+    for (i = LDK_COMPONENT_PAGE_CAPACITY; i > 0; --i)
+    {
+      void* slot = page + (size_t)(i - 1) * entry->desc.entry_size;
+      x_array_push(entry->free_slots, &slot);
     }
+
+    count = x_array_count(entry->free_slots);
   }
 
-  x_hashtable_u32_registered_component_destroy(registry->table);
-  memset(registry, 0, sizeof(*registry));
+  component = *(void**)x_array_get(entry->free_slots, count - 1);
+  x_array_pop(entry->free_slots);
+  memset(component, 0, entry->desc.entry_size);
+  return component;
 }
 
-bool ldk_component_is_registered(LDKComponentRegistry* registry, u32 type)
+static void s_component_paged_release(LDKRegisteredComponent* entry, void* component)
+{
+  x_array_push(entry->free_slots, &component);
+}
+
+/* Returns every component of the pages to the free list */
+static void s_component_pages_reset(LDKRegisteredComponent* entry)
+{
+  u32 page_count = x_array_count(entry->pages);
+  u32 i = 0;
+  u32 j = 0;
+
+  x_array_clear(entry->free_slots);
+
+  for (i = page_count; i > 0; --i)
+  {
+    u8* page = *(u8**)x_array_get(entry->pages, i - 1);
+
+    for (j = LDK_COMPONENT_PAGE_CAPACITY; j > 0; --j)
+    {
+      void* slot = page + (size_t)(j - 1) * entry->desc.entry_size;
+      x_array_push(entry->free_slots, &slot);
+    }
+  }
+}
+
+static void s_component_pages_free(LDKRegisteredComponent* entry)
+{
+  u32 i = 0;
+
+  for (i = 0; i < x_array_count(entry->pages); ++i)
+  {
+    LDK_FREE(*(u8**)x_array_get(entry->pages, i));
+  }
+
+  x_array_clear(entry->pages);
+  x_array_clear(entry->free_slots);
+}
+
+bool ldk_component_registry_initialize(LDKComponentRegistry* registry)
 {
-  if (!registry || !registry->table)
+  if (!registry)
+  {
+    return false;
+  }
+
+  memset(registry, 0, sizeof(*registry));
+  memset(registry->direct_slots, 0xFF, sizeof(registry->direct_slots));
+  memset(registry->builtin_slots, 0xFF, sizeof(registry->builtin_slots));
+
+  registry->entries = (LDKRegisteredComponent*)LDK_ALLOC(sizeof(LDKRegisteredComponent) * LDK_COMPONENT_MAX_TYPES);
+  if (!registry->entries)
+  {
+    return false;
+  }
+
+  registry->slots = x_hashtable_u32_component_slot_create();
+  if (!registry->slots)
   {
+    LDK_FREE(registry->entries);
+    registry->entries = NULL;
     return false;
   }
 
-  return x_hashtable_u32_registered_component_has(registry->table, type);
+  if (!ldk_archetype_table_initialize(&registry->archetypes))
+  {
+    x_hashtable_u32_component_slot_destroy(registry->slots);
+    LDK_FREE(registry->entries);
+    registry->slots = NULL;
+    registry->entries = NULL;
+    return false;
+  }
+
+  if (!ldk_query_registry_initialize(&registry->queries))
+  {
+    ldk_archetype_table_terminate(&registry->archetypes);
+    x_hashtable_u32_component_slot_destroy(registry->slots);
+    LDK_FREE(registry->entries);
+    registry->slots = NULL;
+    registry->entries = NULL;
+    return false;
+  }
+
+  // Tick 0 is "before anything happened" so every component is changed since 0
+  registry->tick = 1;
+  return true;
 }
 
-XArray* ldk_component_store_get(LDKComponentRegistry* registry, u32 type)
+void ldk_component_registry_terminate(LDKComponentRegistry* registry)
 {
-  LDKRegisteredComponent entry;
+  u32 i = 0;
 
-  if (!registry || !registry->table)
+  if (!registry || !registry->entries)
   {
-    return NULL;
+    return;
   }
 
-  if (!x_hashtable_u32_registered_component_get(registry->table, type, &entry))
+  for (i = 0; i < registry->count; ++i)
   {
-    return NULL;
+    LDKRegisteredComponent* comp = &registry->entries[i];
+
+    if (comp->store)
+    {
+      x_array_destroy(comp->store);
+    }
+
+    if (comp->owners)
+    {
+      x_array_destroy(comp->owners);
+    }
+
+    if (comp->ticks)
+    {
+      x_array_destroy(comp->ticks);
+    }
+
+    if (comp->disabled)
+    {
+      x_array_destroy(comp->disabled);
+    }
+
+    if (comp->pages)
+    {
+      s_component_pages_free(comp);
+      x_array_destroy(comp->pages);
+      x_array_destroy(comp->free_slots);
+    }
   }
 
-  return entry.store;
+  x_hashtable_u32_component_slot_destroy(registry->slots);
+  LDK_FREE(registry->entries);
+  ldk_archetype_table_terminate(&registry->archetypes);
+  ldk_query_registry_terminate(&registry->queries);
+  memset(registry, 0, sizeof(*registry));
 }
 
-XArray* ldk_component_owners_get(LDKComponentRegistry* registry, u32 type)
+bool ldk_component_is_registered(LDKComponentRegistry* registry, u32 type)
 {
-  LDKRegisteredComponent entry;
+  return s_component_entry_get(registry, type) != NULL;
+}
+
+XArray* ldk_component_store_get(LDKComponentRegistry* registry, u32 type)
+{
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, type);
 
-  if (!registry || !registry->table)
+  if (!entry)
   {
     return NULL;
   }
 
-  if (!x_hashtable_u32_registered_component_get(registry->table, type, &entry))
+  return entry->store;
+}
+
+XArray* ldk_component_owners_get(LDKComponentRegistry* registry, u32 type)
+{
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, type);
+
+  if (!entry)
   {
     return NULL;
   }
 
-  return entry.owners;
+  return entry->owners;
 }
 
 bool ldk_component_detach(LDKComponentRegistry* registry,
@@ -120,44 +302,98 @@ void ldk_component_registry_remove_all(LDKComponentRegistry* registry,
   // WARNING: removes ALL components, including core ones (Transform).
   // Intended for entity destruction only.
 
+  LDKEntityColdInfo* cold;
   LDKEntityInfo* info;
+  u32 word;
 
   if (!registry || !entity_system)
   {
     return;
   }
 
-  info = ldk_entity_info_get(entity_system, entity);
-  if (!info)
+  cold = ldk_entity_cold_info_get(entity_system, entity);
+  if (!cold)
   {
     return;
   }
 
-  while (info->components.component_count > 0)
+  while (cold->components.component_count > 0)
   {
     u32 last;
     u32 component_type;
 
-    last = (u32)info->components.component_count - 1;
-    component_type = info->components.component_type[last];
+    last = (u32)cold->components.component_count - 1;
+    component_type = ldk_component_directory_types(&cold->components)[last];
 
     if (!ldk_component_detach(registry, entity_system, entity, component_type))
     {
       break;
     }
   }
+
+  // Tags are not in the directory
+  info = ldk_entity_info_get(entity_system, entity);
+
+  for (word = 0; info && word < LDK_COMPONENT_MASK_WORDS; ++word)
+  {
+    u64 tags = info->mask.bits[word] & registry->tag_mask.bits[word];
+
+    while (tags)
+    {
+      u32 slot = word * 64 + ldk_popcount64((tags & (~tags + 1)) - 1);
+      tags &= tags - 1;
+      ldk_entity_tag_remove(entity_system, registry, entity, registry->entries[slot].desc.type);
+    }
+  }
 }
 
-void* ldk_component_create(LDKComponentRegistry* module, u32 component_type, u32* component_index)
+/* Makes room for count disabled bits. New words are clear, so new components start enabled. */
+static bool s_component_disabled_reserve(LDKRegisteredComponent* entry, u32 count)
 {
-  LDKRegisteredComponent registered_component = {0};
+  u32 words = (count + 63) / 64;
+  u32 old_words = (u32)x_array_count(entry->disabled);
 
-  if (!module)
+  if (words <= old_words)
   {
-    return NULL;
+    return true;
+  }
+
+  if (x_array_resize(entry->disabled, words) != XARRAY_OK)
+  {
+    return false;
+  }
+
+  memset(x_array_get(entry->disabled, old_words), 0, sizeof(u64) * (words - old_words));
+  return true;
+}
+
+static void s_component_disabled_assign(LDKRegisteredComponent* entry, u32 index, bool disabled)
+{
+  u64* word = (u64*)x_array_get(entry->disabled, index >> 6);
+  u64 bit = (u64)1 << (index & 63);
+
+  if (((*word & bit) != 0) == disabled)
+  {
+    return;
+  }
+
+  if (disabled)
+  {
+    *word |= bit;
+    entry->disabled_count++;
+  }
+  else
+  {
+    *word &= ~bit;
+    entry->disabled_count--;
   }
+}
+
+void* ldk_component_create(LDKComponentRegistry* module, u32 component_type, u32* component_index)
+{
+  LDKRegisteredComponent* registered_component = NULL;
 
-  if (!module->table)
+  if (!module)
   {
     return NULL;
   }
@@ -167,119 +403,223 @@ void* ldk_component_create(LDKComponentRegistry* module, u32 component_type, u32
     return NULL;
   }
 
-  if (!x_hashtable_u32_registered_component_get(module->table,
-        component_type, &registered_component))
+  registered_component = s_component_entry_get(module, component_type);
+  if (!registered_component)
   {
     return NULL;
   }
 
-  if (!registered_component.store)
+  if (!registered_component->store)
   {
     return NULL;
   }
 
-  if (!registered_component.owners)
+  if (!registered_component->owners)
   {
     return NULL;
   }
 
-  if (x_array_count(registered_component.store) !=
-      x_array_count(registered_component.owners))
+  if (x_array_count(registered_component->store) !=
+      x_array_count(registered_component->owners))
   {
     return NULL;
   }
 
-  u32 new_index = (u32)x_array_count(registered_component.store);
+  u32 new_index = (u32)x_array_count(registered_component->store);
   LDKEntity owner = x_handle_null();
+  LDKComponentTicks ticks = { module->tick, module->tick };
   void* component = NULL;
+  void* paged = NULL;
+
+  if (registered_component->desc.storage == LDK_COMPONENT_STORAGE_PAGED)
+  {
+    paged = s_component_paged_alloc(registered_component);
+    if (!paged)
+    {
+      return NULL;
+    }
+  }
 
-  x_array_push(registered_component.store, NULL);
-  x_array_push(registered_component.owners, &owner);
-  component = x_array_get(registered_component.store, new_index);
+  x_array_push(registered_component->store, NULL);
+  x_array_push(registered_component->owners, &owner);
+  x_array_push(registered_component->ticks, &ticks);
+  component = x_array_get(registered_component->store, new_index);
 
-  if (!component)
+  if (!component || x_array_count(registered_component->ticks) != new_index + 1 ||
+      !s_component_disabled_reserve(registered_component, new_index + 1))
   {
-    x_array_pop(registered_component.owners);
-    x_array_pop(registered_component.store);
+    x_array_resize(registered_component->ticks, new_index);
+    x_array_resize(registered_component->owners, new_index);
+    x_array_resize(registered_component->store, new_index);
+    if (paged)
+    {
+      s_component_paged_release(registered_component, paged);
+    }
     return NULL;
   }
 
-  memset(component, 0, registered_component.desc.entry_size);
+  if (paged)
+  {
+    *(void**)component = paged;
+    component = paged;
+  }
+  else
+  {
+    memset(component, 0, registered_component->desc.entry_size);
+  }
+  registered_component->layout_version++;
   *component_index = new_index;
   return component;
 }
 
-void* ldk_component_get(LDKComponentRegistry* module, u32 component_type, u32 component_index)
+void* ldk_component_create_batch(LDKComponentRegistry* module, u32 component_type, u32 count, u32* first_index)
 {
-  LDKRegisteredComponent registered_component = {0};
+  LDKRegisteredComponent* registered_component = NULL;
+  LDKEntity* owners = NULL;
+  LDKComponentTicks* ticks = NULL;
+  u32 first = 0;
+  u8* components = NULL;
+  u32 i = 0;
+
+  if (!module || !first_index || count == 0)
+  {
+    return NULL;
+  }
 
-  if (!module)
+  registered_component = s_component_entry_get(module, component_type);
+  if (!registered_component)
+  {
+    return NULL;
+  }
+
+  // Paged components are not contiguous
+  if (registered_component->desc.storage != LDK_COMPONENT_STORAGE_PACKED)
+  {
+    return NULL;
+  }
+
+  if (!registered_component->store || !registered_component->owners)
+  {
+    return NULL;
+  }
+
+  if (x_array_count(registered_component->store) !=
+      x_array_count(registered_component->owners))
+  {
+    return NULL;
+  }
+
+  first = (u32)x_array_count(registered_component->store);
+
+  if (x_array_resize(registered_component->store, first + count) != XARRAY_OK)
+  {
+    return NULL;
+  }
+
+  if (x_array_resize(registered_component->owners, first + count) != XARRAY_OK)
   {
+    x_array_resize(registered_component->store, first);
     return NULL;
   }
 
-  if (!module->table)
+  if (x_array_resize(registered_component->ticks, first + count) != XARRAY_OK ||
+      !s_component_disabled_reserve(registered_component, first + count))
   {
+    x_array_resize(registered_component->ticks, first);
+    x_array_resize(registered_component->owners, first);
+    x_array_resize(registered_component->store, first);
     return NULL;
   }
 
-  if (!x_hashtable_u32_registered_component_get(module->table, component_type, &registered_component))
+  components = (u8*)x_array_get(registered_component->store, first);
+  owners = (LDKEntity*)x_array_get(registered_component->owners, first);
+  ticks = (LDKComponentTicks*)x_array_get(registered_component->ticks, first);
+
+  memset(components, 0, (size_t)registered_component->desc.entry_size * count);
+  for (i = 0; i < count; ++i)
+  {
+    owners[i] = x_handle_null();
+    ticks[i].added = module->tick;
+    ticks[i].changed = module->tick;
+  }
+
+  registered_component->layout_version++;
+  *first_index = first;
+  return components;
+}
+
+void* ldk_component_get(LDKComponentRegistry* module, u32 component_type, u32 component_index)
+{
+  LDKRegisteredComponent* registered_component = s_component_entry_get(module, component_type);
+
+  if (!registered_component)
   {
     return NULL;
   }
 
-  if (!registered_component.store)
+  if (!registered_component->store)
   {
     return NULL;
   }
 
-  if (component_index >= (u32)x_array_count(registered_component.store))
+  if (component_index >= (u32)x_array_count(registered_component->store))
   {
     return NULL;
   }
 
-  return x_array_get(registered_component.store, component_index);
+  return ldk_component_entry_data(registered_component, component_index);
 }
 
 bool ldk_component_destroy(LDKComponentRegistry* module, LDKEntityRegistry* entity_module,
     u32 component_type, u32 component_index)
 {
-  LDKRegisteredComponent registered_component = {0};
+  LDKRegisteredComponent* registered_component = NULL;
 
-  if (!module || !module->table || !entity_module)
+  if (!module || !entity_module)
   {
     return false;
   }
 
-  if (!x_hashtable_u32_registered_component_get(module->table, component_type, &registered_component))
+  registered_component = s_component_entry_get(module, component_type);
+  if (!registered_component)
   {
     return false;
   }
 
-  if (!registered_component.store || !registered_component.owners)
+  if (!registered_component->store || !registered_component->owners)
   {
     return false;
   }
 
-  if (x_array_count(registered_component.store) != x_array_count(registered_component.owners))
+  if (x_array_count(registered_component->store) != x_array_count(registered_component->owners))
   {
     return false;
   }
 
-  if (component_index >= (u32)x_array_count(registered_component.store))
+  if (component_index >= (u32)x_array_count(registered_component->store))
   {
     return false;
   }
 
   {
-    u32 last_index = (u32)x_array_count(registered_component.store) - 1;
+    u32 last_index = (u32)x_array_count(registered_component->store) - 1;
+    bool last_disabled = ldk_component_bits_test((const u64*)x_array_data(registered_component->disabled), last_index);
+
+    // The last component takes the removed index, its disabled bit goes with it
+    s_component_disabled_assign(registered_component, component_index, false);
+    s_component_disabled_assign(registered_component, last_index, false);
+
+    if (registered_component->desc.storage == LDK_COMPONENT_STORAGE_PAGED)
+    {
+      s_component_paged_release(registered_component, ldk_component_entry_data(registered_component, component_index));
+    }
 
     if (component_index != last_index)
     {
-      void* dst_component = x_array_get(registered_component.store, component_index);
-      void* src_component = x_array_get(registered_component.store, last_index);
-      void* dst_owner = x_array_get(registered_component.owners, component_index);
-      void* src_owner = x_array_get(registered_component.owners, last_index);
+      void* dst_component = x_array_get(registered_component->store, component_index);
+      void* src_component = x_array_get(registered_component->store, last_index);
+      void* dst_owner = x_array_get(registered_component->owners, component_index);
+      void* src_owner = x_array_get(registered_component->owners, last_index);
 
       if (!dst_component || !src_component || !dst_owner || !src_owner)
       {
@@ -289,13 +629,17 @@ bool ldk_component_destroy(LDKComponentRegistry* module, LDKEntityRegistry* enti
       memcpy(
           dst_component,
           src_component,
-          registered_component.desc.entry_size);
+          s_component_store_stride(registered_component));
 
       memcpy(
           dst_owner,
           src_owner,
           sizeof(LDKEntity));
 
+      *(LDKComponentTicks*)x_array_get(registered_component->ticks, component_index) =
+        *(LDKComponentTicks*)x_array_get(registered_component->ticks, last_index);
+      s_component_disabled_assign(registered_component, component_index, last_disabled);
+
       // Update entity TRANSFORM index
       LDKEntity moved_entity = *(LDKEntity*)src_owner;
       LDKEntityInfo* moved_info = ldk_entity_info_get(entity_module, moved_entity);
@@ -305,8 +649,10 @@ bool ldk_component_destroy(LDKComponentRegistry* module, LDKEntityRegistry* enti
       }
     }
 
-    x_array_pop(registered_component.store);
-    x_array_pop(registered_component.owners);
+    x_array_pop(registered_component->store);
+    x_array_pop(registered_component->owners);
+    x_array_pop(registered_component->ticks);
+    registered_component->layout_version++;
   }
 
   return true;
@@ -317,33 +663,35 @@ bool ldk_component_register(LDKComponentRegistry* registry, const LDKComponentDe
   LDKRegisteredComponent entry = {0};
   XArray* owners = NULL;
   XArray* store = NULL;
+  XArray* ticks = NULL;
+  XArray* disabled = NULL;
+  XArray* pages = NULL;
+  XArray* free_slots = NULL;
+  u32 slot = 0;
 
-  if (!registry || !registry->table || !desc || !desc->type || !desc->entry_size)
+  if (!registry || !registry->entries || !desc || !desc->type)
   {
     return false;
   }
 
-  if (x_hashtable_u32_registered_component_has(registry->table, desc->type))
+  // Only tags have no data
+  if ((desc->storage == LDK_COMPONENT_STORAGE_TAG) != (desc->entry_size == 0))
   {
     return false;
   }
 
-  store = x_array_create(desc->entry_size, desc->initial_capacity);
-  if (!store)
+  if (s_component_entry_get(registry, desc->type))
   {
     return false;
   }
 
-  owners = x_array_create(sizeof(LDKEntity), desc->initial_capacity);
-  if (!owners)
+  if (registry->count >= LDK_COMPONENT_MAX_TYPES)
   {
-    x_array_destroy(store);
-    x_array_destroy(owners);
     return false;
   }
 
-  entry.store = store;
-  entry.owners = owners;
+  slot = registry->count;
+  entry.slot = slot;
   entry.desc.name = desc->name;
   entry.desc.type = desc->type;
   entry.desc.attach = desc->attach;
@@ -351,37 +699,114 @@ bool ldk_component_register(LDKComponentRegistry* registry, const LDKComponentDe
   entry.desc.entry_size = desc->entry_size;
   entry.desc.initial_capacity = desc->initial_capacity;
   entry.desc.user = desc->user;
+  entry.desc.storage = desc->storage;
+
+  // Archetype components live in archetype chunks and tags have no data, neither has a per-type store
+  if (desc->storage == LDK_COMPONENT_STORAGE_PACKED || desc->storage == LDK_COMPONENT_STORAGE_PAGED)
+  {
+    store = x_array_create(s_component_store_stride(&entry), desc->initial_capacity);
+    if (!store)
+    {
+      return false;
+    }
+
+    owners = x_array_create(sizeof(LDKEntity), desc->initial_capacity);
+    ticks = x_array_create(sizeof(LDKComponentTicks), desc->initial_capacity);
+    disabled = x_array_create(sizeof(u64), (desc->initial_capacity + 63) / 64);
+    if (desc->storage == LDK_COMPONENT_STORAGE_PAGED)
+    {
+      pages = x_array_create(sizeof(u8*), 4);
+      free_slots = x_array_create(sizeof(void*), LDK_COMPONENT_PAGE_CAPACITY);
+    }
+
+    if (!owners || !ticks || !disabled ||
+        (desc->storage == LDK_COMPONENT_STORAGE_PAGED && (!pages || !free_slots)))
+    {
+      x_array_destroy(store);
+      if (pages)
+      {
+        x_array_destroy(pages);
+      }
+      if (free_slots)
+      {
+        x_array_destroy(free_slots);
+      }
+      if (owners)
+      {
+        x_array_destroy(owners);
+      }
+      if (ticks)
+      {
+        x_array_destroy(ticks);
+      }
+      if (disabled)
+      {
+        x_array_destroy(disabled);
+      }
+      return false;
+    }
+
+    entry.store = store;
+    entry.owners = owners;
+    entry.ticks = ticks;
+    entry.disabled = disabled;
+    entry.pages = pages;
+    entry.free_slots = free_slots;
+  }
 
-  if (!x_hashtable_u32_registered_component_set(registry->table, desc->type, entry))
+  if (desc->type < LDK_COMPONENT_DIRECT_TYPES)
+  {
+    registry->direct_slots[desc->type] = slot;
+  }
+  else if (desc->type > UINT32_MAX - LDK_COMPONENT_BUILTIN_TYPES)
+  {
+    registry->builtin_slots[UINT32_MAX - desc->type] = slot;
+  }
+  else if (!x_hashtable_u32_component_slot_set(registry->slots, desc->type, slot))
   {
-    x_array_destroy(store);
-    x_array_destroy(owners);
+    if (store)
+    {
+      x_array_destroy(store);
+      x_array_destroy(owners);
+      x_array_destroy(ticks);
+      x_array_destroy(disabled);
+    }
+    if (pages)
+    {
+      x_array_destroy(pages);
+      x_array_destroy(free_slots);
+    }
     return false;
   }
 
+  if (desc->storage == LDK_COMPONENT_STORAGE_TAG)
+  {
+    ldk_component_mask_set(&registry->tag_mask, slot);
+  }
+
+  registry->entries[slot] = entry;
+  registry->count++;
   return true;
 }
 
 bool ldk_component_attach(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
     LDKEntity entity, u32 component_type, u32 component_index, const void* initial_value)
 {
-  LDKRegisteredComponent registered_component = {0};
+  LDKRegisteredComponent* registered_component = NULL;
   void* component = NULL;
 
-  if (!registry || !registry->table || !entity_registry)
+  if (!registry || !entity_registry)
   {
     return false;
   }
 
-  if (!x_hashtable_u32_registered_component_get(
-        registry->table,
-        component_type,
-        &registered_component))
+  registered_component = s_component_entry_get(registry, component_type);
+  if (!registered_component)
   {
     return false;
   }
 
-  component = ldk_component_get(registry, component_type, component_index);
+  component = s_component_data_get(registry, registered_component, entity_registry, entity, component_index);
   if (!component)
   {
     return false;
@@ -389,75 +814,1256 @@ bool ldk_component_attach(LDKComponentRegistry* registry, LDKEntityRegistry* ent
 
   if (initial_value)
   {
-    memcpy(component, initial_value, registered_component.desc.entry_size);
+    memcpy(component, initial_value, registered_component->desc.entry_size);
   }
 
-  if (registered_component.desc.attach)
+  if (registered_component->desc.attach)
   {
-    return registered_component.desc.attach(
+    return registered_component->desc.attach(
         entity_registry,
         registry,
         entity,
         component,
         component_index,
         initial_value,
-        registered_component.desc.user);
+        registered_component->desc.user);
   }
 
   return true;
 }
 
-void ldk_component_destroy_data(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
-    LDKEntity entity, u32 component_type, u32 component_index)
+static int s_component_index_compare_descending(const void* a, const void* b)
 {
-  LDKRegisteredComponent registered_component = {0};
-  void* component = NULL;
+  u32 left = *(const u32*)a;
+  u32 right = *(const u32*)b;
+  return (left < right) - (left > right);
+}
 
-  if (!registry || !registry->table || !entity_registry)
+u32 ldk_component_destroy_batch(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    u32 component_type, u32* component_indices, u32 count)
+{
+  LDKRegisteredComponent* entry = NULL;
+  LDKEntity* owners = NULL;
+  LDKComponentTicks* ticks = NULL;
+  u8* store = NULL;
+  u32 stride = 0;
+  u32 store_count = 0;
+  u32 unique = 0;
+  u32 i = 0;
+
+  if (!registry || !entity_registry || !component_indices || count == 0)
   {
-    return;
+    return 0;
   }
 
-  if (!x_hashtable_u32_registered_component_get(
-        registry->table,
-        component_type,
-        &registered_component))
+  entry = s_component_entry_get(registry, component_type);
+  if (!entry || !entry->store || !entry->owners
+      || x_array_count(entry->store) != x_array_count(entry->owners))
   {
-    return;
+    return 0;
   }
 
-  component = ldk_component_get(registry, component_type, component_index);
-  if (!component)
+  // Removing from the highest index down, the last component is never one still to be removed
+  qsort(component_indices, count, sizeof(u32), s_component_index_compare_descending);
+  store_count = x_array_count(entry->store);
+
+  for (i = 0; i < count; ++i)
   {
-    return;
+    if (component_indices[i] < store_count && (unique == 0 || component_indices[unique - 1] != component_indices[i]))
+    {
+      component_indices[unique++] = component_indices[i];
+    }
   }
 
-  if (registered_component.desc.destroy)
+  if (unique == 0)
   {
-    registered_component.desc.destroy(
-        entity_registry,
-        registry,
+    return 0;
+  }
+
+  owners = (LDKEntity*)x_array_data(entry->owners);
+  ticks = (LDKComponentTicks*)x_array_data(entry->ticks);
+  store = (u8*)x_array_data(entry->store);
+  stride = s_component_store_stride(entry);
+
+  // Every callback runs before anything moves, so they all see the store as it was
+  if (entry->desc.destroy)
+  {
+    for (i = 0; i < unique; ++i)
+    {
+      u32 index = component_indices[i];
+      entry->desc.destroy(entity_registry, registry, owners[index],
+          ldk_component_entry_data(entry, index), index, entry->desc.user);
+    }
+  }
+
+  if (entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED)
+  {
+    for (i = 0; i < unique; ++i)
+    {
+      s_component_paged_release(entry, ldk_component_entry_data(entry, component_indices[i]));
+    }
+  }
+
+  for (i = 0; i < unique; ++i)
+  {
+    u32 index = component_indices[i];
+    u32 last_index = store_count - 1;
+    bool last_disabled = ldk_component_bits_test((const u64*)x_array_data(entry->disabled), last_index);
+
+    s_component_disabled_assign(entry, index, false);
+    s_component_disabled_assign(entry, last_index, false);
+
+    if (index != last_index)
+    {
+      memcpy(store + (size_t)index * stride, store + (size_t)last_index * stride, stride);
+      owners[index] = owners[last_index];
+      ticks[index] = ticks[last_index];
+      s_component_disabled_assign(entry, index, last_disabled);
+
+      if (!x_handle_is_null(owners[index]))
+      {
+        ldk_entity_component_index_set(entity_registry, owners[index], component_type, index);
+      }
+    }
+
+    store_count--;
+  }
+
+  x_array_resize(entry->store, store_count);
+  x_array_resize(entry->owners, store_count);
+  x_array_resize(entry->ticks, store_count);
+  entry->layout_version++;
+  return unique;
+}
+
+void ldk_component_destroy_data(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    LDKEntity entity, u32 component_type, u32 component_index)
+{
+  LDKRegisteredComponent* registered_component = NULL;
+  void* component = NULL;
+
+  if (!registry || !entity_registry)
+  {
+    return;
+  }
+
+  registered_component = s_component_entry_get(registry, component_type);
+  if (!registered_component)
+  {
+    return;
+  }
+
+  component = s_component_data_get(registry, registered_component, entity_registry, entity, component_index);
+  if (!component)
+  {
+    return;
+  }
+
+  if (registered_component->desc.destroy)
+  {
+    registered_component->desc.destroy(
+        entity_registry,
+        registry,
         entity,
         component,
         component_index,
-        registered_component.desc.user);
+        registered_component->desc.user);
   }
 }
 
 
 const char* ldk_component_name_get(LDKComponentRegistry* registry, u32 type)
 {
-  LDKRegisteredComponent entry;
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, type);
+
+  if (!entry)
+  {
+    return NULL;
+  }
+
+  return entry->desc.name;
+}
+
+LDKComponentStorage ldk_component_storage_get(LDKComponentRegistry* registry, u32 type)
+{
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, type);
+
+  if (!entry)
+  {
+    return LDK_COMPONENT_STORAGE_PACKED;
+  }
+
+  return entry->desc.storage;
+}
+
+bool ldk_component_is_tag(LDKComponentRegistry* registry, u32 type)
+{
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, type);
+  return entry && entry->desc.storage == LDK_COMPONENT_STORAGE_TAG;
+}
+
+u32 ldk_component_slot_get(LDKComponentRegistry* registry, u32 type)
+{
+  if (!registry || !registry->entries)
+  {
+    return LDK_COMPONENT_INVALID_SLOT;
+  }
+
+  return s_component_slot_resolve(registry, type);
+}
+
+u32 ldk_component_slot_count(LDKComponentRegistry* registry)
+{
+  if (!registry)
+  {
+    return 0;
+  }
+
+  return registry->count;
+}
+
+LDKRegisteredComponent* ldk_component_entry_get(LDKComponentRegistry* registry, u32 slot)
+{
+  if (!registry || !registry->entries || slot >= registry->count)
+  {
+    return NULL;
+  }
+
+  return &registry->entries[slot];
+}
 
-  if (!registry || !registry->table)
+XArray* ldk_component_store_get_by_slot(LDKComponentRegistry* registry, u32 slot)
+{
+  if (!registry || !registry->entries || slot >= registry->count)
   {
     return NULL;
   }
 
-  if (!x_hashtable_u32_registered_component_get(registry->table, type, &entry))
+  return registry->entries[slot].store;
+}
+
+static LDKComponentTicks* s_component_ticks_get(LDKRegisteredComponent* entry, u32 component_index)
+{
+  if (!entry || !entry->ticks || component_index >= x_array_count(entry->ticks))
   {
     return NULL;
   }
 
-  return entry.desc.name;
+  return (LDKComponentTicks*)x_array_get(entry->ticks, component_index);
+}
+
+u32 ldk_component_tick_get(LDKComponentRegistry* registry)
+{
+  return registry ? registry->tick : 0;
+}
+
+u32 ldk_component_tick_advance(LDKComponentRegistry* registry)
+{
+  if (!registry)
+  {
+    return 0;
+  }
+
+  return registry->tick++;
+}
+
+void ldk_component_mark_changed(LDKComponentRegistry* registry, u32 component_type, u32 component_index)
+{
+  LDKComponentTicks* ticks = s_component_ticks_get(s_component_entry_get(registry, component_type), component_index);
+
+  if (ticks)
+  {
+    ticks->changed = registry->tick;
+  }
+}
+
+void ldk_component_mark_changed_by_slot(LDKComponentRegistry* registry, u32 slot, u32 component_index)
+{
+  LDKComponentTicks* ticks = s_component_ticks_get(ldk_component_entry_get(registry, slot), component_index);
+
+  if (ticks)
+  {
+    ticks->changed = registry->tick;
+  }
+}
+
+const LDKComponentTicks* ldk_component_ticks_get(LDKComponentRegistry* registry, u32 component_type, u32 component_index)
+{
+  return s_component_ticks_get(s_component_entry_get(registry, component_type), component_index);
+}
+
+bool ldk_component_changed_since(LDKComponentRegistry* registry, u32 component_type, u32 component_index, u32 tick)
+{
+  const LDKComponentTicks* ticks = ldk_component_ticks_get(registry, component_type, component_index);
+  return ticks && ticks->changed > tick;
+}
+
+bool ldk_component_added_since(LDKComponentRegistry* registry, u32 component_type, u32 component_index, u32 tick)
+{
+  const LDKComponentTicks* ticks = ldk_component_ticks_get(registry, component_type, component_index);
+  return ticks && ticks->added > tick;
+}
+
+bool ldk_component_enabled_set(LDKComponentRegistry* registry, u32 component_type, u32 component_index, bool enabled)
+{
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, component_type);
+
+  if (!entry || !entry->store || component_index >= (u32)x_array_count(entry->store))
+  {
+    return false;
+  }
+
+  s_component_disabled_assign(entry, component_index, !enabled);
+  return true;
+}
+
+bool ldk_component_is_enabled(LDKComponentRegistry* registry, u32 component_type, u32 component_index)
+{
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, component_type);
+  const u64* disabled = NULL;
+
+  if (!entry || !entry->store || component_index >= (u32)x_array_count(entry->store))
+  {
+    return false;
+  }
+
+  disabled = ldk_component_entry_disabled_bits(entry);
+  return !disabled || !ldk_component_bits_test(disabled, component_index);
+}
+
+typedef struct LDKComponentForeachTask
+{
+  LDKComponentForeachFn fn;
+  void* user;
+  u8* components;
+  const LDKEntity* owners;
+  const u64* disabled;  // NULL when every component is enabled
+  u32 stride;
+  bool paged;           // components holds pointers to components of stride bytes
+} LDKComponentForeachTask;
+
+static void s_component_foreach_run(LDKComponentForeachTask* task, u32 begin, u32 end, u32 worker_index)
+{
+  void* const* pointers = (void* const*)task->components;
+  u32 run_begin = begin;
+  u32 i = 0;
+
+  if (!task->paged)
+  {
+    task->fn(task->user, task->components + (size_t)begin * task->stride,
+        task->owners + begin, end - begin, worker_index);
+    return;
+  }
+
+  // Split into runs of components that are adjacent in their page
+  for (i = begin + 1; i <= end; ++i)
+  {
+    if (i < end && (u8*)pointers[i] == (u8*)pointers[i - 1] + task->stride)
+    {
+      continue;
+    }
+
+    task->fn(task->user, pointers[run_begin], task->owners + run_begin, i - run_begin, worker_index);
+    run_begin = i;
+  }
+}
+
+static void s_component_foreach_range(void* user, u32 begin, u32 end, u32 worker_index)
+{
+  LDKComponentForeachTask* task = (LDKComponentForeachTask*)user;
+  u32 run_begin = begin;
+  u32 i = 0;
+
+  if (!task->disabled)
+  {
+    s_component_foreach_run(task, begin, end, worker_index);
+    return;
+  }
+
+  // Split the range into runs of enabled components
+  for (i = begin; i <= end; ++i)
+  {
+    if (i < end && !ldk_component_bits_test(task->disabled, i))
+    {
+      continue;
+    }
+
+    if (i > run_begin)
+    {
+      s_component_foreach_run(task, run_begin, i, worker_index);
+    }
+
+    run_begin = i + 1;
+  }
+}
+
+bool ldk_component_foreach_parallel(LDKComponentRegistry* registry, struct LDKJobSystem* jobs,
+    u32 component_type, LDKComponentForeachFn fn, void* user, u32 grain)
+{
+  LDKRegisteredComponent* entry = NULL;
+  LDKComponentForeachTask task;
+  u32 count = 0;
+
+  if (!registry || !fn)
+  {
+    return false;
+  }
+
+  entry = s_component_entry_get(registry, component_type);
+  if (!entry || !entry->store)
+  {
+    return false;
+  }
+
+  count = (u32)x_array_count(entry->store);
+  if (count == 0)
+  {
+    return true;
+  }
+
+  task.fn = fn;
+  task.user = user;
+  task.components = (u8*)x_array_data(entry->store);
+  task.owners = (const LDKEntity*)x_array_data(entry->owners);
+  task.disabled = ldk_component_entry_disabled_bits(entry);
+  task.stride = entry->desc.entry_size;
+  task.paged = entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED;
+
+  if (!jobs)
+  {
+    s_component_foreach_range(&task, 0, count, 0);
+    return true;
+  }
+
+  ldk_jobs_parallel_for(jobs, count, grain, s_component_foreach_range, &task);
+  return true;
+}
+
+typedef struct LDKComponentSortItem
+{
+  u64 key;
+  u32 index;
+} LDKComponentSortItem;
+
+static int s_component_sort_item_compare(const void* a, const void* b)
+{
+  const LDKComponentSortItem* item_a = (const LDKComponentSortItem*)a;
+  const LDKComponentSortItem* item_b = (const LDKComponentSortItem*)b;
+
+  if (item_a->key != item_b->key)
+  {
+    return item_a->key < item_b->key ? -1 : 1;
+  }
+
+  // Ties keep the current order so a sorted store is left alone
+  return item_a->index < item_b->index ? -1 : (item_a->index > item_b->index ? 1 : 0);
+}
+
+static u64 s_component_sort_key(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    const LDKComponentSortDesc* desc, LDKEntity owner)
+{
+  u32 component_index = 0;
+
+  switch (desc->key)
+  {
+    case LDK_COMPONENT_SORT_COMPONENT_ORDER:
+      if (!ldk_entity_component_find(entity_registry, owner, desc->order_type, NULL, &component_index))
+      {
+        return ((u64)UINT32_MAX << 32) | owner.index;
+      }
+      return component_index;
+
+    case LDK_COMPONENT_SORT_CUSTOM:
+      return desc->key_fn(desc->user, entity_registry, registry, owner);
+
+    default:
+      return owner.index;
+  }
+}
+
+static void s_component_bytes_swap(u8* a, u8* b, u32 size)
+{
+  u32 i = 0;
+
+  for (i = 0; i < size; ++i)
+  {
+    u8 value = a[i];
+    a[i] = b[i];
+    b[i] = value;
+  }
+}
+
+/* Swaps two components of a packed or paged store with everything parallel to it and repoints the owners */
+static void s_component_swap(LDKRegisteredComponent* entry, LDKEntityRegistry* entity_registry, u32 a, u32 b)
+{
+  LDKEntity* owners = (LDKEntity*)x_array_data(entry->owners);
+  LDKComponentTicks* ticks = (LDKComponentTicks*)x_array_data(entry->ticks);
+  const u64* disabled = (const u64*)x_array_data(entry->disabled);
+  bool disabled_a = ldk_component_bits_test(disabled, a);
+  bool disabled_b = ldk_component_bits_test(disabled, b);
+  LDKEntity owner = owners[a];
+  LDKComponentTicks tick = ticks[a];
+
+  s_component_bytes_swap((u8*)x_array_get(entry->store, a), (u8*)x_array_get(entry->store, b), s_component_store_stride(entry));
+  owners[a] = owners[b];
+  owners[b] = owner;
+  ticks[a] = ticks[b];
+  ticks[b] = tick;
+  s_component_disabled_assign(entry, a, disabled_b);
+  s_component_disabled_assign(entry, b, disabled_a);
+
+  // Null owners are components created by a batch that were never claimed
+  if (!x_handle_is_null(owners[a]))
+  {
+    ldk_entity_component_index_set(entity_registry, owners[a], entry->desc.type, a);
+  }
+
+  if (!x_handle_is_null(owners[b]))
+  {
+    ldk_entity_component_index_set(entity_registry, owners[b], entry->desc.type, b);
+  }
+}
+
+typedef enum LDKComponentSortStart
+{
+  LDK_COMPONENT_SORT_START_SORTED = 0,  // Nothing to do
+  LDK_COMPONENT_SORT_START_STARTED,
+  LDK_COMPONENT_SORT_START_FAILED       // Out of memory, the next step tries again
+} LDKComponentSortStart;
+
+/* Computes the target order of the store */
+static LDKComponentSortStart s_component_sort_pass_begin(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    LDKRegisteredComponent* entry, LDKComponentSort* sort)
+{
+  const LDKEntity* owners = (const LDKEntity*)x_array_data(entry->owners);
+  LDKComponentSortItem* items = NULL;
+  u32* order = NULL;
+  u32* at = NULL;
+  u32* where = NULL;
+  u32 count = (u32)x_array_count(entry->store);
+  bool sorted = true;
+  u32 i = 0;
+
+  sort->active = false;
+  sort->failed = false;
+  sort->cursor = 0;
+  sort->count = count;
+  sort->layout_version = entry->layout_version;
+
+  if (count < 2)
+  {
+    return LDK_COMPONENT_SORT_START_SORTED;
+  }
+
+  items = (LDKComponentSortItem*)LDK_ALLOC(sizeof(LDKComponentSortItem) * count);
+  if (!items)
+  {
+    sort->failed = true;
+    return LDK_COMPONENT_SORT_START_FAILED;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    items[i].key = s_component_sort_key(registry, entity_registry, &sort->desc, owners[i]);
+    items[i].index = i;
+    sorted = sorted && (i == 0 || items[i - 1].key <= items[i].key);
+  }
+
+  if (sorted)
+  {
+    LDK_FREE(items);
+    return LDK_COMPONENT_SORT_START_SORTED;
+  }
+
+  if (x_array_resize(sort->order, count) != XARRAY_OK ||
+      x_array_resize(sort->at, count) != XARRAY_OK ||
+      x_array_resize(sort->where, count) != XARRAY_OK)
+  {
+    LDK_FREE(items);
+    sort->failed = true;
+    return LDK_COMPONENT_SORT_START_FAILED;
+  }
+
+  qsort(items, count, sizeof(LDKComponentSortItem), s_component_sort_item_compare);
+
+  order = (u32*)x_array_data(sort->order);
+  at = (u32*)x_array_data(sort->at);
+  where = (u32*)x_array_data(sort->where);
+
+  for (i = 0; i < count; ++i)
+  {
+    order[i] = items[i].index;
+    at[i] = i;
+    where[i] = i;
+  }
+
+  LDK_FREE(items);
+  sort->active = true;
+  return LDK_COMPONENT_SORT_START_STARTED;
+}
+
+/* Only packed and paged types have a store order */
+static bool s_component_sort_type_valid(LDKComponentRegistry* registry, u32 component_type)
+{
+  LDKRegisteredComponent* entry = s_component_entry_get(registry, component_type);
+
+  return entry &&
+    (entry->desc.storage == LDK_COMPONENT_STORAGE_PACKED || entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED);
+}
+
+bool ldk_component_sort_initialize(LDKComponentRegistry* registry, LDKComponentSort* sort, const LDKComponentSortDesc* desc)
+{
+  if (!registry || !sort || !desc)
+  {
+    return false;
+  }
+
+  if (desc->key == LDK_COMPONENT_SORT_CUSTOM && !desc->key_fn)
+  {
+    return false;
+  }
+
+  if (!s_component_sort_type_valid(registry, desc->component_type))
+  {
+    return false;
+  }
+
+  if (desc->key == LDK_COMPONENT_SORT_COMPONENT_ORDER && !s_component_sort_type_valid(registry, desc->order_type))
+  {
+    return false;
+  }
+
+  memset(sort, 0, sizeof(*sort));
+  sort->desc = *desc;
+  sort->order = x_array_create(sizeof(u32), 64);
+  sort->at = x_array_create(sizeof(u32), 64);
+  sort->where = x_array_create(sizeof(u32), 64);
+
+  if (!sort->order || !sort->at || !sort->where)
+  {
+    ldk_component_sort_terminate(sort);
+    return false;
+  }
+
+  return true;
+}
+
+void ldk_component_sort_terminate(LDKComponentSort* sort)
+{
+  if (!sort)
+  {
+    return;
+  }
+
+  if (sort->order)
+  {
+    x_array_destroy(sort->order);
+  }
+
+  if (sort->at)
+  {
+    x_array_destroy(sort->at);
+  }
+
+  if (sort->where)
+  {
+    x_array_destroy(sort->where);
+  }
+
+  memset(sort, 0, sizeof(*sort));
+}
+
+u32 ldk_component_sort_step(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    LDKComponentSort* sort, u32 max_moves)
+{
+  LDKRegisteredComponent* entry = NULL;
+  const u32* order = NULL;
+  u32* at = NULL;
+  u32* where = NULL;
+  u32 moves = 0;
+
+  if (!registry || !entity_registry || !sort || !sort->order || max_moves == 0)
+  {
+    return 0;
+  }
+
+  entry = s_component_entry_get(registry, sort->desc.component_type);
+  if (!entry || !entry->store)
+  {
+    return 0;
+  }
+
+  // Adds and removes shuffle the store under the pass, its order is stale
+  if (sort->active && (sort->layout_version != entry->layout_version || sort->count != (u32)x_array_count(entry->store)))
+  {
+    sort->active = false;
+  }
+
+  if (!sort->active &&
+      s_component_sort_pass_begin(registry, entity_registry, entry, sort) != LDK_COMPONENT_SORT_START_STARTED)
+  {
+    return 0;
+  }
+
+  order = (const u32*)x_array_data(sort->order);
+  at = (u32*)x_array_data(sort->at);
+  where = (u32*)x_array_data(sort->where);
+
+  // Each position is settled with at most one swap
+  while (sort->cursor < sort->count && moves < max_moves)
+  {
+    u32 position = sort->cursor++;
+    u32 source = where[order[position]];
+    u32 displaced = at[position];
+
+    if (source == position)
+    {
+      continue;
+    }
+
+    s_component_swap(entry, entity_registry, position, source);
+    at[position] = order[position];
+    at[source] = displaced;
+    where[order[position]] = position;
+    where[displaced] = source;
+    moves++;
+  }
+
+  if (sort->cursor >= sort->count)
+  {
+    sort->active = false;
+  }
+
+  return moves;
+}
+
+bool ldk_component_sort(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    const LDKComponentSortDesc* desc)
+{
+  LDKComponentSort sort;
+  bool result = false;
+
+  if (!ldk_component_sort_initialize(registry, &sort, desc))
+  {
+    return false;
+  }
+
+  ldk_component_sort_step(registry, entity_registry, &sort, UINT32_MAX);
+  result = !sort.failed;
+  ldk_component_sort_terminate(&sort);
+  return result;
+}
+
+void* ldk_component_get_by_slot(LDKComponentRegistry* registry, u32 slot, u32 component_index)
+{
+  XArray* store = ldk_component_store_get_by_slot(registry, slot);
+
+  if (!store || component_index >= (u32)x_array_count(store))
+  {
+    return NULL;
+  }
+
+  return ldk_component_entry_data(&registry->entries[slot], component_index);
+}
+
+LDKArchetypeTable* ldk_component_archetypes_get(LDKComponentRegistry* registry)
+{
+  if (!registry || !registry->entries)
+  {
+    return NULL;
+  }
+
+  return &registry->archetypes;
+}
+
+void* ldk_component_archetype_data_get(LDKComponentRegistry* registry, u32 archetype_id, u32 row, u32 component_type)
+{
+  LDKArchetype* archetype = NULL;
+
+  if (!registry)
+  {
+    return NULL;
+  }
+
+  archetype = ldk_archetype_get(&registry->archetypes, archetype_id);
+  if (!archetype)
+  {
+    return NULL;
+  }
+
+  return ldk_archetype_row_component_get(archetype, ldk_archetype_column_find(archetype, component_type), row);
+}
+
+void* ldk_component_archetype_insert(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    LDKEntity entity, u32 component_type)
+{
+  LDKRegisteredComponent* registered_component = NULL;
+  LDKEntityInfo* info = NULL;
+  LDKArchetype* target = NULL;
+  LDKEntity moved_entity = x_handle_null();
+  u32 target_id = LDK_ARCHETYPE_NONE;
+  u32 row = 0;
+
+  if (!registry || !entity_registry)
+  {
+    return NULL;
+  }
+
+  registered_component = s_component_entry_get(registry, component_type);
+  if (!registered_component)
+  {
+    return NULL;
+  }
+
+  if (registered_component->desc.storage != LDK_COMPONENT_STORAGE_ARCHETYPE)
+  {
+    return NULL;
+  }
+
+  info = ldk_entity_info_get(entity_registry, entity);
+  if (!info)
+  {
+    return NULL;
+  }
+
+  target_id = ldk_archetype_transition_add(&registry->archetypes, info->archetype,
+      component_type, registered_component->desc.entry_size);
+
+  target = ldk_archetype_get(&registry->archetypes, target_id);
+  if (!target)
+  {
+    return NULL;
+  }
+
+  if (info->archetype == LDK_ARCHETYPE_NONE)
+  {
+    row = ldk_archetype_row_alloc(target, entity);
+  }
+  else
+  {
+    row = ldk_archetype_row_move(
+        ldk_archetype_get(&registry->archetypes, info->archetype),
+        info->archetype_row,
+        target,
+        &moved_entity);
+  }
+
+  if (row == LDK_ENTITY_INVALID_COMPONENT_INDEX)
+  {
+    return NULL;
+  }
+
+  if (!x_handle_is_null(moved_entity))
+  {
+    LDKEntityInfo* moved_info = ldk_entity_info_get(entity_registry, moved_entity);
+
+    if (moved_info)
+    {
+      moved_info->archetype_row = info->archetype_row;
+    }
+  }
+
+  info->archetype = target_id;
+  info->archetype_row = row;
+
+  return ldk_component_archetype_data_get(registry, target_id, row, component_type);
+}
+
+bool ldk_component_archetype_erase(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    LDKEntity entity, u32 component_type)
+{
+  LDKEntityInfo* info = NULL;
+  LDKArchetype* source = NULL;
+  LDKEntity moved_entity = x_handle_null();
+  u32 target_id = LDK_ARCHETYPE_NONE;
+  u32 row = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+
+  if (!registry || !registry->entries || !entity_registry)
+  {
+    return false;
+  }
+
+  info = ldk_entity_info_get(entity_registry, entity);
+  if (!info)
+  {
+    return false;
+  }
+
+  source = ldk_archetype_get(&registry->archetypes, info->archetype);
+  if (!source || ldk_archetype_column_find(source, component_type) == LDK_ENTITY_INVALID_COMPONENT_INDEX)
+  {
+    return false;
+  }
+
+  target_id = ldk_archetype_transition_remove(&registry->archetypes, info->archetype, component_type);
+
+  if (target_id == LDK_ARCHETYPE_NONE)
+  {
+    ldk_archetype_row_free(source, info->archetype_row, &moved_entity);
+  }
+  else
+  {
+    row = ldk_archetype_row_move(source, info->archetype_row,
+        ldk_archetype_get(&registry->archetypes, target_id), &moved_entity);
+
+    if (row == LDK_ENTITY_INVALID_COMPONENT_INDEX)
+    {
+      return false;
+    }
+  }
+
+  if (!x_handle_is_null(moved_entity))
+  {
+    LDKEntityInfo* moved_info = ldk_entity_info_get(entity_registry, moved_entity);
+
+    if (moved_info)
+    {
+      moved_info->archetype_row = info->archetype_row;
+    }
+  }
+
+  info->archetype = target_id;
+  info->archetype_row = row;
+  return true;
+}
+
+static bool s_component_array_copy(XArray** dst, XArray* src, size_t element_size)
+{
+  u32 count = x_array_count(src);
+
+  if (!*dst)
+  {
+    *dst = x_array_create(element_size, count ? count : 1);
+    if (!*dst)
+    {
+      return false;
+    }
+  }
+
+  if (x_array_resize(*dst, count) != XARRAY_OK)
+  {
+    return false;
+  }
+
+  if (count)
+  {
+    memcpy(x_array_data(*dst), x_array_data(src), element_size * count);
+  }
+
+  return true;
+}
+
+typedef struct LDKComponentPageRef
+{
+  const u8* page;
+  u32 index;
+} LDKComponentPageRef;
+
+static int s_component_page_ref_compare(const void* a, const void* b)
+{
+  const u8* page_a = ((const LDKComponentPageRef*)a)->page;
+  const u8* page_b = ((const LDKComponentPageRef*)b)->page;
+  return (page_a > page_b) - (page_a < page_b);
+}
+
+/* Copies the components of a paged store into dst by value and the slot each one lives in into slots.
+ * A slot is page index * LDK_COMPONENT_PAGE_CAPACITY + index in the page. */
+static bool s_component_paged_gather(XArray** dst, XArray** slots, LDKRegisteredComponent* entry)
+{
+  u32 count = x_array_count(entry->store);
+  u32 page_count = x_array_count(entry->pages);
+  size_t page_size = (size_t)entry->desc.entry_size * LDK_COMPONENT_PAGE_CAPACITY;
+  LDKComponentPageRef* refs = NULL;
+  u32 i = 0;
+
+  if (!*dst)
+  {
+    *dst = x_array_create(entry->desc.entry_size, count ? count : 1);
+  }
+
+  if (!*slots)
+  {
+    *slots = x_array_create(sizeof(u32), count ? count : 1);
+  }
+
+  if (!*dst || !*slots || x_array_resize(*dst, count) != XARRAY_OK || x_array_resize(*slots, count) != XARRAY_OK)
+  {
+    return false;
+  }
+
+  if (count == 0)
+  {
+    return true;
+  }
+
+  // Pages sorted by address so each component finds its page with a binary search
+  refs = (LDKComponentPageRef*)LDK_ALLOC(sizeof(LDKComponentPageRef) * page_count);
+  if (!refs)
+  {
+    return false;
+  }
+
+  for (i = 0; i < page_count; ++i)
+  {
+    refs[i].page = *(u8**)x_array_get(entry->pages, i);
+    refs[i].index = i;
+  }
+
+  qsort(refs, page_count, sizeof(LDKComponentPageRef), s_component_page_ref_compare);
+
+  for (i = 0; i < count; ++i)
+  {
+    const u8* component = (const u8*)ldk_component_entry_data(entry, i);
+    u32 low = 0;
+    u32 high = page_count;
+
+    // Last page starting at or before the component
+    while (high - low > 1)
+    {
+      u32 mid = low + (high - low) / 2;
+
+      if (refs[mid].page <= component)
+      {
+        low = mid;
+      }
+      else
+      {
+        high = mid;
+      }
+    }
+
+    if (component < refs[low].page || component >= refs[low].page + page_size)
+    {
+      LDK_FREE(refs);
+      return false;
+    }
+
+    memcpy(x_array_get(*dst, i), component, entry->desc.entry_size);
+    *(u32*)x_array_get(*slots, i) =
+      refs[low].index * LDK_COMPONENT_PAGE_CAPACITY + (u32)((size_t)(component - refs[low].page) / entry->desc.entry_size);
+  }
+
+  LDK_FREE(refs);
+  return true;
+}
+
+/* Puts the components captured by s_component_paged_gather() back into the slots they were captured from
+ * and rebuilds the free list from the slots left unused */
+static bool s_component_paged_scatter(LDKRegisteredComponent* entry, XArray* src, XArray* slots)
+{
+  u32 count = x_array_count(src);
+  u32 page_count = x_array_count(entry->pages);
+  u32 slot_count = page_count * LDK_COMPONENT_PAGE_CAPACITY;
+  u64* used = NULL;
+  u32 i = 0;
+
+  // Pages are only released with the store, so every captured slot still exists
+  for (i = 0; i < count; ++i)
+  {
+    if (*(u32*)x_array_get(slots, i) >= slot_count)
+    {
+      return false;
+    }
+  }
+
+  used = (u64*)LDK_ALLOC(sizeof(u64) * ((slot_count + 63) / 64 + 1));
+  if (!used || x_array_resize(entry->store, count) != XARRAY_OK)
+  {
+    if (used)
+    {
+      LDK_FREE(used);
+    }
+    return false;
+  }
+
+  memset(used, 0, sizeof(u64) * ((slot_count + 63) / 64 + 1));
+
+  for (i = 0; i < count; ++i)
+  {
+    u32 slot = *(u32*)x_array_get(slots, i);
+    u8* page = *(u8**)x_array_get(entry->pages, slot / LDK_COMPONENT_PAGE_CAPACITY);
+    void* component = page + (size_t)(slot % LDK_COMPONENT_PAGE_CAPACITY) * entry->desc.entry_size;
+
+    memcpy(component, x_array_get(src, i), entry->desc.entry_size);
+    *(void**)x_array_get(entry->store, i) = component;
+    used[slot / 64] |= (u64)1 << (slot % 64);
+  }
+
+  // Same order as s_component_pages_reset() so components are handed out in address order
+  x_array_clear(entry->free_slots);
+
+  for (i = slot_count; i > 0; --i)
+  {
+    u32 slot = i - 1;
+
+    if (!(used[slot / 64] & ((u64)1 << (slot % 64))))
+    {
+      u8* page = *(u8**)x_array_get(entry->pages, slot / LDK_COMPONENT_PAGE_CAPACITY);
+      void* component = page + (size_t)(slot % LDK_COMPONENT_PAGE_CAPACITY) * entry->desc.entry_size;
+      x_array_push(entry->free_slots, &component);
+    }
+  }
+
+  LDK_FREE(used);
+  return true;
+}
+
+bool ldk_component_snapshot_capture(LDKComponentRegistry* registry, LDKComponentSnapshot* snapshot)
+{
+  u32 slot = 0;
+
+  if (!registry || !registry->entries || !snapshot)
+  {
+    return false;
+  }
+
+  if (!snapshot->stores)
+  {
+    snapshot->stores = (LDKComponentStoreSnapshot*)LDK_ALLOC(sizeof(LDKComponentStoreSnapshot) * LDK_COMPONENT_MAX_TYPES);
+    if (!snapshot->stores)
+    {
+      return false;
+    }
+
+    memset(snapshot->stores, 0, sizeof(LDKComponentStoreSnapshot) * LDK_COMPONENT_MAX_TYPES);
+  }
+
+  snapshot->slot_count = registry->count;
+
+  for (slot = 0; slot < registry->count; ++slot)
+  {
+    LDKRegisteredComponent* entry = &registry->entries[slot];
+    LDKComponentStoreSnapshot* stored = &snapshot->stores[slot];
+
+    if (entry->desc.storage != LDK_COMPONENT_STORAGE_PACKED && entry->desc.storage != LDK_COMPONENT_STORAGE_PAGED)
+    {
+      continue;
+    }
+
+    if (!(entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED
+          ? s_component_paged_gather(&stored->store, &stored->slots, entry)
+          : s_component_array_copy(&stored->store, entry->store, entry->desc.entry_size)) ||
+        !s_component_array_copy(&stored->owners, entry->owners, sizeof(LDKEntity)) ||
+        !s_component_array_copy(&stored->ticks, entry->ticks, sizeof(LDKComponentTicks)) ||
+        !s_component_array_copy(&stored->disabled, entry->disabled, sizeof(u64)))
+    {
+      return false;
+    }
+
+    stored->disabled_count = entry->disabled_count;
+  }
+
+  return ldk_archetype_table_snapshot_capture(&registry->archetypes, &snapshot->archetypes);
+}
+
+bool ldk_component_snapshot_restore(LDKComponentRegistry* registry, LDKEntityRegistry* entity_registry,
+    const LDKComponentSnapshot* snapshot)
+{
+  bool result = true;
+  u32 slot = 0;
+
+  if (!registry || !registry->entries || !entity_registry || !snapshot || !snapshot->stores)
+  {
+    return false;
+  }
+
+  for (slot = 0; slot < registry->count; ++slot)
+  {
+    LDKRegisteredComponent* entry = &registry->entries[slot];
+    LDKComponentStoreSnapshot* stored = &snapshot->stores[slot];
+    LDKComponentTicks* ticks = NULL;
+    u32 count = 0;
+    u32 i = 0;
+
+    if (entry->desc.storage != LDK_COMPONENT_STORAGE_PACKED && entry->desc.storage != LDK_COMPONENT_STORAGE_PAGED)
+    {
+      continue;
+    }
+
+    entry->layout_version++;
+
+    if (slot >= snapshot->slot_count || !stored->store)
+    {
+      // Registered after the capture
+      if (entry->pages)
+      {
+        s_component_pages_reset(entry);
+      }
+      x_array_clear(entry->store);
+      x_array_clear(entry->owners);
+      x_array_clear(entry->ticks);
+      x_array_clear(entry->disabled);
+      entry->disabled_count = 0;
+      continue;
+    }
+
+    if (!(entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED
+          ? s_component_paged_scatter(entry, stored->store, stored->slots)
+          : s_component_array_copy(&entry->store, stored->store, entry->desc.entry_size)) ||
+        !s_component_array_copy(&entry->owners, stored->owners, sizeof(LDKEntity)) ||
+        !s_component_array_copy(&entry->ticks, stored->ticks, sizeof(LDKComponentTicks)) ||
+        !s_component_array_copy(&entry->disabled, stored->disabled, sizeof(u64)))
+    {
+      result = false;
+      continue;
+    }
+
+    entry->disabled_count = stored->disabled_count;
+
+    // Ticks are not rewound, consumers see the restored world as new
+    count = x_array_count(entry->ticks);
+    ticks = (LDKComponentTicks*)x_array_data(entry->ticks);
+
+    for (i = 0; i < count; ++i)
+    {
+      ticks[i].added = registry->tick;
+      ticks[i].changed = registry->tick;
+    }
+  }
+
+  if (!ldk_archetype_table_snapshot_restore(&registry->archetypes, &snapshot->archetypes))
+  {
+    result = false;
+  }
+
+  ldk_query_registry_rebuild(&registry->queries, entity_registry);
+  return result;
+}
+
+void ldk_component_snapshot_release(LDKComponentSnapshot* snapshot)
+{
+  u32 slot = 0;
+
+  if (!snapshot)
+  {
+    return;
+  }
+
+  if (snapshot->stores)
+  {
+    for (slot = 0; slot < LDK_COMPONENT_MAX_TYPES; ++slot)
+    {
+      XArray* arrays[5];
+      u32 i = 0;
+
+      arrays[0] = snapshot->stores[slot].store;
+      arrays[1] = snapshot->stores[slot].owners;
+      arrays[2] = snapshot->stores[slot].ticks;
+      arrays[3] = snapshot->stores[slot].disabled;
+      arrays[4] = snapshot->stores[slot].slots;
+
+      for (i = 0; i < 5; ++i)
+      {
+        if (arrays[i])
+        {
+          x_array_destroy(arrays[i]);
+        }
+      }
+    }
+
+    LDK_FREE(snapshot->stores);
+  }
+
+  ldk_archetype_table_snapshot_release(&snapshot->archetypes);
+  memset(snapshot, 0, sizeof(*snapshot));
 }
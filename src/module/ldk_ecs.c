@@ -2,9 +2,18 @@
 #include <module/ldk_system.h>
 #include <module/ldk_ecs.h>
 #include <module/ldk_entity.h>
+#include <module/ldk_jobs.h>
 #include <component/ldk_transform.h>
 #include <component/ldk_camera.h>
 #include <ldk.h>
+#include <ldk_game.h>
+#include <string.h>
+
+#ifndef LDK_ALLOC
+#include <stdlib.h>
+#define LDK_ALLOC(size) malloc(size)
+#define LDK_FREE(ptr) free(ptr)
+#endif
 
 #ifndef LDK_DEFAULT_TRANSFORM_COUNT
 #define LDK_DEFAULT_TRANSFORM_COUNT 64
@@ -18,9 +27,23 @@
 #define LDK_DEFAULT_MESHSOURCE_COUNT 4
 #endif
 
+#if defined(X_COMPILER_MSVC)
+#define LDK_ECS_THREAD_LOCAL __declspec(thread)
+#else
+#define LDK_ECS_THREAD_LOCAL __thread
+#endif
+
+// World bound on this thread with ldk_ecs_world_bind(), NULL for the engine world
+static LDK_ECS_THREAD_LOCAL LDKECS* s_ecs_thread_world = NULL;
+
+static LDKECS* s_ecs_context(void)
+{
+  return s_ecs_thread_world ? s_ecs_thread_world : (LDKECS*)ldk_module_get(LDK_MODULE_ECS);
+}
+
 static LDKEntityRegistry* s_ecs_entity_registry(void)
 {
-  LDKECS* ecs = (LDKECS*)ldk_module_get(LDK_MODULE_ECS);
+  LDKECS* ecs = s_ecs_context();
   return &ecs->entity;
 }
 
@@ -62,10 +85,32 @@ bool ldk_ecs_initialize(LDKECS* context, u32 entity_page_capacity, u32 entity_in
     return false;
   }
 
+  entity_registry->components = component_registry;
+
+  if (!ldk_scenegraph_initialize(&context->scenegraph))
+  {
+    ldk_system_registry_terminate(system_registry);
+    ldk_component_registry_terminate(component_registry);
+    ldk_entity_module_terminate(entity_registry);
+    return false;
+  }
+
   bool error = false;
 
+  memset(context->commands, 0, sizeof(context->commands));
+  for (u32 i = 0; i < LDK_ECS_COMMAND_BUFFER_COUNT; ++i)
+  {
+    if (!ldk_ecs_command_buffer_initialize(&context->commands[i], component_registry))
+    {
+      ldk_log_error("Failed to initialize ECS command buffer %u.", i);
+      error = true;
+      break;
+    }
+  }
+
   // Register internal components
   LDKComponentDesc transform_component_desc = ldk_transform_component_desc(LDK_DEFAULT_TRANSFORM_COUNT);
+  transform_component_desc.user = &context->scenegraph;
   if(! ldk_component_register(&context->component, &transform_component_desc))
   {
     ldk_log_error("Failed to register component: Transform.");
@@ -88,9 +133,15 @@ bool ldk_ecs_initialize(LDKECS* context, u32 entity_page_capacity, u32 entity_in
 
   if (error)
   {
+    for (u32 i = 0; i < LDK_ECS_COMMAND_BUFFER_COUNT; ++i)
+    {
+      ldk_ecs_command_buffer_terminate(&context->commands[i]);
+    }
+
     ldk_component_registry_terminate(&context->component);
     ldk_entity_module_terminate(&context->entity);
     ldk_system_registry_terminate(&context->system);
+    ldk_scenegraph_terminate(&context->scenegraph);
     return false;
   }
 
@@ -98,25 +149,26 @@ bool ldk_ecs_initialize(LDKECS* context, u32 entity_page_capacity, u32 entity_in
   return true;
 }
 
-void ldk_ecs_terminate(void)
+static void s_ecs_context_terminate(LDKECS* context)
 {
-  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
-  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
-  LDKSystemRegistry* system_registry = ldk_ecs_system_registry_get();
-
-  if (system_registry)
+  for (u32 i = 0; i < LDK_ECS_COMMAND_BUFFER_COUNT; ++i)
   {
-    ldk_system_registry_terminate(system_registry);
+    ldk_ecs_command_buffer_terminate(&context->commands[i]);
   }
 
-  if (component_registry)
-  {
-    ldk_component_registry_terminate(component_registry);
-  }
+  ldk_system_registry_terminate(&context->system);
+  ldk_component_registry_terminate(&context->component);
+  ldk_entity_module_terminate(&context->entity);
+  ldk_scenegraph_terminate(&context->scenegraph);
+}
 
-  if (entity_registry)
+void ldk_ecs_terminate(void)
+{
+  LDKECS* ecs = s_ecs_context();
+
+  if (ecs)
   {
-    ldk_entity_module_terminate(entity_registry);
+    s_ecs_context_terminate(ecs);
   }
 }
 
@@ -156,20 +208,78 @@ LDKEntity ldk_ecs_entity_create(void)
 void ldk_ecs_entity_destroy(LDKEntity entity)
 {
   LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
-  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
 
-  if (!entity_registry || !component_registry)
+  if (!entity_registry)
   {
     return;
   }
 
-  if (!ldk_entity_is_alive(entity_registry, entity))
+  ldk_entity_destroy_deferred(entity_registry, entity);
+}
+
+u32 ldk_ecs_entity_create_batch(LDKEntity* out_entities, u32 count)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+  u32 created = 0;
+  u32 kept = 0;
+  u32 i = 0;
+
+  if (!entity_registry || !component_registry || !out_entities)
+  {
+    return 0;
+  }
+
+  created = ldk_entity_create_batch(entity_registry, out_entities, count);
+
+  // Entities always have a transform component
+  if (ldk_entity_component_add_batch(entity_registry, component_registry,
+        out_entities, created, LDK_COMPONENT_TYPE_TRANSFORM, NULL) == created)
+  {
+    return created;
+  }
+
+  for (i = 0; i < created; ++i)
+  {
+    if (!ldk_entity_component_has(entity_registry, out_entities[i], LDK_COMPONENT_TYPE_TRANSFORM))
+    {
+      ldk_component_registry_remove_all(component_registry, entity_registry, out_entities[i]);
+      ldk_entity_destroy(entity_registry, out_entities[i]);
+      continue;
+    }
+
+    out_entities[kept++] = out_entities[i];
+  }
+
+  return kept;
+}
+
+void ldk_ecs_entity_destroy_batch(const LDKEntity* entities, u32 count)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  u32 i = 0;
+
+  if (!entity_registry || !entities)
   {
     return;
   }
 
-  ldk_component_registry_remove_all(component_registry, entity_registry, entity);
-  ldk_entity_destroy(entity_registry, entity);
+  for (i = 0; i < count; ++i)
+  {
+    ldk_entity_destroy_deferred(entity_registry, entities[i]);
+  }
+}
+
+u32 ldk_ecs_entity_destroy_flush(void)
+{
+  LDKECS* ecs = s_ecs_context();
+
+  if (!ecs)
+  {
+    return 0;
+  }
+
+  return ldk_ecs_entity_destroy_pending(ecs);
 }
 
 
@@ -202,6 +312,32 @@ void* ldk_ecs_component_add(LDKEntity entity, u32 component_type, const void* in
       initial_value);
 }
 
+u32 ldk_ecs_component_add_batch(const LDKEntity* entities, u32 count, u32 component_type, const void* initial_values)
+{
+  // Transforms are attached by ldk_ecs_entity_create_batch()
+  if (component_type == LDK_COMPONENT_TYPE_TRANSFORM)
+  {
+    ldk_log_error("Transforms can not be added in batch, entities get one when created.");
+    return 0;
+  }
+
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return 0;
+  }
+
+  return ldk_entity_component_add_batch(
+      entity_registry,
+      component_registry,
+      entities,
+      count,
+      component_type,
+      initial_values);
+}
+
 void* ldk_ecs_component_get(LDKEntity entity, u32 component_type)
 {
   LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
@@ -221,7 +357,62 @@ void* ldk_ecs_component_get(LDKEntity entity, u32 component_type)
 
 const void* ldk_ecs_component_get_const(LDKEntity entity, u32 component_type)
 {
-  return (const void*) ldk_ecs_component_get(entity, component_type);
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return NULL;
+  }
+
+  return ldk_entity_component_get_const(
+      entity_registry,
+      component_registry,
+      entity,
+      component_type);
+}
+
+void ldk_ecs_component_mark_changed(LDKEntity entity, u32 component_type)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+  u32 component_index = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+
+  if (!entity_registry || !component_registry)
+  {
+    return;
+  }
+
+  if (ldk_entity_component_find(entity_registry, entity, component_type, NULL, &component_index))
+  {
+    ldk_component_mark_changed(component_registry, component_type, component_index);
+  }
+}
+
+bool ldk_ecs_component_enable(LDKEntity entity, u32 component_type, bool enabled)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return false;
+  }
+
+  return ldk_entity_component_enabled_set(entity_registry, component_registry, entity, component_type, enabled);
+}
+
+bool ldk_ecs_component_is_enabled(LDKEntity entity, u32 component_type)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return false;
+  }
+
+  return ldk_entity_component_is_enabled(entity_registry, component_registry, entity, component_type);
 }
 
 bool ldk_ecs_component_remove(LDKEntity entity, u32 component_type)
@@ -259,6 +450,514 @@ bool ldk_ecs_component_register(const LDKComponentDesc* desc)
   return ldk_component_register(component_registry, desc);
 }
 
+bool ldk_ecs_tag_add(LDKEntity entity, u32 tag_type)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return false;
+  }
+
+  return ldk_entity_tag_add(entity_registry, component_registry, entity, tag_type);
+}
+
+bool ldk_ecs_tag_remove(LDKEntity entity, u32 tag_type)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return false;
+  }
+
+  return ldk_entity_tag_remove(entity_registry, component_registry, entity, tag_type);
+}
+
+bool ldk_ecs_tag_has(LDKEntity entity, u32 tag_type)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+
+  if (!entity_registry)
+  {
+    return false;
+  }
+
+  return ldk_entity_component_has(entity_registry, entity, tag_type);
+}
+
+u32 ldk_ecs_tick_get(void)
+{
+  return ldk_component_tick_get(ldk_ecs_component_registry_get());
+}
+
+u32 ldk_ecs_tick_advance(void)
+{
+  return ldk_component_tick_advance(ldk_ecs_component_registry_get());
+}
+
+bool ldk_ecs_component_foreach_parallel(u32 component_type, LDKComponentForeachFn fn, void* user, u32 grain)
+{
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+  LDKJobSystem* jobs = (LDKJobSystem*)ldk_module_get(LDK_MODULE_JOBS);
+
+  if (!component_registry)
+  {
+    return false;
+  }
+
+  return ldk_component_foreach_parallel(component_registry, jobs, component_type, fn, user, grain);
+}
+
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+LDKQuery ldk_ecs_query_create(const u32* component_types, u32 component_count)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return LDK_QUERY_INVALID;
+  }
+
+  return ldk_query_create(entity_registry, component_registry, component_types, component_count);
+}
+
+void ldk_ecs_query_destroy(LDKQuery query)
+{
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!component_registry)
+  {
+    return;
+  }
+
+  ldk_query_destroy(component_registry, query);
+}
+
+u32 ldk_ecs_query_count(LDKQuery query)
+{
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!component_registry)
+  {
+    return 0;
+  }
+
+  return ldk_query_count(component_registry, query);
+}
+
+LDKQueryIter ldk_ecs_query_iter_begin(LDKQuery query)
+{
+  return ldk_query_iter_begin(ldk_ecs_entity_registry_get(), ldk_ecs_component_registry_get(), query);
+}
+
+bool ldk_ecs_query_iter_next(LDKQueryIter* iter, LDKQueryBatch* out_batch)
+{
+  return ldk_query_iter_next(iter, out_batch);
+}
+
+
+// ---------------------------------------------------------------------------
+// Prefabs
+// ---------------------------------------------------------------------------
+
+bool ldk_ecs_prefab_capture(LDKPrefab* prefab, LDKEntity entity)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return false;
+  }
+
+  return ldk_prefab_capture(prefab, entity_registry, component_registry, entity);
+}
+
+u32 ldk_ecs_prefab_instantiate(const LDKPrefab* prefab, u32 count, LDKEntity* out_roots)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry)
+  {
+    return 0;
+  }
+
+  return ldk_prefab_instantiate(prefab, entity_registry, component_registry, count, out_roots);
+}
+
+
+// ---------------------------------------------------------------------------
+// Scenes
+// ---------------------------------------------------------------------------
+
+static XArray* s_ecs_scene_metas_create(void)
+{
+  XArray* metas = x_array_create(sizeof(const LDKComponentMeta*), 16);
+  LDKGame* game = ldk_game_get();
+  const LDKComponentMeta* meta = NULL;
+  u32 count = 0;
+  u32 i = 0;
+
+  if (!metas)
+  {
+    return NULL;
+  }
+
+  meta = ldk_transform_component_meta();
+  x_array_push(metas, &meta);
+  meta = ldk_camera_component_meta();
+  x_array_push(metas, &meta);
+
+  if (game && game->metadata_count && game->metadata_get)
+  {
+    count = game->metadata_count();
+
+    for (i = 0; i < count; ++i)
+    {
+      meta = game->metadata_get(i);
+      x_array_push(metas, &meta);
+    }
+  }
+
+  return metas;
+}
+
+bool ldk_ecs_scene_save(const char* path)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+  XArray* entities = NULL;
+  XArray* metas = NULL;
+  LDKEntityIterator it;
+  LDKEntity entity;
+  bool result = false;
+
+  if (!entity_registry || !component_registry || !path)
+  {
+    return false;
+  }
+
+  entities = x_array_create(sizeof(LDKEntity), ldk_entity_alive_count(entity_registry) + 1);
+  metas = s_ecs_scene_metas_create();
+
+  if (entities && metas)
+  {
+    it = ldk_entity_iterator_begin(entity_registry);
+    while (ldk_entity_iterator_next(&it, &entity))
+    {
+      if (!ldk_entity_internal_flags_has(entity_registry, entity, LDK_ENTITY_INTERNAL_PENDING_DELETE))
+      {
+        x_array_push(entities, &entity);
+      }
+    }
+    ldk_entity_iterator_end(&it);
+
+    result = ldk_scene_save(entity_registry, component_registry,
+        (const LDKEntity*)x_array_data(entities), x_array_count(entities),
+        (const LDKComponentMeta* const*)x_array_data(metas), x_array_count(metas), path);
+  }
+
+  if (entities)
+  {
+    x_array_destroy(entities);
+  }
+
+  if (metas)
+  {
+    x_array_destroy(metas);
+  }
+
+  if (!result)
+  {
+    ldk_log_error("Failed to save scene '%s'", path);
+  }
+
+  return result;
+}
+
+bool ldk_ecs_scene_load(const char* path, XArray* out_entities)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry || !path)
+  {
+    return false;
+  }
+
+  if (!ldk_scene_load(entity_registry, component_registry, path, out_entities))
+  {
+    ldk_log_error("Failed to load scene '%s'", path);
+    return false;
+  }
+
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Snapshots
+// ---------------------------------------------------------------------------
+
+bool ldk_ecs_snapshot_capture(LDKECSSnapshot* snapshot)
+{
+  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
+  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+
+  if (!entity_registry || !component_registry || !snapshot)
+  {
+    return false;
+  }
+
+  return ldk_entity_snapshot_capture(entity_registry, &snapshot->entity)
+    && ldk_component_snapshot_capture(component_registry, &snapshot->component);
+}
+
+bool ldk_ecs_snapshot_restore(LDKECSSnapshot* snapshot)
+{
+  LDKECS* ecs = s_ecs_context();
+  u32 i = 0;
+
+  if (!ecs || !snapshot)
+  {
+    return false;
+  }
+
+  // Recorded commands refer to entities of the world being replaced
+  for (i = 0; i < LDK_ECS_COMMAND_BUFFER_COUNT; ++i)
+  {
+    ldk_ecs_command_buffer_clear(&ecs->commands[i]);
+  }
+
+  if (!ldk_entity_snapshot_restore(&ecs->entity, &snapshot->entity))
+  {
+    return false;
+  }
+
+  // Restored transforms bring their own links
+  ldk_scenegraph_invalidate(&ecs->scenegraph);
+  return ldk_component_snapshot_restore(&ecs->component, &ecs->entity, &snapshot->component);
+}
+
+void ldk_ecs_snapshot_release(LDKECSSnapshot* snapshot)
+{
+  if (!snapshot)
+  {
+    return;
+  }
+
+  ldk_entity_snapshot_release(&snapshot->entity);
+  ldk_component_snapshot_release(&snapshot->component);
+}
+
+
+// ---------------------------------------------------------------------------
+// Worlds
+// ---------------------------------------------------------------------------
+
+LDKECS* ldk_ecs_world_create(u32 entity_page_capacity, u32 entity_initial_pages)
+{
+  LDKECS* world = (LDKECS*)LDK_ALLOC(sizeof(LDKECS));
+
+  if (!world)
+  {
+    return NULL;
+  }
+
+  memset(world, 0, sizeof(*world));
+
+  if (!ldk_ecs_initialize(world, entity_page_capacity, entity_initial_pages))
+  {
+    LDK_FREE(world);
+    return NULL;
+  }
+
+  return world;
+}
+
+void ldk_ecs_world_destroy(LDKECS* world)
+{
+  if (!world)
+  {
+    return;
+  }
+
+  if (s_ecs_thread_world == world)
+  {
+    s_ecs_thread_world = NULL;
+  }
+
+  s_ecs_context_terminate(world);
+  LDK_FREE(world);
+}
+
+LDKECS* ldk_ecs_world_bind(LDKECS* world)
+{
+  LDKECS* previous = s_ecs_thread_world;
+  s_ecs_thread_world = world;
+  return previous;
+}
+
+LDKECS* ldk_ecs_world_get(void)
+{
+  return s_ecs_context();
+}
+
+/*
+ * Describes every component type of world for the scene writer. Types without
+ * engine or game metadata are copied as raw bytes. Fails when a type is not
+ * registered with the same size in target, as its components would be dropped.
+ */
+static bool s_ecs_world_metas_build(LDKECS* world, LDKECS* target, XArray* known,
+    LDKComponentMeta* raw_metas, XArray* out_metas)
+{
+  u32 slot_count = ldk_component_slot_count(&world->component);
+  u32 slot = 0;
+  u32 i = 0;
+
+  for (slot = 0; slot < slot_count; ++slot)
+  {
+    const LDKComponentDesc* desc = &ldk_component_entry_get(&world->component, slot)->desc;
+    LDKRegisteredComponent* target_entry = ldk_component_entry_get(&target->component,
+        ldk_component_slot_get(&target->component, desc->type));
+    const LDKComponentMeta* meta = NULL;
+
+    if (!target_entry || target_entry->desc.entry_size != desc->entry_size)
+    {
+      ldk_log_error("Cannot merge component '%s': not registered the same way in the target world.", desc->name);
+      return false;
+    }
+
+    for (i = 0; i < x_array_count(known); ++i)
+    {
+      const LDKComponentMeta* candidate = *(const LDKComponentMeta**)x_array_get(known, i);
+
+      if (candidate && candidate->type == desc->type)
+      {
+        meta = candidate;
+        break;
+      }
+    }
+
+    if (!meta)
+    {
+      raw_metas[slot].name = desc->name;
+      raw_metas[slot].type = desc->type;
+      raw_metas[slot].size = desc->entry_size;
+      raw_metas[slot].fields = NULL;
+      raw_metas[slot].field_count = 0;
+      meta = &raw_metas[slot];
+    }
+
+    x_array_push(out_metas, &meta);
+  }
+
+  return true;
+}
+
+bool ldk_ecs_world_merge(LDKECS* world, XArray* out_entities)
+{
+  LDKECS* target = s_ecs_context();
+  LDKComponentMeta* raw_metas = NULL;
+  XArray* known = NULL;
+  XArray* metas = NULL;
+  XArray* entities = NULL;
+  XArray* scene = NULL;
+  LDKEntityIterator it;
+  LDKEntity entity;
+  u32 slot_count = 0;
+  bool result = false;
+
+  if (!world || !target || world == target)
+  {
+    return false;
+  }
+
+  slot_count = ldk_component_slot_count(&world->component);
+  raw_metas = (LDKComponentMeta*)LDK_ALLOC(sizeof(LDKComponentMeta) * (slot_count + 1));
+  known = s_ecs_scene_metas_create();
+  metas = x_array_create(sizeof(const LDKComponentMeta*), slot_count + 1);
+  entities = x_array_create(sizeof(LDKEntity), ldk_entity_alive_count(&world->entity) + 1);
+  scene = x_array_create(sizeof(u8), 4096);
+
+  if (raw_metas && known && metas && entities && scene
+      && s_ecs_world_metas_build(world, target, known, raw_metas, metas))
+  {
+    it = ldk_entity_iterator_begin(&world->entity);
+    while (ldk_entity_iterator_next(&it, &entity))
+    {
+      if (!ldk_entity_internal_flags_has(&world->entity, entity, LDK_ENTITY_INTERNAL_PENDING_DELETE))
+      {
+        x_array_push(entities, &entity);
+      }
+    }
+    ldk_entity_iterator_end(&it);
+
+    // The scene format already remaps entity handles and adds components in bulk
+    result = ldk_scene_write(&world->entity, &world->component,
+        (const LDKEntity*)x_array_data(entities), x_array_count(entities),
+        (const LDKComponentMeta* const*)x_array_data(metas), x_array_count(metas), scene)
+      && ldk_scene_load_memory(&target->entity, &target->component,
+          x_array_data(scene), x_array_count(scene), out_entities);
+  }
+
+  if (raw_metas)
+  {
+    LDK_FREE(raw_metas);
+  }
+
+  if (known)
+  {
+    x_array_destroy(known);
+  }
+
+  if (metas)
+  {
+    x_array_destroy(metas);
+  }
+
+  if (entities)
+  {
+    x_array_destroy(entities);
+  }
+
+  if (scene)
+  {
+    x_array_destroy(scene);
+  }
+
+  if (!result)
+  {
+    ldk_log_error("Failed to merge ECS world.");
+  }
+
+  return result;
+}
+
+// ---------------------------------------------------------------------------
+// Deferred commands
+// ---------------------------------------------------------------------------
+
+LDKECSCommandBuffer* ldk_ecs_command_buffer_get(u32 thread_index)
+{
+  LDKECS* ecs = s_ecs_context();
+
+  if (!ecs || thread_index >= LDK_ECS_COMMAND_BUFFER_COUNT)
+  {
+    return NULL;
+  }
+
+  return &ecs->commands[thread_index];
+}
+
 
 // ---------------------------------------------------------------------------
 // System management
@@ -297,22 +996,28 @@ bool ldk_ecs_system_unregister(u64 id)
 
 LDKEntityRegistry* ldk_ecs_entity_registry_get(void)
 {
-  LDKECS* ecs = (LDKECS*)ldk_module_get(LDK_MODULE_ECS);
+  LDKECS* ecs = s_ecs_context();
   return &ecs->entity;
 }
 
 LDKComponentRegistry* ldk_ecs_component_registry_get(void)
 {
-  LDKECS* ecs = (LDKECS*)ldk_module_get(LDK_MODULE_ECS);
+  LDKECS* ecs = s_ecs_context();
   return &ecs->component;
 }
 
 LDKSystemRegistry* ldk_ecs_system_registry_get(void)
 {
-  LDKECS* ecs = (LDKECS*)ldk_module_get(LDK_MODULE_ECS);
+  LDKECS* ecs = s_ecs_context();
   return &ecs->system;
 }
 
+LDKScenegraph* ldk_ecs_scenegraph_get(void)
+{
+  LDKECS* ecs = s_ecs_context();
+  return &ecs->scenegraph;
+}
+
 bool ldk_ecs_system_registry_start(LDKECS* context)
 {
   return ldk_system_registry_start(&context->system);
@@ -323,14 +1028,55 @@ bool ldk_ecs_system_registry_stop(LDKECS* context)
   return ldk_system_registry_stop(&context->system);
 }
 
+u32 ldk_ecs_entity_destroy_pending(LDKECS* context)
+{
+  if (!context)
+  {
+    return 0;
+  }
+
+  return ldk_entity_destroy_pending(&context->entity, &context->component);
+}
+
+bool ldk_ecs_command_buffers_playback(LDKECS* context)
+{
+  bool result = true;
+
+  if (!context)
+  {
+    return false;
+  }
+
+  for (u32 i = 0; i < LDK_ECS_COMMAND_BUFFER_COUNT; ++i)
+  {
+    if (ldk_ecs_command_buffer_count(&context->commands[i]) == 0)
+    {
+      continue;
+    }
+
+    if (!ldk_ecs_command_buffer_playback(&context->commands[i], context))
+    {
+      result = false;
+    }
+  }
+
+  return result;
+}
+
 bool ldk_ecs_system_bucket_run(LDKECS* context, LDKSystemBucket bucket, float dt)
 {
+  bool result = false;
+
   if (!context || !context->system.is_started)
   {
     return false;
   }
 
-  return ldk_system_registry_run_bucket(&context->system, bucket, dt);
+  result = ldk_system_registry_run_bucket(&context->system, bucket, dt);
+
+  // Sync point: structural changes recorded by systems are applied between buckets
+  ldk_ecs_command_buffers_playback(context);
+  return result;
 }
 
 #endif
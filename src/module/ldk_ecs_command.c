@@ -0,0 +1,305 @@
+#include <ldk_common.h>
+#include <module/ldk_ecs_command.h>
+#include <module/ldk_ecs.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_arena.h>
+
+#include <string.h>
+
+static bool s_command_push(LDKECSCommandBuffer* buffer, LDKECSCommandType type,
+    LDKEntity entity, u32 component_type, const void* value)
+{
+  LDKECSCommand command = {0};
+
+  if (!buffer || !buffer->commands)
+  {
+    return false;
+  }
+
+  if (x_handle_is_null(entity))
+  {
+    return false;
+  }
+
+  command.type = (u32)type;
+  command.component_type = component_type;
+  command.entity = entity;
+  command.value = NULL;
+
+  if (value)
+  {
+    LDKRegisteredComponent* entry = ldk_component_entry_get(buffer->components,
+        ldk_component_slot_get(buffer->components, component_type));
+
+    if (!entry)
+    {
+      return false;
+    }
+
+    command.value = x_arena_alloc(buffer->arena, entry->desc.entry_size);
+    if (!command.value)
+    {
+      return false;
+    }
+
+    memcpy(command.value, value, entry->desc.entry_size);
+  }
+
+  x_array_push(buffer->commands, &command);
+  return true;
+}
+
+/* Maps a pending handle to the entity created during playback */
+static LDKEntity s_command_entity_resolve(LDKECSCommandBuffer* buffer, LDKEntity entity)
+{
+  if (!ldk_ecs_command_entity_is_pending(entity))
+  {
+    return entity;
+  }
+
+  if (entity.index >= x_array_count(buffer->created))
+  {
+    return x_handle_null();
+  }
+
+  return *(LDKEntity*)x_array_get(buffer->created, entity.index);
+}
+
+bool ldk_ecs_command_buffer_initialize(LDKECSCommandBuffer* buffer, LDKComponentRegistry* components)
+{
+  if (!buffer || !components)
+  {
+    return false;
+  }
+
+  memset(buffer, 0, sizeof(*buffer));
+  buffer->components = components;
+  buffer->arena = x_arena_create(LDK_ECS_COMMAND_ARENA_SIZE);
+  buffer->commands = x_array_create(sizeof(LDKECSCommand), 64);
+  buffer->created = x_array_create(sizeof(LDKEntity), 16);
+
+  if (!buffer->arena || !buffer->commands || !buffer->created)
+  {
+    ldk_ecs_command_buffer_terminate(buffer);
+    return false;
+  }
+
+  return true;
+}
+
+void ldk_ecs_command_buffer_terminate(LDKECSCommandBuffer* buffer)
+{
+  if (!buffer)
+  {
+    return;
+  }
+
+  if (buffer->arena)
+  {
+    x_arena_destroy(buffer->arena);
+  }
+
+  if (buffer->commands)
+  {
+    x_array_destroy(buffer->commands);
+  }
+
+  if (buffer->created)
+  {
+    x_array_destroy(buffer->created);
+  }
+
+  memset(buffer, 0, sizeof(*buffer));
+}
+
+void ldk_ecs_command_buffer_clear(LDKECSCommandBuffer* buffer)
+{
+  if (!buffer || !buffer->commands)
+  {
+    return;
+  }
+
+  x_arena_reset(buffer->arena);
+  x_array_clear(buffer->commands);
+  x_array_clear(buffer->created);
+  buffer->pending_count = 0;
+}
+
+u32 ldk_ecs_command_buffer_count(LDKECSCommandBuffer* buffer)
+{
+  if (!buffer || !buffer->commands)
+  {
+    return 0;
+  }
+
+  return x_array_count(buffer->commands);
+}
+
+bool ldk_ecs_command_buffer_playback(LDKECSCommandBuffer* buffer, struct LDKECS* context)
+{
+  LDKEntityRegistry* entity_registry = NULL;
+  LDKComponentRegistry* component_registry = NULL;
+  bool result = true;
+  u32 count = 0;
+  u32 i = 0;
+
+  if (!buffer || !buffer->commands || !context)
+  {
+    return false;
+  }
+
+  entity_registry = &context->entity;
+  component_registry = &context->component;
+  count = x_array_count(buffer->commands);
+
+  for (i = 0; i < count; ++i)
+  {
+    const LDKECSCommand* command = (const LDKECSCommand*)x_array_get(buffer->commands, i);
+    LDKEntity entity = x_handle_null();
+    bool applied = false;
+
+    if (command->type == LDK_ECS_COMMAND_ENTITY_CREATE)
+    {
+      entity = ldk_entity_create(entity_registry);
+
+      // Entities always have a transform component
+      if (!x_handle_is_null(entity) &&
+          !ldk_entity_component_add(entity_registry, component_registry, entity, LDK_COMPONENT_TYPE_TRANSFORM, NULL))
+      {
+        ldk_entity_destroy(entity_registry, entity);
+        entity = x_handle_null();
+      }
+
+      // Keep the pending index aligned even on failure so later commands resolve to null
+      x_array_push(buffer->created, &entity);
+      applied = !x_handle_is_null(entity);
+    }
+    else
+    {
+      entity = s_command_entity_resolve(buffer, command->entity);
+
+      if (!ldk_entity_is_alive(entity_registry, entity))
+      {
+        result = false;
+        continue;
+      }
+
+      switch (command->type)
+      {
+        case LDK_ECS_COMMAND_ENTITY_DESTROY:
+          // Same as ldk_ecs_entity_destroy(): swept with every other marked entity at the end of the frame
+          ldk_entity_destroy_deferred(entity_registry, entity);
+          applied = true;
+          break;
+
+        case LDK_ECS_COMMAND_COMPONENT_ADD:
+          if (ldk_component_is_tag(component_registry, command->component_type))
+          {
+            applied = ldk_entity_tag_add(entity_registry, component_registry, entity, command->component_type);
+          }
+          else
+          {
+            applied = ldk_entity_component_add(entity_registry, component_registry,
+                entity, command->component_type, command->value) != NULL;
+          }
+          break;
+
+        case LDK_ECS_COMMAND_COMPONENT_REMOVE:
+          applied = ldk_entity_component_remove(entity_registry, component_registry,
+              entity, command->component_type);
+          break;
+
+        case LDK_ECS_COMMAND_COMPONENT_SET:
+          {
+            void* component = ldk_entity_component_get(entity_registry, component_registry,
+                entity, command->component_type);
+            LDKRegisteredComponent* entry = ldk_component_entry_get(component_registry,
+                ldk_component_slot_get(component_registry, command->component_type));
+
+            if (component && entry)
+            {
+              memcpy(component, command->value, entry->desc.entry_size);
+              applied = true;
+            }
+          }
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    if (!applied)
+    {
+      result = false;
+    }
+  }
+
+  ldk_ecs_command_buffer_clear(buffer);
+  return result;
+}
+
+LDKEntity ldk_ecs_command_entity_create(LDKECSCommandBuffer* buffer)
+{
+  LDKEntity entity = x_handle_null();
+
+  if (!buffer || !buffer->commands)
+  {
+    return entity;
+  }
+
+  entity.index = buffer->pending_count;
+  entity.version = LDK_ECS_COMMAND_PENDING_VERSION;
+
+  if (!s_command_push(buffer, LDK_ECS_COMMAND_ENTITY_CREATE, entity, 0, NULL))
+  {
+    return x_handle_null();
+  }
+
+  buffer->pending_count++;
+  return entity;
+}
+
+bool ldk_ecs_command_entity_is_pending(LDKEntity entity)
+{
+  return !x_handle_is_null(entity) && entity.version == LDK_ECS_COMMAND_PENDING_VERSION;
+}
+
+bool ldk_ecs_command_entity_destroy(LDKECSCommandBuffer* buffer, LDKEntity entity)
+{
+  return s_command_push(buffer, LDK_ECS_COMMAND_ENTITY_DESTROY, entity, 0, NULL);
+}
+
+bool ldk_ecs_command_component_add(LDKECSCommandBuffer* buffer, LDKEntity entity, u32 component_type, const void* initial_value)
+{
+  // Transforms are attached on entity creation, like ldk_ecs_component_add()
+  if (component_type == LDK_COMPONENT_TYPE_TRANSFORM)
+  {
+    return false;
+  }
+
+  return s_command_push(buffer, LDK_ECS_COMMAND_COMPONENT_ADD, entity, component_type, initial_value);
+}
+
+bool ldk_ecs_command_component_remove(LDKECSCommandBuffer* buffer, LDKEntity entity, u32 component_type)
+{
+  // Transform components can not be removed
+  if (component_type == LDK_COMPONENT_TYPE_TRANSFORM)
+  {
+    return false;
+  }
+
+  return s_command_push(buffer, LDK_ECS_COMMAND_COMPONENT_REMOVE, entity, component_type, NULL);
+}
+
+bool ldk_ecs_command_component_set(LDKECSCommandBuffer* buffer, LDKEntity entity, u32 component_type, const void* value)
+{
+  if (!value)
+  {
+    return false;
+  }
+
+  return s_command_push(buffer, LDK_ECS_COMMAND_COMPONENT_SET, entity, component_type, value);
+}
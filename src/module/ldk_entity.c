@@ -2,6 +2,13 @@
 #include <module/ldk_component.h>
 #include <stdx/stdx_hpool.h>
 #include <stdx/stdx_array.h>
+
+#ifndef LDK_ALLOC
+#include <stdlib.h>
+#define LDK_ALLOC(size) malloc(size)
+#define LDK_FREE(ptr) free(ptr)
+#endif
+
 #include <string.h>
 
 
@@ -13,35 +20,219 @@ static void s_entity_ctor(void* user, void* item)
   LDKEntityInfo* info = (LDKEntityInfo*)item;
   memset(info, 0, sizeof(*info));
   info->transform_index = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+  info->archetype = LDK_ARCHETYPE_NONE;
+  info->archetype_row = LDK_ENTITY_INVALID_COMPONENT_INDEX;
 }
 
-static bool s_entity_component_ref_add(LDKEntityRegistry* module, LDKEntity entity,
-    u32 component_type, u32 component_index)
+/* Cold data of a slot the caller already knows is alive */
+static LDKEntityColdInfo* s_entity_cold_get(LDKEntityRegistry* module, u32 index)
 {
-  LDKEntityInfo* info = ldk_entity_info_get(module, entity);
-  u32 count = 0;
+  u32 page_capacity = x_hpool_page_capacity(&module->pool);
+  return &module->cold_pages[index / page_capacity][index % page_capacity];
+}
 
-  if (!info)
+/* Grows the cold page table to at least page_count entries. Pages themselves are allocated on first use. */
+static bool s_entity_cold_pages_reserve(LDKEntityRegistry* module, u32 page_count)
+{
+  LDKEntityColdInfo** pages = NULL;
+
+  if (page_count <= module->cold_page_count)
+  {
+    return true;
+  }
+
+  pages = (LDKEntityColdInfo**)LDK_ALLOC(sizeof(LDKEntityColdInfo*) * page_count);
+
+  if (!pages)
   {
     return false;
   }
 
-  if (ldk_entity_component_has(module, entity, component_type))
+  memset(pages, 0, sizeof(LDKEntityColdInfo*) * page_count);
+
+  if (module->cold_pages)
+  {
+    memcpy(pages, module->cold_pages, sizeof(LDKEntityColdInfo*) * module->cold_page_count);
+    LDK_FREE(module->cold_pages);
+  }
+
+  module->cold_pages = pages;
+  module->cold_page_count = page_count;
+  return true;
+}
+
+/* Makes sure the cold page for index exists and resets the entry. Called right after the pool hands out the slot. */
+static bool s_entity_cold_acquire(LDKEntityRegistry* module, u32 index)
+{
+  u32 page_capacity = x_hpool_page_capacity(&module->pool);
+  u32 page = index / page_capacity;
+  LDKEntityColdInfo* cold = NULL;
+
+  if (!s_entity_cold_pages_reserve(module, page + 1))
   {
     return false;
   }
 
-  count = info->components.component_count;
+  if (!module->cold_pages[page])
+  {
+    module->cold_pages[page] = (LDKEntityColdInfo*)LDK_ALLOC(sizeof(LDKEntityColdInfo) * page_capacity);
+
+    if (!module->cold_pages[page])
+    {
+      return false;
+    }
+  }
 
-  if (count >= LDK_ENTITY_MAX_COMPONENTS)
+  cold = s_entity_cold_get(module, index);
+  memset(cold, 0, sizeof(*cold));
+  cold->components.capacity = LDK_ENTITY_INLINE_COMPONENTS;
+  return true;
+}
+
+static void s_entity_cold_release(LDKEntityRegistry* module, u32 index)
+{
+  LDKEntityColdInfo* cold = s_entity_cold_get(module, index);
+
+  if (cold->components.heap)
+  {
+    LDK_FREE(cold->components.heap);
+    cold->components.heap = NULL;
+  }
+}
+
+/* Releases the cold data of every alive entity and, when free_pages is set, the pages themselves */
+static void s_entity_cold_release_all(LDKEntityRegistry* module, bool free_pages)
+{
+  XHPoolIter it = {0};
+  LDKEntity entity = x_handle_null();
+  void* item = NULL;
+  u32 i = 0;
+
+  for (item = x_hpool_iter_begin(&module->pool, &it, &entity);
+      item;
+      item = x_hpool_iter_next(&module->pool, &it, &entity))
+  {
+    s_entity_cold_release(module, entity.index);
+  }
+
+  if (!free_pages)
+  {
+    return;
+  }
+
+  for (i = 0; i < module->cold_page_count; ++i)
+  {
+    if (module->cold_pages[i])
+    {
+      LDK_FREE(module->cold_pages[i]);
+    }
+  }
+
+  if (module->cold_pages)
+  {
+    LDK_FREE(module->cold_pages);
+  }
+
+  module->cold_pages = NULL;
+  module->cold_page_count = 0;
+}
+
+static void* s_entity_component_data_get(LDKEntityInfo* info, LDKEntityColdInfo* cold,
+    LDKComponentRegistry* component_module, u32 slot)
+{
+  u32 component_type = ldk_component_directory_types(&cold->components)[slot];
+  u32 component_index = ldk_component_directory_indices(&cold->components)[slot];
+
+  if (component_index == LDK_ENTITY_ARCHETYPE_COMPONENT_INDEX)
+  {
+    return ldk_component_archetype_data_get(component_module, info->archetype, info->archetype_row, component_type);
+  }
+
+  return ldk_component_get(component_module, component_type, component_index);
+}
+
+/* Mutable access stamps the component change tick. Archetype components are not tracked. */
+static void s_entity_component_mark_changed(LDKEntityColdInfo* cold, LDKComponentRegistry* component_module, u32 slot)
+{
+  u32 component_index = ldk_component_directory_indices(&cold->components)[slot];
+
+  if (component_index != LDK_ENTITY_ARCHETYPE_COMPONENT_INDEX)
+  {
+    ldk_component_mark_changed(component_module, ldk_component_directory_types(&cold->components)[slot], component_index);
+  }
+}
+
+static bool s_entity_directory_grow(LDKComponentDirectory* directory)
+{
+  u32 capacity = (u32)directory->capacity * 2;
+  u32* heap = NULL;
+
+  if (capacity > LDK_COMPONENT_MAX_TYPES)
+  {
+    capacity = LDK_COMPONENT_MAX_TYPES;
+  }
+
+  if (capacity <= directory->component_count)
+  {
+    return false;
+  }
+
+  heap = (u32*)LDK_ALLOC(sizeof(u32) * capacity * 2);
+  if (!heap)
+  {
+    return false;
+  }
+
+  memcpy(heap, ldk_component_directory_types(directory), sizeof(u32) * directory->component_count);
+  memcpy(heap + capacity, ldk_component_directory_indices(directory), sizeof(u32) * directory->component_count);
+
+  if (directory->heap)
+  {
+    LDK_FREE(directory->heap);
+  }
+
+  directory->heap = heap;
+  directory->capacity = (u16)capacity;
+  return true;
+}
+
+/* Directory entries are sorted by slot and tags have none, so the position is the rank of the slot among non tag bits */
+static u32 s_entity_directory_position(LDKEntityRegistry* module, const LDKEntityInfo* info, u32 slot)
+{
+  return ldk_component_mask_rank_excluding(&info->mask, &module->components->tag_mask, slot);
+}
+
+/* Inserts a directory entry at the position given by the component slot and notifies cached queries */
+static bool s_entity_directory_insert(LDKEntityRegistry* module, LDKEntity entity, LDKEntityInfo* info,
+    u32 slot, u32 component_type, u32 component_index)
+{
+  LDKComponentDirectory* directory = &s_entity_cold_get(module, entity.index)->components;
+  u32* types = NULL;
+  u32* indices = NULL;
+  u32 position = 0;
+  u32 count = directory->component_count;
+
+  if (ldk_component_mask_test(&info->mask, slot))
+  {
+    return false;
+  }
+
+  if (count >= directory->capacity && !s_entity_directory_grow(directory))
   {
     return false;
   }
 
-  info->components.component_type[count] = component_type;
-  info->components.component_index[count] = component_index;
-  info->components.component_count = (u16)(count + 1);
-  info->components.version += 1;
+  types = ldk_component_directory_types(directory);
+  indices = ldk_component_directory_indices(directory);
+  position = s_entity_directory_position(module, info, slot);
+
+  memmove(types + position + 1, types + position, sizeof(u32) * (count - position));
+  memmove(indices + position + 1, indices + position, sizeof(u32) * (count - position));
+  types[position] = component_type;
+  indices[position] = component_index;
+  directory->component_count = (u16)(count + 1);
+  directory->version += 1;
+  ldk_component_mask_set(&info->mask, slot);
 
   // For faster entity/transform lookup we keep the transform index in the entityInfo 
   if (component_type == LDK_COMPONENT_TYPE_TRANSFORM)
@@ -49,9 +240,30 @@ static bool s_entity_component_ref_add(LDKEntityRegistry* module, LDKEntity enti
     info->transform_index = component_index;
   }
 
+  ldk_query_registry_entity_changed(&module->components->queries, entity, &info->mask);
   return true;
 }
 
+static bool s_entity_component_ref_add(LDKEntityRegistry* module, LDKEntity entity,
+    u32 component_type, u32 component_index)
+{
+  LDKEntityInfo* info = ldk_entity_info_get(module, entity);
+  u32 slot = 0;
+
+  if (!info || !module->components)
+  {
+    return false;
+  }
+
+  slot = ldk_component_slot_get(module->components, component_type);
+  if (slot == LDK_COMPONENT_INVALID_SLOT)
+  {
+    return false;
+  }
+
+  return s_entity_directory_insert(module, entity, info, slot, component_type, component_index);
+}
+
 static bool s_entity_component_ref_update(LDKEntityRegistry* module, LDKEntity entity,
     u32 component_type, u32 component_index)
 {
@@ -68,7 +280,7 @@ static bool s_entity_component_ref_update(LDKEntityRegistry* module, LDKEntity e
     return false;
   }
 
-  info->components.component_index[slot] = component_index;
+  ldk_component_directory_indices(&s_entity_cold_get(module, entity.index)->components)[slot] = component_index;
 
   // For faster entity/transform lookup we keep the transform index in the entityInfo 
   if (component_type == LDK_COMPONENT_TYPE_TRANSFORM)
@@ -82,43 +294,86 @@ static bool s_entity_component_ref_update(LDKEntityRegistry* module, LDKEntity e
 static bool s_entity_component_ref_remove(LDKEntityRegistry* module, LDKEntity entity, u32 component_type)
 {
   LDKEntityInfo* info = ldk_entity_info_get(module, entity);
-  u32 slot = 0;
+  LDKComponentDirectory* directory = NULL;
+  u32* types = NULL;
+  u32* indices = NULL;
+  u32 position = 0;
   u32 count = 0;
-  u32 last = 0;
 
   if (!info)
   {
     return false;
   }
 
-  if (!ldk_entity_component_find(module, entity, component_type, &slot, NULL))
+  if (!ldk_entity_component_find(module, entity, component_type, &position, NULL))
   {
     return false;
   }
 
-  count = info->components.component_count;
-  last = count - 1;
+  directory = &s_entity_cold_get(module, entity.index)->components;
+  types = ldk_component_directory_types(directory);
+  indices = ldk_component_directory_indices(directory);
+  count = directory->component_count;
+
+  memmove(types + position, types + position + 1, sizeof(u32) * (count - position - 1));
+  memmove(indices + position, indices + position + 1, sizeof(u32) * (count - position - 1));
+  types[count - 1] = 0;
+  indices[count - 1] = 0;
+  directory->component_count = (u16)(count - 1);
+  directory->version += 1;
+  ldk_component_mask_clear(&info->mask, ldk_component_slot_get(module->components, component_type));
+
+  if (component_type == LDK_COMPONENT_TYPE_TRANSFORM)
+  {
+    info->transform_index = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+  }
+
+  ldk_query_registry_entity_changed(&module->components->queries, entity, &info->mask);
+  return true;
+}
+
+static void* s_entity_archetype_component_add(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module,
+    LDKEntity entity, u32 component_type, const void* initial_value)
+{
+  const LDKEntityInfo* info = NULL;
+
+  if (ldk_entity_component_has(entity_module, entity, component_type))
+  {
+    return NULL;
+  }
 
-  if (slot != last)
+  if (!ldk_component_archetype_insert(component_module, entity_module, entity, component_type))
   {
-    info->components.component_type[slot] =
-      info->components.component_type[last];
+    return NULL;
+  }
 
-    info->components.component_index[slot] =
-      info->components.component_index[last];
+  if (!s_entity_component_ref_add(
+        entity_module,
+        entity,
+        component_type,
+        LDK_ENTITY_ARCHETYPE_COMPONENT_INDEX))
+  {
+    ldk_component_archetype_erase(component_module, entity_module, entity, component_type);
+    return NULL;
   }
 
-  info->components.component_type[last] = 0;
-  info->components.component_index[last] = 0;
-  info->components.component_count = (u16)(count - 1);
-  info->components.version += 1;
+  info = ldk_entity_info_get(entity_module, entity);
 
-  if (component_type == LDK_COMPONENT_TYPE_TRANSFORM)
+  if (!ldk_component_attach(
+        component_module,
+        entity_module,
+        entity,
+        component_type,
+        info->archetype_row,
+        initial_value))
   {
-    info->transform_index = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+    s_entity_component_ref_remove(entity_module, entity, component_type);
+    ldk_component_archetype_erase(component_module, entity_module, entity, component_type);
+    return NULL;
   }
 
-  return true;
+  // The attach callback may have added components and moved the row, resolve again
+  return ldk_entity_component_get(entity_module, component_module, entity, component_type);
 }
 
 bool ldk_entity_module_initialize(LDKEntityRegistry* module, u32 page_capacity, u32 initial_pages)
@@ -156,7 +411,24 @@ void ldk_entity_module_terminate(LDKEntityRegistry* module)
     return;
   }
 
+  s_entity_cold_release_all(module, true);
   x_hpool_term(&module->pool);
+
+  if (module->pending_destroy)
+  {
+    x_array_destroy(module->pending_destroy);
+  }
+
+  if (module->sweep_entities)
+  {
+    x_array_destroy(module->sweep_entities);
+  }
+
+  if (module->sweep_indices)
+  {
+    x_array_destroy(module->sweep_indices);
+  }
+
   memset(module, 0, sizeof(*module));
 }
 
@@ -167,17 +439,250 @@ void ldk_entity_module_clear(LDKEntityRegistry* module)
     return;
   }
 
+  // Cold pages are kept for reuse, only the directories spilled to the heap are released
+  s_entity_cold_release_all(module, false);
   x_hpool_clear(&module->pool);
+
+  if (module->pending_destroy)
+  {
+    x_array_clear(module->pending_destroy);
+  }
+}
+
+/* Releases the heap directories of the alive entries of pool */
+static void s_entity_cold_heaps_release(XHPool* pool, LDKEntityColdInfo** cold_pages)
+{
+  u32 page_capacity = x_hpool_page_capacity(pool);
+  u32 i = 0;
+
+  for (i = 0; i < pool->alive_count; ++i)
+  {
+    u32 index = pool->alive[i];
+    LDKComponentDirectory* directory = &cold_pages[index / page_capacity][index % page_capacity].components;
+
+    if (directory->heap)
+    {
+      LDK_FREE(directory->heap);
+      directory->heap = NULL;
+    }
+  }
+}
+
+/*
+ * Makes dst an exact copy of src. Cold pages are copied as raw blocks and only
+ * the few directories spilled to the heap are copied one by one.
+ */
+static bool s_entity_state_copy(XHPool* dst_pool, LDKEntityColdInfo*** dst_pages, u32* dst_page_count,
+    XHPool* src_pool, LDKEntityColdInfo** src_pages, u32 src_page_count)
+{
+  u32 page_capacity = x_hpool_page_capacity(src_pool);
+  bool result = true;
+  u32 i = 0;
+
+  if (dst_pool->page_count > 0 && *dst_pages)
+  {
+    s_entity_cold_heaps_release(dst_pool, *dst_pages);
+  }
+
+  // Pages of a different capacity can not be reused
+  if (*dst_pages && x_hpool_page_capacity(dst_pool) != page_capacity)
+  {
+    for (i = 0; i < *dst_page_count; ++i)
+    {
+      if ((*dst_pages)[i])
+      {
+        LDK_FREE((*dst_pages)[i]);
+      }
+    }
+
+    LDK_FREE(*dst_pages);
+    *dst_pages = NULL;
+    *dst_page_count = 0;
+  }
+
+  if (!x_hpool_copy(dst_pool, src_pool))
+  {
+    return false;
+  }
+
+  if (src_page_count > *dst_page_count)
+  {
+    LDKEntityColdInfo** pages = (LDKEntityColdInfo**)LDK_ALLOC(sizeof(LDKEntityColdInfo*) * src_page_count);
+
+    if (!pages)
+    {
+      return false;
+    }
+
+    memset(pages, 0, sizeof(LDKEntityColdInfo*) * src_page_count);
+
+    if (*dst_pages)
+    {
+      memcpy(pages, *dst_pages, sizeof(LDKEntityColdInfo*) * (*dst_page_count));
+      LDK_FREE(*dst_pages);
+    }
+
+    *dst_pages = pages;
+    *dst_page_count = src_page_count;
+  }
+
+  for (i = 0; i < src_page_count; ++i)
+  {
+    if (!src_pages[i])
+    {
+      continue;
+    }
+
+    if (!(*dst_pages)[i])
+    {
+      (*dst_pages)[i] = (LDKEntityColdInfo*)LDK_ALLOC(sizeof(LDKEntityColdInfo) * page_capacity);
+
+      if (!(*dst_pages)[i])
+      {
+        return false;
+      }
+    }
+
+    memcpy((*dst_pages)[i], src_pages[i], sizeof(LDKEntityColdInfo) * page_capacity);
+  }
+
+  for (i = 0; i < src_pool->alive_count; ++i)
+  {
+    u32 index = src_pool->alive[i];
+    LDKComponentDirectory* directory = &(*dst_pages)[index / page_capacity][index % page_capacity].components;
+    const u32* heap = directory->heap;
+
+    if (!heap)
+    {
+      continue;
+    }
+
+    directory->heap = (u32*)LDK_ALLOC(sizeof(u32) * directory->capacity * 2);
+
+    if (!directory->heap)
+    {
+      // Never share a heap with src. An empty directory can still be released.
+      directory->component_count = 0;
+      directory->capacity = LDK_ENTITY_INLINE_COMPONENTS;
+      result = false;
+      continue;
+    }
+
+    memcpy(directory->heap, heap, sizeof(u32) * directory->capacity * 2);
+  }
+
+  return result;
+}
+
+/* The marked entities of a restored pool are the ones to sweep */
+static void s_entity_pending_rebuild(LDKEntityRegistry* module)
+{
+  XHPoolIter it = {0};
+  LDKEntity entity = x_handle_null();
+  LDKEntityInfo* info = NULL;
+
+  if (module->pending_destroy)
+  {
+    x_array_clear(module->pending_destroy);
+  }
+
+  for (info = (LDKEntityInfo*)x_hpool_iter_begin(&module->pool, &it, &entity);
+      info;
+      info = (LDKEntityInfo*)x_hpool_iter_next(&module->pool, &it, &entity))
+  {
+    if (!(info->internal_flags & LDK_ENTITY_INTERNAL_PENDING_DELETE))
+    {
+      continue;
+    }
+
+    if (!module->pending_destroy)
+    {
+      module->pending_destroy = x_array_create(sizeof(LDKEntity), 64);
+    }
+
+    if (module->pending_destroy)
+    {
+      x_array_push(module->pending_destroy, &entity);
+    }
+  }
+}
+
+bool ldk_entity_snapshot_capture(LDKEntityRegistry* module, LDKEntitySnapshot* snapshot)
+{
+  if (!module || !snapshot)
+  {
+    return false;
+  }
+
+  return s_entity_state_copy(&snapshot->pool, &snapshot->cold_pages, &snapshot->cold_page_count,
+      &module->pool, module->cold_pages, module->cold_page_count);
+}
+
+bool ldk_entity_snapshot_restore(LDKEntityRegistry* module, LDKEntitySnapshot* snapshot)
+{
+  if (!module || !snapshot || snapshot->pool.item_size != sizeof(LDKEntityInfo))
+  {
+    return false;
+  }
+
+  if (!s_entity_state_copy(&module->pool, &module->cold_pages, &module->cold_page_count,
+        &snapshot->pool, snapshot->cold_pages, snapshot->cold_page_count))
+  {
+    return false;
+  }
+
+  s_entity_pending_rebuild(module);
+  return true;
+}
+
+void ldk_entity_snapshot_release(LDKEntitySnapshot* snapshot)
+{
+  u32 i = 0;
+
+  if (!snapshot)
+  {
+    return;
+  }
+
+  if (snapshot->cold_pages)
+  {
+    s_entity_cold_heaps_release(&snapshot->pool, snapshot->cold_pages);
+
+    for (i = 0; i < snapshot->cold_page_count; ++i)
+    {
+      if (snapshot->cold_pages[i])
+      {
+        LDK_FREE(snapshot->cold_pages[i]);
+      }
+    }
+
+    LDK_FREE(snapshot->cold_pages);
+  }
+
+  // The pool copy has the dtor of the registry pool, so its items are freed without calling it
+  snapshot->pool.dtor = NULL;
+  x_hpool_term(&snapshot->pool);
+  memset(snapshot, 0, sizeof(*snapshot));
 }
 
 LDKEntity ldk_entity_create(LDKEntityRegistry* module)
 {
+  LDKEntity entity = x_handle_null();
+
   if (!module)
   {
     return x_handle_null();
   }
 
-  return x_hpool_alloc(&module->pool);
+  entity = x_hpool_alloc(&module->pool);
+
+  if (!x_handle_is_null(entity) && !s_entity_cold_acquire(module, entity.index))
+  {
+    x_hpool_free(&module->pool, entity);
+    return x_handle_null();
+  }
+
+  return entity;
 }
 
 void ldk_entity_destroy(LDKEntityRegistry* module, LDKEntity entity)
@@ -192,9 +697,291 @@ void ldk_entity_destroy(LDKEntityRegistry* module, LDKEntity entity)
     return;
   }
 
+  s_entity_cold_release(module, entity.index);
   x_hpool_free(&module->pool, entity);
 }
 
+u32 ldk_entity_create_batch(LDKEntityRegistry* module, LDKEntity* out_entities, u32 count)
+{
+  u32 page_capacity = 0;
+  u64 last_index = 0;
+  u32 i = 0;
+
+  if (!module || !out_entities || count == 0)
+  {
+    return 0;
+  }
+
+  // The pool hands out recycled slots or the next unused one, so no new index goes past this
+  page_capacity = x_hpool_page_capacity(&module->pool);
+  last_index = (u64)module->pool.next_index + count - 1;
+
+  if (last_index < UINT32_MAX &&
+      !s_entity_cold_pages_reserve(module, (u32)(last_index / page_capacity) + 1))
+  {
+    return 0;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    out_entities[i] = ldk_entity_create(module);
+
+    if (x_handle_is_null(out_entities[i]))
+    {
+      break;
+    }
+  }
+
+  return i;
+}
+
+void ldk_entity_destroy_batch(LDKEntityRegistry* module, const LDKEntity* entities, u32 count)
+{
+  u32 i = 0;
+
+  if (!module || !entities)
+  {
+    return;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    if (x_hpool_is_alive(&module->pool, entities[i]))
+    {
+      s_entity_cold_release(module, entities[i].index);
+      x_hpool_free(&module->pool, entities[i]);
+    }
+  }
+}
+
+bool ldk_entity_destroy_deferred(LDKEntityRegistry* module, LDKEntity entity)
+{
+  LDKEntityInfo* info = NULL;
+
+  if (!module)
+  {
+    return false;
+  }
+
+  info = ldk_entity_info_get(module, entity);
+  if (!info || (info->internal_flags & LDK_ENTITY_INTERNAL_PENDING_DELETE))
+  {
+    return false;
+  }
+
+  if (!module->pending_destroy)
+  {
+    module->pending_destroy = x_array_create(sizeof(LDKEntity), 64);
+
+    if (!module->pending_destroy)
+    {
+      return false;
+    }
+  }
+
+  x_array_push(module->pending_destroy, &entity);
+  info->internal_flags |= LDK_ENTITY_INTERNAL_PENDING_DELETE;
+  return true;
+}
+
+u32 ldk_entity_pending_destroy_count(LDKEntityRegistry* module)
+{
+  if (!module || !module->pending_destroy)
+  {
+    return 0;
+  }
+
+  return x_array_count(module->pending_destroy);
+}
+
+/* Frees the archetype row, clears the entity out of cached queries and releases its handle */
+static void s_entity_sweep_release(LDKEntityRegistry* module, LDKComponentRegistry* component_module, LDKEntity entity)
+{
+  LDKEntityInfo* info = ldk_entity_info_get(module, entity);
+  LDKEntity moved_entity = x_handle_null();
+
+  if (info->archetype != LDK_ARCHETYPE_NONE)
+  {
+    ldk_archetype_row_free(ldk_archetype_get(&component_module->archetypes, info->archetype),
+        info->archetype_row, &moved_entity);
+
+    if (!x_handle_is_null(moved_entity))
+    {
+      LDKEntityInfo* moved_info = ldk_entity_info_get(module, moved_entity);
+
+      if (moved_info)
+      {
+        moved_info->archetype_row = info->archetype_row;
+      }
+    }
+  }
+
+  // Tags have no directory entry, clearing the mask removes them too
+  memset(&info->mask, 0, sizeof(info->mask));
+  ldk_query_registry_entity_changed(&component_module->queries, entity, &info->mask);
+
+  s_entity_cold_release(module, entity.index);
+  x_hpool_free(&module->pool, entity);
+}
+
+u32 ldk_entity_destroy_pending(LDKEntityRegistry* module, LDKComponentRegistry* component_module)
+{
+  u32 slot_offsets[LDK_COMPONENT_MAX_TYPES + 1];
+  u32 slot_cursors[LDK_COMPONENT_MAX_TYPES];
+  XArray* swept = NULL;
+  LDKEntity* entities = NULL;
+  u32* component_indices = NULL;
+  u32* owners = NULL;
+  u32 slot_count = 0;
+  u32 entity_count = 0;
+  u32 total = 0;
+  u32 slot = 0;
+  u32 i = 0;
+  u32 j = 0;
+
+  if (!module || !component_module || ldk_entity_pending_destroy_count(module) == 0)
+  {
+    return 0;
+  }
+
+  if (!module->sweep_entities)
+  {
+    module->sweep_entities = x_array_create(sizeof(LDKEntity), 64);
+  }
+
+  if (!module->sweep_indices)
+  {
+    module->sweep_indices = x_array_create(sizeof(u32), 256);
+  }
+
+  if (!module->sweep_entities || !module->sweep_indices)
+  {
+    return 0;
+  }
+
+  // Entities marked by destroy callbacks go to the emptied list and wait for the next sweep
+  swept = module->pending_destroy;
+  module->pending_destroy = module->sweep_entities;
+  module->sweep_entities = swept;
+  x_array_clear(module->pending_destroy);
+
+  entities = (LDKEntity*)x_array_data(swept);
+  slot_count = ldk_component_slot_count(component_module);
+  memset(slot_offsets, 0, sizeof(slot_offsets));
+
+  // Entities destroyed some other way since they were marked are dropped
+  for (i = 0; i < x_array_count(swept); ++i)
+  {
+    const LDKEntityInfo* info = ldk_entity_info_get(module, entities[i]);
+    LDKComponentDirectory* directory = NULL;
+
+    if (!info || !(info->internal_flags & LDK_ENTITY_INTERNAL_PENDING_DELETE))
+    {
+      continue;
+    }
+
+    directory = &s_entity_cold_get(module, entities[i].index)->components;
+
+    for (j = 0; j < directory->component_count; ++j)
+    {
+      slot_offsets[ldk_component_slot_get(component_module, ldk_component_directory_types(directory)[j]) + 1]++;
+    }
+
+    total += directory->component_count;
+    entities[entity_count++] = entities[i];
+  }
+
+  // Group the directory entries of all entities by slot
+  for (slot = 0; slot < slot_count; ++slot)
+  {
+    slot_offsets[slot + 1] += slot_offsets[slot];
+    slot_cursors[slot] = slot_offsets[slot];
+  }
+
+  if (x_array_resize(module->sweep_indices, (size_t)total * 2) != XARRAY_OK)
+  {
+    // Leave them marked for a later sweep
+    for (i = 0; i < entity_count; ++i)
+    {
+      x_array_push(module->pending_destroy, &entities[i]);
+    }
+
+    x_array_clear(swept);
+    return 0;
+  }
+
+  component_indices = (u32*)x_array_data(module->sweep_indices);
+  owners = component_indices + total;
+
+  for (i = 0; i < entity_count; ++i)
+  {
+    LDKComponentDirectory* directory = &s_entity_cold_get(module, entities[i].index)->components;
+
+    for (j = 0; j < directory->component_count; ++j)
+    {
+      u32 position = slot_cursors[ldk_component_slot_get(component_module, ldk_component_directory_types(directory)[j])]++;
+
+      component_indices[position] = ldk_component_directory_indices(directory)[j];
+      owners[position] = i;
+    }
+  }
+
+  // Highest slot first, as ldk_component_registry_remove_all() does for a single entity
+  for (slot = slot_count; slot-- > 0;)
+  {
+    const LDKRegisteredComponent* entry = ldk_component_entry_get(component_module, slot);
+    u32 begin = slot_offsets[slot];
+    u32 count = slot_offsets[slot + 1] - begin;
+
+    if (count == 0)
+    {
+      continue;
+    }
+
+    if (entry->desc.storage == LDK_COMPONENT_STORAGE_ARCHETYPE)
+    {
+      // Rows are freed whole once every column is done
+      for (i = begin; i < begin + count; ++i)
+      {
+        ldk_component_destroy_data(component_module, module, entities[owners[i]], entry->desc.type,
+            LDK_ENTITY_ARCHETYPE_COMPONENT_INDEX);
+      }
+    }
+    else
+    {
+      ldk_component_destroy_batch(component_module, module, entry->desc.type, component_indices + begin, count);
+    }
+
+    // The entry of this slot is the last one left in each directory
+    for (i = begin; i < begin + count; ++i)
+    {
+      LDKEntity entity = entities[owners[i]];
+      LDKComponentDirectory* directory = &s_entity_cold_get(module, entity.index)->components;
+      LDKEntityInfo* info = ldk_entity_info_get(module, entity);
+      u32 last = (u32)directory->component_count - 1;
+
+      ldk_component_directory_types(directory)[last] = 0;
+      ldk_component_directory_indices(directory)[last] = 0;
+      directory->component_count = (u16)last;
+      directory->version += 1;
+      ldk_component_mask_clear(&info->mask, slot);
+
+      if (entry->desc.type == LDK_COMPONENT_TYPE_TRANSFORM)
+      {
+        info->transform_index = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+      }
+    }
+  }
+
+  for (i = 0; i < entity_count; ++i)
+  {
+    s_entity_sweep_release(module, component_module, entities[i]);
+  }
+
+  x_array_clear(swept);
+  return entity_count;
+}
+
 bool ldk_entity_is_alive(LDKEntityRegistry* module, LDKEntity entity)
 {
   if (!module)
@@ -225,6 +1012,16 @@ const LDKEntityInfo* ldk_entity_info_get_const(LDKEntityRegistry* module, LDKEnt
   return (const LDKEntityInfo*)x_hpool_get(&module->pool, entity);
 }
 
+LDKEntityColdInfo* ldk_entity_cold_info_get(LDKEntityRegistry* module, LDKEntity entity)
+{
+  if (!module || !x_hpool_is_alive(&module->pool, entity))
+  {
+    return NULL;
+  }
+
+  return s_entity_cold_get(module, entity.index);
+}
+
 u32 ldk_entity_alive_count(LDKEntityRegistry* module)
 {
   if (!module)
@@ -322,17 +1119,17 @@ bool ldk_entity_internal_flags_has(LDKEntityRegistry* module, LDKEntity entity,
 bool ldk_entity_name_set(LDKEntityRegistry* module, LDKEntity entity, const char* name)
 {
 #ifdef _DEBUG
-  LDKEntityInfo* info = ldk_entity_info_get(module, entity);
+  LDKEntityColdInfo* cold = ldk_entity_cold_info_get(module, entity);
   size_t len = 0;
 
-  if (!info)
+  if (!cold)
   {
     return false;
   }
 
   if (!name)
   {
-    info->name[0] = 0;
+    cold->name[0] = 0;
     return true;
   }
 
@@ -343,8 +1140,8 @@ bool ldk_entity_name_set(LDKEntityRegistry* module, LDKEntity entity, const char
     len = LDK_ENTITY_NAME_MAX_LEN - 1;
   }
 
-  memcpy(info->name, name, len);
-  info->name[len] = 0;
+  memcpy(cold->name, name, len);
+  cold->name[len] = 0;
 
   return true;
 #else
@@ -358,14 +1155,14 @@ bool ldk_entity_name_set(LDKEntityRegistry* module, LDKEntity entity, const char
 const char* ldk_entity_name_get(LDKEntityRegistry* module, LDKEntity entity)
 {
 #ifdef _DEBUG
-  const LDKEntityInfo* info = ldk_entity_info_get_const(module, entity);
+  const LDKEntityColdInfo* cold = ldk_entity_cold_info_get(module, entity);
 
-  if (!info)
+  if (!cold)
   {
     return NULL;
   }
 
-  return (const char*)info->name;
+  return (const char*)cold->name;
 #else
   (void)module;
   (void)entity;
@@ -375,54 +1172,67 @@ const char* ldk_entity_name_get(LDKEntityRegistry* module, LDKEntity entity)
 
 u32 ldk_entity_component_count(LDKEntityRegistry* module, LDKEntity entity)
 {
-  const LDKEntityInfo* info = ldk_entity_info_get_const(module, entity);
+  const LDKEntityColdInfo* cold = ldk_entity_cold_info_get(module, entity);
 
-  if (!info)
+  if (!cold)
   {
     return 0;
   }
 
-  return info->components.component_count;
+  return cold->components.component_count;
 }
 
 bool ldk_entity_component_find(LDKEntityRegistry* module, LDKEntity entity, u32 component_type,
     u32* out_slot, u32* out_component_index)
 {
-  const LDKEntityInfo* info = ldk_entity_info_get_const(module, entity);
-  u32 i = 0;
-  u32 count = 0;
+  LDKEntityInfo* info = ldk_entity_info_get(module, entity);
+  u32 slot = 0;
+  u32 position = 0;
 
-  if (!info)
+  if (!info || !module->components)
+  {
+    return false;
+  }
+
+  slot = ldk_component_slot_get(module->components, component_type);
+  if (slot == LDK_COMPONENT_INVALID_SLOT || !ldk_component_mask_test(&info->mask, slot) ||
+      ldk_component_mask_test(&module->components->tag_mask, slot))
   {
     return false;
   }
 
-  count = info->components.component_count;
+  position = s_entity_directory_position(module, info, slot);
 
-  for (i = 0; i < count; ++i)
+  if (out_slot)
   {
-    if (info->components.component_type[i] == component_type)
-    {
-      if (out_slot)
-      {
-        *out_slot = i;
-      }
+    *out_slot = position;
+  }
 
-      if (out_component_index)
-      {
-        *out_component_index = info->components.component_index[i];
-      }
+  if (out_component_index)
+  {
+    *out_component_index = ldk_component_directory_indices(&s_entity_cold_get(module, entity.index)->components)[position];
 
-      return true;
+    if (*out_component_index == LDK_ENTITY_ARCHETYPE_COMPONENT_INDEX)
+    {
+      *out_component_index = info->archetype_row;
     }
   }
 
-  return false;
-}
-
-bool ldk_entity_component_has(LDKEntityRegistry* module, LDKEntity entity, u32 component_type)
-{
-  return ldk_entity_component_find(module, entity, component_type, NULL, NULL);
+  return true;
+}
+
+bool ldk_entity_component_has(LDKEntityRegistry* module, LDKEntity entity, u32 component_type)
+{
+  const LDKEntityInfo* info = ldk_entity_info_get(module, entity);
+  u32 slot = 0;
+
+  if (!info || !module->components)
+  {
+    return false;
+  }
+
+  slot = ldk_component_slot_get(module->components, component_type);
+  return slot != LDK_COMPONENT_INVALID_SLOT && ldk_component_mask_test(&info->mask, slot);
 }
 
 LDKTransform* ldk_entity_transform_get(LDKEntityRegistry* entity_module,
@@ -466,7 +1276,7 @@ bool ldk_entity_component_ref_get(LDKEntityRegistry* module, LDKEntity entity,
   }
 
   out_ref->entity = entity;
-  out_ref->version = info->components.version;
+  out_ref->version = s_entity_cold_get(module, entity.index)->components.version;
   out_ref->slot_index = (u16)slot;
 
   return true;
@@ -474,60 +1284,75 @@ bool ldk_entity_component_ref_get(LDKEntityRegistry* module, LDKEntity entity,
 
 bool ldk_component_ref_is_valid(LDKEntityRegistry* entity_system, LDKComponentRef ref)
 {
-  LDKEntityInfo* info = ldk_entity_info_get(entity_system, ref.entity);
+  LDKEntityColdInfo* cold = ldk_entity_cold_info_get(entity_system, ref.entity);
 
-  if (!info)
+  if (!cold)
   {
     return false;
   }
 
-  if (ref.version != info->components.version)
+  if (ref.version != cold->components.version)
   {
     return false;
   }
 
-  return ref.slot_index < info->components.component_count;
+  return ref.slot_index < cold->components.component_count;
 }
 
-void* ldk_component_ref_get(LDKEntityRegistry* entity_system,
-    struct LDKComponentRegistry* component_registry, LDKComponentRef ref)
+static LDKEntityInfo* s_component_ref_info_get(LDKEntityRegistry* entity_system,
+    struct LDKComponentRegistry* component_registry, LDKComponentRef ref, LDKEntityColdInfo** out_cold)
 {
   LDKEntityInfo* info = ldk_entity_info_get(entity_system, ref.entity);
-  XArray* store = NULL;
-  u32 component_index = 0;
-  u32 component_type = 0;
+  LDKEntityColdInfo* cold = NULL;
 
   if (!info || !component_registry)
   {
     return NULL;
   }
 
-  if (ref.version != info->components.version)
+  cold = s_entity_cold_get(entity_system, ref.entity.index);
+
+  if (ref.version != cold->components.version)
   {
     return NULL;
   }
 
-  if (ref.slot_index >= info->components.component_count)
+  if (ref.slot_index >= cold->components.component_count)
   {
     return NULL;
   }
 
-  component_type = info->components.component_type[ref.slot_index];
-  component_index = info->components.component_index[ref.slot_index];
-  store = ldk_component_store_get((LDKComponentRegistry*)component_registry, component_type);
+  *out_cold = cold;
+  return info;
+}
+
+void* ldk_component_ref_get(LDKEntityRegistry* entity_system,
+    struct LDKComponentRegistry* component_registry, LDKComponentRef ref)
+{
+  LDKEntityColdInfo* cold = NULL;
+  LDKEntityInfo* info = s_component_ref_info_get(entity_system, component_registry, ref, &cold);
 
-  if (!store || component_index >= x_array_count(store))
+  if (!info)
   {
     return NULL;
   }
 
-  return x_array_get(store, component_index);
+  s_entity_component_mark_changed(cold, (LDKComponentRegistry*)component_registry, ref.slot_index);
+  return s_entity_component_data_get(info, cold, (LDKComponentRegistry*)component_registry, ref.slot_index);
 }
 
 const void* ldk_component_ref_get_const(LDKEntityRegistry* entity_system,
     struct LDKComponentRegistry* component_registry, LDKComponentRef ref)
 {
-  return ldk_component_ref_get(entity_system, component_registry, ref);
+  LDKEntityColdInfo* cold = NULL;
+  LDKEntityInfo* info = s_component_ref_info_get(entity_system, component_registry, ref, &cold);
+
+  if (!info)
+  {
+    return NULL;
+  }
+
+  return s_entity_component_data_get(info, cold, (LDKComponentRegistry*)component_registry, ref.slot_index);
 }
 
 void ldk_entity_foreach(LDKEntityRegistry* module, LDKEntityIterFn fn, void* user)
@@ -557,6 +1382,69 @@ void ldk_entity_foreach(LDKEntityRegistry* module, LDKEntityIterFn fn, void* use
   }
 }
 
+/* Tags only live in the mask. Flips the bit and notifies cached queries. */
+static bool s_entity_tag_set(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module,
+    LDKEntity entity, u32 tag_type, bool value)
+{
+  LDKEntityInfo* info = ldk_entity_info_get(entity_module, entity);
+  u32 slot = 0;
+
+  if (!info || !component_module)
+  {
+    return false;
+  }
+
+  if (!entity_module->components)
+  {
+    entity_module->components = component_module;
+  }
+
+  slot = ldk_component_slot_get(component_module, tag_type);
+  if (slot == LDK_COMPONENT_INVALID_SLOT || !ldk_component_mask_test(&component_module->tag_mask, slot))
+  {
+    return false;
+  }
+
+  if (ldk_component_mask_test(&info->mask, slot) == value)
+  {
+    return false;
+  }
+
+  if (value)
+  {
+    ldk_component_mask_set(&info->mask, slot);
+  }
+  else
+  {
+    ldk_component_mask_clear(&info->mask, slot);
+  }
+
+  ldk_query_registry_entity_changed(&component_module->queries, entity, &info->mask);
+  return true;
+}
+
+bool ldk_entity_tag_add(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module,
+    LDKEntity entity, u32 tag_type)
+{
+  if (!entity_module)
+  {
+    return false;
+  }
+
+  return s_entity_tag_set(entity_module, component_module, entity, tag_type, true);
+}
+
+bool ldk_entity_tag_remove(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module,
+    LDKEntity entity, u32 tag_type)
+{
+  if (!entity_module)
+  {
+    return false;
+  }
+
+  return s_entity_tag_set(entity_module, component_module, entity, tag_type, false);
+}
+
 void* ldk_entity_component_add(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module,
     LDKEntity entity, u32 component_type, const void* initial_value)
 {
@@ -573,6 +1461,22 @@ void* ldk_entity_component_add(LDKEntityRegistry* entity_module, LDKComponentReg
     return NULL;
   }
 
+  // Component slots are resolved through the bound registry
+  if (!entity_module->components)
+  {
+    entity_module->components = component_module;
+  }
+
+  if (ldk_component_is_tag(component_module, component_type))
+  {
+    return NULL;
+  }
+
+  if (ldk_component_storage_get(component_module, component_type) == LDK_COMPONENT_STORAGE_ARCHETYPE)
+  {
+    return s_entity_archetype_component_add(entity_module, component_module, entity, component_type, initial_value);
+  }
+
   component = ldk_component_create(
       component_module,
       component_type,
@@ -667,7 +1571,9 @@ void* ldk_entity_component_add(LDKEntityRegistry* entity_module, LDKComponentReg
 void* ldk_entity_component_get(LDKEntityRegistry* entity_module,
     LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type)
 {
-  u32 component_index = 0;
+  LDKEntityInfo* info = NULL;
+  LDKEntityColdInfo* cold = NULL;
+  u32 slot = 0;
 
   if (!entity_module)
   {
@@ -683,20 +1589,81 @@ void* ldk_entity_component_get(LDKEntityRegistry* entity_module,
         entity_module,
         entity,
         component_type,
-        NULL,
-        &component_index))
+        &slot,
+        NULL))
   {
     return NULL;
   }
 
-  return ldk_component_get(
-      component_module,
-      component_type,
-      component_index);
+  info = ldk_entity_info_get(entity_module, entity);
+  cold = s_entity_cold_get(entity_module, entity.index);
+  s_entity_component_mark_changed(cold, component_module, slot);
+  return s_entity_component_data_get(info, cold, component_module, slot);
 }
 
-bool ldk_entity_component_remove(LDKEntityRegistry* entity_module,
+const void* ldk_entity_component_get_const(LDKEntityRegistry* entity_module,
+    LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type)
+{
+  u32 slot = 0;
+
+  if (!entity_module || !component_module)
+  {
+    return NULL;
+  }
+
+  if (!ldk_entity_component_find(entity_module, entity, component_type, &slot, NULL))
+  {
+    return NULL;
+  }
+
+  return s_entity_component_data_get(ldk_entity_info_get(entity_module, entity),
+      s_entity_cold_get(entity_module, entity.index), component_module, slot);
+}
+
+bool ldk_entity_component_index_set(LDKEntityRegistry* module, LDKEntity entity, u32 component_type, u32 component_index)
+{
+  return s_entity_component_ref_update(module, entity, component_type, component_index);
+}
+
+bool ldk_entity_component_enabled_set(LDKEntityRegistry* entity_module,
+    LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type, bool enabled)
+{
+  u32 component_index = 0;
+
+  if (!entity_module || !component_module)
+  {
+    return false;
+  }
+
+  if (!ldk_entity_component_find(entity_module, entity, component_type, NULL, &component_index))
+  {
+    return false;
+  }
+
+  return ldk_component_enabled_set(component_module, component_type, component_index, enabled);
+}
+
+bool ldk_entity_component_is_enabled(LDKEntityRegistry* entity_module,
     LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type)
+{
+  u32 component_index = 0;
+
+  if (!entity_module || !component_module)
+  {
+    return false;
+  }
+
+  if (!ldk_entity_component_find(entity_module, entity, component_type, NULL, &component_index))
+  {
+    return false;
+  }
+
+  return ldk_component_is_enabled(component_module, component_type, component_index);
+}
+
+/* Removes a component. The destroy callback is skipped for components that were never attached */
+static bool s_entity_component_remove(LDKEntityRegistry* entity_module,
+    LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type, bool run_destroy)
 {
   XArray* owners = NULL;
   XArray* store = NULL;
@@ -715,6 +1682,11 @@ bool ldk_entity_component_remove(LDKEntityRegistry* entity_module,
     return false;
   }
 
+  if (ldk_component_is_tag(component_module, component_type))
+  {
+    return s_entity_tag_set(entity_module, component_module, entity, component_type, false);
+  }
+
   if (!ldk_entity_component_find(
         entity_module,
         entity,
@@ -725,6 +1697,33 @@ bool ldk_entity_component_remove(LDKEntityRegistry* entity_module,
     return false;
   }
 
+  if (ldk_component_storage_get(component_module, component_type) == LDK_COMPONENT_STORAGE_ARCHETYPE)
+  {
+    if (run_destroy)
+    {
+      ldk_component_destroy_data(
+          component_module,
+          entity_module,
+          entity,
+          component_type,
+          component_index);
+    }
+
+    if (!ldk_component_archetype_erase(
+          component_module,
+          entity_module,
+          entity,
+          component_type))
+    {
+      return false;
+    }
+
+    return s_entity_component_ref_remove(
+        entity_module,
+        entity,
+        component_type);
+  }
+
   store = ldk_component_store_get(component_module, component_type);
   owners = ldk_component_owners_get(component_module, component_type);
 
@@ -758,12 +1757,15 @@ bool ldk_entity_component_remove(LDKEntityRegistry* entity_module,
     had_move = true;
   }
 
-  ldk_component_destroy_data(
-      component_module,
-      entity_module,
-      entity,
-      component_type,
-      component_index);
+  if (run_destroy)
+  {
+    ldk_component_destroy_data(
+        component_module,
+        entity_module,
+        entity,
+        component_type,
+        component_index);
+  }
 
   if (!ldk_component_destroy(
         component_module,
@@ -792,6 +1794,174 @@ bool ldk_entity_component_remove(LDKEntityRegistry* entity_module,
       component_type);
 }
 
+bool ldk_entity_component_remove(LDKEntityRegistry* entity_module,
+    LDKComponentRegistry* component_module, LDKEntity entity, u32 component_type)
+{
+  return s_entity_component_remove(entity_module, component_module, entity, component_type, true);
+}
+
+u32 ldk_entity_component_add_batch(LDKEntityRegistry* entity_module, LDKComponentRegistry* component_module,
+    const LDKEntity* entities, u32 count, u32 component_type, const void* initial_values)
+{
+  LDKRegisteredComponent* entry = NULL;
+  const u8* values = (const u8*)initial_values;
+  XArray* failed = NULL;
+  LDKEntity* owners = NULL;
+  u8* components = NULL;
+  u32 entry_size = 0;
+  u32 slot = 0;
+  u32 first_index = 0;
+  u32 added = 0;
+  u32 prefix = 0;
+  u32 i = 0;
+
+  if (!entity_module || !component_module || !entities || count == 0)
+  {
+    return 0;
+  }
+
+  if (!entity_module->components)
+  {
+    entity_module->components = component_module;
+  }
+
+  slot = ldk_component_slot_get(component_module, component_type);
+  entry = ldk_component_entry_get(component_module, slot);
+  if (!entry)
+  {
+    return 0;
+  }
+
+  entry_size = entry->desc.entry_size;
+
+  if (entry->desc.storage == LDK_COMPONENT_STORAGE_TAG)
+  {
+    for (i = 0; i < count; ++i)
+    {
+      if (s_entity_tag_set(entity_module, component_module, entities[i], component_type, true))
+      {
+        added++;
+      }
+    }
+
+    return added;
+  }
+
+  // Archetype rows move on every add and paged components are not contiguous,
+  // so there is no block to fill
+  if (entry->desc.storage == LDK_COMPONENT_STORAGE_ARCHETYPE || entry->desc.storage == LDK_COMPONENT_STORAGE_PAGED)
+  {
+    for (i = 0; i < count; ++i)
+    {
+      if (ldk_entity_component_add(entity_module, component_module, entities[i], component_type,
+            values ? values + (size_t)i * entry_size : NULL))
+      {
+        added++;
+      }
+    }
+
+    return added;
+  }
+
+  components = (u8*)ldk_component_create_batch(component_module, component_type, count, &first_index);
+  if (!components)
+  {
+    return 0;
+  }
+
+  owners = (LDKEntity*)x_array_get(entry->owners, first_index);
+
+  for (i = 0; i < count; ++i)
+  {
+    LDKEntityInfo* info = ldk_entity_info_get(entity_module, entities[i]);
+
+    // Dead entities and entities that already own the component are skipped
+    if (!info || !s_entity_directory_insert(entity_module, entities[i], info, slot, component_type, first_index + added))
+    {
+      continue;
+    }
+
+    owners[added] = entities[i];
+
+    if (values)
+    {
+      if (added == i)
+      {
+        prefix++;
+      }
+      else
+      {
+        memcpy(components + (size_t)added * entry_size, values + (size_t)i * entry_size, entry_size);
+      }
+    }
+
+    added++;
+  }
+
+  // Values of the leading run of accepted entities map 1:1 to the new rows
+  if (prefix > 0)
+  {
+    memcpy(components, values, (size_t)prefix * entry_size);
+  }
+
+  if (added < count)
+  {
+    x_array_resize(entry->store, first_index + added);
+    x_array_resize(entry->owners, first_index + added);
+    x_array_resize(entry->ticks, first_index + added);
+    entry->layout_version++;
+  }
+
+  if (!entry->desc.attach)
+  {
+    return added;
+  }
+
+  // The store may grow while attach callbacks run, so rows are resolved on every iteration.
+  // initial_value points to the already copied component.
+  for (i = 0; i < added; ++i)
+  {
+    LDKEntity entity = *(LDKEntity*)x_array_get(entry->owners, first_index + i);
+    void* component = x_array_get(entry->store, first_index + i);
+
+    if (!entry->desc.attach(
+          entity_module,
+          component_module,
+          entity,
+          component,
+          first_index + i,
+          values ? component : NULL,
+          entry->desc.user))
+    {
+      if (!failed)
+      {
+        failed = x_array_create(sizeof(LDKEntity), 8);
+      }
+
+      if (failed)
+      {
+        x_array_push(failed, &entity);
+      }
+    }
+  }
+
+  if (failed)
+  {
+    for (i = 0; i < x_array_count(failed); ++i)
+    {
+      if (s_entity_component_remove(entity_module, component_module,
+            *(LDKEntity*)x_array_get(failed, i), component_type, false))
+      {
+        added--;
+      }
+    }
+
+    x_array_destroy(failed);
+  }
+
+  return added;
+}
+
 void ldk_entity_internal_flags_set(LDKEntityRegistry* module, LDKEntity entity, u16 flags)
 {
   LDKEntityInfo* info = ldk_entity_info_get(module, entity);
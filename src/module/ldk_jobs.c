@@ -0,0 +1,496 @@
+#include <ldk_common.h>
+#include <ldk_os.h>
+#include <module/ldk_jobs.h>
+
+#ifndef LDK_ALLOC
+#include <stdlib.h>
+#define LDK_ALLOC(size) malloc(size)
+#define LDK_FREE(ptr) free(ptr)
+#endif
+
+#include <string.h>
+
+#if defined(X_COMPILER_MSVC)
+#define LDK_JOBS_THREAD_LOCAL __declspec(thread)
+#else
+#define LDK_JOBS_THREAD_LOCAL __thread
+#endif
+
+// Failed attempts to find a job before a worker goes to sleep
+#ifndef LDK_JOBS_SPIN_COUNT
+#define LDK_JOBS_SPIN_COUNT 64
+#endif
+
+#define LDK_JOBS_QUEUE_MASK (LDK_JOBS_QUEUE_CAPACITY - 1)
+
+typedef struct LDKJob
+{
+  LDKJobFn fn;
+  LDKJobRangeFn range_fn;     // Set for parallel_for ranges, fn is NULL
+  void* user;
+  LDKJobCounter* counter;
+  LDKJobCounter* dependency;
+  u32 begin;
+  u32 end;
+} LDKJob;
+
+/*
+ * Chase-Lev deque. The owner pushes and pops at bottom, thieves take from top.
+ * top and bottom live on different cache lines so thieves do not slow down the owner.
+ */
+typedef struct LDKJobQueue
+{
+  volatile i64 top;
+  u8 pad0[64 - sizeof(i64)];
+  volatile i64 bottom;
+  u8 pad1[64 - sizeof(i64)];
+  LDKJobSystem* system;
+  u32 worker_index;
+  LDKJob jobs[LDK_JOBS_QUEUE_CAPACITY];
+} LDKJobQueue;
+
+static LDK_JOBS_THREAD_LOCAL const LDKJobSystem* s_worker_system = NULL;
+static LDK_JOBS_THREAD_LOCAL u32 s_worker_index = LDK_JOBS_INVALID_WORKER;
+
+static bool s_queue_push(LDKJobQueue* queue, const LDKJob* job)
+{
+  i64 bottom = queue->bottom;
+  i64 top = ldk_os_atomic_load_i64(&queue->top);
+
+  if (bottom - top >= LDK_JOBS_QUEUE_CAPACITY)
+  {
+    return false;
+  }
+
+  queue->jobs[bottom & LDK_JOBS_QUEUE_MASK] = *job;
+  ldk_os_atomic_store_i64(&queue->bottom, bottom + 1);
+  return true;
+}
+
+static bool s_queue_pop(LDKJobQueue* queue, LDKJob* out_job)
+{
+  i64 bottom = queue->bottom - 1;
+  i64 top;
+  bool result = true;
+
+  // Store-load ordering with a thief's read of bottom, both accesses are sequentially consistent
+  ldk_os_atomic_store_i64(&queue->bottom, bottom);
+  top = ldk_os_atomic_load_i64(&queue->top);
+
+  if (top > bottom)
+  {
+    ldk_os_atomic_store_i64(&queue->bottom, bottom + 1);
+    return false;
+  }
+
+  *out_job = queue->jobs[bottom & LDK_JOBS_QUEUE_MASK];
+
+  // Last job: race any thief for it
+  if (top == bottom)
+  {
+    result = ldk_os_atomic_cas_i64(&queue->top, top, top + 1);
+    ldk_os_atomic_store_i64(&queue->bottom, bottom + 1);
+  }
+
+  return result;
+}
+
+static bool s_queue_steal(LDKJobQueue* queue, LDKJob* out_job)
+{
+  i64 top = ldk_os_atomic_load_i64(&queue->top);
+  i64 bottom = ldk_os_atomic_load_i64(&queue->bottom);
+
+  if (top >= bottom)
+  {
+    return false;
+  }
+
+  *out_job = queue->jobs[top & LDK_JOBS_QUEUE_MASK];
+  return ldk_os_atomic_cas_i64(&queue->top, top, top + 1);
+}
+
+static bool s_job_find(LDKJobSystem* system, u32 worker_index, LDKJob* out_job)
+{
+  u32 i;
+
+  if (s_queue_pop(&system->queues[worker_index], out_job))
+  {
+    return true;
+  }
+
+  for (i = 1; i < system->worker_count; ++i)
+  {
+    u32 victim = (worker_index + i) % system->worker_count;
+
+    if (s_queue_steal(&system->queues[victim], out_job))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void s_job_execute(LDKJobSystem* system, const LDKJob* job, u32 worker_index)
+{
+  if (job->dependency)
+  {
+    ldk_jobs_wait(system, job->dependency);
+  }
+
+  if (job->range_fn)
+  {
+    job->range_fn(job->user, job->begin, job->end, worker_index);
+  }
+  else
+  {
+    job->fn(job->user, worker_index);
+  }
+
+  if (job->counter)
+  {
+    ldk_os_atomic_add_i32(&job->counter->value, -1);
+  }
+}
+
+static void s_jobs_wake(LDKJobSystem* system, u32 job_count)
+{
+  // The add is a full barrier: queued jobs are visible before sleeping is read
+  i32 sleeping = ldk_os_atomic_add_i32(&system->sleeping, 0);
+
+  if (sleeping > 0)
+  {
+    ldk_os_semaphore_signal(system->wake, job_count < (u32) sleeping ? job_count : (u32) sleeping);
+  }
+}
+
+static void s_jobs_submit(LDKJobSystem* system, const LDKJob* jobs, u32 count)
+{
+  u32 worker_index = ldk_jobs_worker_index(system);
+  u32 queued = 0;
+  u32 i;
+
+  for (i = 0; i < count; ++i)
+  {
+    if (worker_index != LDK_JOBS_INVALID_WORKER &&
+        s_queue_push(&system->queues[worker_index], &jobs[i]))
+    {
+      queued++;
+      continue;
+    }
+
+    s_job_execute(system, &jobs[i], worker_index);
+  }
+
+  if (queued > 0)
+  {
+    s_jobs_wake(system, queued);
+  }
+}
+
+static u32 s_worker_thread(void* user)
+{
+  LDKJobQueue* queue = (LDKJobQueue*) user;
+  LDKJobSystem* system = queue->system;
+  u32 worker_index = queue->worker_index;
+  u32 spin = 0;
+  LDKJob job;
+
+  s_worker_system = system;
+  s_worker_index = worker_index;
+
+  while (ldk_os_atomic_load_i32(&system->running))
+  {
+    if (s_job_find(system, worker_index, &job))
+    {
+      s_job_execute(system, &job, worker_index);
+      spin = 0;
+      continue;
+    }
+
+    if (++spin < LDK_JOBS_SPIN_COUNT)
+    {
+      ldk_os_thread_yield();
+      continue;
+    }
+
+    // Announce we are going to sleep, then look again so a job queued in between is not missed
+    ldk_os_atomic_add_i32(&system->sleeping, 1);
+
+    if (s_job_find(system, worker_index, &job))
+    {
+      ldk_os_atomic_add_i32(&system->sleeping, -1);
+      s_job_execute(system, &job, worker_index);
+      spin = 0;
+      continue;
+    }
+
+    if (ldk_os_atomic_load_i32(&system->running))
+    {
+      ldk_os_semaphore_wait(system->wake);
+    }
+
+    ldk_os_atomic_add_i32(&system->sleeping, -1);
+    spin = 0;
+  }
+
+  return 0;
+}
+
+static void s_range_jobs_submit(LDKJobSystem* system, u32 begin, u32 end, u32 batch_size,
+    LDKJobRangeFn fn, void* user, LDKJobCounter* counter)
+{
+  LDKJob jobs[64];
+  u32 job_count = 0;
+
+  while (begin < end)
+  {
+    LDKJob* job = &jobs[job_count++];
+
+    memset(job, 0, sizeof(*job));
+    job->range_fn = fn;
+    job->user = user;
+    job->counter = counter;
+    job->begin = begin;
+    job->end = (end - begin) > batch_size ? begin + batch_size : end;
+    begin = job->end;
+
+    if (job_count == sizeof(jobs) / sizeof(jobs[0]))
+    {
+      s_jobs_submit(system, jobs, job_count);
+      job_count = 0;
+    }
+  }
+
+  if (job_count > 0)
+  {
+    s_jobs_submit(system, jobs, job_count);
+  }
+}
+
+bool ldk_jobs_initialize(LDKJobSystem* system, u32 worker_count)
+{
+  u32 i;
+
+  if (!system)
+  {
+    return false;
+  }
+
+  memset(system, 0, sizeof(*system));
+
+  if (worker_count == 0)
+  {
+    worker_count = ldk_os_cpu_count();
+  }
+
+  if (worker_count > LDK_JOBS_MAX_WORKERS)
+  {
+    worker_count = LDK_JOBS_MAX_WORKERS;
+  }
+
+  if (worker_count == 0)
+  {
+    worker_count = 1;
+  }
+
+  system->queues = (LDKJobQueue*) LDK_ALLOC(sizeof(LDKJobQueue) * worker_count);
+  system->wake = ldk_os_semaphore_create(0);
+
+  if (!system->queues || !system->wake)
+  {
+    ldk_jobs_terminate(system);
+    return false;
+  }
+
+  for (i = 0; i < worker_count; ++i)
+  {
+    LDKJobQueue* queue = &system->queues[i];
+
+    queue->top = 0;
+    queue->bottom = 0;
+    queue->system = system;
+    queue->worker_index = i;
+  }
+
+  system->worker_count = worker_count;
+  system->running = 1;
+
+  s_worker_system = system;
+  s_worker_index = 0;
+
+  for (i = 1; i < worker_count; ++i)
+  {
+    system->threads[i] = ldk_os_thread_create(s_worker_thread, &system->queues[i]);
+
+    if (!system->threads[i])
+    {
+      ldk_jobs_terminate(system);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ldk_jobs_terminate(LDKJobSystem* system)
+{
+  u32 i;
+  LDKJob job;
+
+  if (!system)
+  {
+    return;
+  }
+
+  if (system->queues && system->worker_count > 0)
+  {
+    while (s_job_find(system, 0, &job))
+    {
+      s_job_execute(system, &job, 0);
+    }
+  }
+
+  ldk_os_atomic_store_i32(&system->running, 0);
+
+  if (system->wake && system->worker_count > 1)
+  {
+    ldk_os_semaphore_signal(system->wake, system->worker_count - 1);
+  }
+
+  for (i = 1; i < LDK_JOBS_MAX_WORKERS; ++i)
+  {
+    ldk_os_thread_join(system->threads[i]);
+  }
+
+  if (system->wake)
+  {
+    ldk_os_semaphore_destroy(system->wake);
+  }
+
+  if (system->queues)
+  {
+    LDK_FREE(system->queues);
+  }
+
+  if (s_worker_system == system)
+  {
+    s_worker_system = NULL;
+    s_worker_index = LDK_JOBS_INVALID_WORKER;
+  }
+
+  memset(system, 0, sizeof(*system));
+}
+
+u32 ldk_jobs_worker_count(const LDKJobSystem* system)
+{
+  return system ? system->worker_count : 0;
+}
+
+u32 ldk_jobs_worker_index(const LDKJobSystem* system)
+{
+  if (!system || s_worker_system != system)
+  {
+    return LDK_JOBS_INVALID_WORKER;
+  }
+
+  return s_worker_index;
+}
+
+void ldk_jobs_run(LDKJobSystem* system, const LDKJobDesc* jobs, u32 count, LDKJobCounter* counter)
+{
+  LDKJob batch[64];
+  u32 batch_count = 0;
+  u32 i;
+
+  if (!system || !system->queues || !jobs || count == 0)
+  {
+    return;
+  }
+
+  if (counter)
+  {
+    ldk_os_atomic_add_i32(&counter->value, (i32) count);
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    LDKJob* job = &batch[batch_count++];
+
+    memset(job, 0, sizeof(*job));
+    job->fn = jobs[i].fn;
+    job->user = jobs[i].user;
+    job->dependency = jobs[i].dependency;
+    job->counter = counter;
+
+    if (batch_count == sizeof(batch) / sizeof(batch[0]))
+    {
+      s_jobs_submit(system, batch, batch_count);
+      batch_count = 0;
+    }
+  }
+
+  if (batch_count > 0)
+  {
+    s_jobs_submit(system, batch, batch_count);
+  }
+}
+
+bool ldk_jobs_is_done(const LDKJobCounter* counter)
+{
+  return !counter || ldk_os_atomic_load_i32((volatile i32*) &counter->value) <= 0;
+}
+
+void ldk_jobs_wait(LDKJobSystem* system, LDKJobCounter* counter)
+{
+  u32 worker_index = ldk_jobs_worker_index(system);
+  LDKJob job;
+
+  while (!ldk_jobs_is_done(counter))
+  {
+    if (worker_index != LDK_JOBS_INVALID_WORKER && s_job_find(system, worker_index, &job))
+    {
+      s_job_execute(system, &job, worker_index);
+    }
+    else
+    {
+      ldk_os_thread_yield();
+    }
+  }
+}
+
+void ldk_jobs_parallel_for(LDKJobSystem* system, u32 count, u32 batch_size, LDKJobRangeFn fn, void* user)
+{
+  LDKJobCounter counter = {0};
+  u32 worker_index;
+  u32 job_count;
+
+  if (!system || !fn || count == 0)
+  {
+    return;
+  }
+
+  worker_index = ldk_jobs_worker_index(system);
+
+  if (batch_size == 0)
+  {
+    // A few ranges per worker so stealing can even out uneven ranges
+    batch_size = count / (system->worker_count * 4);
+    if (batch_size == 0)
+    {
+      batch_size = 1;
+    }
+  }
+
+  if (worker_index == LDK_JOBS_INVALID_WORKER || system->worker_count == 1 || count <= batch_size)
+  {
+    fn(user, 0, count, worker_index);
+    return;
+  }
+
+  job_count = (count + batch_size - 1) / batch_size;
+  ldk_os_atomic_add_i32(&counter.value, (i32) job_count);
+
+  s_range_jobs_submit(system, 0, count, batch_size, fn, user, &counter);
+  ldk_jobs_wait(system, &counter);
+}
@@ -0,0 +1,597 @@
+#include <ldk_common.h>
+#include <module/ldk_prefab.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <component/ldk_transform.h>
+#include <module/ldk_scenegraph.h>
+#include <stdx/stdx_array.h>
+
+#include <string.h>
+
+#ifndef LDK_PREFAB_BATCH_INSTANCES
+#define LDK_PREFAB_BATCH_INSTANCES 1024 // Instances filled per batched component add. Bounds the scratch buffers.
+#endif
+
+typedef struct LDKPrefabCaptureItem
+{
+  LDKEntity entity;
+  u32 parent_node;
+} LDKPrefabCaptureItem;
+
+static void s_prefab_column_destroy(LDKPrefabColumn* column)
+{
+  if (column->nodes)
+  {
+    x_array_destroy(column->nodes);
+  }
+
+  if (column->values)
+  {
+    x_array_destroy(column->values);
+  }
+
+  column->nodes = NULL;
+  column->values = NULL;
+}
+
+static LDKPrefabColumn* s_prefab_column_get(LDKPrefab* prefab, LDKComponentRegistry* component_registry, u32 component_type)
+{
+  LDKRegisteredComponent* entry = NULL;
+  LDKPrefabColumn column = {0};
+  u32 slot = ldk_component_slot_get(component_registry, component_type);
+  u32 count = x_array_count(prefab->columns);
+  u32 position = 0;
+
+  entry = ldk_component_entry_get(component_registry, slot);
+  if (!entry)
+  {
+    return NULL;
+  }
+
+  // Columns are kept ordered by slot
+  for (position = 0; position < count; ++position)
+  {
+    LDKPrefabColumn* current = (LDKPrefabColumn*)x_array_get(prefab->columns, position);
+
+    if (current->slot == slot)
+    {
+      return current;
+    }
+
+    if (current->slot > slot)
+    {
+      break;
+    }
+  }
+
+  column.component_type = component_type;
+  column.slot = slot;
+  column.entry_size = entry->desc.storage == LDK_COMPONENT_STORAGE_TAG ? 0 : entry->desc.entry_size;
+  column.nodes = x_array_create(sizeof(u32), 4);
+
+  if (!column.nodes)
+  {
+    return NULL;
+  }
+
+  if (column.entry_size > 0)
+  {
+    column.values = x_array_create(column.entry_size, 4);
+    if (!column.values)
+    {
+      s_prefab_column_destroy(&column);
+      return NULL;
+    }
+  }
+
+  if (x_array_insert(prefab->columns, &column, position) != XARRAY_OK)
+  {
+    s_prefab_column_destroy(&column);
+    return NULL;
+  }
+
+  return (LDKPrefabColumn*)x_array_get(prefab->columns, position);
+}
+
+/* The Transform type of a world carries its scenegraph as user data */
+static LDKScenegraph* s_prefab_scenegraph_get(LDKComponentRegistry* component_registry)
+{
+  LDKRegisteredComponent* entry = ldk_component_entry_get(component_registry,
+      ldk_component_slot_get(component_registry, LDK_COMPONENT_TYPE_TRANSFORM));
+
+  return entry ? (LDKScenegraph*)entry->desc.user : NULL;
+}
+
+static void s_prefab_transform_link(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    LDKScenegraph* scenegraph, LDKEntity child, LDKEntity parent)
+{
+  LDKTransform* child_transform = ldk_entity_transform_get(entity_registry, component_registry, child);
+  LDKTransform* parent_transform = ldk_entity_transform_get(entity_registry, component_registry, parent);
+
+  if (!child_transform || !parent_transform)
+  {
+    return;
+  }
+
+  // Both transforms are new, so there is nothing to unlink and no cycle to check for
+  child_transform->parent = parent;
+  child_transform->next_sibling = parent_transform->first_child;
+
+  if (!x_handle_is_null(parent_transform->first_child))
+  {
+    LDKTransform* first_child_transform = ldk_entity_transform_get(entity_registry, component_registry, parent_transform->first_child);
+
+    if (first_child_transform)
+    {
+      first_child_transform->prev_sibling = child;
+    }
+  }
+
+  parent_transform->first_child = child;
+  ldk_scenegraph_node_parent_set(scenegraph, entity_registry, component_registry, child, parent);
+}
+
+bool ldk_prefab_initialize(LDKPrefab* prefab)
+{
+  if (!prefab)
+  {
+    return false;
+  }
+
+  memset(prefab, 0, sizeof(*prefab));
+  prefab->parents = x_array_create(sizeof(u32), 8);
+  prefab->flags = x_array_create(sizeof(u16), 8);
+  prefab->columns = x_array_create(sizeof(LDKPrefabColumn), 8);
+
+  if (!prefab->parents || !prefab->flags || !prefab->columns)
+  {
+    ldk_prefab_terminate(prefab);
+    return false;
+  }
+
+  return true;
+}
+
+void ldk_prefab_terminate(LDKPrefab* prefab)
+{
+  if (!prefab)
+  {
+    return;
+  }
+
+  if (prefab->columns)
+  {
+    ldk_prefab_clear(prefab);
+    x_array_destroy(prefab->columns);
+  }
+
+  if (prefab->parents)
+  {
+    x_array_destroy(prefab->parents);
+  }
+
+  if (prefab->flags)
+  {
+    x_array_destroy(prefab->flags);
+  }
+
+  memset(prefab, 0, sizeof(*prefab));
+}
+
+void ldk_prefab_clear(LDKPrefab* prefab)
+{
+  u32 i = 0;
+
+  if (!prefab || !prefab->columns)
+  {
+    return;
+  }
+
+  for (i = 0; i < x_array_count(prefab->columns); ++i)
+  {
+    s_prefab_column_destroy((LDKPrefabColumn*)x_array_get(prefab->columns, i));
+  }
+
+  x_array_clear(prefab->columns);
+  x_array_clear(prefab->parents);
+  x_array_clear(prefab->flags);
+}
+
+u32 ldk_prefab_node_count(const LDKPrefab* prefab)
+{
+  if (!prefab || !prefab->parents)
+  {
+    return 0;
+  }
+
+  return x_array_count(prefab->parents);
+}
+
+u32 ldk_prefab_node_add(LDKPrefab* prefab, u32 parent_node, u16 flags)
+{
+  u32 node = ldk_prefab_node_count(prefab);
+
+  if (!prefab || !prefab->parents)
+  {
+    return LDK_PREFAB_NO_PARENT;
+  }
+
+  if (parent_node != LDK_PREFAB_NO_PARENT && parent_node >= node)
+  {
+    return LDK_PREFAB_NO_PARENT;
+  }
+
+  x_array_push(prefab->parents, &parent_node);
+  x_array_push(prefab->flags, &flags);
+
+  if (x_array_count(prefab->parents) != node + 1 || x_array_count(prefab->flags) != node + 1)
+  {
+    x_array_resize(prefab->parents, node);
+    x_array_resize(prefab->flags, node);
+    return LDK_PREFAB_NO_PARENT;
+  }
+
+  return node;
+}
+
+bool ldk_prefab_component_set(LDKPrefab* prefab, LDKComponentRegistry* component_registry,
+    u32 node, u32 component_type, const void* value)
+{
+  LDKPrefabColumn* column = NULL;
+  u32 count = 0;
+  u32 position = 0;
+  void* stored = NULL;
+
+  if (!prefab || !component_registry || node >= ldk_prefab_node_count(prefab))
+  {
+    return false;
+  }
+
+  column = s_prefab_column_get(prefab, component_registry, component_type);
+  if (!column)
+  {
+    return false;
+  }
+
+  count = x_array_count(column->nodes);
+  for (position = 0; position < count; ++position)
+  {
+    u32 current = *(u32*)x_array_get(column->nodes, position);
+
+    if (current >= node)
+    {
+      break;
+    }
+  }
+
+  if (position == count || *(u32*)x_array_get(column->nodes, position) != node)
+  {
+    if (x_array_insert(column->nodes, &node, position) != XARRAY_OK)
+    {
+      return false;
+    }
+
+    if (column->values && x_array_insert(column->values, NULL, position) != XARRAY_OK)
+    {
+      x_array_delete_at(column->nodes, position);
+      return false;
+    }
+  }
+
+  if (!column->values)
+  {
+    return true;
+  }
+
+  stored = x_array_get(column->values, position);
+
+  if (value)
+  {
+    memcpy(stored, value, column->entry_size);
+  }
+  else
+  {
+    memset(stored, 0, column->entry_size);
+  }
+
+  // Links are rebuilt from the node parents on every instance
+  if (component_type == LDK_COMPONENT_TYPE_TRANSFORM && column->entry_size == sizeof(LDKTransform))
+  {
+    LDKTransform* transform = (LDKTransform*)stored;
+
+    if (!value)
+    {
+      *transform = ldk_transform_make_default();
+    }
+
+    transform->parent = x_handle_null();
+    transform->first_child = x_handle_null();
+    transform->next_sibling = x_handle_null();
+    transform->prev_sibling = x_handle_null();
+    transform->flags |= LDK_TRANSFORM_FLAG_WORLD_DIRTY;
+  }
+
+  return true;
+}
+
+bool ldk_prefab_capture(LDKPrefab* prefab, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, LDKEntity root)
+{
+  XArray* pending = NULL;
+  LDKPrefabCaptureItem item;
+  u32 slot_count = 0;
+  u32 cursor = 0;
+  bool result = true;
+
+  if (!prefab || !entity_registry || !component_registry || !ldk_entity_is_alive(entity_registry, root))
+  {
+    return false;
+  }
+
+  ldk_prefab_clear(prefab);
+
+  pending = x_array_create(sizeof(LDKPrefabCaptureItem), 16);
+  if (!pending)
+  {
+    return false;
+  }
+
+  item.entity = root;
+  item.parent_node = LDK_PREFAB_NO_PARENT;
+  x_array_push(pending, &item);
+  slot_count = ldk_component_slot_count(component_registry);
+
+  // Breadth first, so parents come before their children and siblings keep their order
+  while (result && cursor < x_array_count(pending))
+  {
+    LDKPrefabCaptureItem current = *(LDKPrefabCaptureItem*)x_array_get(pending, cursor++);
+    const LDKEntityInfo* info = ldk_entity_info_get(entity_registry, current.entity);
+    const LDKTransform* transform = NULL;
+    LDKComponentMask mask;
+    u32 node = 0;
+    u32 slot = 0;
+
+    if (!info)
+    {
+      continue;
+    }
+
+    mask = info->mask;
+    node = ldk_prefab_node_add(prefab, current.parent_node, info->flags);
+
+    if (node == LDK_PREFAB_NO_PARENT)
+    {
+      result = false;
+      break;
+    }
+
+    for (slot = 0; slot < slot_count; ++slot)
+    {
+      LDKRegisteredComponent* entry = NULL;
+      const void* value = NULL;
+
+      if (!ldk_component_mask_test(&mask, slot))
+      {
+        continue;
+      }
+
+      entry = ldk_component_entry_get(component_registry, slot);
+      if (!entry)
+      {
+        continue;
+      }
+
+      if (entry->desc.storage != LDK_COMPONENT_STORAGE_TAG)
+      {
+        value = ldk_entity_component_get_const(entity_registry, component_registry, current.entity, entry->desc.type);
+      }
+
+      if (!ldk_prefab_component_set(prefab, component_registry, node, entry->desc.type, value))
+      {
+        result = false;
+        break;
+      }
+    }
+
+    transform = ldk_entity_transform_get_const(entity_registry, component_registry, current.entity);
+    if (transform)
+    {
+      LDKEntity child = transform->first_child;
+
+      while (!x_handle_is_null(child))
+      {
+        const LDKTransform* child_transform = ldk_entity_transform_get_const(entity_registry, component_registry, child);
+
+        if (!child_transform)
+        {
+          break;
+        }
+
+        item.entity = child;
+        item.parent_node = node;
+        x_array_push(pending, &item);
+        child = child_transform->next_sibling;
+      }
+    }
+  }
+
+  x_array_destroy(pending);
+
+  if (!result)
+  {
+    ldk_prefab_clear(prefab);
+  }
+
+  return result;
+}
+
+static u32 s_prefab_instances_create(const LDKPrefab* prefab, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, u32 count, XArray* entities, XArray* targets, XArray* values,
+    LDKEntity* out_roots)
+{
+  LDKEntity* instance_entities = (LDKEntity*)x_array_data(entities);
+  const u32* parents = (const u32*)x_array_data(prefab->parents);
+  const u16* flags = (const u16*)x_array_data(prefab->flags);
+  LDKScenegraph* scenegraph = s_prefab_scenegraph_get(component_registry);
+  u32 node_count = ldk_prefab_node_count(prefab);
+  u32 column_count = x_array_count(prefab->columns);
+  u32 created = 0;
+  u32 instances = 0;
+  u32 first = 0;
+  u32 i = 0;
+  bool failed = false;
+
+  created = ldk_entity_create_batch(entity_registry, instance_entities, count * node_count);
+  instances = created / node_count;
+
+  // Only whole instances are kept
+  if (created > instances * node_count)
+  {
+    ldk_entity_destroy_batch(entity_registry, instance_entities + instances * node_count, created - instances * node_count);
+  }
+
+  for (i = 0; i < instances * node_count; ++i)
+  {
+    if (flags[i % node_count])
+    {
+      ldk_entity_flags_set(entity_registry, instance_entities[i], flags[i % node_count]);
+    }
+  }
+
+  for (first = 0; first < instances && !failed; first += LDK_PREFAB_BATCH_INSTANCES)
+  {
+    u32 batch = (instances - first) < LDK_PREFAB_BATCH_INSTANCES ? (instances - first) : LDK_PREFAB_BATCH_INSTANCES;
+    u32 c = 0;
+
+    // Columns are ordered by slot, so each add appends to the entity directories
+    for (c = 0; c < column_count; ++c)
+    {
+      const LDKPrefabColumn* column = (const LDKPrefabColumn*)x_array_get(prefab->columns, c);
+      const u32* nodes = (const u32*)x_array_data(column->nodes);
+      u32 column_nodes = x_array_count(column->nodes);
+      size_t column_bytes = (size_t)column_nodes * column->entry_size;
+      LDKEntity* target = NULL;
+      u8* value = NULL;
+      u32 j = 0;
+      u32 n = 0;
+
+      if (column_nodes == 0)
+      {
+        continue;
+      }
+
+      if (x_array_resize(targets, batch * column_nodes) != XARRAY_OK ||
+          (column_bytes > 0 && x_array_resize(values, batch * column_bytes) != XARRAY_OK))
+      {
+        failed = true;
+        break;
+      }
+
+      target = (LDKEntity*)x_array_data(targets);
+      value = (u8*)x_array_data(values);
+
+      for (j = 0; j < batch; ++j)
+      {
+        const LDKEntity* instance = instance_entities + (size_t)(first + j) * node_count;
+
+        for (n = 0; n < column_nodes; ++n)
+        {
+          target[j * column_nodes + n] = instance[nodes[n]];
+        }
+
+        if (column_bytes > 0)
+        {
+          memcpy(value + j * column_bytes, x_array_data(column->values), column_bytes);
+        }
+      }
+
+      if (ldk_entity_component_add_batch(entity_registry, component_registry, target, batch * column_nodes,
+            column->component_type, column_bytes > 0 ? value : NULL) != batch * column_nodes)
+      {
+        failed = true;
+        break;
+      }
+    }
+  }
+
+  // A missing component would leave partial instances, nothing is kept
+  if (failed)
+  {
+    for (i = 0; i < instances * node_count; ++i)
+    {
+      ldk_component_registry_remove_all(component_registry, entity_registry, instance_entities[i]);
+      ldk_entity_destroy(entity_registry, instance_entities[i]);
+    }
+
+    return 0;
+  }
+
+  // Children are prepended, so nodes are linked last to first to keep the sibling order
+  for (i = 0; i < instances; ++i)
+  {
+    const LDKEntity* instance = instance_entities + (size_t)i * node_count;
+    u32 n = node_count;
+
+    while (n-- > 1)
+    {
+      if (parents[n] != LDK_PREFAB_NO_PARENT)
+      {
+        s_prefab_transform_link(entity_registry, component_registry, scenegraph, instance[n], instance[parents[n]]);
+      }
+    }
+
+    if (out_roots)
+    {
+      out_roots[i] = instance[0];
+    }
+  }
+
+  return instances;
+}
+
+u32 ldk_prefab_instantiate(const LDKPrefab* prefab, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, u32 count, LDKEntity* out_roots)
+{
+  XArray* entities = NULL;
+  XArray* targets = NULL;
+  XArray* values = NULL;
+  u32 node_count = ldk_prefab_node_count(prefab);
+  u32 instances = 0;
+
+  if (!prefab || !entity_registry || !component_registry || count == 0 || node_count == 0)
+  {
+    return 0;
+  }
+
+  if (count > UINT32_MAX / node_count)
+  {
+    count = UINT32_MAX / node_count;
+  }
+
+  entities = x_array_create(sizeof(LDKEntity), count * node_count);
+  targets = x_array_create(sizeof(LDKEntity), 64);
+  values = x_array_create(1, 256);
+
+  if (entities && targets && values && x_array_resize(entities, count * node_count) == XARRAY_OK)
+  {
+    instances = s_prefab_instances_create(prefab, entity_registry, component_registry, count,
+        entities, targets, values, out_roots);
+  }
+
+  if (entities)
+  {
+    x_array_destroy(entities);
+  }
+
+  if (targets)
+  {
+    x_array_destroy(targets);
+  }
+
+  if (values)
+  {
+    x_array_destroy(values);
+  }
+
+  return instances;
+}
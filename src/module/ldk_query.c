@@ -0,0 +1,731 @@
+#include <ldk_common.h>
+#include <module/ldk_query.h>
+#include <module/ldk_component.h>
+#include <module/ldk_entity.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_hpool.h>
+
+#ifndef LDK_ALLOC
+#include <stdlib.h>
+#define LDK_ALLOC(size) malloc(size)
+#define LDK_FREE(ptr) free(ptr)
+#endif
+
+#include <string.h>
+
+#define LDK_QUERY_NOT_MATCHED UINT32_MAX
+
+/* Entities matching a set of terms. Shared by every query with the same terms in any order. */
+typedef struct LDKQueryMatch
+{
+  LDKComponentMask mask;
+  u32 types[LDK_QUERY_MAX_TERMS];   // Sorted
+  u32 term_count;
+  u32 ref_count;
+  XArray* entities;   // LDKEntity, dense list of matched entities
+  XArray* sparse;     // u32, entity index -> position in entities
+  XArray* indices;    // u32[term_count] per matched entity, last known store index of each term
+} LDKQueryMatch;
+
+typedef struct LDKQueryState
+{
+  u32 types[LDK_QUERY_MAX_TERMS];   // In creation order
+  u32 terms[LDK_QUERY_MAX_TERMS];   // Position of each type in match->types
+  u32 term_count;
+  u32 ref_count;
+  LDKQueryMatch* match;
+} LDKQueryState;
+
+static LDKQueryState* s_query_state_get(LDKQueryRegistry* registry, LDKQuery query)
+{
+  if (!registry || !registry->queries || query >= x_array_count(registry->queries))
+  {
+    return NULL;
+  }
+
+  return *(LDKQueryState**)x_array_get(registry->queries, query);
+}
+
+static void s_query_match_destroy(LDKQueryMatch* match)
+{
+  if (!match)
+  {
+    return;
+  }
+
+  if (match->entities)
+  {
+    x_array_destroy(match->entities);
+  }
+
+  if (match->sparse)
+  {
+    x_array_destroy(match->sparse);
+  }
+
+  if (match->indices)
+  {
+    x_array_destroy(match->indices);
+  }
+
+  LDK_FREE(match);
+}
+
+static u32 s_query_position_get(LDKQueryMatch* match, LDKEntity entity)
+{
+  if (entity.index >= x_array_count(match->sparse))
+  {
+    return LDK_QUERY_NOT_MATCHED;
+  }
+
+  return *(u32*)x_array_get(match->sparse, entity.index);
+}
+
+static void s_query_entity_add(LDKQueryMatch* match, LDKEntity entity)
+{
+  u32 position = x_array_count(match->entities);
+  u32 not_matched = LDK_QUERY_NOT_MATCHED;
+  u32 unknown = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+  u32 term = 0;
+
+  while (x_array_count(match->sparse) <= entity.index)
+  {
+    x_array_push(match->sparse, &not_matched);
+  }
+
+  x_array_push(match->entities, &entity);
+  *(u32*)x_array_get(match->sparse, entity.index) = position;
+
+  // Store indices are resolved on first iteration
+  for (term = 0; term < match->term_count; ++term)
+  {
+    x_array_push(match->indices, &unknown);
+  }
+}
+
+static void s_query_entity_remove(LDKQueryMatch* match, u32 position)
+{
+  LDKEntity* removed = (LDKEntity*)x_array_get(match->entities, position);
+  u32 last = x_array_count(match->entities) - 1;
+  u32 term = 0;
+
+  *(u32*)x_array_get(match->sparse, removed->index) = LDK_QUERY_NOT_MATCHED;
+
+  if (position != last)
+  {
+    LDKEntity moved = *(LDKEntity*)x_array_get(match->entities, last);
+    u32* indices = (u32*)x_array_data(match->indices);
+
+    *removed = moved;
+    *(u32*)x_array_get(match->sparse, moved.index) = position;
+
+    for (term = 0; term < match->term_count; ++term)
+    {
+      indices[(size_t)position * match->term_count + term] = indices[(size_t)last * match->term_count + term];
+    }
+  }
+
+  x_array_pop(match->entities);
+  x_array_resize(match->indices, (size_t)last * match->term_count);
+}
+
+static void s_query_match_entity_changed(LDKQueryMatch* match, LDKEntity entity, const LDKComponentMask* mask)
+{
+  bool matches = ldk_component_mask_contains(mask, &match->mask);
+  u32 position = s_query_position_get(match, entity);
+
+  if (matches && position == LDK_QUERY_NOT_MATCHED)
+  {
+    s_query_entity_add(match, entity);
+  }
+  else if (!matches && position != LDK_QUERY_NOT_MATCHED)
+  {
+    s_query_entity_remove(match, position);
+  }
+  else if (matches)
+  {
+    // Keep the handle current in case the entity index was recycled
+    *(LDKEntity*)x_array_get(match->entities, position) = entity;
+  }
+}
+
+static void s_query_match_populate(LDKQueryMatch* match, LDKEntityRegistry* entity_registry)
+{
+  LDKEntityIterator it;
+  LDKEntity entity;
+
+  it = ldk_entity_iterator_begin(entity_registry);
+  while (ldk_entity_iterator_next(&it, &entity))
+  {
+    const LDKEntityInfo* info = ldk_entity_info_get(entity_registry, entity);
+
+    if (info && ldk_component_mask_contains(&info->mask, &match->mask))
+    {
+      s_query_entity_add(match, entity);
+    }
+  }
+  ldk_entity_iterator_end(&it);
+}
+
+/* Returns the match of the sorted types, creating and populating it if no query uses them yet */
+static LDKQueryMatch* s_query_match_acquire(LDKQueryRegistry* registry, LDKEntityRegistry* entity_registry,
+    const LDKComponentMask* mask, const u32* sorted_types, u32 term_count)
+{
+  LDKQueryMatch* match = NULL;
+  u32 count = x_array_count(registry->matches);
+  u32 i = 0;
+
+  for (i = 0; i < count; ++i)
+  {
+    match = *(LDKQueryMatch**)x_array_get(registry->matches, i);
+
+    if (match->term_count == term_count && memcmp(match->types, sorted_types, sizeof(u32) * term_count) == 0)
+    {
+      match->ref_count++;
+      return match;
+    }
+  }
+
+  match = (LDKQueryMatch*)LDK_ALLOC(sizeof(LDKQueryMatch));
+  if (!match)
+  {
+    return NULL;
+  }
+
+  memset(match, 0, sizeof(*match));
+  memcpy(match->types, sorted_types, sizeof(u32) * term_count);
+  match->mask = *mask;
+  match->term_count = term_count;
+  match->ref_count = 1;
+  match->entities = x_array_create(sizeof(LDKEntity), 64);
+  match->sparse = x_array_create(sizeof(u32), 64);
+  match->indices = x_array_create(sizeof(u32), 64 * term_count);
+
+  if (!match->entities || !match->sparse || !match->indices)
+  {
+    s_query_match_destroy(match);
+    return NULL;
+  }
+
+  x_array_push(registry->matches, &match);
+
+  // Initial population. From now on the match is kept up to date incrementally.
+  s_query_match_populate(match, entity_registry);
+  return match;
+}
+
+static void s_query_match_release(LDKQueryRegistry* registry, LDKQueryMatch* match)
+{
+  u32 count = x_array_count(registry->matches);
+  u32 i = 0;
+
+  if (--match->ref_count > 0)
+  {
+    return;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    if (*(LDKQueryMatch**)x_array_get(registry->matches, i) == match)
+    {
+      *(LDKQueryMatch**)x_array_get(registry->matches, i) = *(LDKQueryMatch**)x_array_get(registry->matches, count - 1);
+      x_array_pop(registry->matches);
+      break;
+    }
+  }
+
+  s_query_match_destroy(match);
+}
+
+bool ldk_query_registry_initialize(LDKQueryRegistry* registry)
+{
+  if (!registry)
+  {
+    return false;
+  }
+
+  memset(registry, 0, sizeof(*registry));
+
+  registry->queries = x_array_create(sizeof(LDKQueryState*), 8);
+  registry->matches = x_array_create(sizeof(LDKQueryMatch*), 8);
+
+  if (!registry->queries || !registry->matches)
+  {
+    ldk_query_registry_terminate(registry);
+    return false;
+  }
+
+  return true;
+}
+
+void ldk_query_registry_terminate(LDKQueryRegistry* registry)
+{
+  u32 i = 0;
+
+  if (!registry)
+  {
+    return;
+  }
+
+  if (registry->queries)
+  {
+    for (i = 0; i < x_array_count(registry->queries); ++i)
+    {
+      LDKQueryState* state = *(LDKQueryState**)x_array_get(registry->queries, i);
+
+      if (state)
+      {
+        LDK_FREE(state);
+      }
+    }
+
+    x_array_destroy(registry->queries);
+  }
+
+  if (registry->matches)
+  {
+    for (i = 0; i < x_array_count(registry->matches); ++i)
+    {
+      s_query_match_destroy(*(LDKQueryMatch**)x_array_get(registry->matches, i));
+    }
+
+    x_array_destroy(registry->matches);
+  }
+
+  memset(registry, 0, sizeof(*registry));
+}
+
+void ldk_query_registry_entity_changed(LDKQueryRegistry* registry, LDKEntity entity, const LDKComponentMask* mask)
+{
+  u32 count = 0;
+  u32 i = 0;
+
+  if (!registry || !registry->matches || !mask)
+  {
+    return;
+  }
+
+  count = x_array_count(registry->matches);
+
+  for (i = 0; i < count; ++i)
+  {
+    s_query_match_entity_changed(*(LDKQueryMatch**)x_array_get(registry->matches, i), entity, mask);
+  }
+}
+
+void ldk_query_registry_rebuild(LDKQueryRegistry* registry, LDKEntityRegistry* entity_registry)
+{
+  u32 i = 0;
+
+  if (!registry || !registry->matches || !entity_registry)
+  {
+    return;
+  }
+
+  for (i = 0; i < x_array_count(registry->matches); ++i)
+  {
+    LDKQueryMatch* match = *(LDKQueryMatch**)x_array_get(registry->matches, i);
+
+    x_array_clear(match->entities);
+    x_array_clear(match->sparse);
+    x_array_clear(match->indices);
+    s_query_match_populate(match, entity_registry);
+  }
+}
+
+LDKQuery ldk_query_create(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const u32* component_types, u32 component_count)
+{
+  LDKQueryRegistry* registry = NULL;
+  LDKQueryState* state = NULL;
+  LDKComponentMask mask = {0};
+  LDKQuery query = LDK_QUERY_INVALID;
+  u32 sorted[LDK_QUERY_MAX_TERMS];
+  u32 count = 0;
+  u32 i = 0;
+  u32 j = 0;
+
+  if (!entity_registry || !component_registry || !component_types)
+  {
+    return LDK_QUERY_INVALID;
+  }
+
+  if (component_count == 0 || component_count > LDK_QUERY_MAX_TERMS)
+  {
+    return LDK_QUERY_INVALID;
+  }
+
+  registry = &component_registry->queries;
+
+  for (i = 0; i < component_count; ++i)
+  {
+    u32 slot = ldk_component_slot_get(component_registry, component_types[i]);
+
+    if (slot == LDK_COMPONENT_INVALID_SLOT)
+    {
+      return LDK_QUERY_INVALID;
+    }
+
+    ldk_component_mask_set(&mask, slot);
+  }
+
+  count = x_array_count(registry->queries);
+
+  // Reuse an identical query
+  for (i = 0; i < count; ++i)
+  {
+    state = *(LDKQueryState**)x_array_get(registry->queries, i);
+
+    if (state &&
+        state->term_count == component_count &&
+        memcmp(state->types, component_types, sizeof(u32) * component_count) == 0)
+    {
+      state->ref_count++;
+      return i;
+    }
+  }
+
+  // Queries with the same terms in another order share the matched entities
+  memcpy(sorted, component_types, sizeof(u32) * component_count);
+
+  for (i = 1; i < component_count; ++i)
+  {
+    u32 type = sorted[i];
+
+    for (j = i; j > 0 && sorted[j - 1] > type; --j)
+    {
+      sorted[j] = sorted[j - 1];
+    }
+
+    sorted[j] = type;
+  }
+
+  state = (LDKQueryState*)LDK_ALLOC(sizeof(LDKQueryState));
+  if (!state)
+  {
+    return LDK_QUERY_INVALID;
+  }
+
+  memset(state, 0, sizeof(*state));
+  memcpy(state->types, component_types, sizeof(u32) * component_count);
+  state->term_count = component_count;
+  state->ref_count = 1;
+
+  for (i = 0; i < component_count; ++i)
+  {
+    j = 0;
+    while (sorted[j] != component_types[i])
+    {
+      j++;
+    }
+
+    state->terms[i] = j;
+  }
+
+  state->match = s_query_match_acquire(registry, entity_registry, &mask, sorted, component_count);
+  if (!state->match)
+  {
+    LDK_FREE(state);
+    return LDK_QUERY_INVALID;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    if (*(LDKQueryState**)x_array_get(registry->queries, i) == NULL)
+    {
+      query = i;
+      break;
+    }
+  }
+
+  if (query == LDK_QUERY_INVALID)
+  {
+    query = count;
+    x_array_push(registry->queries, &state);
+  }
+  else
+  {
+    *(LDKQueryState**)x_array_get(registry->queries, query) = state;
+  }
+
+  return query;
+}
+
+void ldk_query_destroy(LDKComponentRegistry* component_registry, LDKQuery query)
+{
+  LDKQueryState* state = NULL;
+
+  if (!component_registry)
+  {
+    return;
+  }
+
+  state = s_query_state_get(&component_registry->queries, query);
+  if (!state)
+  {
+    return;
+  }
+
+  state->ref_count--;
+
+  if (state->ref_count == 0)
+  {
+    s_query_match_release(&component_registry->queries, state->match);
+    LDK_FREE(state);
+    *(LDKQueryState**)x_array_get(component_registry->queries.queries, query) = NULL;
+  }
+}
+
+u32 ldk_query_count(LDKComponentRegistry* component_registry, LDKQuery query)
+{
+  LDKQueryState* state = NULL;
+
+  if (!component_registry)
+  {
+    return 0;
+  }
+
+  state = s_query_state_get(&component_registry->queries, query);
+  if (!state)
+  {
+    return 0;
+  }
+
+  return x_array_count(state->match->entities);
+}
+
+const LDKEntity* ldk_query_entities(LDKComponentRegistry* component_registry, LDKQuery query)
+{
+  LDKQueryState* state = NULL;
+
+  if (!component_registry)
+  {
+    return NULL;
+  }
+
+  state = s_query_state_get(&component_registry->queries, query);
+  if (!state)
+  {
+    return NULL;
+  }
+
+  return (const LDKEntity*)x_array_data(state->match->entities);
+}
+
+LDKQueryIter ldk_query_iter_begin(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry, LDKQuery query)
+{
+  LDKQueryIter iter = {0};
+
+  iter.entity_registry = entity_registry;
+  iter.component_registry = component_registry;
+  iter.query = query;
+  iter.cursor = 0;
+  iter.filter = LDK_QUERY_FILTER_NONE;
+  return iter;
+}
+
+void ldk_query_iter_filter_set(LDKQueryIter* iter, LDKQueryFilter filter, u32 term, u32 tick)
+{
+  if (!iter)
+  {
+    return;
+  }
+
+  iter->filter = filter;
+  iter->filter_term = term;
+  iter->filter_tick = tick;
+}
+
+static bool s_query_filter_passes(const LDKQueryIter* iter, XArray* ticks, u32 component_index)
+{
+  const LDKComponentTicks* component_ticks = NULL;
+
+  if (!ticks || component_index >= x_array_count(ticks))
+  {
+    return false;
+  }
+
+  component_ticks = (const LDKComponentTicks*)x_array_get(ticks, component_index);
+
+  if (iter->filter == LDK_QUERY_FILTER_ADDED)
+  {
+    return component_ticks->added > iter->filter_tick;
+  }
+
+  return component_ticks->changed > iter->filter_tick;
+}
+
+static bool s_query_any_disabled(const u64* const* disabled, const u32* component_indices, u32 term_count)
+{
+  u32 term = 0;
+
+  for (term = 0; term < term_count; ++term)
+  {
+    if (disabled[term] && component_indices[term] != LDK_ENTITY_INVALID_COMPONENT_INDEX &&
+        ldk_component_bits_test(disabled[term], component_indices[term]))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool ldk_query_iter_next(LDKQueryIter* iter, LDKQueryBatch* out_batch)
+{
+  LDKQueryState* state = NULL;
+  LDKQueryMatch* match = NULL;
+  const LDKRegisteredComponent* entries[LDK_QUERY_MAX_TERMS] = {0};
+  const LDKEntity* owners[LDK_QUERY_MAX_TERMS] = {0};
+  u32 owner_counts[LDK_QUERY_MAX_TERMS] = {0};
+  bool tags[LDK_QUERY_MAX_TERMS] = {0};
+  const u64* disabled[LDK_QUERY_MAX_TERMS] = {0};
+  bool any_disabled = false;
+  bool any_archetype = false;
+  XArray* filter_ticks = NULL;
+  u32 filter_term = 0;
+  const LDKEntity* entities = NULL;
+  u32* cached_indices = NULL;
+  u32 total = 0;
+  u32 count = 0;
+  u32 term = 0;
+
+  if (!iter || !out_batch || !iter->entity_registry || !iter->component_registry)
+  {
+    return false;
+  }
+
+  state = s_query_state_get(&iter->component_registry->queries, iter->query);
+  if (!state)
+  {
+    return false;
+  }
+
+  match = state->match;
+  total = x_array_count(match->entities);
+  if (iter->cursor >= total)
+  {
+    return false;
+  }
+
+  if (iter->filter != LDK_QUERY_FILTER_NONE)
+  {
+    LDKRegisteredComponent* entry = NULL;
+
+    if (iter->filter_term >= state->term_count)
+    {
+      iter->cursor = total;
+      return false;
+    }
+
+    filter_term = state->terms[iter->filter_term];
+    entry = ldk_component_entry_get(iter->component_registry,
+        ldk_component_slot_get(iter->component_registry, match->types[filter_term]));
+    filter_ticks = entry ? entry->ticks : NULL;
+  }
+
+  // Packed and paged stores are resolved once per batch. Archetype and tag terms have no store.
+  for (term = 0; term < match->term_count; ++term)
+  {
+    entries[term] = ldk_component_entry_get(iter->component_registry,
+        ldk_component_slot_get(iter->component_registry, match->types[term]));
+    if (entries[term] && !entries[term]->store)
+    {
+      entries[term] = NULL;
+    }
+    tags[term] = ldk_component_is_tag(iter->component_registry, match->types[term]);
+    disabled[term] = ldk_component_entry_disabled_bits(entries[term]);
+    any_disabled = any_disabled || disabled[term] != NULL;
+    any_archetype = any_archetype || (!entries[term] && !tags[term]);
+
+    if (entries[term])
+    {
+      owners[term] = (const LDKEntity*)x_array_data(entries[term]->owners);
+      owner_counts[term] = x_array_count(entries[term]->owners);
+    }
+  }
+
+  entities = (const LDKEntity*)x_array_data(match->entities);
+  cached_indices = (u32*)x_array_data(match->indices);
+  out_batch->term_count = state->term_count;
+
+  // Filtered entities are skipped, keep scanning until the batch is full
+  while (count < LDK_QUERY_BATCH_SIZE && iter->cursor < total)
+  {
+    u32 position = iter->cursor++;
+    LDKEntity entity = entities[position];
+    const LDKEntityInfo* info = any_archetype ? ldk_entity_info_get(iter->entity_registry, entity) : NULL;
+    u32* cached = cached_indices + (size_t)position * match->term_count;
+    u32 component_indices[LDK_QUERY_MAX_TERMS];
+
+    for (term = 0; term < match->term_count; ++term)
+    {
+      u32 index = cached[term];
+
+      component_indices[term] = LDK_ENTITY_INVALID_COMPONENT_INDEX;
+
+      // Tag terms yield no component, only matching entities
+      if (tags[term])
+      {
+        continue;
+      }
+
+      if (!entries[term])
+      {
+        if (info)
+        {
+          component_indices[term] = info->archetype_row;
+        }
+        continue;
+      }
+
+      // Stores move components around, the cached index holds as long as it still points back at the entity
+      if (index < owner_counts[term] && owners[term][index].index == entity.index &&
+          owners[term][index].version == entity.version)
+      {
+        component_indices[term] = index;
+      }
+      else if (ldk_entity_component_find(iter->entity_registry, entity, match->types[term], NULL, &index))
+      {
+        component_indices[term] = index;
+        cached[term] = index;
+      }
+    }
+
+    // Entities with any disabled term are skipped
+    if (any_disabled && s_query_any_disabled(disabled, component_indices, match->term_count))
+    {
+      continue;
+    }
+
+    if (iter->filter != LDK_QUERY_FILTER_NONE &&
+        !s_query_filter_passes(iter, filter_ticks, component_indices[filter_term]))
+    {
+      continue;
+    }
+
+    out_batch->entities[count] = entity;
+
+    for (term = 0; term < state->term_count; ++term)
+    {
+      u32 match_term = state->terms[term];
+      u32 component_index = component_indices[match_term];
+      void* component = NULL;
+
+      if (component_index != LDK_ENTITY_INVALID_COMPONENT_INDEX)
+      {
+        component = entries[match_term] ?
+          ldk_component_entry_data(entries[match_term], component_index) :
+          ldk_component_archetype_data_get(iter->component_registry, info->archetype, info->archetype_row, match->types[match_term]);
+      }
+
+      out_batch->components[term][count] = component;
+      out_batch->indices[term][count] = component_index;
+    }
+
+    count++;
+  }
+
+  out_batch->count = count;
+  return count > 0;
+}
@@ -0,0 +1,644 @@
+#include <ldk.h>
+#include <ldk_common.h>
+#include <ldk_os.h>
+#include <module/ldk_scene.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_hpool.h>
+#include <stdx/stdx_io.h>
+#include <stdx/stdx_log.h>
+
+#include <string.h>
+
+#ifndef LDK_SCENE_BATCH_COMPONENTS
+#define LDK_SCENE_BATCH_COMPONENTS 4096 // Components per batched add. Bounds the scratch buffers.
+#endif
+
+#define LDK_SCENE_NO_INDEX UINT32_MAX
+
+static const LDKComponentMeta* s_scene_meta_find(const LDKComponentMeta* const* metas, u32 meta_count, u32 component_type)
+{
+  u32 i = 0;
+
+  for (i = 0; i < meta_count; ++i)
+  {
+    if (metas[i] && metas[i]->type == component_type)
+    {
+      return metas[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Appends size bytes at the next aligned offset. Returns them zeroed, or NULL on failure. */
+static u8* s_scene_reserve(XArray* out, size_t size, u64* out_offset)
+{
+  u32 start = x_array_count(out);
+  u64 offset = ((u64)start + LDK_SCENE_ALIGNMENT - 1) & ~(u64)(LDK_SCENE_ALIGNMENT - 1);
+  u8* data = NULL;
+
+  if (offset + size > UINT32_MAX || x_array_resize(out, (size_t)(offset + size)) != XARRAY_OK)
+  {
+    return NULL;
+  }
+
+  data = (u8*)x_array_data(out);
+  memset(data + start, 0, (size_t)(offset + size - start));
+  *out_offset = offset;
+  return data + offset;
+}
+
+/* Handles are saved as the scene index of the entity, or null when it is not in the scene */
+static void s_scene_handle_save(u8* field, const LDKEntity* entities, u32 entity_count, XArray* sparse)
+{
+  LDKEntity handle;
+  LDKEntity saved = x_handle_null();
+  u32 scene_index = LDK_SCENE_NO_INDEX;
+
+  memcpy(&handle, field, sizeof(handle));
+
+  if (!x_handle_is_null(handle) && handle.index < x_array_count(sparse))
+  {
+    scene_index = *(u32*)x_array_get(sparse, handle.index);
+  }
+
+  if (scene_index < entity_count && entities[scene_index].version == handle.version)
+  {
+    saved.index = scene_index;
+    saved.version = 0;
+  }
+
+  memcpy(field, &saved, sizeof(saved));
+}
+
+static void s_scene_handle_load(u8* field, const LDKEntity* remap, u32 entity_count)
+{
+  LDKEntity handle;
+
+  memcpy(&handle, field, sizeof(handle));
+  handle = handle.index < entity_count ? remap[handle.index] : x_handle_null();
+  memcpy(field, &handle, sizeof(handle));
+}
+
+static bool s_scene_block_write(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const LDKEntity* entities, u32 entity_count, const LDKComponentMeta* meta, u32 entry_size,
+    XArray* sparse, XArray* owners, XArray* out, LDKSceneBlock* block)
+{
+  u32* owner_data = NULL;
+  u32* fixups = NULL;
+  u8* values = NULL;
+  u32 i = 0;
+  u32 f = 0;
+
+  memset(block, 0, sizeof(*block));
+  block->component_type = meta->type;
+  block->entry_size = entry_size;
+  block->count = x_array_count(owners);
+
+  for (i = 0; i < meta->field_count; ++i)
+  {
+    if (meta->fields[i].type != LDK_FIELD_ENTITY)
+    {
+      continue;
+    }
+
+    if (meta->fields[i].offset + sizeof(LDKEntity) > entry_size)
+    {
+      return false;
+    }
+
+    block->fixup_count++;
+  }
+
+  owner_data = (u32*)s_scene_reserve(out, sizeof(u32) * block->count, &block->owners_offset);
+  if (!owner_data)
+  {
+    return false;
+  }
+
+  memcpy(owner_data, x_array_data(owners), sizeof(u32) * block->count);
+
+  if (block->fixup_count > 0)
+  {
+    fixups = (u32*)s_scene_reserve(out, sizeof(u32) * block->fixup_count, &block->fixups_offset);
+    if (!fixups)
+    {
+      return false;
+    }
+
+    for (i = 0; i < meta->field_count; ++i)
+    {
+      if (meta->fields[i].type == LDK_FIELD_ENTITY)
+      {
+        fixups[f++] = meta->fields[i].offset;
+      }
+    }
+  }
+
+  if (entry_size == 0)
+  {
+    return true;
+  }
+
+  values = s_scene_reserve(out, (size_t)block->count * entry_size, &block->data_offset);
+  if (!values)
+  {
+    return false;
+  }
+
+  fixups = block->fixup_count ? (u32*)((u8*)x_array_data(out) + block->fixups_offset) : NULL;
+
+  for (i = 0; i < block->count; ++i)
+  {
+    LDKEntity owner = entities[*(u32*)x_array_get(owners, i)];
+    const void* component = ldk_entity_component_get_const(entity_registry, component_registry, owner, meta->type);
+    u8* value = values + (size_t)i * entry_size;
+
+    if (!component)
+    {
+      return false;
+    }
+
+    memcpy(value, component, entry_size);
+
+    for (f = 0; f < block->fixup_count; ++f)
+    {
+      s_scene_handle_save(value + fixups[f], entities, entity_count, sparse);
+    }
+  }
+
+  return true;
+}
+
+bool ldk_scene_write(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const LDKEntity* entities, u32 entity_count, const LDKComponentMeta* const* metas, u32 meta_count, XArray* out)
+{
+  LDKSceneHeader header = {0};
+  XArray* sparse = NULL;
+  XArray* owners = NULL;
+  XArray* toc = NULL;
+  u16* flags = NULL;
+  u8* toc_data = NULL;
+  u64 header_offset = 0;
+  u32 max_index = 0;
+  u32 no_index = LDK_SCENE_NO_INDEX;
+  u32 slot_count = 0;
+  u32 slot = 0;
+  u32 i = 0;
+  bool result = true;
+
+  if (!entity_registry || !component_registry || !out || (!entities && entity_count) || (!metas && meta_count))
+  {
+    return false;
+  }
+
+  for (i = 0; i < entity_count; ++i)
+  {
+    if (!ldk_entity_is_alive(entity_registry, entities[i]))
+    {
+      return false;
+    }
+
+    max_index = entities[i].index > max_index ? entities[i].index : max_index;
+  }
+
+  sparse = x_array_create(sizeof(u32), max_index + 1);
+  owners = x_array_create(sizeof(u32), 64);
+  toc = x_array_create(sizeof(LDKSceneBlock), 16);
+
+  if (!sparse || !owners || !toc || x_array_resize(sparse, max_index + 1) != XARRAY_OK)
+  {
+    result = false;
+  }
+
+  for (i = 0; result && i <= max_index; ++i)
+  {
+    *(u32*)x_array_get(sparse, i) = no_index;
+  }
+
+  // Entity index -> scene index. Every entity can be saved only once.
+  for (i = 0; result && i < entity_count; ++i)
+  {
+    u32* scene_index = (u32*)x_array_get(sparse, entities[i].index);
+
+    result = *scene_index == LDK_SCENE_NO_INDEX;
+    *scene_index = i;
+  }
+
+  x_array_clear(out);
+  header.magic = LDK_SCENE_MAGIC;
+  header.version = LDK_SCENE_VERSION;
+  header.entity_count = entity_count;
+
+  if (result && !s_scene_reserve(out, sizeof(LDKSceneHeader), &header_offset))
+  {
+    result = false;
+  }
+
+  if (result)
+  {
+    flags = (u16*)s_scene_reserve(out, sizeof(u16) * entity_count, &header.flags_offset);
+    result = flags != NULL;
+  }
+
+  for (i = 0; result && i < entity_count; ++i)
+  {
+    flags[i] = ldk_entity_flags_get(entity_registry, entities[i]);
+  }
+
+  slot_count = ldk_component_slot_count(component_registry);
+
+  // One block per saved type, in slot order
+  for (slot = 0; result && slot < slot_count; ++slot)
+  {
+    LDKRegisteredComponent* entry = ldk_component_entry_get(component_registry, slot);
+    const LDKComponentMeta* meta = s_scene_meta_find(metas, meta_count, entry->desc.type);
+    LDKSceneBlock block;
+
+    if (!meta)
+    {
+      continue;
+    }
+
+    if (meta->size != entry->desc.entry_size)
+    {
+      result = false;
+      break;
+    }
+
+    x_array_clear(owners);
+
+    for (i = 0; i < entity_count; ++i)
+    {
+      if (ldk_entity_component_has(entity_registry, entities[i], entry->desc.type))
+      {
+        x_array_push(owners, &i);
+      }
+    }
+
+    if (x_array_count(owners) == 0)
+    {
+      continue;
+    }
+
+    result = s_scene_block_write(entity_registry, component_registry, entities, entity_count, meta,
+        entry->desc.entry_size, sparse, owners, out, &block);
+
+    if (result)
+    {
+      x_array_push(toc, &block);
+      header.block_count++;
+    }
+  }
+
+  if (result)
+  {
+    toc_data = s_scene_reserve(out, sizeof(LDKSceneBlock) * header.block_count, &header.toc_offset);
+    result = toc_data != NULL;
+  }
+
+  if (result)
+  {
+    if (header.block_count)
+    {
+      memcpy(toc_data, x_array_data(toc), sizeof(LDKSceneBlock) * header.block_count);
+    }
+
+    header.size = x_array_count(out);
+    memcpy(x_array_data(out), &header, sizeof(header));
+  }
+
+  if (sparse)
+  {
+    x_array_destroy(sparse);
+  }
+
+  if (owners)
+  {
+    x_array_destroy(owners);
+  }
+
+  if (toc)
+  {
+    x_array_destroy(toc);
+  }
+
+  if (!result)
+  {
+    x_array_clear(out);
+  }
+
+  return result;
+}
+
+bool ldk_scene_save(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const LDKEntity* entities, u32 entity_count, const LDKComponentMeta* const* metas, u32 meta_count, const char* path)
+{
+  XArray* data = NULL;
+  XFile* file = NULL;
+  bool result = false;
+
+  if (!path)
+  {
+    return false;
+  }
+
+  data = x_array_create(1, 4096);
+  if (!data)
+  {
+    return false;
+  }
+
+  if (ldk_scene_write(entity_registry, component_registry, entities, entity_count, metas, meta_count, data))
+  {
+    file = x_io_open(path, "wb");
+
+    if (file)
+    {
+      result = x_io_write(file, x_array_data(data), x_array_count(data)) == x_array_count(data);
+      x_io_close(file);
+    }
+  }
+
+  x_array_destroy(data);
+  return result;
+}
+
+static bool s_scene_range_is_valid(u64 size, u64 offset, u64 count, u64 element_size)
+{
+  if (offset > size || offset % LDK_SCENE_ALIGNMENT != 0)
+  {
+    return false;
+  }
+
+  return element_size == 0 || count <= (size - offset) / element_size;
+}
+
+bool ldk_scene_validate(const void* data, size_t size)
+{
+  const u8* bytes = (const u8*)data;
+  const LDKSceneHeader* header = (const LDKSceneHeader*)data;
+  const LDKSceneBlock* blocks = NULL;
+  u32 b = 0;
+  u32 i = 0;
+
+  // Sections are read in place
+  if (!data || size < sizeof(LDKSceneHeader) || ((uintptr_t)data % sizeof(u64)) != 0)
+  {
+    return false;
+  }
+
+  if (header->magic != LDK_SCENE_MAGIC || header->version != LDK_SCENE_VERSION || header->size > size)
+  {
+    return false;
+  }
+
+  if (!s_scene_range_is_valid(header->size, header->flags_offset, header->entity_count, sizeof(u16)) ||
+      !s_scene_range_is_valid(header->size, header->toc_offset, header->block_count, sizeof(LDKSceneBlock)))
+  {
+    return false;
+  }
+
+  blocks = (const LDKSceneBlock*)(bytes + header->toc_offset);
+
+  for (b = 0; b < header->block_count; ++b)
+  {
+    const LDKSceneBlock* block = &blocks[b];
+    const u32* owners = (const u32*)(bytes + block->owners_offset);
+    const u32* fixups = (const u32*)(bytes + block->fixups_offset);
+
+    if (!s_scene_range_is_valid(header->size, block->owners_offset, block->count, sizeof(u32)) ||
+        !s_scene_range_is_valid(header->size, block->fixups_offset, block->fixup_count, sizeof(u32)))
+    {
+      return false;
+    }
+
+    if (block->entry_size > 0 && !s_scene_range_is_valid(header->size, block->data_offset, block->count, block->entry_size))
+    {
+      return false;
+    }
+
+    if (block->entry_size == 0 && block->fixup_count > 0)
+    {
+      return false;
+    }
+
+    // Owners are unique and ascending
+    for (i = 0; i < block->count; ++i)
+    {
+      if (owners[i] >= header->entity_count || (i > 0 && owners[i] <= owners[i - 1]))
+      {
+        return false;
+      }
+    }
+
+    for (i = 0; i < block->fixup_count; ++i)
+    {
+      if ((u64)fixups[i] + sizeof(LDKEntity) > block->entry_size)
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static bool s_scene_block_load(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const u8* bytes, const LDKSceneBlock* block, const LDKEntity* remap, u32 entity_count,
+    XArray* scratch_entities, XArray* scratch_values)
+{
+  LDKRegisteredComponent* entry = ldk_component_entry_get(component_registry,
+      ldk_component_slot_get(component_registry, block->component_type));
+  const u32* owners = (const u32*)(bytes + block->owners_offset);
+  const u32* fixups = (const u32*)(bytes + block->fixups_offset);
+  const u8* values = block->entry_size ? bytes + block->data_offset : NULL;
+  u32 first = 0;
+
+  if (!entry)
+  {
+    ldk_log_warning("Skipping scene block of unregistered component type %u (%u components)",
+        block->component_type, block->count);
+    return true;
+  }
+
+  if (entry->desc.entry_size != block->entry_size)
+  {
+    ldk_log_warning("Skipping scene block of component type %u: saved with %u bytes per component, registered with %u",
+        block->component_type, block->entry_size, entry->desc.entry_size);
+    return true;
+  }
+
+  for (first = 0; first < block->count; first += LDK_SCENE_BATCH_COMPONENTS)
+  {
+    u32 count = block->count - first < LDK_SCENE_BATCH_COMPONENTS ? block->count - first : LDK_SCENE_BATCH_COMPONENTS;
+    const u32* chunk_owners = owners + first;
+    const LDKEntity* chunk_entities = remap + chunk_owners[0];
+    const u8* chunk_values = values ? values + (size_t)first * block->entry_size : NULL;
+    u32 i = 0;
+    u32 f = 0;
+
+    // Owners are ascending, so a run of consecutive scene indices maps straight onto the remap table
+    if (chunk_owners[count - 1] - chunk_owners[0] != count - 1)
+    {
+      LDKEntity* chunk = NULL;
+
+      if (x_array_resize(scratch_entities, count) != XARRAY_OK)
+      {
+        return false;
+      }
+
+      chunk = (LDKEntity*)x_array_data(scratch_entities);
+
+      for (i = 0; i < count; ++i)
+      {
+        chunk[i] = remap[chunk_owners[i]];
+      }
+
+      chunk_entities = chunk;
+    }
+
+    // Only types with entity fields are copied before the add, everything else comes straight from the file
+    if (chunk_values && block->fixup_count > 0)
+    {
+      u8* chunk = NULL;
+
+      if (x_array_resize(scratch_values, (size_t)count * block->entry_size) != XARRAY_OK)
+      {
+        return false;
+      }
+
+      chunk = (u8*)x_array_data(scratch_values);
+      memcpy(chunk, chunk_values, (size_t)count * block->entry_size);
+
+      for (i = 0; i < count; ++i)
+      {
+        for (f = 0; f < block->fixup_count; ++f)
+        {
+          s_scene_handle_load(chunk + (size_t)i * block->entry_size + fixups[f], remap, entity_count);
+        }
+      }
+
+      chunk_values = chunk;
+    }
+
+    // Scene entities are new and own each type once, so anything short of count is a failed add
+    if (ldk_entity_component_add_batch(entity_registry, component_registry, chunk_entities, count,
+          block->component_type, chunk_values) != count)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ldk_scene_load_memory(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const void* data, size_t size, XArray* out_entities)
+{
+  const u8* bytes = (const u8*)data;
+  const LDKSceneHeader* header = (const LDKSceneHeader*)data;
+  const LDKSceneBlock* blocks = NULL;
+  const u16* flags = NULL;
+  XArray* remap = out_entities;
+  XArray* scratch_entities = NULL;
+  XArray* scratch_values = NULL;
+  LDKEntity* entities = NULL;
+  u32 i = 0;
+  bool result = true;
+
+  if (!entity_registry || !component_registry || !ldk_scene_validate(data, size))
+  {
+    return false;
+  }
+
+  if (!remap)
+  {
+    remap = x_array_create(sizeof(LDKEntity), header->entity_count ? header->entity_count : 1);
+  }
+
+  scratch_entities = x_array_create(sizeof(LDKEntity), 64);
+  scratch_values = x_array_create(1, 1024);
+
+  if (!remap || !scratch_entities || !scratch_values || x_array_resize(remap, header->entity_count) != XARRAY_OK)
+  {
+    result = false;
+  }
+
+  if (result && header->entity_count > 0)
+  {
+    entities = (LDKEntity*)x_array_data(remap);
+    i = ldk_entity_create_batch(entity_registry, entities, header->entity_count);
+
+    if (i != header->entity_count)
+    {
+      ldk_entity_destroy_batch(entity_registry, entities, i);
+      entities = NULL;
+      result = false;
+    }
+  }
+
+  if (result)
+  {
+    flags = (const u16*)(bytes + header->flags_offset);
+    blocks = (const LDKSceneBlock*)(bytes + header->toc_offset);
+
+    for (i = 0; i < header->entity_count; ++i)
+    {
+      if (flags[i])
+      {
+        ldk_entity_flags_set(entity_registry, entities[i], flags[i]);
+      }
+    }
+
+    for (i = 0; i < header->block_count; ++i)
+    {
+      if (!s_scene_block_load(entity_registry, component_registry, bytes, &blocks[i], entities,
+            header->entity_count, scratch_entities, scratch_values))
+      {
+        ldk_log_error("Failed to add scene block of component type %u (%u components)",
+            blocks[i].component_type, blocks[i].count);
+        result = false;
+      }
+    }
+  }
+
+  if (remap && remap != out_entities)
+  {
+    x_array_destroy(remap);
+  }
+  else if (remap && !entities)
+  {
+    x_array_clear(remap);
+  }
+
+  if (scratch_entities)
+  {
+    x_array_destroy(scratch_entities);
+  }
+
+  if (scratch_values)
+  {
+    x_array_destroy(scratch_values);
+  }
+
+  return result;
+}
+
+bool ldk_scene_load(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    const char* path, XArray* out_entities)
+{
+  LDKFileMapping mapping;
+  bool result = false;
+
+  if (!path || !ldk_os_file_map(path, &mapping))
+  {
+    return false;
+  }
+
+  result = ldk_scene_load_memory(entity_registry, component_registry, mapping.data, mapping.size, out_entities);
+  ldk_os_file_unmap(&mapping);
+  return result;
+}
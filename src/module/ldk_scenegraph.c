@@ -1,8 +1,35 @@
 #include <module/ldk_scenegraph.h>
 #include <module/ldk_ecs.h>
+#include <module/ldk_jobs.h>
 #include <component/ldk_transform.h>
 #include <stdx/stdx_array.h>
 
+#include <ldk.h>
+#include <ldk_os.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LDK_SCENEGRAPH_SSE
+#include <emmintrin.h>
+#endif
+
+#define LDK_SCENEGRAPH_NODE_UPDATED (1u << 0) // World matrix recomputed by the current pass
+#define LDK_SCENEGRAPH_NODE_QUEUED  (1u << 1) // Entity is on the dirty list
+
+typedef struct LDKScenegraphTask
+{
+  LDKScenegraphNode* nodes;
+  LDKEntityRegistry* entity_registry;
+  LDKTransform* transforms;
+  const LDKEntity* owners;
+  u32 transform_count;
+  bool force;
+  const u32* level;       // Node indices of the level being updated
+  volatile i32 failed;
+  volatile i32 updated;   // World matrices recomputed
+} LDKScenegraphTask;
+
 static bool s_entity_eq(LDKEntity a, LDKEntity b)
 {
   return a.index == b.index && a.version == b.version;
@@ -26,51 +53,6 @@ static const LDKTransform* s_scenegraph_transform_get_const(LDKEntityRegistry* e
       entity);
 }
 
-static bool s_scenegraph_subtree_mark_dirty(LDKEntityRegistry* entity_registry,
-    LDKComponentRegistry* component_registry, LDKEntity entity)
-{
-  LDKTransform* transform = s_scenegraph_transform_get(
-      entity_registry,
-      component_registry,
-      entity);
-
-  if (!transform)
-  {
-    return false;
-  }
-
-  transform->flags |= LDK_TRANSFORM_FLAG_WORLD_DIRTY;
-
-  LDKEntity child = transform->first_child;
-
-  while (!x_handle_is_null(child))
-  {
-    const LDKTransform* child_transform = s_scenegraph_transform_get_const(
-        entity_registry,
-        component_registry,
-        child);
-
-    if (!child_transform)
-    {
-      return false;
-    }
-
-    LDKEntity next_child = child_transform->next_sibling;
-
-    if (!s_scenegraph_subtree_mark_dirty(
-          entity_registry,
-          component_registry,
-          child))
-    {
-      return false;
-    }
-
-    child = next_child;
-  }
-
-  return true;
-}
-
 static bool s_scenegraph_is_ancestor(LDKEntityRegistry* entity_registry,
     LDKComponentRegistry* component_registry, LDKEntity entity,
     LDKEntity possible_ancestor)
@@ -233,65 +215,1041 @@ static bool s_scenegraph_update_subtree(LDKEntityRegistry* entity_registry,
   return true;
 }
 
-bool ldk_scenegraph_update(float dt)
+// ---------------------------------------------------------------------------
+// Node array
+// ---------------------------------------------------------------------------
+
+bool ldk_scenegraph_initialize(LDKScenegraph* scenegraph)
 {
-  LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
-  LDKComponentRegistry* component_registry = ldk_ecs_component_registry_get();
+  if (!scenegraph)
+  {
+    return false;
+  }
 
-  (void)dt;
+  memset(scenegraph, 0, sizeof(*scenegraph));
+  scenegraph->nodes = x_array_create(sizeof(LDKScenegraphNode), 64);
+  scenegraph->node_of = x_array_create(sizeof(u32), 64);
+  scenegraph->remap = x_array_create(sizeof(u32), 64);
+  scenegraph->levels = x_array_create(sizeof(u32), 64);
+  scenegraph->level_ends = x_array_create(sizeof(u32), 16);
+  scenegraph->dirty = x_array_create(sizeof(LDKEntity), 64);
+  scenegraph->stack = x_array_create(sizeof(u32), 64);
+  scenegraph->levels_dirty = true;
+
+  if (!scenegraph->nodes || !scenegraph->node_of || !scenegraph->remap ||
+      !scenegraph->levels || !scenegraph->level_ends || !scenegraph->dirty || !scenegraph->stack)
+  {
+    ldk_scenegraph_terminate(scenegraph);
+    return false;
+  }
 
-  if (!entity_registry || !component_registry)
+  return true;
+}
+
+void ldk_scenegraph_terminate(LDKScenegraph* scenegraph)
+{
+  if (!scenegraph)
+  {
+    return;
+  }
+
+  if (scenegraph->nodes)
+  {
+    x_array_destroy(scenegraph->nodes);
+  }
+
+  if (scenegraph->node_of)
+  {
+    x_array_destroy(scenegraph->node_of);
+  }
+
+  if (scenegraph->remap)
+  {
+    x_array_destroy(scenegraph->remap);
+  }
+
+  if (scenegraph->levels)
+  {
+    x_array_destroy(scenegraph->levels);
+  }
+
+  if (scenegraph->level_ends)
+  {
+    x_array_destroy(scenegraph->level_ends);
+  }
+
+  if (scenegraph->dirty)
+  {
+    x_array_destroy(scenegraph->dirty);
+  }
+
+  if (scenegraph->stack)
+  {
+    x_array_destroy(scenegraph->stack);
+  }
+
+  memset(scenegraph, 0, sizeof(*scenegraph));
+}
+
+void ldk_scenegraph_invalidate(LDKScenegraph* scenegraph)
+{
+  if (scenegraph)
+  {
+    scenegraph->rebuild = true;
+  }
+}
+
+/* Node index of entity, or LDK_SCENEGRAPH_NO_PARENT when it has none */
+static u32 s_scenegraph_node_find(LDKScenegraph* scenegraph, LDKEntity entity)
+{
+  u32 node = LDK_SCENEGRAPH_NO_PARENT;
+
+  if (x_handle_is_null(entity) || entity.index >= x_array_count(scenegraph->node_of))
+  {
+    return LDK_SCENEGRAPH_NO_PARENT;
+  }
+
+  node = *(u32*)x_array_get(scenegraph->node_of, entity.index);
+  if (node >= x_array_count(scenegraph->nodes) ||
+      !s_entity_eq(((LDKScenegraphNode*)x_array_get(scenegraph->nodes, node))->entity, entity))
+  {
+    return LDK_SCENEGRAPH_NO_PARENT;
+  }
+
+  return node;
+}
+
+static bool s_scenegraph_node_push(LDKScenegraph* scenegraph, LDKEntity entity, u32 parent, u32 transform_index)
+{
+  LDKScenegraphNode node;
+  u32 index = x_array_count(scenegraph->nodes);
+  u32 old_count = x_array_count(scenegraph->node_of);
+
+  if (entity.index >= old_count)
+  {
+    u32 i = 0;
+
+    if (x_array_resize(scenegraph->node_of, entity.index + 1) != XARRAY_OK)
+    {
+      return false;
+    }
+
+    for (i = old_count; i <= entity.index; ++i)
+    {
+      *(u32*)x_array_get(scenegraph->node_of, i) = LDK_SCENEGRAPH_NO_PARENT;
+    }
+  }
+
+  node.entity = entity;
+  node.parent = parent;
+  node.transform_index = transform_index;
+  node.flags = 0;
+  x_array_push(scenegraph->nodes, &node);
+  if (x_array_count(scenegraph->nodes) != index + 1)
   {
     return false;
   }
 
-  XArray* store = ldk_component_store_get(
-      component_registry,
-      LDK_COMPONENT_TYPE_TRANSFORM);
+  *(u32*)x_array_get(scenegraph->node_of, entity.index) = index;
+  scenegraph->live_count++;
+  scenegraph->levels_dirty = true;
+  return true;
+}
 
-  XArray* owners = ldk_component_owners_get(
-      component_registry,
-      LDK_COMPONENT_TYPE_TRANSFORM);
+static void s_scenegraph_node_kill(LDKScenegraph* scenegraph, u32 node)
+{
+  LDKScenegraphNode* dead = (LDKScenegraphNode*)x_array_get(scenegraph->nodes, node);
+
+  *(u32*)x_array_get(scenegraph->node_of, dead->entity.index) = LDK_SCENEGRAPH_NO_PARENT;
+  dead->entity = x_handle_null();
+  scenegraph->live_count--;
+  scenegraph->dead_count++;
+  scenegraph->levels_dirty = true;
+}
+
+void ldk_scenegraph_node_add(LDKScenegraph* scenegraph, LDKEntity entity, LDKEntity parent, u32 transform_index)
+{
+  u32 parent_node = LDK_SCENEGRAPH_NO_PARENT;
+
+  if (!scenegraph || !scenegraph->nodes || scenegraph->rebuild)
+  {
+    return;
+  }
+
+  if (s_scenegraph_node_find(scenegraph, entity) != LDK_SCENEGRAPH_NO_PARENT)
+  {
+    scenegraph->rebuild = true;
+    return;
+  }
+
+  // Transforms copied with their links (scenes, prefabs) are appended under
+  // their parent when it is already known, anything else is fixed by a rebuild
+  parent_node = s_scenegraph_node_find(scenegraph, parent);
+  if (!x_handle_is_null(parent) && parent_node == LDK_SCENEGRAPH_NO_PARENT)
+  {
+    scenegraph->rebuild = true;
+    return;
+  }
+
+  if (!s_scenegraph_node_push(scenegraph, entity, parent_node, transform_index))
+  {
+    scenegraph->rebuild = true;
+    return;
+  }
+
+  ldk_scenegraph_node_dirty(scenegraph, entity);
+}
+
+void ldk_scenegraph_node_remove(LDKScenegraph* scenegraph, LDKEntity entity)
+{
+  u32 node = LDK_SCENEGRAPH_NO_PARENT;
+
+  if (!scenegraph || !scenegraph->nodes || scenegraph->rebuild)
+  {
+    return;
+  }
+
+  node = s_scenegraph_node_find(scenegraph, entity);
+  if (node == LDK_SCENEGRAPH_NO_PARENT)
+  {
+    scenegraph->rebuild = true;
+    return;
+  }
+
+  s_scenegraph_node_kill(scenegraph, node);
+}
+
+/*
+ * Appends the subtree of the last node again below its current links, killing
+ * the nodes it had before. Nodes are appended breadth first so every parent
+ * still comes before its children.
+ */
+static bool s_scenegraph_subtree_append(LDKScenegraph* scenegraph, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, u32 first)
+{
+  u32 cursor = first;
+
+  while (cursor < x_array_count(scenegraph->nodes))
+  {
+    LDKEntity parent = ((LDKScenegraphNode*)x_array_get(scenegraph->nodes, cursor))->entity;
+    const LDKTransform* transform = s_scenegraph_transform_get_const(entity_registry, component_registry, parent);
+    LDKEntity child = transform ? transform->first_child : x_handle_null();
+
+    if (!transform)
+    {
+      return false;
+    }
+
+    while (!x_handle_is_null(child))
+    {
+      const LDKTransform* child_transform = s_scenegraph_transform_get_const(entity_registry, component_registry, child);
+      u32 old_node = s_scenegraph_node_find(scenegraph, child);
+
+      if (!child_transform)
+      {
+        return false;
+      }
+
+      if (old_node != LDK_SCENEGRAPH_NO_PARENT)
+      {
+        s_scenegraph_node_kill(scenegraph, old_node);
+      }
+
+      if (!s_scenegraph_node_push(scenegraph, child, cursor, LDK_ENTITY_INVALID_COMPONENT_INDEX))
+      {
+        return false;
+      }
+
+      child = child_transform->next_sibling;
+    }
+
+    cursor++;
+  }
+
+  return true;
+}
+
+void ldk_scenegraph_node_parent_set(LDKScenegraph* scenegraph, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, LDKEntity entity, LDKEntity parent)
+{
+  LDKScenegraphNode* node = NULL;
+  u32 node_index = LDK_SCENEGRAPH_NO_PARENT;
+  u32 parent_index = LDK_SCENEGRAPH_NO_PARENT;
+
+  if (!scenegraph || !scenegraph->nodes || scenegraph->rebuild)
+  {
+    return;
+  }
+
+  node_index = s_scenegraph_node_find(scenegraph, entity);
+  parent_index = s_scenegraph_node_find(scenegraph, parent);
+  if (node_index == LDK_SCENEGRAPH_NO_PARENT || (!x_handle_is_null(parent) && parent_index == LDK_SCENEGRAPH_NO_PARENT))
+  {
+    scenegraph->rebuild = true;
+    return;
+  }
+
+  // Detaching or moving below an earlier node keeps parents before children
+  if (parent_index == LDK_SCENEGRAPH_NO_PARENT || parent_index < node_index)
+  {
+    node = (LDKScenegraphNode*)x_array_get(scenegraph->nodes, node_index);
+    node->parent = parent_index;
+    scenegraph->levels_dirty = true;
+    return;
+  }
+
+  // The new parent comes later, the whole subtree moves to the end
+  {
+    u32 first = x_array_count(scenegraph->nodes);
+    u32 transform_index = ((LDKScenegraphNode*)x_array_get(scenegraph->nodes, node_index))->transform_index;
+
+    s_scenegraph_node_kill(scenegraph, node_index);
+    if (!s_scenegraph_node_push(scenegraph, entity, parent_index, transform_index) ||
+        !s_scenegraph_subtree_append(scenegraph, entity_registry, component_registry, first))
+    {
+      scenegraph->rebuild = true;
+    }
+  }
+}
+
+void ldk_scenegraph_node_dirty(LDKScenegraph* scenegraph, LDKEntity entity)
+{
+  LDKScenegraphNode* node = NULL;
+  u32 node_index = LDK_SCENEGRAPH_NO_PARENT;
+
+  if (!scenegraph || !scenegraph->nodes || scenegraph->rebuild)
+  {
+    return;
+  }
+
+  node_index = s_scenegraph_node_find(scenegraph, entity);
+  if (node_index == LDK_SCENEGRAPH_NO_PARENT)
+  {
+    scenegraph->rebuild = true;
+    return;
+  }
+
+  node = (LDKScenegraphNode*)x_array_get(scenegraph->nodes, node_index);
+  if (node->flags & LDK_SCENEGRAPH_NODE_QUEUED)
+  {
+    return;
+  }
+
+  // Past this size the update visits every node anyway
+  node->flags |= LDK_SCENEGRAPH_NODE_QUEUED;
+  if (x_array_count(scenegraph->dirty) <= scenegraph->live_count)
+  {
+    x_array_push(scenegraph->dirty, &entity);
+  }
+}
+
+/* Drops removed nodes, keeping the order */
+static void s_scenegraph_compact(LDKScenegraph* scenegraph)
+{
+  LDKScenegraphNode* nodes = (LDKScenegraphNode*)x_array_data(scenegraph->nodes);
+  u32 count = x_array_count(scenegraph->nodes);
+  u32* remap = NULL;
+  u32 kept = 0;
+  u32 i = 0;
+
+  if (x_array_resize(scenegraph->remap, count) != XARRAY_OK)
+  {
+    return;
+  }
+
+  remap = (u32*)x_array_data(scenegraph->remap);
+
+  for (i = 0; i < count; ++i)
+  {
+    LDKScenegraphNode node = nodes[i];
+
+    if (x_handle_is_null(node.entity))
+    {
+      remap[i] = LDK_SCENEGRAPH_NO_PARENT;
+      continue;
+    }
+
+    // Parents come first so they are already remapped
+    node.parent = node.parent == LDK_SCENEGRAPH_NO_PARENT ? LDK_SCENEGRAPH_NO_PARENT : remap[node.parent];
+    remap[i] = kept;
+    nodes[kept] = node;
+    *(u32*)x_array_get(scenegraph->node_of, node.entity.index) = kept;
+    kept++;
+  }
+
+  x_array_resize(scenegraph->nodes, kept);
+  scenegraph->dead_count = 0;
+  scenegraph->levels_dirty = true;
+}
+
+/* Rebuilds the node array breadth first from the roots of the Transform store */
+static bool s_scenegraph_rebuild(LDKScenegraph* scenegraph, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry)
+{
+  XArray* store = ldk_component_store_get(component_registry, LDK_COMPONENT_TYPE_TRANSFORM);
+  XArray* owners = ldk_component_owners_get(component_registry, LDK_COMPONENT_TYPE_TRANSFORM);
+  u32 count = 0;
+  u32 i = 0;
 
   if (!store || !owners)
   {
     return false;
   }
 
-  if (x_array_count(store) != x_array_count(owners))
+  x_array_clear(scenegraph->nodes);
+  memset(x_array_data(scenegraph->node_of), 0xFF, sizeof(u32) * x_array_count(scenegraph->node_of));
+  scenegraph->live_count = 0;
+  scenegraph->dead_count = 0;
+  scenegraph->rebuild = false;
+  scenegraph->levels_dirty = true;
+
+  count = x_array_count(store);
+  for (i = 0; i < count; ++i)
+  {
+    const LDKTransform* transform = (const LDKTransform*)x_array_get(store, i);
+    LDKEntity owner = *(LDKEntity*)x_array_get(owners, i);
+
+    if (x_handle_is_null(owner) || !x_handle_is_null(transform->parent))
+    {
+      continue;
+    }
+
+    if (!s_scenegraph_node_push(scenegraph, owner, LDK_SCENEGRAPH_NO_PARENT, i))
+    {
+      scenegraph->rebuild = true;
+      return false;
+    }
+  }
+
+  if (!s_scenegraph_subtree_append(scenegraph, entity_registry, component_registry, 0))
   {
+    scenegraph->rebuild = true;
     return false;
   }
 
-  for (u32 i = 0; i < x_array_count(store); ++i)
+  return true;
+}
+
+/*
+ * Groups the live nodes by depth, keeping node order within a level. Depths
+ * are computed in node order as parents come before their children.
+ */
+static bool s_scenegraph_levels_build(LDKScenegraph* scenegraph)
+{
+  const LDKScenegraphNode* nodes = (const LDKScenegraphNode*)x_array_data(scenegraph->nodes);
+  u32 count = x_array_count(scenegraph->nodes);
+  u32* depths = NULL;
+  u32* ends = NULL;
+  u32* levels = NULL;
+  u32 level_count = 0;
+  u32 offset = 0;
+  u32 i = 0;
+
+  if (x_array_resize(scenegraph->remap, count) != XARRAY_OK ||
+      x_array_resize(scenegraph->levels, scenegraph->live_count) != XARRAY_OK)
+  {
+    return false;
+  }
+
+  depths = (u32*)x_array_data(scenegraph->remap);
+  for (i = 0; i < count; ++i)
+  {
+    u32 parent = nodes[i].parent;
+
+    if (x_handle_is_null(nodes[i].entity))
+    {
+      depths[i] = LDK_SCENEGRAPH_NO_PARENT;
+      continue;
+    }
+
+    // A node below a removed parent fails validation during the update anyway
+    depths[i] = (parent == LDK_SCENEGRAPH_NO_PARENT || depths[parent] == LDK_SCENEGRAPH_NO_PARENT)
+      ? 0 : depths[parent] + 1;
+    level_count = depths[i] + 1 > level_count ? depths[i] + 1 : level_count;
+  }
+
+  if (x_array_resize(scenegraph->level_ends, level_count) != XARRAY_OK)
+  {
+    return false;
+  }
+
+  ends = (u32*)x_array_data(scenegraph->level_ends);
+  memset(ends, 0, sizeof(u32) * level_count);
+  for (i = 0; i < count; ++i)
+  {
+    if (depths[i] != LDK_SCENEGRAPH_NO_PARENT)
+    {
+      ends[depths[i]]++;
+    }
+  }
+
+  // Level sizes become level starts, and level ends once every node is placed
+  for (i = 0; i < level_count; ++i)
+  {
+    u32 size = ends[i];
+
+    ends[i] = offset;
+    offset += size;
+  }
+
+  levels = (u32*)x_array_data(scenegraph->levels);
+  for (i = 0; i < count; ++i)
+  {
+    if (depths[i] != LDK_SCENEGRAPH_NO_PARENT)
+    {
+      levels[ends[depths[i]]++] = i;
+    }
+  }
+
+  scenegraph->levels_dirty = false;
+  return true;
+}
+
+/*
+ * Resolves the transform of a live node and checks its parent link. Returns
+ * NULL when the node does not match the Transform store.
+ */
+static LDKTransform* s_scenegraph_node_transform(const LDKScenegraphTask* task, LDKScenegraphNode* node)
+{
+  const LDKScenegraphNode* parent = node->parent == LDK_SCENEGRAPH_NO_PARENT ? NULL : &task->nodes[node->parent];
+  LDKTransform* transform = NULL;
+
+  // Store indices change when transforms are removed or sorted
+  if (node->transform_index >= task->transform_count || !s_entity_eq(task->owners[node->transform_index], node->entity))
+  {
+    const LDKEntityInfo* info = ldk_entity_info_get(task->entity_registry, node->entity);
+
+    if (!info || info->transform_index >= task->transform_count)
+    {
+      return NULL;
+    }
+
+    node->transform_index = info->transform_index;
+  }
+
+  transform = &task->transforms[node->transform_index];
+
+  if (parent ? (x_handle_is_null(parent->entity) || !s_entity_eq(transform->parent, parent->entity))
+      : !x_handle_is_null(transform->parent))
+  {
+    return NULL;
+  }
+
+  return transform;
+}
+
+// ---------------------------------------------------------------------------
+// World matrix kernel
+// ---------------------------------------------------------------------------
+
+static void s_scenegraph_compose_scalar(const LDKScenegraphCompose* batch, u32 i)
+{
+  Mat4 local_matrix = mat4_compose(
+      vec3_make(batch->position[0][i], batch->position[1][i], batch->position[2][i]),
+      quat_make(batch->rotation[0][i], batch->rotation[1][i], batch->rotation[2][i], batch->rotation[3][i]),
+      vec3_make(batch->scale[0][i], batch->scale[1][i], batch->scale[2][i]));
+
+  *batch->world[i] = batch->parent_world[i] ? mat4_mul(*batch->parent_world[i], local_matrix) : local_matrix;
+}
+
+#ifdef LDK_SCENEGRAPH_SSE
+/*
+ * Composes four local matrices at once, one transform per lane, then
+ * multiplies each by its parent one column at a time. The operations are done
+ * in the same order as mat4_compose() and mat4_mul(), so results match the
+ * scalar path.
+ */
+static void s_scenegraph_compose_sse(const LDKScenegraphCompose* batch, u32 first)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  __m128 x = _mm_loadu_ps(batch->rotation[0] + first);
+  __m128 y = _mm_loadu_ps(batch->rotation[1] + first);
+  __m128 z = _mm_loadu_ps(batch->rotation[2] + first);
+  __m128 w = _mm_loadu_ps(batch->rotation[3] + first);
+  __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+          _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+  __m128 valid = _mm_cmpgt_ps(length, _mm_set1_ps(STDXM_EPS));
+  __m128 sx = _mm_loadu_ps(batch->scale[0] + first);
+  __m128 sy = _mm_loadu_ps(batch->scale[1] + first);
+  __m128 sz = _mm_loadu_ps(batch->scale[2] + first);
+  __m128 xx, yy, zz, xy, xz, yz, wx, wy, wz;
+  float local[12][4];
+  u32 lane = 0;
+
+  // Rotations too short to normalize become the identity, as in quat_norm()
+  x = _mm_and_ps(_mm_div_ps(x, length), valid);
+  y = _mm_and_ps(_mm_div_ps(y, length), valid);
+  z = _mm_and_ps(_mm_div_ps(z, length), valid);
+  w = _mm_or_ps(_mm_and_ps(_mm_div_ps(w, length), valid), _mm_andnot_ps(valid, one));
+
+  xx = _mm_mul_ps(x, x);
+  yy = _mm_mul_ps(y, y);
+  zz = _mm_mul_ps(z, z);
+  xy = _mm_mul_ps(x, y);
+  xz = _mm_mul_ps(x, z);
+  yz = _mm_mul_ps(y, z);
+  wx = _mm_mul_ps(w, x);
+  wy = _mm_mul_ps(w, y);
+  wz = _mm_mul_ps(w, z);
+
+  // Rotation columns scaled by the matching scale axis, then the translation
+  _mm_storeu_ps(local[0], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx));
+  _mm_storeu_ps(local[1], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx));
+  _mm_storeu_ps(local[2], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx));
+  _mm_storeu_ps(local[3], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy));
+  _mm_storeu_ps(local[4], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy));
+  _mm_storeu_ps(local[5], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy));
+  _mm_storeu_ps(local[6], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz));
+  _mm_storeu_ps(local[7], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz));
+  _mm_storeu_ps(local[8], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz));
+  _mm_storeu_ps(local[9], _mm_loadu_ps(batch->position[0] + first));
+  _mm_storeu_ps(local[10], _mm_loadu_ps(batch->position[1] + first));
+  _mm_storeu_ps(local[11], _mm_loadu_ps(batch->position[2] + first));
+
+  for (lane = 0; lane < 4; ++lane)
+  {
+    const Mat4* parent_world = batch->parent_world[first + lane];
+    float* out = batch->world[first + lane]->m;
+    __m128 column[4];
+    u32 c = 0;
+
+    column[0] = _mm_setr_ps(local[0][lane], local[1][lane], local[2][lane], 0.0f);
+    column[1] = _mm_setr_ps(local[3][lane], local[4][lane], local[5][lane], 0.0f);
+    column[2] = _mm_setr_ps(local[6][lane], local[7][lane], local[8][lane], 0.0f);
+    column[3] = _mm_setr_ps(local[9][lane], local[10][lane], local[11][lane], 1.0f);
+
+    if (parent_world)
+    {
+      __m128 p0 = _mm_loadu_ps(parent_world->m + 0);
+      __m128 p1 = _mm_loadu_ps(parent_world->m + 4);
+      __m128 p2 = _mm_loadu_ps(parent_world->m + 8);
+      __m128 p3 = _mm_loadu_ps(parent_world->m + 12);
+
+      for (c = 0; c < 3; ++c)
+      {
+        column[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(local[c * 3 + 0][lane])),
+              _mm_mul_ps(p1, _mm_set1_ps(local[c * 3 + 1][lane]))),
+            _mm_mul_ps(p2, _mm_set1_ps(local[c * 3 + 2][lane])));
+      }
+
+      column[3] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(local[9][lane])),
+                _mm_mul_ps(p1, _mm_set1_ps(local[10][lane]))),
+            _mm_mul_ps(p2, _mm_set1_ps(local[11][lane]))), p3);
+    }
+
+    for (c = 0; c < 4; ++c)
+    {
+      _mm_storeu_ps(out + c * 4, column[c]);
+    }
+  }
+}
+#endif // LDK_SCENEGRAPH_SSE
+
+void ldk_scenegraph_compose(const LDKScenegraphCompose* batch, u32 count)
+{
+  u32 i = 0;
+
+  if (!batch)
+  {
+    return;
+  }
+
+#ifdef LDK_SCENEGRAPH_SSE
+  for (; i + 4 <= count; i += 4)
+  {
+    s_scenegraph_compose_sse(batch, i);
+  }
+#endif
+
+  for (; i < count; ++i)
+  {
+    s_scenegraph_compose_scalar(batch, i);
+  }
+}
+
+/* Transforms gathered for ldk_scenegraph_compose() */
+typedef struct LDKScenegraphComposeBuffer
+{
+  float position[3][LDK_SCENEGRAPH_COMPOSE_BATCH];
+  float rotation[4][LDK_SCENEGRAPH_COMPOSE_BATCH];
+  float scale[3][LDK_SCENEGRAPH_COMPOSE_BATCH];
+  const Mat4* parent_world[LDK_SCENEGRAPH_COMPOSE_BATCH];
+  Mat4* world[LDK_SCENEGRAPH_COMPOSE_BATCH];
+  u32 count;
+} LDKScenegraphComposeBuffer;
+
+static void s_scenegraph_buffer_flush(LDKScenegraphComposeBuffer* buffer)
+{
+  LDKScenegraphCompose batch;
+  u32 i = 0;
+
+  for (i = 0; i < 3; ++i)
+  {
+    batch.position[i] = buffer->position[i];
+    batch.scale[i] = buffer->scale[i];
+  }
+
+  for (i = 0; i < 4; ++i)
+  {
+    batch.rotation[i] = buffer->rotation[i];
+  }
+
+  batch.parent_world = buffer->parent_world;
+  batch.world = buffer->world;
+  ldk_scenegraph_compose(&batch, buffer->count);
+  buffer->count = 0;
+}
+
+/*
+ * Queues the world matrix of a node. It is only written when the buffer is
+ * flushed, so the parent of every queued node must already be up to date.
+ */
+static void s_scenegraph_buffer_add(LDKScenegraphComposeBuffer* buffer, const LDKScenegraphTask* task,
+    const LDKScenegraphNode* node, LDKTransform* transform)
+{
+  u32 i = buffer->count;
+
+  buffer->position[0][i] = transform->local_position.x;
+  buffer->position[1][i] = transform->local_position.y;
+  buffer->position[2][i] = transform->local_position.z;
+  buffer->rotation[0][i] = transform->local_rotation.x;
+  buffer->rotation[1][i] = transform->local_rotation.y;
+  buffer->rotation[2][i] = transform->local_rotation.z;
+  buffer->rotation[3][i] = transform->local_rotation.w;
+  buffer->scale[0][i] = transform->local_scale.x;
+  buffer->scale[1][i] = transform->local_scale.y;
+  buffer->scale[2][i] = transform->local_scale.z;
+  buffer->parent_world[i] = node->parent != LDK_SCENEGRAPH_NO_PARENT
+    ? &task->transforms[task->nodes[node->parent].transform_index].world_matrix : NULL;
+  buffer->world[i] = &transform->world_matrix;
+  transform->flags &= ~LDK_TRANSFORM_FLAG_WORLD_DIRTY;
+
+  if (++buffer->count == LDK_SCENEGRAPH_COMPOSE_BATCH)
+  {
+    s_scenegraph_buffer_flush(buffer);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Update passes
+// ---------------------------------------------------------------------------
+
+/*
+ * Queues a single node of a full pass. force recomputes the node even when it
+ * is clean, as a failed pass may have cleared dirty flags.
+ */
+static bool s_scenegraph_node_update(const LDKScenegraphTask* task, LDKScenegraphComposeBuffer* buffer, u32 index, u32* updated)
+{
+  LDKScenegraphNode* node = &task->nodes[index];
+  LDKTransform* transform = NULL;
+
+  if (x_handle_is_null(node->entity))
+  {
+    return true;
+  }
+
+  transform = s_scenegraph_node_transform(task, node);
+  if (!transform)
+  {
+    return false;
+  }
+
+  // A full pass covers the dirty list, so the queued flag is dropped as well
+  if (task->force || (transform->flags & LDK_TRANSFORM_FLAG_WORLD_DIRTY) ||
+      (node->parent != LDK_SCENEGRAPH_NO_PARENT && (task->nodes[node->parent].flags & LDK_SCENEGRAPH_NODE_UPDATED)))
+  {
+    s_scenegraph_buffer_add(buffer, task, node, transform);
+    node->flags = LDK_SCENEGRAPH_NODE_UPDATED;
+    (*updated)++;
+  }
+  else
+  {
+    node->flags = 0;
+  }
+
+  return true;
+}
+
+static void s_scenegraph_level_range(void* user, u32 begin, u32 end, u32 worker_index)
+{
+  LDKScenegraphTask* task = (LDKScenegraphTask*)user;
+  LDKScenegraphComposeBuffer buffer;
+  u32 updated = 0;
+  u32 i = 0;
+
+  (void)worker_index;
+
+  buffer.count = 0;
+  for (i = begin; i < end; ++i)
+  {
+    if (!s_scenegraph_node_update(task, &buffer, task->level[i], &updated))
+    {
+      task->failed = 1;
+      break;
+    }
+  }
+
+  s_scenegraph_buffer_flush(&buffer);
+  ldk_os_atomic_add_i32(&task->updated, (i32)updated);
+}
+
+/*
+ * Runs the levels in order. Large levels are split across the workers when
+ * there is a job system, the others run on the calling thread.
+ */
+static bool s_scenegraph_update_levels(LDKScenegraph* scenegraph, LDKScenegraphTask* task, LDKJobSystem* jobs)
+{
+  const u32* levels = NULL;
+  const u32* ends = NULL;
+  u32 level_count = 0;
+  u32 begin = 0;
+  u32 i = 0;
+
+  if (scenegraph->levels_dirty && !s_scenegraph_levels_build(scenegraph))
+  {
+    return false;
+  }
+
+  levels = (const u32*)x_array_data(scenegraph->levels);
+  ends = (const u32*)x_array_data(scenegraph->level_ends);
+  level_count = x_array_count(scenegraph->level_ends);
+
+  for (i = 0; i < level_count; ++i)
+  {
+    task->level = levels + begin;
+    if (jobs)
+    {
+      ldk_jobs_parallel_for(jobs, ends[i] - begin, LDK_SCENEGRAPH_JOB_BATCH, s_scenegraph_level_range, task);
+    }
+    else
+    {
+      s_scenegraph_level_range(task, 0, ends[i] - begin, 0);
+    }
+
+    if (task->failed)
+    {
+      return false;
+    }
+
+    begin = ends[i];
+  }
+
+  return true;
+}
+
+static int s_scenegraph_node_index_compare(const void* a, const void* b)
+{
+  u32 index_a = *(const u32*)a;
+  u32 index_b = *(const u32*)b;
+
+  return index_a < index_b ? -1 : (index_a > index_b ? 1 : 0);
+}
+
+/*
+ * Recomputes the subtrees of the dirty list. Queued nodes are visited in node
+ * order, so a queued ancestor is done first and clears the dirty flags of the
+ * queued nodes below it, which are then skipped. Each subtree is walked one
+ * depth at a time, so a whole depth is composed in batches.
+ */
+static bool s_scenegraph_update_dirty(LDKScenegraph* scenegraph, LDKScenegraphTask* task)
+{
+  const LDKEntity* dirty = (const LDKEntity*)x_array_data(scenegraph->dirty);
+  u32 dirty_count = x_array_count(scenegraph->dirty);
+  LDKScenegraphComposeBuffer buffer;
+  u32* queued = NULL;
+  u32 queued_count = 0;
+  u32 i = 0;
+
+  if (dirty_count == 0)
+  {
+    return true;
+  }
+
+  if (x_array_resize(scenegraph->remap, dirty_count) != XARRAY_OK)
   {
-    LDKTransform* transform = (LDKTransform*)x_array_get(store, i);
+    return false;
+  }
+
+  // Entities destroyed after being queued have no node anymore
+  queued = (u32*)x_array_data(scenegraph->remap);
+  for (i = 0; i < dirty_count; ++i)
+  {
+    u32 node = s_scenegraph_node_find(scenegraph, dirty[i]);
+
+    if (node != LDK_SCENEGRAPH_NO_PARENT)
+    {
+      task->nodes[node].flags &= ~LDK_SCENEGRAPH_NODE_QUEUED;
+      queued[queued_count++] = node;
+    }
+  }
+
+  qsort(queued, queued_count, sizeof(u32), s_scenegraph_node_index_compare);
+
+  buffer.count = 0;
+  for (i = 0; i < queued_count; ++i)
+  {
+    LDKTransform* transform = s_scenegraph_node_transform(task, &task->nodes[queued[i]]);
+    u32 depth_begin = 0;
 
     if (!transform)
     {
       return false;
     }
 
-    if (!x_handle_is_null(transform->parent))
+    if (!(transform->flags & LDK_TRANSFORM_FLAG_WORLD_DIRTY))
     {
       continue;
     }
 
-    if (!s_scenegraph_update_subtree(
-          entity_registry,
-          component_registry,
-          transform,
-          mat4_identity(),
-          false,
-          false))
+    s_scenegraph_buffer_add(&buffer, task, &task->nodes[queued[i]], transform);
+    s_scenegraph_buffer_flush(&buffer);
+    task->updated++;
+    x_array_clear(scenegraph->stack);
+    x_array_push(scenegraph->stack, &queued[i]);
+
+    // stack holds the walked nodes, the last depth starting at depth_begin
+    while (depth_begin < x_array_count(scenegraph->stack))
     {
-      return false;
+      u32 depth_end = x_array_count(scenegraph->stack);
+      u32 j = 0;
+
+      for (j = depth_begin; j < depth_end; ++j)
+      {
+        u32 parent = *(u32*)x_array_get(scenegraph->stack, j);
+        LDKEntity child = task->transforms[task->nodes[parent].transform_index].first_child;
+
+        while (!x_handle_is_null(child))
+        {
+          u32 node = s_scenegraph_node_find(scenegraph, child);
+          LDKTransform* child_transform = node == LDK_SCENEGRAPH_NO_PARENT
+            ? NULL : s_scenegraph_node_transform(task, &task->nodes[node]);
+
+          if (!child_transform || task->nodes[node].parent != parent)
+          {
+            return false;
+          }
+
+          s_scenegraph_buffer_add(&buffer, task, &task->nodes[node], child_transform);
+          task->updated++;
+          if (!x_handle_is_null(child_transform->first_child))
+          {
+            x_array_push(scenegraph->stack, &node);
+          }
+
+          child = child_transform->next_sibling;
+        }
+      }
+
+      s_scenegraph_buffer_flush(&buffer);
+      depth_begin = depth_end;
     }
   }
 
   return true;
 }
 
+bool ldk_scenegraph_update_world(LDKScenegraph* scenegraph, LDKEntityRegistry* entity_registry,
+    LDKComponentRegistry* component_registry, LDKJobSystem* jobs)
+{
+  XArray* store = NULL;
+  XArray* owners = NULL;
+  u32 attempt = 0;
+
+  if (!scenegraph || !scenegraph->nodes || !entity_registry || !component_registry)
+  {
+    return false;
+  }
+
+  store = ldk_component_store_get(component_registry, LDK_COMPONENT_TYPE_TRANSFORM);
+  owners = ldk_component_owners_get(component_registry, LDK_COMPONENT_TYPE_TRANSFORM);
+  if (!store || !owners || x_array_count(store) != x_array_count(owners))
+  {
+    return false;
+  }
+
+  // Levels only pay off when the calling thread can hand work to other workers
+  if (jobs && (jobs->worker_count < 2 || ldk_jobs_worker_index(jobs) == LDK_JOBS_INVALID_WORKER))
+  {
+    jobs = NULL;
+  }
+
+  if (scenegraph->dead_count > 64 && scenegraph->dead_count > scenegraph->live_count)
+  {
+    s_scenegraph_compact(scenegraph);
+  }
+
+  memset(&scenegraph->stats, 0, sizeof(scenegraph->stats));
+  scenegraph->stats.dirty_count = x_array_count(scenegraph->dirty);
+
+  // A pass that finds the array out of date rebuilds it and runs once more
+  for (attempt = 0; attempt < 2; ++attempt)
+  {
+    LDKScenegraphTask task;
+    bool full_pass = false;
+    bool updated = false;
+
+    // Walking many subtrees costs more than one pass over the levels
+    full_pass = attempt > 0 || scenegraph->rebuild || scenegraph->live_count != x_array_count(store) ||
+      x_array_count(scenegraph->dirty) > scenegraph->live_count / 16;
+
+    if ((scenegraph->rebuild || scenegraph->live_count != x_array_count(store)) &&
+        !s_scenegraph_rebuild(scenegraph, entity_registry, component_registry))
+    {
+      return false;
+    }
+
+    task.nodes = (LDKScenegraphNode*)x_array_data(scenegraph->nodes);
+    task.entity_registry = entity_registry;
+    task.transforms = (LDKTransform*)x_array_data(store);
+    task.owners = (const LDKEntity*)x_array_data(owners);
+    task.transform_count = x_array_count(store);
+    task.force = attempt > 0;
+    task.level = NULL;
+    task.failed = 0;
+    task.updated = 0;
+
+    updated = full_pass
+      ? s_scenegraph_update_levels(scenegraph, &task, scenegraph->live_count >= LDK_SCENEGRAPH_PARALLEL_MIN ? jobs : NULL)
+      : s_scenegraph_update_dirty(scenegraph, &task);
+
+    scenegraph->stats.matrices_updated += (u32)task.updated;
+    scenegraph->stats.full_pass = full_pass;
+
+    if (updated)
+    {
+      x_array_clear(scenegraph->dirty);
+      return true;
+    }
+
+    scenegraph->rebuild = true;
+  }
+
+  return false;
+}
+
+bool ldk_scenegraph_update(float dt)
+{
+  (void)dt;
+
+  return ldk_scenegraph_update_world(ldk_ecs_scenegraph_get(),
+      ldk_ecs_entity_registry_get(), ldk_ecs_component_registry_get(),
+      (LDKJobSystem*)ldk_module_get(LDK_MODULE_JOBS));
+}
+
+LDKScenegraphStats ldk_scenegraph_stats_get(void)
+{
+  LDKScenegraphStats stats = {0};
+  LDKScenegraph* scenegraph = ldk_ecs_scenegraph_get();
+
+  if (scenegraph)
+  {
+    stats = scenegraph->stats;
+  }
+
+  return stats;
+}
+
 bool ldk_scenegraph_update_entity(LDKEntity entity)
 {
   LDKEntityRegistry* entity_registry = ldk_ecs_entity_registry_get();
@@ -431,10 +1389,12 @@ bool ldk_scenegraph_set_parent(LDKEntity child_entity, LDKEntity parent_entity)
     parent_transform->first_child = child_entity;
   }
 
-  return s_scenegraph_subtree_mark_dirty(
-      entity_registry,
-      component_registry,
-      child_entity);
+  ldk_scenegraph_node_parent_set(ldk_ecs_scenegraph_get(), entity_registry, component_registry,
+      child_entity, parent_entity);
+
+  child_transform->flags |= LDK_TRANSFORM_FLAG_WORLD_DIRTY;
+  ldk_scenegraph_node_dirty(ldk_ecs_scenegraph_get(), child_entity);
+  return true;
 }
 
 bool ldk_scenegraph_detach(LDKEntity entity)
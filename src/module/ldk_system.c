@@ -25,8 +25,19 @@ typedef struct LDKSystemRegistryInternal
 {
   XArray_LDKRegisteredSystem* systems;
   XArray_u32* buckets[LDK_SYSTEM_BUCKET_COUNT];
+  XArray_u32* waves[LDK_SYSTEM_BUCKET_COUNT];   // End offset of each wave in the bucket list
+  LDKSystemExecutorFn executor;
+  void* executor_user;
 } LDKSystemRegistryInternal;
 
+typedef struct LDKSystemWaveTask
+{
+  LDKSystemRegistryInternal* internal;
+  const u32* systems;
+  LDKSystemBucket bucket;
+  float dt;
+} LDKSystemWaveTask;
+
 static int s_system_desc_has_any_callback(const LDKSystemDesc* desc)
 {
   if (!desc)
@@ -94,6 +105,116 @@ static i32 s_system_get_bucket_order(const LDKRegisteredSystem* system, LDKSyste
   }
 }
 
+static bool s_system_access_has(const u32* types, u32 count, u32 type)
+{
+  u32 i;
+
+  if (count > LDK_SYSTEM_MAX_ACCESS)
+  {
+    count = LDK_SYSTEM_MAX_ACCESS;
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    if (types[i] == type)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Returns true if the systems touch the same component and at least one of them writes it */
+static bool s_system_conflicts(const LDKRegisteredSystem* left, const LDKRegisteredSystem* right)
+{
+  const LDKSystemAccess* a;
+  const LDKSystemAccess* b;
+  u32 i;
+
+  // Systems that did not declare their access are exclusive
+  if (!(left->desc.flags & LDK_SYSTEM_FLAG_PARALLEL) || !(right->desc.flags & LDK_SYSTEM_FLAG_PARALLEL))
+  {
+    return true;
+  }
+
+  a = &left->desc.access;
+  b = &right->desc.access;
+
+  for (i = 0; i < a->write_count && i < LDK_SYSTEM_MAX_ACCESS; ++i)
+  {
+    if (s_system_access_has(b->writes, b->write_count, a->writes[i]) ||
+        s_system_access_has(b->reads, b->read_count, a->writes[i]))
+    {
+      return true;
+    }
+  }
+
+  for (i = 0; i < b->write_count && i < LDK_SYSTEM_MAX_ACCESS; ++i)
+  {
+    if (s_system_access_has(a->reads, a->read_count, b->writes[i]))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool s_system_run(LDKRegisteredSystem* system, LDKSystemBucket bucket, float dt)
+{
+  if (!(system->desc.flags & LDK_SYSTEM_FLAG_ENABLED))
+  {
+    return true;
+  }
+
+  switch (bucket)
+  {
+    case LDK_SYSTEM_BUCKET_PRE_UPDATE:
+      if (system->desc.callbacks.pre_update)
+      {
+        system->desc.callbacks.pre_update(system->userdata, dt);
+      }
+      break;
+
+    case LDK_SYSTEM_BUCKET_UPDATE:
+      if (system->desc.callbacks.update)
+      {
+        system->desc.callbacks.update(system->userdata, dt);
+      }
+      break;
+
+    case LDK_SYSTEM_BUCKET_POST_UPDATE:
+      if (system->desc.callbacks.post_update)
+      {
+        system->desc.callbacks.post_update(system->userdata, dt);
+      }
+      break;
+
+    case LDK_SYSTEM_BUCKET_RENDER:
+      if (system->desc.callbacks.render)
+      {
+        system->desc.callbacks.render(system->userdata, dt);
+      }
+      break;
+
+    default:
+      ldk_log_error("Unknown system bucket %d.", (i32)bucket);
+      return false;
+  }
+
+  return true;
+}
+
+static void s_system_wave_task(void* task_user, u32 index)
+{
+  LDKSystemWaveTask* task = (LDKSystemWaveTask*)task_user;
+  LDKRegisteredSystem* system = x_array_LDKRegisteredSystem_get(task->internal->systems, task->systems[index]);
+
+  // Jobs have no result, ldk_system_registry_run_bucket() rejects unknown buckets before scheduling
+  s_system_run(system, task->bucket, task->dt);
+}
+
 static inline LDKSystemRegistryInternal* s_system_registry_internal(LDKSystemRegistry* registry)
 {
   return (LDKSystemRegistryInternal*)registry->internal;
@@ -153,6 +274,7 @@ static void s_system_registry_clear_bucket_lists(LDKSystemRegistry* registry)
   for (i = 0; i < LDK_SYSTEM_BUCKET_COUNT; ++i)
   {
     x_array_u32_clear(internal->buckets[i]);
+    x_array_u32_clear(internal->waves[i]);
   }
 }
 
@@ -247,6 +369,83 @@ static void s_system_registry_sort_bucket(LDKSystemRegistry* registry, LDKSystem
   }
 }
 
+/*
+ * Splits a sorted bucket into waves. A system goes one wave after the latest
+ * earlier system it conflicts with, so conflicting systems keep their order.
+ * The bucket list is reordered by wave, keeping the sorted order inside a wave.
+ */
+static bool s_system_registry_build_bucket_waves(LDKSystemRegistry* registry, LDKSystemBucket bucket)
+{
+  LDKSystemRegistryInternal* internal;
+  XArray_u32* bucket_list;
+  u32* levels;
+  u32* ordered;
+  u32 count;
+  u32 wave_count;
+  u32 wave;
+  u32 n;
+  u32 i;
+  u32 j;
+
+  internal = s_system_registry_internal(registry);
+  bucket_list = internal->buckets[bucket];
+  count = x_array_u32_count(bucket_list);
+
+  if (count == 0)
+  {
+    return true;
+  }
+
+  levels = (u32*)LDK_ALLOC(sizeof(u32) * count * 2);
+  if (!levels)
+  {
+    return false;
+  }
+
+  ordered = levels + count;
+  wave_count = 0;
+
+  for (i = 0; i < count; ++i)
+  {
+    const LDKRegisteredSystem* system = x_array_LDKRegisteredSystem_get(internal->systems, *x_array_u32_get(bucket_list, i));
+
+    levels[i] = 0;
+
+    for (j = 0; j < i; ++j)
+    {
+      const LDKRegisteredSystem* previous = x_array_LDKRegisteredSystem_get(internal->systems, *x_array_u32_get(bucket_list, j));
+
+      if (levels[j] + 1 > levels[i] && s_system_conflicts(system, previous))
+      {
+        levels[i] = levels[j] + 1;
+      }
+    }
+
+    if (levels[i] + 1 > wave_count)
+    {
+      wave_count = levels[i] + 1;
+    }
+  }
+
+  n = 0;
+  for (wave = 0; wave < wave_count; ++wave)
+  {
+    for (i = 0; i < count; ++i)
+    {
+      if (levels[i] == wave)
+      {
+        ordered[n++] = *x_array_u32_get(bucket_list, i);
+      }
+    }
+
+    x_array_u32_push(internal->waves[bucket], n);
+  }
+
+  memcpy(x_array_u32_data(bucket_list), ordered, sizeof(u32) * count);
+  LDK_FREE(levels);
+  return true;
+}
+
 static bool s_system_registry_build_bucket_lists(LDKSystemRegistry* registry)
 {
   LDKSystemRegistryInternal* internal;
@@ -286,6 +485,12 @@ static bool s_system_registry_build_bucket_lists(LDKSystemRegistry* registry)
   for (bucket_index = 0; bucket_index < LDK_SYSTEM_BUCKET_COUNT; ++bucket_index)
   {
     s_system_registry_sort_bucket(registry, (LDKSystemBucket)bucket_index);
+
+    if (!s_system_registry_build_bucket_waves(registry, (LDKSystemBucket)bucket_index))
+    {
+      s_system_registry_clear_bucket_lists(registry);
+      return false;
+    }
   }
 
   return true;
@@ -346,13 +551,22 @@ bool ldk_system_registry_initialize(LDKSystemRegistry* registry)
   for (i = 0; i < LDK_SYSTEM_BUCKET_COUNT; ++i)
   {
     internal->buckets[i] = x_array_u32_create(8);
-    if (!internal->buckets[i])
+    internal->waves[i] = x_array_u32_create(8);
+    if (!internal->buckets[i] || !internal->waves[i])
     {
       u32 j;
 
-      for (j = 0; j < i; ++j)
+      for (j = 0; j <= i; ++j)
       {
-        x_array_u32_destroy(internal->buckets[j]);
+        if (internal->buckets[j])
+        {
+          x_array_u32_destroy(internal->buckets[j]);
+        }
+
+        if (internal->waves[j])
+        {
+          x_array_u32_destroy(internal->waves[j]);
+        }
       }
 
       x_array_LDKRegisteredSystem_destroy(internal->systems);
@@ -393,6 +607,11 @@ void ldk_system_registry_terminate(LDKSystemRegistry* registry)
       {
         x_array_u32_destroy(internal->buckets[i]);
       }
+
+      if (internal->waves[i])
+      {
+        x_array_u32_destroy(internal->waves[i]);
+      }
     }
 
     if (internal->systems)
@@ -619,6 +838,8 @@ bool ldk_system_registry_run_bucket(LDKSystemRegistry* registry, LDKSystemBucket
 {
   LDKSystemRegistryInternal* internal;
   XArray_u32* bucket_list;
+  XArray_u32* waves;
+  u32 wave_start;
   u32 i;
 
   if (!registry || !registry->is_initialized || !registry->is_started)
@@ -628,6 +849,7 @@ bool ldk_system_registry_run_bucket(LDKSystemRegistry* registry, LDKSystemBucket
 
   if (bucket >= LDK_SYSTEM_BUCKET_COUNT)
   {
+    ldk_log_error("Unknown system bucket %d.", (i32)bucket);
     return false;
   }
 
@@ -638,53 +860,35 @@ bool ldk_system_registry_run_bucket(LDKSystemRegistry* registry, LDKSystemBucket
   }
 
   bucket_list = internal->buckets[bucket];
+  waves = internal->waves[bucket];
+  wave_start = 0;
 
-  for (i = 0; i < x_array_u32_count(bucket_list); ++i)
+  for (i = 0; i < x_array_u32_count(waves); ++i)
   {
-    u32* system_index_ptr;
-    LDKRegisteredSystem* system;
+    u32 wave_end = *x_array_u32_get(waves, i);
+    u32 wave_size = wave_end - wave_start;
+    LDKSystemWaveTask task;
 
-    system_index_ptr = x_array_u32_get(bucket_list, i);
-    system = x_array_LDKRegisteredSystem_get(internal->systems, *system_index_ptr);
+    task.internal = internal;
+    task.systems = x_array_u32_data(bucket_list) + wave_start;
+    task.bucket = bucket;
+    task.dt = dt;
 
-    if (!(system->desc.flags & LDK_SYSTEM_FLAG_ENABLED))
+    if (internal->executor && wave_size > 1)
     {
-      continue;
+      internal->executor(internal->executor_user, wave_size, s_system_wave_task, &task);
     }
-
-    switch (bucket)
+    else
     {
-      case LDK_SYSTEM_BUCKET_PRE_UPDATE:
-        if (system->desc.callbacks.pre_update)
-        {
-          system->desc.callbacks.pre_update(system->userdata, dt);
-        }
-        break;
-
-      case LDK_SYSTEM_BUCKET_UPDATE:
-        if (system->desc.callbacks.update)
-        {
-          system->desc.callbacks.update(system->userdata, dt);
-        }
-        break;
-
-      case LDK_SYSTEM_BUCKET_POST_UPDATE:
-        if (system->desc.callbacks.post_update)
-        {
-          system->desc.callbacks.post_update(system->userdata, dt);
-        }
-        break;
-
-      case LDK_SYSTEM_BUCKET_RENDER:
-        if (system->desc.callbacks.render)
-        {
-          system->desc.callbacks.render(system->userdata, dt);
-        }
-        break;
+      u32 j;
 
-      default:
-        return false;
+      for (j = 0; j < wave_size; ++j)
+      {
+        s_system_wave_task(&task, j);
+      }
     }
+
+    wave_start = wave_end;
   }
 
   return true;
@@ -695,3 +899,40 @@ bool ldk_system_registry_has(const LDKSystemRegistry* registry, u64 id)
   return s_system_registry_find_by_id_const(registry, id) != NULL;
 }
 
+
+void ldk_system_registry_executor_set(LDKSystemRegistry* registry, LDKSystemExecutorFn executor, void* executor_user)
+{
+  LDKSystemRegistryInternal* internal;
+
+  if (!registry)
+  {
+    return;
+  }
+
+  internal = s_system_registry_internal(registry);
+  if (!internal)
+  {
+    return;
+  }
+
+  internal->executor = executor;
+  internal->executor_user = executor_user;
+}
+
+u32 ldk_system_registry_wave_count(const LDKSystemRegistry* registry, LDKSystemBucket bucket)
+{
+  const LDKSystemRegistryInternal* internal;
+
+  if (!registry || bucket >= LDK_SYSTEM_BUCKET_COUNT)
+  {
+    return 0;
+  }
+
+  internal = s_system_registry_internal_const(registry);
+  if (!internal)
+  {
+    return 0;
+  }
+
+  return x_array_u32_count(internal->waves[bucket]);
+}
@@ -0,0 +1,511 @@
+/**
+ * @file   bench_ldk_ecs.c
+ * @brief  ECS benchmarks.
+ *
+ * Times the ECS operations a frame leans on at 10k, 100k and 1M entities and
+ * prints one result per operation and entity count, as JSON (default) or CSV.
+ * Operations that touch every entity once are timed in chunks of
+ * BENCH_CHUNK_SIZE entities and iterations are timed per pass, so every run
+ * adds many samples. Results are nanoseconds per entity: median and p99 over
+ * the samples of all runs.
+ *
+ * Each run uses a fresh world bound on the main thread, so the engine does not
+ * need to be initialized.
+ *
+ * usage: bench_ecs [--csv] [--runs N] [--max-entities N]
+ */
+
+#if defined(LDK_SHAREDLIB)
+#define X_IMPL_ARRAY
+#define X_IMPL_MATH
+#define X_IMPL_LOG
+#endif // LDK_SHAREDLIB
+
+#include <ldk.h>
+#include <module/ldk_ecs.h>
+#include <module/ldk_scenegraph.h>
+#include <component/ldk_transform.h>
+#include <stdx/stdx_array.h>
+
+#define X_IMPL_TIME
+#include <stdx/stdx_time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_CHUNK_SIZE      1024
+#define BENCH_PASSES          8     // Timed passes per run for iteration and scenegraph benchmarks
+#define BENCH_DEFAULT_RUNS    5
+#define BENCH_HIERARCHY_WIDTH 8     // One root and BENCH_HIERARCHY_WIDTH - 1 children per group
+#define BENCH_SPARSE_STRIDE   50    // One group in BENCH_SPARSE_STRIDE moves per sparse scenegraph pass
+
+typedef struct BenchPosition
+{
+  float x;
+  float y;
+  float z;
+} BenchPosition;
+
+typedef struct BenchVelocity
+{
+  float x;
+  float y;
+  float z;
+} BenchVelocity;
+
+enum
+{
+  BENCH_COMPONENT_POSITION = 1,
+  BENCH_COMPONENT_VELOCITY = 2
+};
+
+typedef enum BenchOp
+{
+  BENCH_OP_ENTITY_CREATE = 0,
+  BENCH_OP_COMPONENT_ADD,
+  BENCH_OP_COMPONENT_GET,
+  BENCH_OP_ITERATE_DENSE,
+  BENCH_OP_ITERATE_QUERY,
+  BENCH_OP_SCENEGRAPH_UPDATE,
+  BENCH_OP_SCENEGRAPH_SPARSE,
+  BENCH_OP_COMPONENT_REMOVE,
+  BENCH_OP_ENTITY_DESTROY,
+  BENCH_OP_COUNT
+} BenchOp;
+
+static const char* s_bench_op_names[BENCH_OP_COUNT] =
+{
+  "entity_create",
+  "component_add",
+  "component_get",
+  "iterate_dense",
+  "iterate_query",
+  "scenegraph_update",
+  "scenegraph_update_sparse",
+  "component_remove",
+  "entity_destroy",
+};
+
+static const u32 s_bench_sizes[] = { 10000, 100000, 1000000 };
+
+typedef struct BenchState
+{
+  XArray* samples[BENCH_OP_COUNT]; // double, nanoseconds per entity
+  LDKEntity* entities;
+  u32* order;                      // Shuffled entity order for random access benchmarks
+  u32 count;
+  u32 seed;
+} BenchState;
+
+static u32 s_bench_random(BenchState* state)
+{
+  // xorshift32, good enough to shuffle and reproducible across runs
+  state->seed ^= state->seed << 13;
+  state->seed ^= state->seed >> 17;
+  state->seed ^= state->seed << 5;
+  return state->seed;
+}
+
+static void s_bench_shuffle(BenchState* state)
+{
+  u32 i = 0;
+
+  for (i = 0; i < state->count; ++i)
+  {
+    state->order[i] = i;
+  }
+
+  for (i = state->count; i > 1; --i)
+  {
+    u32 j = s_bench_random(state) % i;
+    u32 value = state->order[i - 1];
+
+    state->order[i - 1] = state->order[j];
+    state->order[j] = value;
+  }
+}
+
+static void s_bench_sample(BenchState* state, BenchOp op, const XTimer* timer, u32 entities)
+{
+  double ns = x_time_nanoseconds(x_timer_elapsed(timer)) / (double)entities;
+  x_array_push(state->samples[op], &ns);
+}
+
+static int s_bench_double_compare(const void* a, const void* b)
+{
+  double value_a = *(const double*)a;
+  double value_b = *(const double*)b;
+  return value_a < value_b ? -1 : (value_a > value_b ? 1 : 0);
+}
+
+static double s_bench_percentile(const double* sorted, u32 count, double percentile)
+{
+  u32 rank = (u32)(percentile * (double)(count - 1) + 0.5);
+  return sorted[rank < count ? rank : count - 1];
+}
+
+static void s_bench_report(BenchState* state, bool csv, bool* first)
+{
+  u32 op = 0;
+
+  for (op = 0; op < BENCH_OP_COUNT; ++op)
+  {
+    double* samples = (double*)x_array_data(state->samples[op]);
+    u32 count = x_array_count(state->samples[op]);
+    double median = 0.0;
+    double p99 = 0.0;
+
+    if (count == 0)
+    {
+      continue;
+    }
+
+    qsort(samples, count, sizeof(double), s_bench_double_compare);
+    median = s_bench_percentile(samples, count, 0.5);
+    p99 = s_bench_percentile(samples, count, 0.99);
+
+    if (csv)
+    {
+      printf("%s,%u,%u,%.3f,%.3f\n", s_bench_op_names[op], state->count, count, median, p99);
+    }
+    else
+    {
+      printf("%s    { \"name\": \"%s\", \"entities\": %u, \"samples\": %u, \"median_ns\": %.3f, \"p99_ns\": %.3f }",
+          *first ? "" : ",\n", s_bench_op_names[op], state->count, count, median, p99);
+      *first = false;
+    }
+
+    x_array_clear(state->samples[op]);
+  }
+
+  fflush(stdout);
+}
+
+static void s_bench_foreach_position(void* user, void* components, const LDKEntity* owners, u32 count, u32 worker_index)
+{
+  BenchPosition* positions = (BenchPosition*)components;
+  u32 i = 0;
+
+  (void)user;
+  (void)owners;
+  (void)worker_index;
+
+  for (i = 0; i < count; ++i)
+  {
+    positions[i].x += 1.0f;
+  }
+}
+
+static bool s_bench_register(void)
+{
+  LDKComponentDesc desc = {0};
+
+  desc.name = "BenchPosition";
+  desc.type = BENCH_COMPONENT_POSITION;
+  desc.entry_size = sizeof(BenchPosition);
+  desc.initial_capacity = 1024;
+  if (!ldk_ecs_component_register(&desc))
+  {
+    return false;
+  }
+
+  desc.name = "BenchVelocity";
+  desc.type = BENCH_COMPONENT_VELOCITY;
+  desc.entry_size = sizeof(BenchVelocity);
+  return ldk_ecs_component_register(&desc);
+}
+
+static bool s_bench_run(BenchState* state)
+{
+  const u32 n = state->count;
+  const u32 query_types[] = { BENCH_COMPONENT_POSITION, BENCH_COMPONENT_VELOCITY };
+  LDKECS* world = ldk_ecs_world_create(4096, (n + 4095) / 4096);
+  LDKECS* previous = NULL;
+  BenchPosition position = { 0.0f, 0.0f, 0.0f };
+  BenchVelocity velocity = { 1.0f, 0.0f, 0.0f };
+  LDKQuery query;
+  XTimer timer;
+  volatile float sink = 0.0f;
+  u32 pass = 0;
+  u32 begin = 0;
+  u32 i = 0;
+
+  if (!world)
+  {
+    return false;
+  }
+
+  previous = ldk_ecs_world_bind(world);
+
+  if (!s_bench_register())
+  {
+    ldk_ecs_world_bind(previous);
+    ldk_ecs_world_destroy(world);
+    return false;
+  }
+
+  for (begin = 0; begin < n; begin += BENCH_CHUNK_SIZE)
+  {
+    u32 end = begin + BENCH_CHUNK_SIZE < n ? begin + BENCH_CHUNK_SIZE : n;
+
+    x_timer_start(&timer);
+    for (i = begin; i < end; ++i)
+    {
+      state->entities[i] = ldk_ecs_entity_create();
+    }
+    s_bench_sample(state, BENCH_OP_ENTITY_CREATE, &timer, end - begin);
+  }
+
+  for (begin = 0; begin < n; begin += BENCH_CHUNK_SIZE)
+  {
+    u32 end = begin + BENCH_CHUNK_SIZE < n ? begin + BENCH_CHUNK_SIZE : n;
+
+    x_timer_start(&timer);
+    for (i = begin; i < end; ++i)
+    {
+      ldk_ecs_component_add(state->entities[i], BENCH_COMPONENT_POSITION, &position);
+    }
+    s_bench_sample(state, BENCH_OP_COMPONENT_ADD, &timer, end - begin);
+  }
+
+  // Half of the entities move, so the query skips the other half
+  for (i = 0; i < n; i += 2)
+  {
+    ldk_ecs_component_add(state->entities[i], BENCH_COMPONENT_VELOCITY, &velocity);
+  }
+
+  s_bench_shuffle(state);
+
+  for (begin = 0; begin < n; begin += BENCH_CHUNK_SIZE)
+  {
+    u32 end = begin + BENCH_CHUNK_SIZE < n ? begin + BENCH_CHUNK_SIZE : n;
+
+    x_timer_start(&timer);
+    for (i = begin; i < end; ++i)
+    {
+      const BenchPosition* p = (const BenchPosition*)ldk_ecs_component_get_const(state->entities[state->order[i]], BENCH_COMPONENT_POSITION);
+      sink += p->x;
+    }
+    s_bench_sample(state, BENCH_OP_COMPONENT_GET, &timer, end - begin);
+  }
+
+  // No job system: the dense loop itself is measured, not the workers
+  for (pass = 0; pass < BENCH_PASSES; ++pass)
+  {
+    x_timer_start(&timer);
+    ldk_component_foreach_parallel(&world->component, NULL, BENCH_COMPONENT_POSITION, s_bench_foreach_position, NULL, 0);
+    s_bench_sample(state, BENCH_OP_ITERATE_DENSE, &timer, n);
+  }
+
+  query = ldk_ecs_query_create(query_types, 2);
+  for (pass = 0; pass < BENCH_PASSES; ++pass)
+  {
+    LDKQueryIter iter = ldk_ecs_query_iter_begin(query);
+    LDKQueryBatch batch;
+
+    x_timer_start(&timer);
+    while (ldk_ecs_query_iter_next(&iter, &batch))
+    {
+      for (i = 0; i < batch.count; ++i)
+      {
+        BenchPosition* p = (BenchPosition*)batch.components[0][i];
+        const BenchVelocity* v = (const BenchVelocity*)batch.components[1][i];
+
+        p->x += v->x;
+        p->y += v->y;
+        p->z += v->z;
+      }
+    }
+    s_bench_sample(state, BENCH_OP_ITERATE_QUERY, &timer, n / 2);
+  }
+  ldk_ecs_query_destroy(query);
+
+  for (i = 0; i < n; ++i)
+  {
+    if (i % BENCH_HIERARCHY_WIDTH != 0)
+    {
+      ldk_transform_set_parent(state->entities[i], state->entities[i - i % BENCH_HIERARCHY_WIDTH]);
+    }
+  }
+
+  for (pass = 0; pass < BENCH_PASSES; ++pass)
+  {
+    Vec3 root_position;
+
+    root_position.x = (float)pass;
+    root_position.y = 0.0f;
+    root_position.z = 0.0f;
+
+    // Moving every root dirties the whole forest
+    for (i = 0; i < n; i += BENCH_HIERARCHY_WIDTH)
+    {
+      ldk_transform_set_local_position(state->entities[i], root_position);
+    }
+
+    x_timer_start(&timer);
+    ldk_scenegraph_update(0.0f);
+    s_bench_sample(state, BENCH_OP_SCENEGRAPH_UPDATE, &timer, n);
+  }
+
+  // Mostly static world, reported per entity of the whole world
+  for (pass = 0; pass < BENCH_PASSES; ++pass)
+  {
+    Vec3 root_position;
+
+    root_position.x = (float)pass;
+    root_position.y = 1.0f;
+    root_position.z = 0.0f;
+
+    for (i = (pass % BENCH_SPARSE_STRIDE) * BENCH_HIERARCHY_WIDTH; i < n; i += BENCH_HIERARCHY_WIDTH * BENCH_SPARSE_STRIDE)
+    {
+      ldk_transform_set_local_position(state->entities[i], root_position);
+    }
+
+    x_timer_start(&timer);
+    ldk_scenegraph_update(0.0f);
+    s_bench_sample(state, BENCH_OP_SCENEGRAPH_SPARSE, &timer, n);
+  }
+
+  for (begin = 0; begin < n; begin += BENCH_CHUNK_SIZE)
+  {
+    u32 end = begin + BENCH_CHUNK_SIZE < n ? begin + BENCH_CHUNK_SIZE : n;
+
+    x_timer_start(&timer);
+    for (i = begin; i < end; ++i)
+    {
+      ldk_ecs_component_remove(state->entities[state->order[i]], BENCH_COMPONENT_POSITION);
+    }
+    s_bench_sample(state, BENCH_OP_COMPONENT_REMOVE, &timer, end - begin);
+  }
+
+  // Destruction is deferred, each chunk is marked and swept
+  s_bench_shuffle(state);
+
+  for (begin = 0; begin < n; begin += BENCH_CHUNK_SIZE)
+  {
+    u32 end = begin + BENCH_CHUNK_SIZE < n ? begin + BENCH_CHUNK_SIZE : n;
+
+    x_timer_start(&timer);
+    for (i = begin; i < end; ++i)
+    {
+      ldk_ecs_entity_destroy(state->entities[state->order[i]]);
+    }
+    ldk_ecs_entity_destroy_flush();
+    s_bench_sample(state, BENCH_OP_ENTITY_DESTROY, &timer, end - begin);
+  }
+
+  (void)sink;
+  ldk_ecs_world_bind(previous);
+  ldk_ecs_world_destroy(world);
+  return true;
+}
+
+static void s_bench_usage(void)
+{
+  fprintf(stderr, "usage: bench_ecs [--csv] [--runs N] [--max-entities N]\n");
+}
+
+int main(int argc, char** argv)
+{
+  BenchState state;
+  u32 runs = BENCH_DEFAULT_RUNS;
+  u32 max_entities = UINT32_MAX;
+  bool csv = false;
+  bool first = true;
+  bool result = true;
+  u32 size = 0;
+  u32 run = 0;
+  u32 op = 0;
+  int i = 0;
+
+  for (i = 1; i < argc; ++i)
+  {
+    if (strcmp(argv[i], "--csv") == 0)
+    {
+      csv = true;
+    }
+    else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+    {
+      runs = (u32)strtoul(argv[++i], NULL, 10);
+    }
+    else if (strcmp(argv[i], "--max-entities") == 0 && i + 1 < argc)
+    {
+      max_entities = (u32)strtoul(argv[++i], NULL, 10);
+    }
+    else
+    {
+      s_bench_usage();
+      return 1;
+    }
+  }
+
+  if (runs == 0)
+  {
+    s_bench_usage();
+    return 1;
+  }
+
+  memset(&state, 0, sizeof(state));
+  for (op = 0; op < BENCH_OP_COUNT; ++op)
+  {
+    state.samples[op] = x_array_create(sizeof(double), 1024);
+  }
+
+  if (csv)
+  {
+    printf("name,entities,samples,median_ns,p99_ns\n");
+  }
+  else
+  {
+    printf("{\n  \"benchmark\": \"ecs\",\n  \"unit\": \"ns/entity\",\n  \"runs\": %u,\n  \"results\": [\n", runs);
+  }
+
+  for (size = 0; size < sizeof(s_bench_sizes) / sizeof(s_bench_sizes[0]) && result; ++size)
+  {
+    if (s_bench_sizes[size] > max_entities)
+    {
+      break;
+    }
+
+    state.count = s_bench_sizes[size];
+    state.seed = 0x9E3779B9u;
+    state.entities = (LDKEntity*)malloc(sizeof(LDKEntity) * state.count);
+    state.order = (u32*)malloc(sizeof(u32) * state.count);
+    if (!state.entities || !state.order)
+    {
+      result = false;
+    }
+
+    for (run = 0; run < runs && result; ++run)
+    {
+      result = s_bench_run(&state);
+    }
+
+    if (result)
+    {
+      s_bench_report(&state, csv, &first);
+    }
+
+    free(state.entities);
+    free(state.order);
+  }
+
+  if (!csv)
+  {
+    printf("\n  ]\n}\n");
+  }
+
+  for (op = 0; op < BENCH_OP_COUNT; ++op)
+  {
+    x_array_destroy(state.samples[op]);
+  }
+
+  if (!result)
+  {
+    fprintf(stderr, "bench_ecs: failed to set up a world of %u entities\n", state.count);
+    return 1;
+  }
+
+  return 0;
+}
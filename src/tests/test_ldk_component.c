@@ -6,6 +6,7 @@
 #include <ldk.h>
 #include <module/ldk_entity.h>
 #include <module/ldk_component.h>
+#include <module/ldk_jobs.h>
 #include <stdx/stdx_log.h>
 
 #define X_IMPL_TEST
@@ -549,12 +550,901 @@ int test_component_registry_remove_all(void)
   return 0;
 }
 
+int test_component_archetype_add_moves_entity_between_archetypes(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKComponentDesc desc_a = *s_component_a_desc();
+  LDKComponentDesc desc_b = *s_component_b_desc();
+  LDKEntity entity_1;
+  LDKEntity entity_2;
+  TestComponentA initial_a;
+  TestComponentA* component_a = NULL;
+  TestComponentB* component_b = NULL;
+  const LDKEntityInfo* info_1 = NULL;
+  const LDKEntityInfo* info_2 = NULL;
+  u32 archetype_a = 0;
+
+  desc_a.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+  desc_b.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+  initial_a.value = 5;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_a));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_b));
+  ASSERT_TRUE(ldk_component_store_get(&component_registry, TEST_COMPONENT_A) == NULL);
+
+  entity_1 = ldk_entity_create(&entity_registry);
+  entity_2 = ldk_entity_create(&entity_registry);
+
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_A, &initial_a) != NULL);
+  initial_a.value = 6;
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity_2, TEST_COMPONENT_A, &initial_a) != NULL);
+
+  info_1 = ldk_entity_info_get(&entity_registry, entity_1);
+  info_2 = ldk_entity_info_get(&entity_registry, entity_2);
+  archetype_a = info_1->archetype;
+  ASSERT_TRUE(info_2->archetype == archetype_a);
+  ASSERT_TRUE(info_1->archetype_row == 0);
+  ASSERT_TRUE(info_2->archetype_row == 1);
+
+  // Adding B moves entity_1 out, entity_2 is swapped into row 0
+  component_b = (TestComponentB*)ldk_entity_component_add(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_B, NULL);
+  ASSERT_TRUE(component_b != NULL);
+  component_b->value = 9;
+
+  ASSERT_TRUE(info_1->archetype != archetype_a);
+  ASSERT_TRUE(info_2->archetype_row == 0);
+
+  component_a = (TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_A);
+  ASSERT_TRUE(component_a != NULL && component_a->value == 5);
+  component_a = (TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entity_2, TEST_COMPONENT_A);
+  ASSERT_TRUE(component_a != NULL && component_a->value == 6);
+
+  // Removing B moves entity_1 back to the A archetype, keeping its data
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_B));
+  ASSERT_TRUE(info_1->archetype == archetype_a);
+  ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, entity_1, TEST_COMPONENT_B));
+  component_a = (TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_A);
+  ASSERT_TRUE(component_a != NULL && component_a->value == 5);
+
+  ldk_component_registry_remove_all(&component_registry, &entity_registry, entity_2);
+  ASSERT_TRUE(info_2->archetype == LDK_ARCHETYPE_NONE);
+  ASSERT_TRUE(info_1->archetype_row == 0);
+  ASSERT_TRUE(ldk_archetype_get(&component_registry.archetypes, archetype_a)->entity_count == 1);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_archetype_chunk_iteration(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKComponentDesc desc_a = *s_component_a_desc();
+  LDKArchetype* archetype = NULL;
+  u32 archetype_id = 0;
+  u32 chunk_index = 0;
+  u32 column = 0;
+  int sum = 0;
+  u32 seen = 0;
+  int i = 0;
+  const int count = 5000;
+
+  desc_a.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 1024, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_a));
+
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA value;
+    LDKEntity entity = ldk_entity_create(&entity_registry);
+
+    value.value = i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, TEST_COMPONENT_A, &value) != NULL);
+    archetype_id = ldk_entity_info_get(&entity_registry, entity)->archetype;
+  }
+
+  archetype = ldk_archetype_get(ldk_component_archetypes_get(&component_registry), archetype_id);
+  ASSERT_TRUE(archetype != NULL);
+  ASSERT_TRUE(archetype->entity_count == (u32)count);
+  ASSERT_TRUE(ldk_archetype_chunk_count(archetype) > 1);
+
+  column = ldk_archetype_column_find(archetype, TEST_COMPONENT_A);
+  ASSERT_TRUE(column != LDK_ENTITY_INVALID_COMPONENT_INDEX);
+
+  for (chunk_index = 0; chunk_index < ldk_archetype_chunk_count(archetype); ++chunk_index)
+  {
+    LDKArchetypeChunk* chunk = ldk_archetype_chunk_get(archetype, chunk_index);
+    TestComponentA* values = (TestComponentA*)ldk_archetype_chunk_column(archetype, chunk, column);
+    u32 row = 0;
+
+    for (row = 0; row < chunk->count; ++row)
+    {
+      sum += values[row].value;
+      seen++;
+    }
+  }
+
+  ASSERT_TRUE(seen == (u32)count);
+  ASSERT_TRUE(sum == (count - 1) * count / 2);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_slots_are_dense_for_any_type_id(void)
+{
+  LDKComponentRegistry registry;
+  LDKComponentDesc desc_large = *s_component_b_desc();
+  LDKComponentDesc desc_builtin = *s_component_b_desc();
+  TestComponentA* component = NULL;
+
+  desc_large.type = 0x12345678;
+  desc_builtin.type = UINT32_MAX - 5;
+
+  ASSERT_TRUE(ldk_component_registry_initialize(&registry));
+  ASSERT_TRUE(ldk_component_register(&registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&registry, &desc_large));
+  ASSERT_TRUE(ldk_component_register(&registry, &desc_builtin));
+  ASSERT_TRUE(!ldk_component_register(&registry, &desc_large));
+
+  ASSERT_TRUE(ldk_component_slot_count(&registry) == 3);
+  ASSERT_TRUE(ldk_component_slot_get(&registry, TEST_COMPONENT_A) == 0);
+  ASSERT_TRUE(ldk_component_slot_get(&registry, 0x12345678) == 1);
+  ASSERT_TRUE(ldk_component_slot_get(&registry, UINT32_MAX - 5) == 2);
+  ASSERT_TRUE(ldk_component_slot_get(&registry, 999) == LDK_COMPONENT_INVALID_SLOT);
+  ASSERT_TRUE(ldk_component_slot_get(&registry, UINT32_MAX - 6) == LDK_COMPONENT_INVALID_SLOT);
+
+  ASSERT_TRUE(ldk_component_store_get_by_slot(&registry, 1) == ldk_component_store_get(&registry, 0x12345678));
+  ASSERT_TRUE(ldk_component_entry_get(&registry, 2)->desc.type == UINT32_MAX - 5);
+
+  {
+    u32 index = 0;
+    component = (TestComponentA*)ldk_component_create(&registry, TEST_COMPONENT_A, &index);
+    ASSERT_TRUE(component != NULL);
+    ASSERT_TRUE(ldk_component_get_by_slot(&registry, 0, index) == component);
+  }
+
+  ldk_component_registry_terminate(&registry);
+  return 0;
+}
+
+typedef struct TestForeachState
+{
+  LDKEntityRegistry* entity_registry;
+  volatile i32 visited;
+  volatile i32 bad_owners;
+} TestForeachState;
+
+static void test_component_foreach_double(void* user, void* components, const LDKEntity* owners, u32 count, u32 worker_index)
+{
+  TestForeachState* state = (TestForeachState*)user;
+  TestComponentA* values = (TestComponentA*)components;
+  u32 i = 0;
+
+  for (i = 0; i < count; ++i)
+  {
+    values[i].value *= 2;
+
+    if (!ldk_entity_is_alive(state->entity_registry, owners[i]))
+    {
+      ldk_os_atomic_add_i32(&state->bad_owners, 1);
+    }
+  }
+
+  ldk_os_atomic_add_i32(&state->visited, (i32)count);
+}
+
+int test_component_foreach_parallel(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKJobSystem jobs;
+  LDKComponentDesc archetype_desc = *s_component_b_desc();
+  TestForeachState state;
+  XArray* store = NULL;
+  const i32 count = 10000;
+  i32 i = 0;
+
+  archetype_desc.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 1024, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &archetype_desc));
+  ASSERT_TRUE(ldk_jobs_initialize(&jobs, 4));
+
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA value;
+    LDKEntity entity = ldk_entity_create(&entity_registry);
+
+    value.value = i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, TEST_COMPONENT_A, &value) != NULL);
+  }
+
+  memset(&state, 0, sizeof(state));
+  state.entity_registry = &entity_registry;
+
+  ASSERT_TRUE(ldk_component_foreach_parallel(&component_registry, &jobs, TEST_COMPONENT_A, test_component_foreach_double, &state, 0));
+  ASSERT_TRUE(ldk_component_foreach_parallel(&component_registry, NULL, TEST_COMPONENT_A, test_component_foreach_double, &state, 0));
+  ASSERT_TRUE(state.visited == count * 2);
+  ASSERT_TRUE(state.bad_owners == 0);
+
+  store = ldk_component_store_get(&component_registry, TEST_COMPONENT_A);
+  for (i = 0; i < count; ++i)
+  {
+    ASSERT_TRUE(((TestComponentA*)x_array_get(store, i))->value == i * 4);
+  }
+
+  // Archetype components have no packed store
+  ASSERT_TRUE(!ldk_component_foreach_parallel(&component_registry, &jobs, TEST_COMPONENT_B, test_component_foreach_double, &state, 0));
+
+  ldk_jobs_terminate(&jobs);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_enable_disable(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKEntity entities[100];
+  const u32 types[] = { TEST_COMPONENT_A };
+  TestForeachState state;
+  LDKQuery query;
+  LDKQueryIter iter;
+  LDKQueryBatch batch;
+  u32 disabled = 0;
+  u32 seen = 0;
+  i32 i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 128, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+
+  for (i = 0; i < 100; ++i)
+  {
+    TestComponentA value;
+
+    value.value = i;
+    entities[i] = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &value) != NULL);
+    ASSERT_TRUE(ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A));
+
+    if (i % 3 == 0)
+    {
+      ASSERT_TRUE(ldk_entity_component_enabled_set(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, false));
+      disabled++;
+    }
+  }
+
+  ASSERT_TRUE(!ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[3], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_entity_component_get(&entity_registry, &component_registry, entities[3], TEST_COMPONENT_A) != NULL);
+  ASSERT_TRUE(ldk_component_entry_get(&component_registry, 0)->disabled_count == disabled);
+
+  // Disabled components are skipped without being moved
+  memset(&state, 0, sizeof(state));
+  state.entity_registry = &entity_registry;
+  ASSERT_TRUE(ldk_component_foreach_parallel(&component_registry, NULL, TEST_COMPONENT_A, test_component_foreach_double, &state, 0));
+  ASSERT_TRUE(state.visited == (i32)(100 - disabled));
+  ASSERT_TRUE(((TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entities[3], TEST_COMPONENT_A))->value == 3);
+  ASSERT_TRUE(((TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entities[4], TEST_COMPONENT_A))->value == 8);
+
+  query = ldk_query_create(&entity_registry, &component_registry, types, 1);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 100);
+  iter = ldk_query_iter_begin(&entity_registry, &component_registry, query);
+
+  while (ldk_query_iter_next(&iter, &batch))
+  {
+    u32 j = 0;
+
+    for (j = 0; j < batch.count; ++j)
+    {
+      ASSERT_TRUE(ldk_entity_component_is_enabled(&entity_registry, &component_registry, batch.entities[j], TEST_COMPONENT_A));
+      seen++;
+    }
+  }
+
+  ASSERT_TRUE(seen == 100 - disabled);
+
+  // The disabled bit follows the last component (entity 99) when it fills a removed index
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[1], TEST_COMPONENT_A));
+  ASSERT_TRUE(!ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[99], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[2], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_component_entry_get(&component_registry, 0)->disabled_count == disabled);
+
+  // Removing a disabled component drops its bit
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[0], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[98], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_component_entry_get(&component_registry, 0)->disabled_count == disabled - 1);
+
+  ASSERT_TRUE(ldk_entity_component_enabled_set(&entity_registry, &component_registry, entities[99], TEST_COMPONENT_A, true));
+  ASSERT_TRUE(ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[99], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_component_entry_get(&component_registry, 0)->disabled_count == disabled - 2);
+
+  ldk_query_destroy(&component_registry, query);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+static bool s_owners_sorted_by_index(LDKComponentRegistry* registry, u32 type)
+{
+  XArray* owners = ldk_component_owners_get(registry, type);
+  u32 i = 0;
+
+  for (i = 1; i < x_array_count(owners); ++i)
+  {
+    if (((LDKEntity*)x_array_get(owners, i - 1))->index > ((LDKEntity*)x_array_get(owners, i))->index)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int test_component_sort_incremental(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKComponentSortDesc desc = {0};
+  LDKComponentSort sort;
+  LDKEntity entities[200];
+  XArray* owners_a = NULL;
+  XArray* owners_b = NULL;
+  u32 steps = 0;
+  i32 i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 256, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+
+  // Add in reverse so the store order is the opposite of the entity order
+  for (i = 0; i < 200; ++i)
+  {
+    entities[i] = ldk_entity_create(&entity_registry);
+  }
+
+  for (i = 199; i >= 0; --i)
+  {
+    TestComponentA value;
+    value.value = i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &value) != NULL);
+  }
+
+  ASSERT_TRUE(ldk_entity_component_enabled_set(&entity_registry, &component_registry, entities[5], TEST_COMPONENT_A, false));
+
+  desc.component_type = TEST_COMPONENT_A;
+  desc.key = LDK_COMPONENT_SORT_ENTITY_INDEX;
+  ASSERT_TRUE(ldk_component_sort_initialize(&component_registry, &sort, &desc));
+
+  ASSERT_TRUE(ldk_component_sort_step(&component_registry, &entity_registry, &sort, 7) == 7);
+
+  // A structural change in the middle of a pass restarts it
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[0], TEST_COMPONENT_A));
+
+  while (ldk_component_sort_step(&component_registry, &entity_registry, &sort, 7) > 0)
+  {
+    steps++;
+  }
+
+  ASSERT_TRUE(steps > 1);
+  ASSERT_TRUE(s_owners_sorted_by_index(&component_registry, TEST_COMPONENT_A));
+
+  // Directory indices, data and disabled bits follow the components
+  for (i = 1; i < 200; ++i)
+  {
+    TestComponentA* value = (TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A);
+    ASSERT_TRUE(value != NULL && value->value == i);
+    ASSERT_TRUE(ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A) == (i != 5));
+  }
+
+  ASSERT_TRUE(ldk_component_sort_step(&component_registry, &entity_registry, &sort, 7) == 0);
+  ASSERT_TRUE(!sort.failed);
+  ldk_component_sort_terminate(&sort);
+
+  // B follows the order of A
+  for (i = 0; i < 200; i += 2)
+  {
+    TestComponentB value;
+    value.value = i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[199 - i], TEST_COMPONENT_B, &value) != NULL);
+  }
+
+  desc.component_type = TEST_COMPONENT_B;
+  desc.key = LDK_COMPONENT_SORT_COMPONENT_ORDER;
+  desc.order_type = TEST_COMPONENT_A;
+  ASSERT_TRUE(ldk_component_sort(&component_registry, &entity_registry, &desc));
+
+  owners_a = ldk_component_owners_get(&component_registry, TEST_COMPONENT_A);
+  owners_b = ldk_component_owners_get(&component_registry, TEST_COMPONENT_B);
+  ASSERT_TRUE(s_owners_sorted_by_index(&component_registry, TEST_COMPONENT_B));
+  ASSERT_TRUE(((LDKEntity*)x_array_get(owners_b, x_array_count(owners_b) - 1))->index == entities[199].index);
+  ASSERT_TRUE(x_array_count(owners_a) == 199);
+
+  for (i = 0; i < 200; i += 2)
+  {
+    TestComponentB* value = (TestComponentB*)ldk_entity_component_get(&entity_registry, &component_registry, entities[199 - i], TEST_COMPONENT_B);
+    ASSERT_TRUE(value != NULL && value->value == i);
+  }
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_sort_rejects_archetype_order(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKComponentDesc desc_a = *s_component_a_desc();
+  LDKComponentSortDesc desc = {0};
+  LDKComponentSort sort;
+  LDKEntity entity;
+
+  desc_a.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_a));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+
+  entity = ldk_entity_create(&entity_registry);
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, TEST_COMPONENT_A, NULL) != NULL);
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, TEST_COMPONENT_B, NULL) != NULL);
+
+  // Archetype rows are not store indices, B can not be ordered by them
+  desc.component_type = TEST_COMPONENT_B;
+  desc.key = LDK_COMPONENT_SORT_COMPONENT_ORDER;
+  desc.order_type = TEST_COMPONENT_A;
+  ASSERT_TRUE(!ldk_component_sort_initialize(&component_registry, &sort, &desc));
+  ASSERT_TRUE(!ldk_component_sort(&component_registry, &entity_registry, &desc));
+
+  // Neither can an archetype type be sorted, nor a type be ordered by an unregistered one
+  desc.component_type = TEST_COMPONENT_A;
+  desc.key = LDK_COMPONENT_SORT_ENTITY_INDEX;
+  ASSERT_TRUE(!ldk_component_sort_initialize(&component_registry, &sort, &desc));
+
+  desc.component_type = TEST_COMPONENT_B;
+  desc.key = LDK_COMPONENT_SORT_COMPONENT_ORDER;
+  desc.order_type = 77;
+  ASSERT_TRUE(!ldk_component_sort_initialize(&component_registry, &sort, &desc));
+
+  desc.key = LDK_COMPONENT_SORT_ENTITY_INDEX;
+  ASSERT_TRUE(ldk_component_sort_initialize(&component_registry, &sort, &desc));
+  ldk_component_sort_terminate(&sort);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_snapshot_restore(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKEntitySnapshot entity_snapshot;
+  LDKComponentSnapshot component_snapshot;
+  LDKComponentDesc desc_c = *s_component_b_desc();
+  LDKComponentDesc desc_extra = *s_component_b_desc();
+  LDKEntity entities[50];
+  LDKEntity created[20];
+  const u32 types[] = { TEST_COMPONENT_A, TEST_COMPONENT_B };
+  LDKQuery query;
+  i32 i = 0;
+
+  memset(&entity_snapshot, 0, sizeof(entity_snapshot));
+  memset(&component_snapshot, 0, sizeof(component_snapshot));
+  desc_c.type = 3;
+  desc_c.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 64, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_c));
+
+  // Enough types to push entities[0] past its inline component directory
+  for (i = 0; i < 10; ++i)
+  {
+    desc_extra.type = 10 + i;
+    ASSERT_TRUE(ldk_component_register(&component_registry, &desc_extra));
+  }
+
+  for (i = 0; i < 50; ++i)
+  {
+    TestComponentA value;
+
+    value.value = i;
+    entities[i] = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &value) != NULL);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], 3, &value) != NULL);
+
+    if (i % 2 == 0)
+    {
+      ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B, &value) != NULL);
+    }
+  }
+
+  for (i = 0; i < 10; ++i)
+  {
+    TestComponentB value;
+
+    value.value = 100 + i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[0], 10 + i, &value) != NULL);
+  }
+
+  query = ldk_query_create(&entity_registry, &component_registry, types, 2);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 25);
+
+  ASSERT_TRUE(ldk_entity_snapshot_capture(&entity_registry, &entity_snapshot));
+  ASSERT_TRUE(ldk_component_snapshot_capture(&component_registry, &component_snapshot));
+
+  // Change the world in every way the snapshot has to undo
+  ldk_component_registry_remove_all(&component_registry, &entity_registry, entities[2]);
+  ldk_entity_destroy(&entity_registry, entities[2]);
+
+  for (i = 0; i < 20; ++i)
+  {
+    TestComponentA value;
+
+    value.value = -i;
+    created[i] = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, created[i], TEST_COMPONENT_A, &value) != NULL);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, created[i], TEST_COMPONENT_B, &value) != NULL);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, created[i], 3, &value) != NULL);
+  }
+
+  ((TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entities[4], TEST_COMPONENT_A))->value = 1000;
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[6], TEST_COMPONENT_B));
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[1], 3));
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[0], 15));
+  ASSERT_TRUE(ldk_entity_component_enabled_set(&entity_registry, &component_registry, entities[8], TEST_COMPONENT_A, false));
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 25 - 2 + 20);
+
+  ASSERT_TRUE(ldk_entity_snapshot_restore(&entity_registry, &entity_snapshot));
+  ASSERT_TRUE(ldk_component_snapshot_restore(&component_registry, &entity_registry, &component_snapshot));
+
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 50);
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&component_registry, TEST_COMPONENT_A)) == 50);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 25);
+  ASSERT_TRUE(ldk_component_entry_get(&component_registry, 0)->disabled_count == 0);
+
+  for (i = 0; i < 20; ++i)
+  {
+    ASSERT_TRUE(!ldk_entity_is_alive(&entity_registry, created[i]));
+  }
+
+  for (i = 0; i < 50; ++i)
+  {
+    const TestComponentA* a = (const TestComponentA*)ldk_entity_component_get_const(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A);
+    const TestComponentB* c = (const TestComponentB*)ldk_entity_component_get_const(&entity_registry, &component_registry, entities[i], 3);
+
+    ASSERT_TRUE(ldk_entity_is_alive(&entity_registry, entities[i]));
+    ASSERT_TRUE(a != NULL && a->value == i);
+    ASSERT_TRUE(c != NULL && c->value == i);
+    ASSERT_TRUE(ldk_entity_component_has(&entity_registry, entities[i], TEST_COMPONENT_B) == (i % 2 == 0));
+    ASSERT_TRUE(ldk_entity_component_is_enabled(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A));
+  }
+
+  ASSERT_TRUE(ldk_entity_component_count(&entity_registry, entities[0]) == 13);
+
+  for (i = 0; i < 10; ++i)
+  {
+    const TestComponentB* extra = (const TestComponentB*)ldk_entity_component_get_const(&entity_registry, &component_registry, entities[0], 10 + i);
+    ASSERT_TRUE(extra != NULL && extra->value == 100 + i);
+  }
+
+  // The restored world keeps working
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[0], TEST_COMPONENT_B));
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 24);
+  ASSERT_TRUE(!ldk_entity_is_alive(&entity_registry, created[0]));
+  ASSERT_TRUE(ldk_entity_is_alive(&entity_registry, ldk_entity_create(&entity_registry)));
+
+  ldk_component_snapshot_release(&component_snapshot);
+  ldk_entity_snapshot_release(&entity_snapshot);
+  ldk_query_destroy(&component_registry, query);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_snapshot_restore_archetype_growth(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKEntitySnapshot entity_snapshot;
+  LDKComponentSnapshot component_snapshot;
+  LDKComponentDesc desc_c = *s_component_b_desc();
+  LDKComponentDesc desc_d = *s_component_b_desc();
+  LDKArchetypeTable* archetypes = NULL;
+  LDKEntity kept;
+  LDKEntity removed;
+  u32 archetype_c = 0;
+  u32 archetype_d = 0;
+  i32 i = 0;
+
+  memset(&entity_snapshot, 0, sizeof(entity_snapshot));
+  memset(&component_snapshot, 0, sizeof(component_snapshot));
+  desc_c.type = 3;
+  desc_c.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+  desc_d.type = 4;
+  desc_d.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 1024, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_c));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_d));
+  archetypes = ldk_component_archetypes_get(&component_registry);
+
+  // One entity in the C archetype and an empty D archetype
+  kept = ldk_entity_create(&entity_registry);
+  removed = ldk_entity_create(&entity_registry);
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, kept, 3, &i) != NULL);
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, removed, 4, &i) != NULL);
+  archetype_c = ldk_entity_info_get(&entity_registry, kept)->archetype;
+  archetype_d = ldk_entity_info_get(&entity_registry, removed)->archetype;
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, removed, 4));
+  ASSERT_TRUE(ldk_archetype_get(archetypes, archetype_d)->entity_count == 0);
+
+  ASSERT_TRUE(ldk_entity_snapshot_capture(&entity_registry, &entity_snapshot));
+  ASSERT_TRUE(ldk_component_snapshot_capture(&component_registry, &component_snapshot));
+
+  // Grow C past one chunk and give D chunks it did not have at capture
+  for (i = 0; i < 5000; ++i)
+  {
+    LDKEntity entity = ldk_entity_create(&entity_registry);
+
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, (i % 4) ? 3 : 4, &i) != NULL);
+  }
+
+  ASSERT_TRUE(ldk_archetype_chunk_count(ldk_archetype_get(archetypes, archetype_c)) > 1);
+  ASSERT_TRUE(ldk_archetype_chunk_count(ldk_archetype_get(archetypes, archetype_d)) > 0);
+
+  ASSERT_TRUE(ldk_entity_snapshot_restore(&entity_registry, &entity_snapshot));
+  ASSERT_TRUE(ldk_component_snapshot_restore(&component_registry, &entity_registry, &component_snapshot));
+
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 2);
+  ASSERT_TRUE(ldk_archetype_get(archetypes, archetype_c)->entity_count == 1);
+  ASSERT_TRUE(ldk_archetype_chunk_count(ldk_archetype_get(archetypes, archetype_c)) == 1);
+  ASSERT_TRUE(ldk_archetype_get(archetypes, archetype_d)->entity_count == 0);
+  ASSERT_TRUE(ldk_archetype_chunk_count(ldk_archetype_get(archetypes, archetype_d)) == 0);
+  ASSERT_TRUE(((const TestComponentB*)ldk_entity_component_get_const(&entity_registry, &component_registry, kept, 3))->value == 0);
+
+  // The emptied chunks are reused
+  for (i = 0; i < 2000; ++i)
+  {
+    LDKEntity entity = ldk_entity_create(&entity_registry);
+
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, 3, &i) != NULL);
+  }
+
+  ASSERT_TRUE(ldk_archetype_get(archetypes, archetype_c)->entity_count == 2001);
+  ASSERT_TRUE(((const TestComponentB*)ldk_entity_component_get_const(&entity_registry, &component_registry, kept, 3))->value == 0);
+
+  ldk_component_snapshot_release(&component_snapshot);
+  ldk_entity_snapshot_release(&entity_snapshot);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_paged_stable_addresses(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKJobSystem jobs;
+  LDKComponentDesc paged_desc = *s_component_a_desc();
+  LDKEntity entities[3 * LDK_COMPONENT_PAGE_CAPACITY];
+  TestComponentA* components[3 * LDK_COMPONENT_PAGE_CAPACITY];
+  const u32 count = 3 * LDK_COMPONENT_PAGE_CAPACITY;
+  TestForeachState state;
+  LDKQuery query;
+  LDKQueryIter iter;
+  LDKQueryBatch batch;
+  u32 type = TEST_COMPONENT_A;
+  u32 visited = 0;
+  u32 i = 0;
+
+  paged_desc.storage = LDK_COMPONENT_STORAGE_PAGED;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 1024, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &paged_desc));
+  ASSERT_TRUE(ldk_jobs_initialize(&jobs, 4));
+  ASSERT_TRUE(ldk_component_create_batch(&component_registry, TEST_COMPONENT_A, 4, &i) == NULL);
+
+  // Grow past several pages while holding on to every pointer
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA value;
+
+    value.value = (int)i;
+    entities[i] = ldk_entity_create(&entity_registry);
+    components[i] = (TestComponentA*)ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &value);
+    ASSERT_TRUE(components[i] != NULL);
+  }
+
+  // Removing every third component moves pointers in the store, not data
+  for (i = 0; i < count; i += 3)
+  {
+    ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A));
+  }
+
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&component_registry, TEST_COMPONENT_A)) == count - count / 3);
+
+  for (i = 0; i < count; ++i)
+  {
+    void* current = ldk_entity_component_get(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A);
+
+    if (i % 3 == 0)
+    {
+      ASSERT_TRUE(current == NULL);
+    }
+    else
+    {
+      ASSERT_TRUE(current == components[i]);
+      ASSERT_TRUE(components[i]->value == (int)i);
+    }
+  }
+
+  // Released components are reused before a new page is allocated
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[0], TEST_COMPONENT_A, NULL) != NULL);
+  ASSERT_TRUE(x_array_count(ldk_component_entry_get(&component_registry, 0)->pages) == 3);
+  ASSERT_TRUE(((TestComponentA*)ldk_entity_component_get(&entity_registry, &component_registry, entities[0], TEST_COMPONENT_A))->value == 0);
+
+  // Queries and parallel iteration go through the store pointers
+  query = ldk_query_create(&entity_registry, &component_registry, &type, 1);
+  iter = ldk_query_iter_begin(&entity_registry, &component_registry, query);
+  while (ldk_query_iter_next(&iter, &batch))
+  {
+    for (i = 0; i < batch.count; ++i)
+    {
+      ASSERT_TRUE(batch.components[0][i] == ldk_entity_component_get(&entity_registry, &component_registry, batch.entities[i], TEST_COMPONENT_A));
+    }
+    visited += batch.count;
+  }
+  ASSERT_TRUE(visited == count - count / 3 + 1);
+
+  ASSERT_TRUE(ldk_entity_component_enabled_set(&entity_registry, &component_registry, entities[1], TEST_COMPONENT_A, false));
+  memset(&state, 0, sizeof(state));
+  state.entity_registry = &entity_registry;
+  ASSERT_TRUE(ldk_component_foreach_parallel(&component_registry, &jobs, TEST_COMPONENT_A, test_component_foreach_double, &state, 16));
+  ASSERT_TRUE(state.visited == (i32)visited - 1);
+  ASSERT_TRUE(state.bad_owners == 0);
+  ASSERT_TRUE(components[1]->value == 1);
+  ASSERT_TRUE(components[2]->value == 4);
+  ASSERT_TRUE(components[count - 1]->value == (int)(count - 1) * 2);
+
+  ldk_query_destroy(&component_registry, query);
+  ldk_jobs_terminate(&jobs);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_component_snapshot_restore_paged_keeps_addresses(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKEntitySnapshot entity_snapshot;
+  LDKComponentSnapshot component_snapshot;
+  LDKComponentDesc paged_desc = *s_component_a_desc();
+  LDKEntity entities[2 * LDK_COMPONENT_PAGE_CAPACITY];
+  TestComponentA* components[2 * LDK_COMPONENT_PAGE_CAPACITY];
+  const u32 count = 2 * LDK_COMPONENT_PAGE_CAPACITY;
+  TestComponentA* reused = NULL;
+  u32 i = 0;
+  u32 j = 0;
+
+  memset(&entity_snapshot, 0, sizeof(entity_snapshot));
+  memset(&component_snapshot, 0, sizeof(component_snapshot));
+  paged_desc.storage = LDK_COMPONENT_STORAGE_PAGED;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 1024, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &paged_desc));
+
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA value;
+
+    value.value = (int)i;
+    entities[i] = ldk_entity_create(&entity_registry);
+    components[i] = (TestComponentA*)ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &value);
+    ASSERT_TRUE(components[i] != NULL);
+  }
+
+  // Leave holes so the free list differs from the page order
+  for (i = 0; i < count; i += 3)
+  {
+    ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A));
+  }
+
+  ASSERT_TRUE(ldk_entity_snapshot_capture(&entity_registry, &entity_snapshot));
+  ASSERT_TRUE(ldk_component_snapshot_capture(&component_registry, &component_snapshot));
+
+  // Overwrite, remove and grow a new page after the capture
+  for (i = 0; i < count; ++i)
+  {
+    if (i % 3 == 1)
+    {
+      ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A));
+    }
+    else if (i % 3 == 2)
+    {
+      components[i]->value = -1;
+    }
+  }
+
+  for (i = 0; i < count; ++i)
+  {
+    LDKEntity entity = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, TEST_COMPONENT_A, NULL) != NULL);
+  }
+
+  ASSERT_TRUE(x_array_count(ldk_component_entry_get(&component_registry, 0)->pages) == 3);
+  ASSERT_TRUE(ldk_entity_snapshot_restore(&entity_registry, &entity_snapshot));
+  ASSERT_TRUE(ldk_component_snapshot_restore(&component_registry, &entity_registry, &component_snapshot));
+
+  // Every component alive at capture is back at its captured address
+  for (i = 0; i < count; ++i)
+  {
+    void* current = ldk_entity_component_get(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A);
+
+    if (i % 3 == 0)
+    {
+      ASSERT_TRUE(current == NULL);
+    }
+    else
+    {
+      ASSERT_TRUE(current == components[i]);
+      ASSERT_TRUE(components[i]->value == (int)i);
+    }
+  }
+
+  // Slots left free by the capture are handed out again, never a live one
+  for (i = 0; i < count; i += 3)
+  {
+    reused = (TestComponentA*)ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, NULL);
+    ASSERT_TRUE(reused != NULL);
+    ASSERT_TRUE(reused->value == 0);
+
+    for (j = 0; j < count; ++j)
+    {
+      ASSERT_TRUE(j % 3 == 0 || reused != components[j]);
+    }
+  }
+
+  for (i = 1; i < count; i += 3)
+  {
+    ASSERT_TRUE(components[i]->value == (int)i);
+  }
+
+  ldk_entity_snapshot_release(&entity_snapshot);
+  ldk_component_snapshot_release(&component_snapshot);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
 int main(void)
 {
   STDXTestCase tests[] =
   {
     X_TEST(test_component_register_and_get_store),
     X_TEST(test_component_duplicate_registration_fails),
+    X_TEST(test_component_slots_are_dense_for_any_type_id),
     X_TEST(test_component_add_with_null_callbacks_and_initial_value_copies_component),
     X_TEST(test_component_add_calls_attach_callback_after_copying_initial_value),
     X_TEST(test_component_add_rolls_back_when_attach_fails),
@@ -562,6 +1452,16 @@ int main(void)
     X_TEST(test_component_remove_calls_destroy_callback),
     X_TEST(test_component_remove_entity_updates_moved_owner_ref),
     X_TEST(test_component_registry_remove_all),
+    X_TEST(test_component_archetype_add_moves_entity_between_archetypes),
+    X_TEST(test_component_archetype_chunk_iteration),
+    X_TEST(test_component_foreach_parallel),
+    X_TEST(test_component_enable_disable),
+    X_TEST(test_component_sort_incremental),
+    X_TEST(test_component_sort_rejects_archetype_order),
+    X_TEST(test_component_snapshot_restore),
+    X_TEST(test_component_snapshot_restore_archetype_growth),
+    X_TEST(test_component_paged_stable_addresses),
+    X_TEST(test_component_snapshot_restore_paged_keeps_addresses),
   };
 
   return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
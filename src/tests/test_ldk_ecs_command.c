@@ -0,0 +1,172 @@
+#if defined(LDK_SHAREDLIB)
+#define X_IMPL_ARRAY
+#define X_IMPL_LOG
+#endif // LDK_SHAREDLIB
+
+#include <ldk.h>
+#include <module/ldk_ecs.h>
+#include <module/ldk_ecs_command.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_log.h>
+
+#define X_IMPL_TEST
+#include <stdx/stdx_test.h>
+
+typedef struct TestComponentA
+{
+  int value;
+} TestComponentA;
+
+enum
+{
+  TEST_COMPONENT_A = 1
+};
+
+static const LDKComponentDesc* s_component_a_desc()
+{
+  static LDKComponentDesc component_a = {
+    .name = "TestComponentA",
+    .type = TEST_COMPONENT_A,
+    .entry_size = sizeof(TestComponentA),
+    .initial_capacity = 8,
+    .attach = NULL,
+    .destroy = NULL,
+    .user = NULL
+  };
+  return &component_a;
+}
+
+static void s_ecs_terminate(LDKECS* ecs)
+{
+  u32 i = 0;
+
+  for (i = 0; i < LDK_ECS_COMMAND_BUFFER_COUNT; ++i)
+  {
+    ldk_ecs_command_buffer_terminate(&ecs->commands[i]);
+  }
+
+  ldk_system_registry_terminate(&ecs->system);
+  ldk_component_registry_terminate(&ecs->component);
+  ldk_entity_module_terminate(&ecs->entity);
+}
+
+static bool s_ecs_playback(LDKECS* ecs)
+{
+  bool result = true;
+  u32 i = 0;
+
+  for (i = 0; i < LDK_ECS_COMMAND_BUFFER_COUNT; ++i)
+  {
+    if (ldk_ecs_command_buffer_count(&ecs->commands[i]) > 0 &&
+        !ldk_ecs_command_buffer_playback(&ecs->commands[i], ecs))
+    {
+      result = false;
+    }
+  }
+
+  return result;
+}
+
+int test_ecs_command_playback_applies_in_order(void)
+{
+  static LDKECS ecs;
+  LDKECSCommandBuffer* buffer = NULL;
+  LDKEntity pending;
+  LDKEntity entity;
+  LDKEntityIterator it;
+  TestComponentA a = { 7 };
+  TestComponentA* stored = NULL;
+
+  ASSERT_TRUE(ldk_ecs_initialize(&ecs, 16, 1));
+  ASSERT_TRUE(ldk_component_register(&ecs.component, s_component_a_desc()));
+  buffer = &ecs.commands[0];
+
+  pending = ldk_ecs_command_entity_create(buffer);
+  ASSERT_TRUE(ldk_ecs_command_entity_is_pending(pending));
+  ASSERT_TRUE(ldk_ecs_command_component_add(buffer, pending, TEST_COMPONENT_A, &a));
+
+  // The value is copied on record
+  a.value = 42;
+  ASSERT_TRUE(ldk_ecs_command_component_set(buffer, pending, TEST_COMPONENT_A, &a));
+  a.value = 0;
+
+  // Transforms are managed by the ECS
+  ASSERT_TRUE(!ldk_ecs_command_component_remove(buffer, pending, LDK_COMPONENT_TYPE_TRANSFORM));
+
+  ASSERT_TRUE(ldk_ecs_command_buffer_count(buffer) == 3);
+  ASSERT_TRUE(ldk_entity_alive_count(&ecs.entity) == 0);
+
+  ASSERT_TRUE(s_ecs_playback(&ecs));
+  ASSERT_TRUE(ldk_ecs_command_buffer_count(buffer) == 0);
+  ASSERT_TRUE(ldk_entity_alive_count(&ecs.entity) == 1);
+
+  it = ldk_entity_iterator_begin(&ecs.entity);
+  ASSERT_TRUE(ldk_entity_iterator_next(&it, &entity));
+  ldk_entity_iterator_end(&it);
+
+  ASSERT_TRUE(ldk_entity_component_has(&ecs.entity, entity, LDK_COMPONENT_TYPE_TRANSFORM));
+  stored = (TestComponentA*) ldk_entity_component_get(&ecs.entity, &ecs.component, entity, TEST_COMPONENT_A);
+  ASSERT_TRUE(stored != NULL && stored->value == 42);
+
+  ASSERT_TRUE(ldk_ecs_command_component_remove(buffer, entity, TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_ecs_command_entity_destroy(buffer, entity));
+  ASSERT_TRUE(ldk_entity_component_has(&ecs.entity, entity, TEST_COMPONENT_A));
+
+  // Like a direct destroy the entity is only marked, the end-of-frame sweep removes it
+  ASSERT_TRUE(s_ecs_playback(&ecs));
+  ASSERT_TRUE(ldk_entity_is_alive(&ecs.entity, entity));
+  ASSERT_TRUE(ldk_entity_internal_flags_has(&ecs.entity, entity, LDK_ENTITY_INTERNAL_PENDING_DELETE));
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&ecs.component, TEST_COMPONENT_A)) == 0);
+  ASSERT_TRUE(ldk_entity_destroy_pending(&ecs.entity, &ecs.component) == 1);
+  ASSERT_TRUE(!ldk_entity_is_alive(&ecs.entity, entity));
+
+  s_ecs_terminate(&ecs);
+  return 0;
+}
+
+int test_ecs_command_playback_skips_invalid_commands(void)
+{
+  static LDKECS ecs;
+  LDKECSCommandBuffer* first = NULL;
+  LDKECSCommandBuffer* second = NULL;
+  LDKEntity entity;
+  TestComponentA a = { 1 };
+
+  ASSERT_TRUE(ldk_ecs_initialize(&ecs, 16, 1));
+  ASSERT_TRUE(ldk_component_register(&ecs.component, s_component_a_desc()));
+  first = &ecs.commands[0];
+  second = &ecs.commands[1];
+
+  entity = ldk_entity_create(&ecs.entity);
+  ASSERT_TRUE(ldk_entity_component_add(&ecs.entity, &ecs.component, entity, LDK_COMPONENT_TYPE_TRANSFORM, NULL) != NULL);
+
+  // Buffers are played back in index order: the destroy only marks the entity, the add still lands
+  ASSERT_TRUE(ldk_ecs_command_entity_destroy(first, entity));
+  ASSERT_TRUE(ldk_ecs_command_component_add(second, entity, TEST_COMPONENT_A, &a));
+
+  ASSERT_TRUE(s_ecs_playback(&ecs));
+  ASSERT_TRUE(ldk_entity_component_has(&ecs.entity, entity, TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_entity_destroy_pending(&ecs.entity, &ecs.component) == 1);
+  ASSERT_TRUE(ldk_entity_alive_count(&ecs.entity) == 0);
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&ecs.component, TEST_COMPONENT_A)) == 0);
+
+  // Commands on an entity that is already gone are dropped
+  ASSERT_TRUE(ldk_ecs_command_component_add(second, entity, TEST_COMPONENT_A, &a));
+  ASSERT_TRUE(!s_ecs_playback(&ecs));
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&ecs.component, TEST_COMPONENT_A)) == 0);
+  ASSERT_TRUE(ldk_ecs_command_buffer_count(second) == 0);
+
+  s_ecs_terminate(&ecs);
+  return 0;
+}
+
+int main(void)
+{
+  STDXTestCase tests[] =
+  {
+    X_TEST(test_ecs_command_playback_applies_in_order),
+    X_TEST(test_ecs_command_playback_skips_invalid_commands),
+  };
+
+  return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
+}
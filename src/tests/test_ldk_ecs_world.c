@@ -0,0 +1,157 @@
+#if defined(LDK_SHAREDLIB)
+#define X_IMPL_ARRAY
+#define X_IMPL_MATH
+#define X_IMPL_LOG
+#endif // LDK_SHAREDLIB
+
+#include <ldk.h>
+#include <module/ldk_ecs.h>
+#include <component/ldk_transform.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_log.h>
+
+#define X_IMPL_TEST
+#include <stdx/stdx_test.h>
+
+typedef struct TestComponentA
+{
+  int value;
+} TestComponentA;
+
+enum
+{
+  TEST_COMPONENT_A = 1,
+  TEST_COMPONENT_B = 2
+};
+
+static const LDKComponentDesc* s_component_a_desc()
+{
+  static LDKComponentDesc component_a = {
+    .name = "TestComponentA",
+    .type = TEST_COMPONENT_A,
+    .entry_size = sizeof(TestComponentA),
+    .initial_capacity = 8,
+    .attach = NULL,
+    .destroy = NULL,
+    .user = NULL
+  };
+  return &component_a;
+}
+
+static int s_entity_eq(LDKEntity a, LDKEntity b)
+{
+  return a.index == b.index && a.version == b.version;
+}
+
+int test_ecs_world_bind(void)
+{
+  LDKECS* world = ldk_ecs_world_create(16, 1);
+  LDKECS* previous = NULL;
+  LDKEntity entity;
+
+  ASSERT_TRUE(world != NULL);
+
+  previous = ldk_ecs_world_bind(world);
+  ASSERT_TRUE(ldk_ecs_world_get() == world);
+
+  // The facade resolves to the bound world
+  entity = ldk_ecs_entity_create();
+  ASSERT_TRUE(!x_handle_is_null(entity));
+  ASSERT_TRUE(ldk_entity_alive_count(&world->entity) == 1);
+  ASSERT_TRUE(ldk_entity_component_has(&world->entity, entity, LDK_COMPONENT_TYPE_TRANSFORM));
+
+  ASSERT_TRUE(ldk_ecs_world_bind(previous) == world);
+
+  // Destroying a bound world unbinds it
+  ldk_ecs_world_bind(world);
+  ldk_ecs_world_destroy(world);
+  ASSERT_TRUE(ldk_ecs_world_get() != world);
+  ldk_ecs_world_bind(previous);
+  return 0;
+}
+
+int test_ecs_world_merge(void)
+{
+  LDKECS* target = ldk_ecs_world_create(16, 1);
+  LDKECS* chunk = ldk_ecs_world_create(16, 1);
+  LDKECS* previous = NULL;
+  XArray* merged = x_array_create(sizeof(LDKEntity), 4);
+  LDKComponentDesc component_b = *s_component_a_desc();
+  LDKEntity existing;
+  LDKEntity parent;
+  LDKEntity child;
+  LDKEntity merged_parent;
+  LDKEntity merged_child;
+  TestComponentA a;
+  const TestComponentA* stored = NULL;
+  Vec3 position;
+
+  ASSERT_TRUE(target != NULL && chunk != NULL && merged != NULL);
+  ASSERT_TRUE(ldk_component_register(&target->component, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&chunk->component, s_component_a_desc()));
+
+  previous = ldk_ecs_world_bind(target);
+  existing = ldk_ecs_entity_create();
+  ASSERT_TRUE(!x_handle_is_null(existing));
+
+  // Populate the chunk as a loader thread would
+  ldk_ecs_world_bind(chunk);
+  parent = ldk_ecs_entity_create();
+  child = ldk_ecs_entity_create();
+  ASSERT_TRUE(ldk_transform_set_parent(child, parent));
+  position.x = 1.0f;
+  position.y = 2.0f;
+  position.z = 3.0f;
+  ASSERT_TRUE(ldk_transform_set_local_position(child, position));
+  a.value = 7;
+  ASSERT_TRUE(ldk_ecs_component_add(child, TEST_COMPONENT_A, &a) != NULL);
+
+  // Merging into itself is rejected
+  ASSERT_TRUE(!ldk_ecs_world_merge(chunk, NULL));
+
+  ldk_ecs_world_bind(target);
+  ASSERT_TRUE(ldk_ecs_world_merge(chunk, merged));
+  ASSERT_TRUE(x_array_count(merged) == 2);
+  ASSERT_TRUE(ldk_entity_alive_count(&target->entity) == 3);
+  ASSERT_TRUE(ldk_entity_alive_count(&chunk->entity) == 2);
+
+  merged_parent = *(LDKEntity*)x_array_get(merged, 0);
+  merged_child = *(LDKEntity*)x_array_get(merged, 1);
+  ASSERT_TRUE(!s_entity_eq(merged_parent, existing));
+
+  // Hierarchy links point at the merged entities
+  ASSERT_TRUE(s_entity_eq(ldk_transform_get_parent(merged_child), merged_parent));
+  ASSERT_TRUE(x_handle_is_null(ldk_transform_get_parent(merged_parent)));
+  position.y = 0.0f;
+  ASSERT_TRUE(ldk_transform_get_local_position(merged_child, &position));
+  ASSERT_TRUE(float_eq(position.y, 2.0f));
+
+  // Components without metadata are copied as they are
+  stored = (const TestComponentA*)ldk_ecs_component_get_const(merged_child, TEST_COMPONENT_A);
+  ASSERT_TRUE(stored != NULL && stored->value == 7);
+  ASSERT_TRUE(ldk_ecs_component_get_const(merged_parent, TEST_COMPONENT_A) == NULL);
+
+  // A type unknown to the target fails the whole merge
+  component_b.name = "TestComponentB";
+  component_b.type = TEST_COMPONENT_B;
+  ASSERT_TRUE(ldk_component_register(&chunk->component, &component_b));
+  ASSERT_TRUE(!ldk_ecs_world_merge(chunk, NULL));
+  ASSERT_TRUE(ldk_entity_alive_count(&target->entity) == 3);
+
+  ldk_ecs_world_bind(previous);
+  ldk_ecs_world_destroy(chunk);
+  ldk_ecs_world_destroy(target);
+  x_array_destroy(merged);
+  return 0;
+}
+
+int main(void)
+{
+  STDXTestCase tests[] =
+  {
+    X_TEST(test_ecs_world_bind),
+    X_TEST(test_ecs_world_merge),
+  };
+
+  return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
+}
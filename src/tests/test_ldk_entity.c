@@ -7,6 +7,7 @@
 #include <ldk.h>
 #include <module/ldk_entity.h>
 #include <module/ldk_component.h>
+#include <module/ldk_query.h>
 #include <stdx/stdx_array.h>
 #include <stdx/stdx_log.h>
 
@@ -304,7 +305,7 @@ int test_entity_component_ref_invalidation_on_remove_add(void)
   LDKComponentRegistry component_registry;
   LDKEntityRegistry entity_registry;
   LDKEntity entity;
-  LDKEntityInfo* info = NULL;
+  LDKEntityColdInfo* cold = NULL;
   u32 out_slot = 0;
   u32 out_index = 0;
   TestComponentA* component_a_0 = NULL;
@@ -318,9 +319,9 @@ int test_entity_component_ref_invalidation_on_remove_add(void)
   ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
 
   entity = ldk_entity_create(&entity_registry);
-  info = ldk_entity_info_get(&entity_registry, entity);
+  cold = ldk_entity_cold_info_get(&entity_registry, entity);
 
-  ASSERT_TRUE(info != NULL);
+  ASSERT_TRUE(cold != NULL);
 
   component_a_0 = (TestComponentA*)ldk_entity_component_add(
       &entity_registry,
@@ -332,7 +333,7 @@ int test_entity_component_ref_invalidation_on_remove_add(void)
   component_a_0->value = 10;
 
   ASSERT_TRUE(ldk_entity_component_ref_get(&entity_registry, entity, TEST_COMPONENT_A, &ref_a));
-  ASSERT_TRUE(info->components.version == 1);
+  ASSERT_TRUE(cold->components.version == 1);
 
   component_b_0 = (TestComponentB*)ldk_entity_component_add(
       &entity_registry,
@@ -344,7 +345,7 @@ int test_entity_component_ref_invalidation_on_remove_add(void)
   component_b_0->value = 30;
 
   ASSERT_TRUE(ldk_entity_component_ref_get(&entity_registry, entity, TEST_COMPONENT_B, &ref_b));
-  ASSERT_TRUE(info->components.version == 2);
+  ASSERT_TRUE(cold->components.version == 2);
   ASSERT_TRUE(!ldk_component_ref_is_valid(&entity_registry, ref_a));
   ASSERT_TRUE(ldk_component_ref_is_valid(&entity_registry, ref_b));
 
@@ -353,7 +354,7 @@ int test_entity_component_ref_invalidation_on_remove_add(void)
         &component_registry,
         entity,
         TEST_COMPONENT_B));
-  ASSERT_TRUE(info->components.version == 3);
+  ASSERT_TRUE(cold->components.version == 3);
   ASSERT_TRUE(!ldk_component_ref_is_valid(&entity_registry, ref_b));
 
   component_b_1 = (TestComponentB*)ldk_entity_component_add(
@@ -372,7 +373,7 @@ int test_entity_component_ref_invalidation_on_remove_add(void)
         &out_slot,
         &out_index));
   ASSERT_TRUE(out_index == 0);
-  ASSERT_TRUE(info->components.version == 4);
+  ASSERT_TRUE(cold->components.version == 4);
 
   ASSERT_TRUE(ldk_entity_component_ref_get(&entity_registry, entity, TEST_COMPONENT_A, &ref_a_new));
   ASSERT_TRUE(ldk_component_ref_is_valid(&entity_registry, ref_a_new));
@@ -386,6 +387,289 @@ int test_entity_component_ref_invalidation_on_remove_add(void)
   return 0;
 }
 
+int test_entity_component_directory_spills_past_inline_capacity(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKComponentDesc descs[20];
+  LDKEntity entity;
+  const u32 count = 20;
+  u32 i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+
+  // Register in reverse so the directory order differs from the add order
+  for (i = 0; i < count; ++i)
+  {
+    descs[i] = *s_component_a_desc();
+    descs[i].type = 100 + (count - i);
+    ASSERT_TRUE(ldk_component_register(&component_registry, &descs[i]));
+  }
+
+  entity = ldk_entity_create(&entity_registry);
+
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA value = { (int) i };
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, 101 + i, &value) != NULL);
+  }
+
+  ASSERT_TRUE(ldk_entity_component_count(&entity_registry, entity) == count);
+  ASSERT_TRUE(count > LDK_ENTITY_INLINE_COMPONENTS);
+
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA* value = (TestComponentA*) ldk_entity_component_get(&entity_registry, &component_registry, entity, 101 + i);
+    ASSERT_TRUE(ldk_entity_component_has(&entity_registry, entity, 101 + i));
+    ASSERT_TRUE(value != NULL && value->value == (int) i);
+  }
+
+  // Removing from the middle keeps every other lookup intact
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entity, 110));
+  ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, entity, 110));
+  ASSERT_TRUE(!ldk_entity_component_find(&entity_registry, entity, 110, NULL, NULL));
+
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA* value = (TestComponentA*) ldk_entity_component_get(&entity_registry, &component_registry, entity, 101 + i);
+    if (101 + i == 110)
+    {
+      continue;
+    }
+
+    ASSERT_TRUE(value != NULL && value->value == (int) i);
+  }
+
+  ldk_component_registry_remove_all(&component_registry, &entity_registry, entity);
+  ASSERT_TRUE(ldk_entity_component_count(&entity_registry, entity) == 0);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_entity_cold_info_reset_on_reuse(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKComponentDesc descs[12];
+  LDKEntity entities[40];
+  LDKEntity entity;
+  LDKEntity reused;
+  const u32 count = 12;
+  u32 i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+
+  for (i = 0; i < count; ++i)
+  {
+    descs[i] = *s_component_a_desc();
+    descs[i].type = 200 + i;
+    ASSERT_TRUE(ldk_component_register(&component_registry, &descs[i]));
+  }
+
+  // Past the first pool page so the cold data has to grow its page table
+  ASSERT_TRUE(ldk_entity_create_batch(&entity_registry, entities, 40) == 40);
+  entity = entities[39];
+  ASSERT_TRUE(ldk_entity_cold_info_get(&entity_registry, entity) != NULL);
+  ASSERT_TRUE(entity_registry.cold_page_count >= 3);
+
+  for (i = 0; i < count; ++i)
+  {
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, 200 + i, NULL) != NULL);
+  }
+
+  ASSERT_TRUE(ldk_entity_cold_info_get(&entity_registry, entity)->components.heap != NULL);
+
+  // The destroy path does not go through remove_all here, the spilled directory must still be released
+  ldk_entity_destroy(&entity_registry, entity);
+  ASSERT_TRUE(ldk_entity_cold_info_get(&entity_registry, entity) == NULL);
+
+  reused = ldk_entity_create(&entity_registry);
+  ASSERT_TRUE(reused.index == entity.index);
+  ASSERT_TRUE(ldk_entity_component_count(&entity_registry, reused) == 0);
+  ASSERT_TRUE(ldk_entity_cold_info_get(&entity_registry, reused)->components.heap == NULL);
+  ASSERT_TRUE(ldk_entity_cold_info_get(&entity_registry, reused)->components.capacity == LDK_ENTITY_INLINE_COMPONENTS);
+
+  ldk_entity_module_clear(&entity_registry);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 0);
+  entity = ldk_entity_create(&entity_registry);
+  ASSERT_TRUE(ldk_entity_component_count(&entity_registry, entity) == 0);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_entity_component_add_batch(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKEntity entities[64];
+  TestComponentA values[64];
+  XArray* owners = NULL;
+  u32 created = 0;
+  u32 i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+
+  created = ldk_entity_create_batch(&entity_registry, entities, 64);
+  ASSERT_TRUE(created == 64);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 64);
+
+  for (i = 0; i < 64; ++i)
+  {
+    values[i].value = (int) i * 3;
+  }
+
+  // Entities that already own the component are skipped
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[10], TEST_COMPONENT_A, NULL) != NULL);
+  ASSERT_TRUE(ldk_entity_component_add_batch(&entity_registry, &component_registry, entities, 64, TEST_COMPONENT_A, values) == 63);
+
+  owners = ldk_component_owners_get(&component_registry, TEST_COMPONENT_A);
+  ASSERT_TRUE(x_array_count(owners) == 64);
+
+  for (i = 0; i < 64; ++i)
+  {
+    TestComponentA* value = (TestComponentA*) ldk_entity_component_get(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A);
+    ASSERT_TRUE(value != NULL);
+    ASSERT_TRUE(value->value == (i == 10 ? 0 : (int) i * 3));
+  }
+
+  for (i = 0; i < 64; ++i)
+  {
+    ldk_component_registry_remove_all(&component_registry, &entity_registry, entities[i]);
+  }
+
+  ldk_entity_destroy_batch(&entity_registry, entities, 64);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 0);
+  ASSERT_TRUE(x_array_count(owners) == 0);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+static int s_destroy_count = 0;
+
+static void s_count_destroy(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    LDKEntity entity, void* component, u32 component_index, void* user)
+{
+  s_destroy_count++;
+}
+
+int test_entity_destroy_pending(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKComponentDesc desc_a = *s_component_a_desc();
+  LDKComponentDesc desc_b = *s_component_b_desc();
+  LDKComponentDesc tag = {0};
+  LDKEntity entities[64];
+  LDKEntity entity;
+  LDKQuery query;
+  u32 query_type = TEST_COMPONENT_A;
+  u32 pending = 0;
+  u32 i = 0;
+
+  desc_a.destroy = s_count_destroy;
+  desc_b.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+  tag.name = "Tag";
+  tag.type = 3;
+  tag.storage = LDK_COMPONENT_STORAGE_TAG;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_a));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_b));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &tag));
+  ASSERT_TRUE(ldk_entity_create_batch(&entity_registry, entities, 64) == 64);
+
+  for (i = 0; i < 64; ++i)
+  {
+    TestComponentA a = { (int) i };
+    TestComponentB b = { (int) i };
+
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &a) != NULL);
+
+    if (i % 2 == 0)
+    {
+      ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B, &b) != NULL);
+    }
+
+    if (i % 5 == 0)
+    {
+      ASSERT_TRUE(ldk_entity_tag_add(&entity_registry, &component_registry, entities[i], 3));
+    }
+  }
+
+  query = ldk_query_create(&entity_registry, &component_registry, &query_type, 1);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 64);
+
+  for (i = 0; i < 64; ++i)
+  {
+    if (i % 3 != 0)
+    {
+      ASSERT_TRUE(ldk_entity_destroy_deferred(&entity_registry, entities[i]));
+      pending++;
+    }
+  }
+
+  // Marked entities stay alive until the sweep and can not be marked twice
+  ASSERT_TRUE(!ldk_entity_destroy_deferred(&entity_registry, entities[1]));
+  ASSERT_TRUE(ldk_entity_pending_destroy_count(&entity_registry) == pending);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 64);
+  ASSERT_TRUE(ldk_entity_component_get(&entity_registry, &component_registry, entities[1], TEST_COMPONENT_A) != NULL);
+
+  // An entity destroyed right away after being marked is skipped by the sweep
+  ldk_component_registry_remove_all(&component_registry, &entity_registry, entities[2]);
+  ldk_entity_destroy(&entity_registry, entities[2]);
+  pending--;
+
+  s_destroy_count = 0;
+  ASSERT_TRUE(ldk_entity_destroy_pending(&entity_registry, &component_registry) == pending);
+  ASSERT_TRUE(s_destroy_count == (int) pending);
+  ASSERT_TRUE(ldk_entity_pending_destroy_count(&entity_registry) == 0);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 64 - pending - 1);
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&component_registry, TEST_COMPONENT_A)) == 64 - pending - 1);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 64 - pending - 1);
+
+  // Survivors keep their values wherever the compaction moved them
+  for (i = 0; i < 64; ++i)
+  {
+    const TestComponentA* a = NULL;
+    const TestComponentB* b = NULL;
+
+    if (i % 3 != 0)
+    {
+      ASSERT_TRUE(!ldk_entity_is_alive(&entity_registry, entities[i]));
+      continue;
+    }
+
+    a = (const TestComponentA*) ldk_entity_component_get_const(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A);
+    b = (const TestComponentB*) ldk_entity_component_get_const(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B);
+    ASSERT_TRUE(a != NULL && a->value == (int) i);
+    ASSERT_TRUE((i % 2 == 0) == (b != NULL));
+    ASSERT_TRUE(b == NULL || b->value == (int) i);
+    ASSERT_TRUE(ldk_entity_component_has(&entity_registry, entities[i], 3) == (i % 5 == 0));
+  }
+
+  // Reused slots start unmarked
+  entity = ldk_entity_create(&entity_registry);
+  ASSERT_TRUE(ldk_entity_destroy_deferred(&entity_registry, entity));
+  ASSERT_TRUE(ldk_entity_destroy_pending(&entity_registry, &component_registry) == 1);
+  ASSERT_TRUE(ldk_entity_destroy_pending(&entity_registry, &component_registry) == 0);
+
+  ldk_query_destroy(&component_registry, query);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
 int main(void)
 {
   STDXTestCase tests[] =
@@ -397,6 +681,10 @@ int main(void)
     X_TEST(test_entity_component_ref_mutation),
     X_TEST(test_entity_component_ref_invalid_after_entity_destroy),
     X_TEST(test_entity_component_ref_invalidation_on_remove_add),
+    X_TEST(test_entity_component_directory_spills_past_inline_capacity),
+    X_TEST(test_entity_cold_info_reset_on_reuse),
+    X_TEST(test_entity_component_add_batch),
+    X_TEST(test_entity_destroy_pending),
   };
 
   return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
@@ -0,0 +1,204 @@
+#if defined(LDK_SHAREDLIB)
+#define X_IMPL_LOG
+#endif
+
+#include <ldk_common.h>
+#include <ldk_os.h>
+#include <module/ldk_jobs.h>
+#include <stdx/stdx_log.h>
+
+#define X_IMPL_TEST
+#include <stdx/stdx_test.h>
+#include <string.h>
+
+#define TEST_JOB_COUNT 1000
+#define TEST_RANGE_COUNT 100000
+
+typedef struct TestRangeState
+{
+  volatile i32 visits[TEST_RANGE_COUNT];
+  volatile i32 bad_worker;
+  u32 worker_count;
+} TestRangeState;
+
+typedef struct TestDependencyState
+{
+  volatile i32 first_done;
+  volatile i32 order_violations;
+} TestDependencyState;
+
+static void s_count_job(void* user, u32 worker_index)
+{
+  ldk_os_atomic_add_i32((volatile i32*) user, 1);
+}
+
+static void s_first_job(void* user, u32 worker_index)
+{
+  TestDependencyState* state = (TestDependencyState*) user;
+  ldk_os_atomic_add_i32(&state->first_done, 1);
+}
+
+static void s_second_job(void* user, u32 worker_index)
+{
+  TestDependencyState* state = (TestDependencyState*) user;
+
+  if (ldk_os_atomic_load_i32(&state->first_done) != TEST_JOB_COUNT)
+  {
+    ldk_os_atomic_add_i32(&state->order_violations, 1);
+  }
+}
+
+static void s_range_job(void* user, u32 begin, u32 end, u32 worker_index)
+{
+  TestRangeState* state = (TestRangeState*) user;
+
+  if (worker_index >= state->worker_count)
+  {
+    ldk_os_atomic_add_i32(&state->bad_worker, 1);
+  }
+
+  for (u32 i = begin; i < end; ++i)
+  {
+    ldk_os_atomic_add_i32(&state->visits[i], 1);
+  }
+}
+
+static LDKJobSystem* g_nested_system = NULL;
+
+static void s_nested_job(void* user, u32 worker_index)
+{
+  // parallel_for from inside a job helps while it waits instead of blocking the worker
+  ldk_jobs_parallel_for(g_nested_system, TEST_RANGE_COUNT, 0, s_range_job, user);
+}
+
+int test_jobs_run_and_wait(void)
+{
+  static LDKJobDesc jobs[TEST_JOB_COUNT];
+  LDKJobSystem system;
+  LDKJobCounter counter = {0};
+  volatile i32 executed = 0;
+
+  ASSERT_TRUE(ldk_jobs_initialize(&system, 4));
+  ASSERT_TRUE(ldk_jobs_worker_count(&system) == 4);
+  ASSERT_TRUE(ldk_jobs_worker_index(&system) == 0);
+
+  for (u32 i = 0; i < TEST_JOB_COUNT; ++i)
+  {
+    jobs[i].fn = s_count_job;
+    jobs[i].user = (void*) &executed;
+    jobs[i].dependency = NULL;
+  }
+
+  ldk_jobs_run(&system, jobs, TEST_JOB_COUNT, &counter);
+  ldk_jobs_wait(&system, &counter);
+
+  ASSERT_TRUE(ldk_jobs_is_done(&counter));
+  ASSERT_TRUE(executed == TEST_JOB_COUNT);
+
+  ldk_jobs_terminate(&system);
+  ASSERT_TRUE(ldk_jobs_worker_index(&system) == LDK_JOBS_INVALID_WORKER);
+  return 0;
+}
+
+int test_jobs_dependency(void)
+{
+  static LDKJobDesc first[TEST_JOB_COUNT];
+  static TestDependencyState state;
+  LDKJobSystem system;
+  LDKJobCounter first_counter = {0};
+  LDKJobCounter second_counter = {0};
+  LDKJobDesc second[8];
+
+  memset(&state, 0, sizeof(state));
+  ASSERT_TRUE(ldk_jobs_initialize(&system, 4));
+
+  for (u32 i = 0; i < TEST_JOB_COUNT; ++i)
+  {
+    first[i].fn = s_first_job;
+    first[i].user = &state;
+    first[i].dependency = NULL;
+  }
+
+  for (u32 i = 0; i < 8; ++i)
+  {
+    second[i].fn = s_second_job;
+    second[i].user = &state;
+    second[i].dependency = &first_counter;
+  }
+
+  ldk_jobs_run(&system, first, TEST_JOB_COUNT, &first_counter);
+  ldk_jobs_run(&system, second, 8, &second_counter);
+  ldk_jobs_wait(&system, &second_counter);
+
+  ASSERT_TRUE(ldk_jobs_is_done(&first_counter));
+  ASSERT_TRUE(state.first_done == TEST_JOB_COUNT);
+  ASSERT_TRUE(state.order_violations == 0);
+
+  ldk_jobs_terminate(&system);
+  return 0;
+}
+
+int test_jobs_parallel_for(void)
+{
+  static TestRangeState state;
+  LDKJobSystem system;
+  LDKJobDesc job;
+  LDKJobCounter counter = {0};
+
+  memset(&state, 0, sizeof(state));
+  ASSERT_TRUE(ldk_jobs_initialize(&system, 4));
+  state.worker_count = ldk_jobs_worker_count(&system);
+
+  ldk_jobs_parallel_for(&system, TEST_RANGE_COUNT, 0, s_range_job, &state);
+  ldk_jobs_parallel_for(&system, TEST_RANGE_COUNT, 7, s_range_job, &state);
+
+  g_nested_system = &system;
+  job.fn = s_nested_job;
+  job.user = &state;
+  job.dependency = NULL;
+  ldk_jobs_run(&system, &job, 1, &counter);
+  ldk_jobs_wait(&system, &counter);
+
+  for (u32 i = 0; i < TEST_RANGE_COUNT; ++i)
+  {
+    ASSERT_TRUE(state.visits[i] == 3);
+  }
+
+  ASSERT_TRUE(state.bad_worker == 0);
+
+  ldk_jobs_terminate(&system);
+  return 0;
+}
+
+int test_jobs_single_worker(void)
+{
+  static TestRangeState state;
+  LDKJobSystem system;
+
+  memset(&state, 0, sizeof(state));
+  ASSERT_TRUE(ldk_jobs_initialize(&system, 1));
+  state.worker_count = ldk_jobs_worker_count(&system);
+
+  ldk_jobs_parallel_for(&system, TEST_RANGE_COUNT, 16, s_range_job, &state);
+
+  for (u32 i = 0; i < TEST_RANGE_COUNT; ++i)
+  {
+    ASSERT_TRUE(state.visits[i] == 1);
+  }
+
+  ldk_jobs_terminate(&system);
+  return 0;
+}
+
+int main(void)
+{
+  STDXTestCase tests[] =
+  {
+    X_TEST(test_jobs_run_and_wait),
+    X_TEST(test_jobs_dependency),
+    X_TEST(test_jobs_parallel_for),
+    X_TEST(test_jobs_single_worker),
+  };
+
+  return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
+}
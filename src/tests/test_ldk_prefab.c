@@ -0,0 +1,272 @@
+#if defined(LDK_SHAREDLIB)
+#define X_IMPL_ARRAY
+#define X_IMPL_MATH
+#define X_IMPL_LOG
+#endif // LDK_SHAREDLIB
+
+#include <ldk.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <module/ldk_prefab.h>
+#include <component/ldk_transform.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_log.h>
+
+#define X_IMPL_TEST
+#include <stdx/stdx_test.h>
+
+#define TEST_INSTANCE_COUNT 100
+
+typedef struct TestComponentA
+{
+  int value;
+} TestComponentA;
+
+enum
+{
+  TEST_COMPONENT_A = 1,
+  TEST_TAG_ENEMY = 2
+};
+
+static int s_attach_count = 0;
+
+static bool s_count_attach(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    LDKEntity entity, void* component, u32 component_index, const void* initial_value, void* user)
+{
+  s_attach_count++;
+  return initial_value != NULL;
+}
+
+static int s_entity_eq(LDKEntity a, LDKEntity b)
+{
+  return a.index == b.index && a.version == b.version;
+}
+
+static bool s_registries_initialize(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry)
+{
+  LDKComponentDesc transform = {0};
+  LDKComponentDesc component_a = {0};
+  LDKComponentDesc tag = {0};
+
+  transform.name = "Transform";
+  transform.type = LDK_COMPONENT_TYPE_TRANSFORM;
+  transform.entry_size = sizeof(LDKTransform);
+  transform.initial_capacity = 8;
+
+  component_a.name = "TestComponentA";
+  component_a.type = TEST_COMPONENT_A;
+  component_a.entry_size = sizeof(TestComponentA);
+  component_a.initial_capacity = 8;
+  component_a.attach = s_count_attach;
+
+  tag.name = "Enemy";
+  tag.type = TEST_TAG_ENEMY;
+  tag.storage = LDK_COMPONENT_STORAGE_TAG;
+
+  return ldk_entity_module_initialize(entity_registry, 256, 1)
+    && ldk_component_registry_initialize(component_registry)
+    && ldk_component_register(component_registry, &component_a)
+    && ldk_component_register(component_registry, &transform)
+    && ldk_component_register(component_registry, &tag);
+}
+
+static void s_registries_terminate(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry)
+{
+  ldk_component_registry_terminate(component_registry);
+  ldk_entity_module_terminate(entity_registry);
+}
+
+int test_prefab_instantiate(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKPrefab prefab;
+  LDKEntity roots[TEST_INSTANCE_COUNT];
+  TestComponentA value;
+  u32 nodes[3];
+  u32 i = 0;
+
+  ASSERT_TRUE(s_registries_initialize(&entity_registry, &component_registry));
+  ASSERT_TRUE(ldk_prefab_initialize(&prefab));
+
+  nodes[0] = ldk_prefab_node_add(&prefab, LDK_PREFAB_NO_PARENT, 0);
+  nodes[1] = ldk_prefab_node_add(&prefab, nodes[0], 0);
+  nodes[2] = ldk_prefab_node_add(&prefab, nodes[0], 4);
+  ASSERT_TRUE(ldk_prefab_node_add(&prefab, 7, 0) == LDK_PREFAB_NO_PARENT);
+  ASSERT_TRUE(ldk_prefab_node_count(&prefab) == 3);
+
+  for (i = 0; i < 3; ++i)
+  {
+    value.value = (int)i + 10;
+    ASSERT_TRUE(ldk_prefab_component_set(&prefab, &component_registry, nodes[i], LDK_COMPONENT_TYPE_TRANSFORM, NULL));
+    ASSERT_TRUE(ldk_prefab_component_set(&prefab, &component_registry, nodes[i], TEST_COMPONENT_A, &value));
+  }
+
+  ASSERT_TRUE(ldk_prefab_component_set(&prefab, &component_registry, nodes[2], TEST_TAG_ENEMY, NULL));
+
+  s_attach_count = 0;
+  ASSERT_TRUE(ldk_prefab_instantiate(&prefab, &entity_registry, &component_registry, TEST_INSTANCE_COUNT, roots) == TEST_INSTANCE_COUNT);
+  ASSERT_TRUE(s_attach_count == 3 * TEST_INSTANCE_COUNT);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 3 * TEST_INSTANCE_COUNT);
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&component_registry, TEST_COMPONENT_A)) == 3 * TEST_INSTANCE_COUNT);
+
+  for (i = 0; i < TEST_INSTANCE_COUNT; ++i)
+  {
+    const LDKTransform* root = ldk_entity_transform_get_const(&entity_registry, &component_registry, roots[i]);
+    const LDKTransform* first = NULL;
+    const LDKTransform* second = NULL;
+    LDKEntity first_entity;
+    LDKEntity second_entity;
+
+    ASSERT_TRUE(root != NULL && x_handle_is_null(root->parent));
+    ASSERT_TRUE(((const TestComponentA*)ldk_entity_component_get_const(&entity_registry, &component_registry, roots[i], TEST_COMPONENT_A))->value == 10);
+
+    // Children keep the node order
+    first_entity = root->first_child;
+    first = ldk_entity_transform_get_const(&entity_registry, &component_registry, first_entity);
+    ASSERT_TRUE(first != NULL && s_entity_eq(first->parent, roots[i]));
+    ASSERT_TRUE(x_handle_is_null(first->prev_sibling));
+    ASSERT_TRUE(((const TestComponentA*)ldk_entity_component_get_const(&entity_registry, &component_registry, first_entity, TEST_COMPONENT_A))->value == 11);
+    ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, first_entity, TEST_TAG_ENEMY));
+
+    second_entity = first->next_sibling;
+    second = ldk_entity_transform_get_const(&entity_registry, &component_registry, second_entity);
+    ASSERT_TRUE(second != NULL && s_entity_eq(second->parent, roots[i]));
+    ASSERT_TRUE(s_entity_eq(second->prev_sibling, first_entity));
+    ASSERT_TRUE(x_handle_is_null(second->next_sibling));
+    ASSERT_TRUE((second->flags & LDK_TRANSFORM_FLAG_WORLD_DIRTY) != 0);
+    ASSERT_TRUE(float_eq(second->local_scale.x, 1.0f));
+    ASSERT_TRUE(((const TestComponentA*)ldk_entity_component_get_const(&entity_registry, &component_registry, second_entity, TEST_COMPONENT_A))->value == 12);
+    ASSERT_TRUE(ldk_entity_component_has(&entity_registry, second_entity, TEST_TAG_ENEMY));
+    ASSERT_TRUE(ldk_entity_flags_get(&entity_registry, second_entity) == 4);
+  }
+
+  ldk_prefab_terminate(&prefab);
+  s_registries_terminate(&entity_registry, &component_registry);
+  return 0;
+}
+
+int test_prefab_capture(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKPrefab prefab;
+  LDKEntity entities[3];
+  LDKEntity copy;
+  LDKTransform transform = ldk_transform_make_default();
+  TestComponentA value;
+  const LDKTransform* root = NULL;
+  const LDKTransform* child = NULL;
+  const LDKTransform* grandchild = NULL;
+  u32 i = 0;
+
+  ASSERT_TRUE(s_registries_initialize(&entity_registry, &component_registry));
+  ASSERT_TRUE(ldk_prefab_initialize(&prefab));
+
+  // entities[0] -> entities[1] -> entities[2]
+  for (i = 0; i < 3; ++i)
+  {
+    entities[i] = ldk_entity_create(&entity_registry);
+    transform.local_position.x = (float)i;
+    value.value = (int)i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], LDK_COMPONENT_TYPE_TRANSFORM, &transform) != NULL);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &value) != NULL);
+  }
+
+  ldk_entity_transform_get(&entity_registry, &component_registry, entities[0])->first_child = entities[1];
+  ldk_entity_transform_get(&entity_registry, &component_registry, entities[1])->parent = entities[0];
+  ldk_entity_transform_get(&entity_registry, &component_registry, entities[1])->first_child = entities[2];
+  ldk_entity_transform_get(&entity_registry, &component_registry, entities[2])->parent = entities[1];
+  ASSERT_TRUE(ldk_entity_tag_add(&entity_registry, &component_registry, entities[2], TEST_TAG_ENEMY));
+
+  // Capturing a subtree leaves its ancestors out
+  ASSERT_TRUE(ldk_prefab_capture(&prefab, &entity_registry, &component_registry, entities[1]));
+  ASSERT_TRUE(ldk_prefab_node_count(&prefab) == 2);
+
+  ASSERT_TRUE(ldk_prefab_capture(&prefab, &entity_registry, &component_registry, entities[0]));
+  ASSERT_TRUE(ldk_prefab_node_count(&prefab) == 3);
+
+  ASSERT_TRUE(ldk_prefab_instantiate(&prefab, &entity_registry, &component_registry, 1, &copy) == 1);
+  ASSERT_TRUE(!s_entity_eq(copy, entities[0]));
+
+  root = ldk_entity_transform_get_const(&entity_registry, &component_registry, copy);
+  ASSERT_TRUE(root != NULL && x_handle_is_null(root->parent));
+  ASSERT_TRUE(float_eq(root->local_position.x, 0.0f));
+
+  child = ldk_entity_transform_get_const(&entity_registry, &component_registry, root->first_child);
+  ASSERT_TRUE(child != NULL && s_entity_eq(child->parent, copy));
+  ASSERT_TRUE(!s_entity_eq(root->first_child, entities[1]));
+  ASSERT_TRUE(float_eq(child->local_position.x, 1.0f));
+
+  grandchild = ldk_entity_transform_get_const(&entity_registry, &component_registry, child->first_child);
+  ASSERT_TRUE(grandchild != NULL && s_entity_eq(grandchild->parent, root->first_child));
+  ASSERT_TRUE(x_handle_is_null(grandchild->first_child));
+  ASSERT_TRUE(float_eq(grandchild->local_position.x, 2.0f));
+  ASSERT_TRUE(ldk_entity_component_has(&entity_registry, child->first_child, TEST_TAG_ENEMY));
+  ASSERT_TRUE(((const TestComponentA*)ldk_entity_component_get_const(&entity_registry, &component_registry, child->first_child, TEST_COMPONENT_A))->value == 2);
+
+  // The source hierarchy is untouched
+  ASSERT_TRUE(s_entity_eq(ldk_entity_transform_get_const(&entity_registry, &component_registry, entities[0])->first_child, entities[1]));
+
+  ldk_prefab_terminate(&prefab);
+  s_registries_terminate(&entity_registry, &component_registry);
+  return 0;
+}
+
+int test_prefab_instantiate_fails_whole(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry target_entities;
+  LDKComponentRegistry target_components;
+  LDKComponentDesc transform = {0};
+  LDKPrefab prefab;
+  LDKEntity roots[TEST_INSTANCE_COUNT];
+  TestComponentA value;
+  u32 nodes[2];
+
+  ASSERT_TRUE(s_registries_initialize(&entity_registry, &component_registry));
+  ASSERT_TRUE(ldk_prefab_initialize(&prefab));
+
+  nodes[0] = ldk_prefab_node_add(&prefab, LDK_PREFAB_NO_PARENT, 0);
+  nodes[1] = ldk_prefab_node_add(&prefab, nodes[0], 0);
+  value.value = 1;
+  ASSERT_TRUE(ldk_prefab_component_set(&prefab, &component_registry, nodes[0], LDK_COMPONENT_TYPE_TRANSFORM, NULL));
+  ASSERT_TRUE(ldk_prefab_component_set(&prefab, &component_registry, nodes[1], LDK_COMPONENT_TYPE_TRANSFORM, NULL));
+  ASSERT_TRUE(ldk_prefab_component_set(&prefab, &component_registry, nodes[1], TEST_COMPONENT_A, &value));
+  ASSERT_TRUE(ldk_prefab_component_set(&prefab, &component_registry, nodes[1], TEST_TAG_ENEMY, NULL));
+
+  // The target knows Transform but not A or the tag, so their columns can not be added
+  transform.name = "Transform";
+  transform.type = LDK_COMPONENT_TYPE_TRANSFORM;
+  transform.entry_size = sizeof(LDKTransform);
+  transform.initial_capacity = 8;
+  ASSERT_TRUE(ldk_entity_module_initialize(&target_entities, 256, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&target_components));
+  ASSERT_TRUE(ldk_component_register(&target_components, &transform));
+
+  ASSERT_TRUE(ldk_prefab_instantiate(&prefab, &target_entities, &target_components, TEST_INSTANCE_COUNT, roots) == 0);
+  ASSERT_TRUE(ldk_entity_alive_count(&target_entities) == 0);
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&target_components, LDK_COMPONENT_TYPE_TRANSFORM)) == 0);
+
+  // The registry the prefab was built with still instantiates it whole
+  ASSERT_TRUE(ldk_prefab_instantiate(&prefab, &entity_registry, &component_registry, TEST_INSTANCE_COUNT, roots) == TEST_INSTANCE_COUNT);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 2 * TEST_INSTANCE_COUNT);
+
+  ldk_prefab_terminate(&prefab);
+  s_registries_terminate(&target_entities, &target_components);
+  s_registries_terminate(&entity_registry, &component_registry);
+  return 0;
+}
+
+int main(void)
+{
+  STDXTestCase tests[] =
+  {
+    X_TEST(test_prefab_instantiate),
+    X_TEST(test_prefab_capture),
+    X_TEST(test_prefab_instantiate_fails_whole),
+  };
+
+  return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
+}
@@ -0,0 +1,489 @@
+#if defined(LDK_SHAREDLIB)
+#define X_IMPL_ARRAY
+#define X_IMPL_LOG
+#endif // LDK_SHAREDLIB
+
+#include <ldk.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <module/ldk_query.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_log.h>
+
+#define X_IMPL_TEST
+#include <stdx/stdx_test.h>
+
+typedef struct TestComponentA
+{
+  int value;
+} TestComponentA;
+
+typedef struct TestComponentB
+{
+  int value;
+} TestComponentB;
+
+enum
+{
+  TEST_COMPONENT_A = 1,
+  TEST_COMPONENT_B = 2,
+  TEST_TAG_ENEMY = 3
+};
+
+static const LDKComponentDesc* s_component_a_desc()
+{
+  static LDKComponentDesc component_a = {
+    .name = "TestComponentA",
+    .type = TEST_COMPONENT_A,
+    .entry_size = sizeof(TestComponentA),
+    .initial_capacity = 8,
+    .attach = NULL,
+    .destroy = NULL,
+    .user = NULL
+  };
+  return &component_a;
+}
+
+static const LDKComponentDesc* s_component_b_desc()
+{
+  static LDKComponentDesc component_b = {
+    .name = "TestComponentB",
+    .type = TEST_COMPONENT_B,
+    .entry_size = sizeof(TestComponentB),
+    .initial_capacity = 8,
+    .attach = NULL,
+    .destroy = NULL,
+    .user = NULL
+  };
+  return &component_b;
+}
+
+int test_query_matches_existing_entities(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKEntity entities[4];
+  const u32 types[] = { TEST_COMPONENT_A, TEST_COMPONENT_B };
+  LDKQuery query;
+  int i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+
+  for (i = 0; i < 4; ++i)
+  {
+    entities[i] = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, NULL) != NULL);
+  }
+
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[1], TEST_COMPONENT_B, NULL) != NULL);
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[3], TEST_COMPONENT_B, NULL) != NULL);
+
+  query = ldk_query_create(&entity_registry, &component_registry, types, 2);
+  ASSERT_TRUE(query != LDK_QUERY_INVALID);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 2);
+
+  // Identical queries are shared
+  ASSERT_TRUE(ldk_query_create(&entity_registry, &component_registry, types, 2) == query);
+  ldk_query_destroy(&component_registry, query);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 2);
+
+  ldk_query_destroy(&component_registry, query);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 0);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_query_updates_incrementally_on_add_remove(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKEntity entity_1;
+  LDKEntity entity_2;
+  const u32 types[] = { TEST_COMPONENT_A, TEST_COMPONENT_B };
+  LDKQuery query;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+
+  query = ldk_query_create(&entity_registry, &component_registry, types, 2);
+  ASSERT_TRUE(query != LDK_QUERY_INVALID);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 0);
+
+  entity_1 = ldk_entity_create(&entity_registry);
+  entity_2 = ldk_entity_create(&entity_registry);
+
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_A, NULL) != NULL);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 0);
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_B, NULL) != NULL);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 1);
+
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity_2, TEST_COMPONENT_B, NULL) != NULL);
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity_2, TEST_COMPONENT_A, NULL) != NULL);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 2);
+
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entity_1, TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 1);
+  ASSERT_TRUE(ldk_query_entities(&component_registry, query)[0].index == entity_2.index);
+
+  ldk_component_registry_remove_all(&component_registry, &entity_registry, entity_2);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 0);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_query_iteration_yields_component_batches(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKComponentDesc desc_b = *s_component_b_desc();
+  const u32 types[] = { TEST_COMPONENT_B, TEST_COMPONENT_A };
+  LDKQueryBatch batch;
+  LDKQueryIter iter;
+  LDKQuery query;
+  const int count = LDK_QUERY_BATCH_SIZE * 2 + 3;
+  u32 batches = 0;
+  u32 seen = 0;
+  int i = 0;
+
+  // Mix packed and archetype storage in the same query
+  desc_b.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 256, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &desc_b));
+
+  for (i = 0; i < count; ++i)
+  {
+    TestComponentA a;
+    TestComponentB b;
+    LDKEntity entity = ldk_entity_create(&entity_registry);
+
+    a.value = i;
+    b.value = -i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, TEST_COMPONENT_A, &a) != NULL);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entity, TEST_COMPONENT_B, &b) != NULL);
+  }
+
+  query = ldk_query_create(&entity_registry, &component_registry, types, 2);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == (u32)count);
+
+  iter = ldk_query_iter_begin(&entity_registry, &component_registry, query);
+  while (ldk_query_iter_next(&iter, &batch))
+  {
+    ASSERT_TRUE(batch.term_count == 2);
+    batches++;
+
+    for (i = 0; i < (int)batch.count; ++i)
+    {
+      TestComponentB* b = (TestComponentB*)batch.components[0][i];
+      TestComponentA* a = (TestComponentA*)batch.components[1][i];
+
+      ASSERT_TRUE(a != NULL && b != NULL);
+      ASSERT_TRUE(a->value == -b->value);
+      ASSERT_TRUE(ldk_entity_component_get(&entity_registry, &component_registry, batch.entities[i], TEST_COMPONENT_A) == a);
+      seen++;
+    }
+  }
+
+  ASSERT_TRUE(batches == 3);
+  ASSERT_TRUE(seen == (u32)count);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+static u32 s_query_filtered_count(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    LDKQuery query, LDKQueryFilter filter, u32 term, u32 tick, LDKEntity* out_last)
+{
+  LDKQueryIter iter = ldk_query_iter_begin(entity_registry, component_registry, query);
+  LDKQueryBatch batch;
+  u32 count = 0;
+
+  ldk_query_iter_filter_set(&iter, filter, term, tick);
+
+  while (ldk_query_iter_next(&iter, &batch))
+  {
+    count += batch.count;
+    *out_last = batch.entities[batch.count - 1];
+  }
+
+  return count;
+}
+
+int test_query_change_filters(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKEntity entities[100];
+  LDKEntity last = {0};
+  const u32 types[] = { TEST_COMPONENT_A, TEST_COMPONENT_B };
+  LDKQuery query;
+  TestComponentB* b = NULL;
+  u32 tick = 0;
+  int i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 128, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+
+  for (i = 0; i < 100; ++i)
+  {
+    entities[i] = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, NULL) != NULL);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B, NULL) != NULL);
+  }
+
+  query = ldk_query_create(&entity_registry, &component_registry, types, 2);
+  ASSERT_TRUE(query != LDK_QUERY_INVALID);
+
+  // Everything is new on the first run
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_ADDED, 0, tick, &last) == 100);
+  tick = ldk_component_tick_advance(&component_registry);
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_CHANGED, 1, tick, &last) == 0);
+
+  // Const access does not count as a change, mutable access does
+  ASSERT_TRUE(ldk_entity_component_get_const(&entity_registry, &component_registry, entities[10], TEST_COMPONENT_B) != NULL);
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_CHANGED, 1, tick, &last) == 0);
+
+  b = (TestComponentB*)ldk_entity_component_get(&entity_registry, &component_registry, entities[99], TEST_COMPONENT_B);
+  ASSERT_TRUE(b != NULL);
+  b->value = 5;
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_CHANGED, 1, tick, &last) == 1);
+  ASSERT_TRUE(last.index == entities[99].index);
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_CHANGED, 0, tick, &last) == 0);
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_ADDED, 1, tick, &last) == 0);
+
+  // Ticks follow components when the store is compacted
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[0], TEST_COMPONENT_B));
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_CHANGED, 1, tick, &last) == 1);
+  ASSERT_TRUE(last.index == entities[99].index);
+
+  // Changes are reported once per consumer run
+  tick = ldk_component_tick_advance(&component_registry);
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_CHANGED, 1, tick, &last) == 0);
+
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[0], TEST_COMPONENT_B, NULL) != NULL);
+  ASSERT_TRUE(s_query_filtered_count(&entity_registry, &component_registry, query, LDK_QUERY_FILTER_ADDED, 1, tick, &last) == 1);
+  ASSERT_TRUE(last.index == entities[0].index);
+
+  ldk_query_destroy(&component_registry, query);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int test_query_tag_terms(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKComponentDesc tag = {0};
+  LDKComponentDesc bad = {0};
+  LDKEntity entities[8];
+  const u32 types[] = { TEST_COMPONENT_B, TEST_TAG_ENEMY };
+  LDKQuery query;
+  LDKQueryIter iter;
+  LDKQueryBatch batch;
+  TestComponentB value = {0};
+  u32 seen = 0;
+  int i = 0;
+
+  tag.name = "Enemy";
+  tag.type = TEST_TAG_ENEMY;
+  tag.storage = LDK_COMPONENT_STORAGE_TAG;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 16, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+
+  // Only tags may be registered without data, and tags can not have any
+  bad = tag;
+  bad.entry_size = 4;
+  ASSERT_TRUE(!ldk_component_register(&component_registry, &bad));
+  bad = *s_component_a_desc();
+  bad.entry_size = 0;
+  ASSERT_TRUE(!ldk_component_register(&component_registry, &bad));
+
+  // The tag slot sits between A and B so directory positions must skip it
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, &tag));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+  ASSERT_TRUE(ldk_component_is_tag(&component_registry, TEST_TAG_ENEMY));
+  ASSERT_TRUE(ldk_component_store_get(&component_registry, TEST_TAG_ENEMY) == NULL);
+
+  query = ldk_query_create(&entity_registry, &component_registry, types, 2);
+  ASSERT_TRUE(query != LDK_QUERY_INVALID);
+
+  for (i = 0; i < 8; ++i)
+  {
+    entities[i] = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, NULL) != NULL);
+
+    if (i % 2 == 0)
+    {
+      ASSERT_TRUE(ldk_entity_tag_add(&entity_registry, &component_registry, entities[i], TEST_TAG_ENEMY));
+    }
+
+    value.value = i;
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B, &value) != NULL);
+  }
+
+  // Tags take no directory entry and have no data
+  ASSERT_TRUE(ldk_entity_component_count(&entity_registry, entities[0]) == 2);
+  ASSERT_TRUE(ldk_entity_component_has(&entity_registry, entities[0], TEST_TAG_ENEMY));
+  ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, entities[1], TEST_TAG_ENEMY));
+  ASSERT_TRUE(!ldk_entity_tag_add(&entity_registry, &component_registry, entities[0], TEST_TAG_ENEMY));
+  ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[1], TEST_TAG_ENEMY, NULL) == NULL);
+  ASSERT_TRUE(!ldk_entity_tag_add(&entity_registry, &component_registry, entities[1], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_entity_component_get(&entity_registry, &component_registry, entities[0], TEST_TAG_ENEMY) == NULL);
+  ASSERT_TRUE(((TestComponentB*)ldk_entity_component_get(&entity_registry, &component_registry, entities[6], TEST_COMPONENT_B))->value == 6);
+
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 4);
+  iter = ldk_query_iter_begin(&entity_registry, &component_registry, query);
+
+  while (ldk_query_iter_next(&iter, &batch))
+  {
+    u32 j = 0;
+
+    for (j = 0; j < batch.count; ++j)
+    {
+      ASSERT_TRUE(batch.components[1][j] == NULL);
+      ASSERT_TRUE(((TestComponentB*)batch.components[0][j])->value % 2 == 0);
+      seen++;
+    }
+  }
+
+  ASSERT_TRUE(seen == 4);
+
+  // Removing the tag, generically or through remove_all, updates the query
+  ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[2], TEST_TAG_ENEMY));
+  ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, entities[2], TEST_TAG_ENEMY));
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 3);
+
+  ldk_component_registry_remove_all(&component_registry, &entity_registry, entities[4]);
+  ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, entities[4], TEST_TAG_ENEMY));
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 2);
+
+  ASSERT_TRUE(ldk_entity_component_add_batch(&entity_registry, &component_registry, entities, 8, TEST_TAG_ENEMY, NULL) == 6);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query) == 7);
+
+  ldk_query_destroy(&component_registry, query);
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+static u32 s_query_check_components(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry, LDKQuery query)
+{
+  LDKQueryIter iter = ldk_query_iter_begin(entity_registry, component_registry, query);
+  LDKQueryBatch batch;
+  u32 bad = 0;
+  u32 seen = 0;
+  u32 i = 0;
+
+  while (ldk_query_iter_next(&iter, &batch))
+  {
+    for (i = 0; i < batch.count; ++i)
+    {
+      const TestComponentB* b = (const TestComponentB*)batch.components[0][i];
+      const TestComponentA* a = (const TestComponentA*)batch.components[1][i];
+
+      if (b != ldk_entity_component_get(entity_registry, component_registry, batch.entities[i], TEST_COMPONENT_B) ||
+          a != ldk_entity_component_get(entity_registry, component_registry, batch.entities[i], TEST_COMPONENT_A) ||
+          a->value != -b->value)
+      {
+        bad++;
+      }
+      seen++;
+    }
+  }
+
+  return bad == 0 ? seen : 0;
+}
+
+int test_query_reordered_terms_share_matches(void)
+{
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry entity_registry;
+  LDKEntity entities[100];
+  const u32 types_ab[] = { TEST_COMPONENT_A, TEST_COMPONENT_B };
+  const u32 types_ba[] = { TEST_COMPONENT_B, TEST_COMPONENT_A };
+  LDKQuery query_ab;
+  LDKQuery query_ba;
+  int i = 0;
+
+  ASSERT_TRUE(ldk_entity_module_initialize(&entity_registry, 128, 1));
+  ASSERT_TRUE(ldk_component_registry_initialize(&component_registry));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_a_desc()));
+  ASSERT_TRUE(ldk_component_register(&component_registry, s_component_b_desc()));
+
+  for (i = 0; i < 100; ++i)
+  {
+    TestComponentA a;
+    TestComponentB b;
+
+    a.value = i;
+    b.value = -i;
+    entities[i] = ldk_entity_create(&entity_registry);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A, &a) != NULL);
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B, &b) != NULL);
+  }
+
+  // Each order gets its own handle and batch layout over one matched entity list
+  query_ab = ldk_query_create(&entity_registry, &component_registry, types_ab, 2);
+  query_ba = ldk_query_create(&entity_registry, &component_registry, types_ba, 2);
+  ASSERT_TRUE(query_ab != LDK_QUERY_INVALID && query_ba != LDK_QUERY_INVALID && query_ab != query_ba);
+  ASSERT_TRUE(ldk_query_create(&entity_registry, &component_registry, types_ba, 2) == query_ba);
+  ASSERT_TRUE(ldk_query_entities(&component_registry, query_ab) == ldk_query_entities(&component_registry, query_ba));
+  ASSERT_TRUE(s_query_check_components(&entity_registry, &component_registry, query_ba) == 100);
+
+  // Removals move the last components of the stores into the holes behind the cached indices
+  for (i = 0; i < 100; i += 3)
+  {
+    ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_A));
+  }
+
+  for (i = 1; i < 100; i += 7)
+  {
+    ASSERT_TRUE(ldk_entity_component_remove(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B));
+    ASSERT_TRUE(ldk_entity_component_add(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B, NULL) != NULL);
+    ((TestComponentB*)ldk_entity_component_get(&entity_registry, &component_registry, entities[i], TEST_COMPONENT_B))->value = -i;
+  }
+
+  ldk_query_destroy(&component_registry, query_ab);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query_ba) == 66);
+  ASSERT_TRUE(s_query_check_components(&entity_registry, &component_registry, query_ba) == 66);
+
+  ldk_query_destroy(&component_registry, query_ba);
+  ldk_query_destroy(&component_registry, query_ba);
+  ASSERT_TRUE(ldk_query_count(&component_registry, query_ba) == 0);
+
+  ldk_component_registry_terminate(&component_registry);
+  ldk_entity_module_terminate(&entity_registry);
+  return 0;
+}
+
+int main(void)
+{
+  STDXTestCase tests[] =
+  {
+    X_TEST(test_query_matches_existing_entities),
+    X_TEST(test_query_updates_incrementally_on_add_remove),
+    X_TEST(test_query_iteration_yields_component_batches),
+    X_TEST(test_query_change_filters),
+    X_TEST(test_query_tag_terms),
+    X_TEST(test_query_reordered_terms_share_matches),
+  };
+
+  return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
+}
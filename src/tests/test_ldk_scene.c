@@ -0,0 +1,377 @@
+#if defined(LDK_SHAREDLIB)
+#define X_IMPL_ARRAY
+#define X_IMPL_MATH
+#define X_IMPL_LOG
+#endif // LDK_SHAREDLIB
+
+#include <ldk.h>
+#include <module/ldk_entity.h>
+#include <module/ldk_component.h>
+#include <module/ldk_scene.h>
+#include <component/ldk_transform.h>
+#include <stdx/stdx_array.h>
+#include <stdx/stdx_log.h>
+
+#define X_IMPL_TEST
+#include <stdx/stdx_test.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#define TEST_ENTITY_COUNT 10
+
+typedef struct TestComponentA
+{
+  int value;
+  LDKEntity target;
+} TestComponentA;
+
+typedef struct TestComponentB
+{
+  int value;
+} TestComponentB;
+
+enum
+{
+  TEST_COMPONENT_A = 1,
+  TEST_COMPONENT_B = 2,
+  TEST_COMPONENT_UNSAVED = 3,
+  TEST_TAG_ENEMY = 4
+};
+
+static int s_bad_targets = 0;
+static bool s_reject_attach = false;
+
+static const LDKComponentMeta* s_component_a_meta(void)
+{
+  static const LDKComponentFieldMeta fields[] =
+  {
+    { "value",  LDK_FIELD_I32,    offsetof(TestComponentA, value),  0, LDK_FIELD_WIDGET_I32,    0.0f, 0.0f },
+    { "target", LDK_FIELD_ENTITY, offsetof(TestComponentA, target), 0, LDK_FIELD_WIDGET_ENTITY, 0.0f, 0.0f },
+  };
+
+  static const LDKComponentMeta meta = { "TestComponentA", TEST_COMPONENT_A, sizeof(TestComponentA), fields, 2 };
+  return &meta;
+}
+
+static const LDKComponentMeta* s_component_b_meta(void)
+{
+  static const LDKComponentFieldMeta fields[] =
+  {
+    { "value", LDK_FIELD_I32, offsetof(TestComponentB, value), 0, LDK_FIELD_WIDGET_I32, 0.0f, 0.0f },
+  };
+
+  static const LDKComponentMeta meta = { "TestComponentB", TEST_COMPONENT_B, sizeof(TestComponentB), fields, 1 };
+  return &meta;
+}
+
+static const LDKComponentMeta* s_tag_meta(void)
+{
+  static const LDKComponentMeta meta = { "Enemy", TEST_TAG_ENEMY, 0, NULL, 0 };
+  return &meta;
+}
+
+static const LDKComponentMeta* s_transform_meta(void)
+{
+  static const LDKComponentFieldMeta fields[] =
+  {
+    { "parent",       LDK_FIELD_ENTITY, offsetof(LDKTransform, parent),       0, LDK_FIELD_WIDGET_ENTITY, 0.0f, 0.0f },
+    { "first_child",  LDK_FIELD_ENTITY, offsetof(LDKTransform, first_child),  0, LDK_FIELD_WIDGET_ENTITY, 0.0f, 0.0f },
+    { "next_sibling", LDK_FIELD_ENTITY, offsetof(LDKTransform, next_sibling), 0, LDK_FIELD_WIDGET_ENTITY, 0.0f, 0.0f },
+    { "prev_sibling", LDK_FIELD_ENTITY, offsetof(LDKTransform, prev_sibling), 0, LDK_FIELD_WIDGET_ENTITY, 0.0f, 0.0f },
+  };
+
+  static const LDKComponentMeta meta = { "Transform", LDK_COMPONENT_TYPE_TRANSFORM, sizeof(LDKTransform), fields, 4 };
+  return &meta;
+}
+
+static bool s_check_target(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    LDKEntity entity, void* component, u32 component_index, const void* initial_value, void* user)
+{
+  const TestComponentA* a = (const TestComponentA*)component;
+
+  // Handles are already remapped when attach runs
+  if (!x_handle_is_null(a->target) && !ldk_entity_is_alive(entity_registry, a->target))
+  {
+    s_bad_targets++;
+  }
+
+  return !s_reject_attach;
+}
+
+static int s_entity_eq(LDKEntity a, LDKEntity b)
+{
+  return a.index == b.index && a.version == b.version;
+}
+
+static bool s_registries_initialize(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry, bool with_b)
+{
+  LDKComponentDesc transform = {0};
+  LDKComponentDesc component_a = {0};
+  LDKComponentDesc component_b = {0};
+  LDKComponentDesc unsaved = {0};
+  LDKComponentDesc tag = {0};
+
+  transform.name = "Transform";
+  transform.type = LDK_COMPONENT_TYPE_TRANSFORM;
+  transform.entry_size = sizeof(LDKTransform);
+  transform.initial_capacity = 8;
+
+  component_a.name = "TestComponentA";
+  component_a.type = TEST_COMPONENT_A;
+  component_a.entry_size = sizeof(TestComponentA);
+  component_a.initial_capacity = 8;
+  component_a.attach = s_check_target;
+
+  component_b.name = "TestComponentB";
+  component_b.type = TEST_COMPONENT_B;
+  component_b.entry_size = sizeof(TestComponentB);
+  component_b.initial_capacity = 8;
+  component_b.storage = LDK_COMPONENT_STORAGE_ARCHETYPE;
+
+  unsaved = component_b;
+  unsaved.name = "Unsaved";
+  unsaved.type = TEST_COMPONENT_UNSAVED;
+  unsaved.storage = LDK_COMPONENT_STORAGE_PACKED;
+
+  tag.name = "Enemy";
+  tag.type = TEST_TAG_ENEMY;
+  tag.storage = LDK_COMPONENT_STORAGE_TAG;
+
+  return ldk_entity_module_initialize(entity_registry, 64, 1)
+    && ldk_component_registry_initialize(component_registry)
+    && ldk_component_register(component_registry, &component_a)
+    && ldk_component_register(component_registry, &transform)
+    && (!with_b || ldk_component_register(component_registry, &component_b))
+    && ldk_component_register(component_registry, &unsaved)
+    && ldk_component_register(component_registry, &tag);
+}
+
+static void s_registries_terminate(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry)
+{
+  ldk_component_registry_terminate(component_registry);
+  ldk_entity_module_terminate(entity_registry);
+}
+
+/* entities[i].A targets entities[i + 1], entities[3] targets outside. Odd entities have B, entities[1] is a child of entities[0]. */
+static bool s_scene_build(LDKEntityRegistry* entity_registry, LDKComponentRegistry* component_registry,
+    LDKEntity* entities, LDKEntity* outside)
+{
+  LDKTransform transform = ldk_transform_make_default();
+  i32 i = 0;
+
+  *outside = ldk_entity_create(entity_registry);
+
+  for (i = 0; i < TEST_ENTITY_COUNT; ++i)
+  {
+    entities[i] = ldk_entity_create(entity_registry);
+  }
+
+  for (i = 0; i < TEST_ENTITY_COUNT; ++i)
+  {
+    TestComponentA a;
+    TestComponentB b;
+
+    a.value = i;
+    a.target = i == 3 ? *outside : entities[(i + 1) % TEST_ENTITY_COUNT];
+    b.value = 100 + i;
+
+    if (!ldk_entity_component_add(entity_registry, component_registry, entities[i], TEST_COMPONENT_A, &a) ||
+        !ldk_entity_component_add(entity_registry, component_registry, entities[i], TEST_COMPONENT_UNSAVED, &b) ||
+        !ldk_entity_component_add(entity_registry, component_registry, entities[i], LDK_COMPONENT_TYPE_TRANSFORM, &transform))
+    {
+      return false;
+    }
+
+    if (i % 2 == 1 && !ldk_entity_component_add(entity_registry, component_registry, entities[i], TEST_COMPONENT_B, &b))
+    {
+      return false;
+    }
+  }
+
+  ldk_entity_transform_get(entity_registry, component_registry, entities[0])->first_child = entities[1];
+  ldk_entity_transform_get(entity_registry, component_registry, entities[1])->parent = entities[0];
+  ldk_entity_flags_set(entity_registry, entities[2], 7);
+  return ldk_entity_tag_add(entity_registry, component_registry, entities[5], TEST_TAG_ENEMY);
+}
+
+int test_scene_write_and_load(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  const LDKComponentMeta* metas[4];
+  LDKEntity entities[TEST_ENTITY_COUNT];
+  LDKEntity outside;
+  XArray* data = x_array_create(1, 256);
+  XArray* loaded = x_array_create(sizeof(LDKEntity), 16);
+  const LDKEntity* copies = NULL;
+  const LDKTransform* transform = NULL;
+  i32 i = 0;
+
+  metas[0] = s_component_a_meta();
+  metas[1] = s_component_b_meta();
+  metas[2] = s_tag_meta();
+  metas[3] = s_transform_meta();
+
+  ASSERT_TRUE(s_registries_initialize(&entity_registry, &component_registry, true));
+  ASSERT_TRUE(s_scene_build(&entity_registry, &component_registry, entities, &outside));
+
+  ASSERT_TRUE(ldk_scene_write(&entity_registry, &component_registry, entities, TEST_ENTITY_COUNT, metas, 4, data));
+  ASSERT_TRUE(ldk_scene_validate(x_array_data(data), x_array_count(data)));
+  ASSERT_TRUE(((const LDKSceneHeader*)x_array_data(data))->block_count == 4);
+
+  // Load next to the originals so every handle has to be remapped
+  s_bad_targets = 0;
+  ASSERT_TRUE(ldk_scene_load_memory(&entity_registry, &component_registry, x_array_data(data), x_array_count(data), loaded));
+  ASSERT_TRUE(s_bad_targets == 0);
+  ASSERT_TRUE(x_array_count(loaded) == TEST_ENTITY_COUNT);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == 2 * TEST_ENTITY_COUNT + 1);
+
+  copies = (const LDKEntity*)x_array_data(loaded);
+
+  for (i = 0; i < TEST_ENTITY_COUNT; ++i)
+  {
+    const TestComponentA* a = (const TestComponentA*)ldk_entity_component_get_const(&entity_registry, &component_registry, copies[i], TEST_COMPONENT_A);
+    const TestComponentB* b = (const TestComponentB*)ldk_entity_component_get_const(&entity_registry, &component_registry, copies[i], TEST_COMPONENT_B);
+
+    ASSERT_TRUE(!s_entity_eq(copies[i], entities[i]));
+    ASSERT_TRUE(a != NULL && a->value == i);
+    ASSERT_TRUE(i == 3 ? x_handle_is_null(a->target) : s_entity_eq(a->target, copies[(i + 1) % TEST_ENTITY_COUNT]));
+    ASSERT_TRUE((b != NULL) == (i % 2 == 1));
+    ASSERT_TRUE(b == NULL || b->value == 100 + i);
+    ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, copies[i], TEST_COMPONENT_UNSAVED));
+    ASSERT_TRUE(ldk_entity_component_has(&entity_registry, copies[i], TEST_TAG_ENEMY) == (i == 5));
+    ASSERT_TRUE(ldk_entity_flags_get(&entity_registry, copies[i]) == (i == 2 ? 7 : 0));
+  }
+
+  transform = ldk_entity_transform_get_const(&entity_registry, &component_registry, copies[1]);
+  ASSERT_TRUE(transform != NULL && s_entity_eq(transform->parent, copies[0]));
+  transform = ldk_entity_transform_get_const(&entity_registry, &component_registry, copies[0]);
+  ASSERT_TRUE(transform != NULL && s_entity_eq(transform->first_child, copies[1]));
+  ASSERT_TRUE(x_handle_is_null(transform->parent));
+
+  x_array_destroy(loaded);
+  x_array_destroy(data);
+  s_registries_terminate(&entity_registry, &component_registry);
+  return 0;
+}
+
+int test_scene_load_rejects_invalid_data(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  LDKEntityRegistry target_entities;
+  LDKComponentRegistry target_components;
+  const LDKComponentMeta* metas[2];
+  LDKComponentMeta stale_meta;
+  LDKEntity entities[TEST_ENTITY_COUNT];
+  LDKEntity outside;
+  XArray* data = x_array_create(1, 256);
+  XArray* loaded = x_array_create(sizeof(LDKEntity), 16);
+  LDKSceneHeader* header = NULL;
+  LDKSceneBlock* block = NULL;
+  u32 owner = 0;
+
+  metas[0] = s_component_a_meta();
+  metas[1] = s_component_b_meta();
+
+  ASSERT_TRUE(s_registries_initialize(&entity_registry, &component_registry, true));
+  ASSERT_TRUE(s_registries_initialize(&target_entities, &target_components, false));
+  ASSERT_TRUE(s_scene_build(&entity_registry, &component_registry, entities, &outside));
+  ASSERT_TRUE(ldk_scene_write(&entity_registry, &component_registry, entities, TEST_ENTITY_COUNT, metas, 2, data));
+
+  header = (LDKSceneHeader*)x_array_data(data);
+
+  // Truncated
+  ASSERT_TRUE(!ldk_scene_load_memory(&target_entities, &target_components, header, x_array_count(data) - 4, loaded));
+
+  // Bad magic
+  header->magic ^= 1;
+  ASSERT_TRUE(!ldk_scene_load_memory(&target_entities, &target_components, header, x_array_count(data), loaded));
+  header->magic ^= 1;
+
+  // Owner out of range
+  block = (LDKSceneBlock*)((u8*)header + header->toc_offset);
+  memcpy(&owner, (u8*)header + block->owners_offset, sizeof(owner));
+  *(u32*)((u8*)header + block->owners_offset) = TEST_ENTITY_COUNT;
+  ASSERT_TRUE(!ldk_scene_load_memory(&target_entities, &target_components, header, x_array_count(data), loaded));
+  *(u32*)((u8*)header + block->owners_offset) = owner;
+  ASSERT_TRUE(ldk_entity_alive_count(&target_entities) == 0);
+
+  // Blocks of unregistered types are skipped
+  ASSERT_TRUE(ldk_scene_load_memory(&target_entities, &target_components, header, x_array_count(data), loaded));
+  ASSERT_TRUE(ldk_entity_alive_count(&target_entities) == TEST_ENTITY_COUNT);
+  ASSERT_TRUE(x_array_count(ldk_component_store_get(&target_components, TEST_COMPONENT_A)) == TEST_ENTITY_COUNT);
+
+  // A meta that does not match the registered size can not be saved
+  stale_meta = *s_component_b_meta();
+  stale_meta.size = sizeof(TestComponentB) + 4;
+  metas[1] = &stale_meta;
+  ASSERT_TRUE(!ldk_scene_write(&entity_registry, &component_registry, entities, TEST_ENTITY_COUNT, metas, 2, data));
+  ASSERT_TRUE(x_array_count(data) == 0);
+
+  x_array_destroy(loaded);
+  x_array_destroy(data);
+  s_registries_terminate(&target_entities, &target_components);
+  s_registries_terminate(&entity_registry, &component_registry);
+  return 0;
+}
+
+int test_scene_load_reports_failed_blocks(void)
+{
+  LDKEntityRegistry entity_registry;
+  LDKComponentRegistry component_registry;
+  const LDKComponentMeta* metas[2];
+  LDKEntity entities[TEST_ENTITY_COUNT];
+  LDKEntity outside;
+  XArray* data = x_array_create(1, 256);
+  XArray* loaded = x_array_create(sizeof(LDKEntity), 16);
+  LDKSceneHeader* header = NULL;
+  const LDKEntity* copies = NULL;
+  u32 alive = 0;
+
+  metas[0] = s_component_a_meta();
+  metas[1] = s_component_b_meta();
+
+  ASSERT_TRUE(s_registries_initialize(&entity_registry, &component_registry, true));
+  ASSERT_TRUE(s_scene_build(&entity_registry, &component_registry, entities, &outside));
+  ASSERT_TRUE(ldk_scene_write(&entity_registry, &component_registry, entities, TEST_ENTITY_COUNT, metas, 2, data));
+
+  // Every bit of the saved flags is game defined, none of them reaches the internal flags
+  header = (LDKSceneHeader*)x_array_data(data);
+  *(u16*)((u8*)header + header->flags_offset) = 0xFFFF;
+  ASSERT_TRUE(ldk_scene_load_memory(&entity_registry, &component_registry, header, x_array_count(data), loaded));
+  copies = (const LDKEntity*)x_array_data(loaded);
+  ASSERT_TRUE(ldk_entity_flags_get(&entity_registry, copies[0]) == 0xFFFF);
+  ASSERT_TRUE(ldk_entity_internal_flags_get(&entity_registry, copies[0]) == LDK_ENTITY_INTERNAL_NONE);
+  ASSERT_TRUE(ldk_entity_pending_destroy_count(&entity_registry) == 0);
+  ASSERT_TRUE(ldk_entity_destroy_pending(&entity_registry, &component_registry) == 0);
+
+  // A rejected attach fails the load but keeps the created entities listed for the caller
+  alive = ldk_entity_alive_count(&entity_registry);
+  s_reject_attach = true;
+  ASSERT_TRUE(!ldk_scene_load_memory(&entity_registry, &component_registry, header, x_array_count(data), loaded));
+  s_reject_attach = false;
+  ASSERT_TRUE(x_array_count(loaded) == TEST_ENTITY_COUNT);
+  ASSERT_TRUE(ldk_entity_alive_count(&entity_registry) == alive + TEST_ENTITY_COUNT);
+  copies = (const LDKEntity*)x_array_data(loaded);
+  ASSERT_TRUE(!ldk_entity_component_has(&entity_registry, copies[0], TEST_COMPONENT_A));
+  ASSERT_TRUE(ldk_entity_component_has(&entity_registry, copies[1], TEST_COMPONENT_B));
+
+  x_array_destroy(loaded);
+  x_array_destroy(data);
+  s_registries_terminate(&entity_registry, &component_registry);
+  return 0;
+}
+
+int main(void)
+{
+  STDXTestCase tests[] =
+  {
+    X_TEST(test_scene_write_and_load),
+    X_TEST(test_scene_load_rejects_invalid_data),
+    X_TEST(test_scene_load_reports_failed_blocks),
+  };
+
+  return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
+}
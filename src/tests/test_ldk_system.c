@@ -10,6 +10,7 @@
 #define X_IMPL_TEST
 #include <stdx/stdx_test.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define DELTA_TIME 0.016f
 enum
@@ -484,6 +485,93 @@ int test_system_registry_clear_while_stopped(void)
   return 0;
 }
 
+static int g_executor_calls = 0;
+static int g_executor_tasks = 0;
+
+static void test_executor(void* executor_user, u32 count, LDKSystemTaskFn task, void* task_user)
+{
+  u32 i;
+
+  (void)executor_user;
+  g_executor_calls++;
+  g_executor_tasks += (int)count;
+
+  // Run in reverse to make sure no order is assumed inside a wave
+  for (i = count; i > 0; --i)
+  {
+    task(task_user, i - 1);
+  }
+}
+
+int test_system_registry_parallel_waves(void)
+{
+  LDKSystemRegistry registry;
+  LDKSystemDesc a;
+  LDKSystemDesc b;
+  LDKSystemDesc c;
+
+  test_reset_counters();
+  g_executor_calls = 0;
+  g_executor_tasks = 0;
+
+  memset(&a, 0, sizeof(a));
+  a.id = TEST_SYSTEM_ID_A;
+  a.name = "system_a";
+  a.flags = LDK_SYSTEM_FLAG_ENABLED | LDK_SYSTEM_FLAG_PARALLEL;
+  a.update_order = 10;
+  a.callbacks.initialize = test_system_initialize;
+  a.callbacks.terminate = test_system_terminate;
+  a.callbacks.update = test_system_update_a;
+  a.access.writes[0] = 1;
+  a.access.write_count = 1;
+
+  // Reads component 2 only: shares the first wave with system A
+  b = a;
+  b.id = TEST_SYSTEM_ID_B;
+  b.name = "system_b";
+  b.update_order = 20;
+  b.callbacks.update = test_system_update_b;
+  b.access.write_count = 0;
+  b.access.reads[0] = 2;
+  b.access.read_count = 1;
+
+  // Reads component 1 written by A: must run after it
+  c = b;
+  c.id = TEST_SYSTEM_ID_C;
+  c.name = "system_c";
+  c.update_order = 30;
+  c.callbacks.update = test_system_update_c;
+  c.access.reads[0] = 1;
+
+  ASSERT_TRUE(ldk_system_registry_initialize(&registry));
+  ASSERT_TRUE(ldk_system_registry_register(&registry, &a));
+  ASSERT_TRUE(ldk_system_registry_register(&registry, &b));
+  ASSERT_TRUE(ldk_system_registry_register(&registry, &c));
+  ldk_system_registry_executor_set(&registry, test_executor, NULL);
+
+  ASSERT_TRUE(ldk_system_registry_start(&registry));
+  ASSERT_TRUE(ldk_system_registry_wave_count(&registry, LDK_SYSTEM_BUCKET_UPDATE) == 2);
+  ASSERT_TRUE(ldk_system_registry_run_bucket(&registry, LDK_SYSTEM_BUCKET_UPDATE, DELTA_TIME));
+
+  ASSERT_TRUE(g_callback_ok);
+  ASSERT_TRUE(g_executor_calls == 1);
+  ASSERT_TRUE(g_executor_tasks == 2);
+  ASSERT_TRUE(g_order_log_count == 3);
+  ASSERT_TRUE(g_order_log[2] == 3);
+  ASSERT_TRUE(ldk_system_registry_stop(&registry));
+
+  // Systems without declared access are exclusive
+  b.flags = LDK_SYSTEM_FLAG_ENABLED;
+  ASSERT_TRUE(ldk_system_registry_unregister(&registry, TEST_SYSTEM_ID_B));
+  ASSERT_TRUE(ldk_system_registry_register(&registry, &b));
+  ASSERT_TRUE(ldk_system_registry_start(&registry));
+  ASSERT_TRUE(ldk_system_registry_wave_count(&registry, LDK_SYSTEM_BUCKET_UPDATE) == 3);
+  ASSERT_TRUE(ldk_system_registry_stop(&registry));
+
+  ldk_system_registry_terminate(&registry);
+  return 0;
+}
+
 int main(void)
 {
   STDXTestCase tests[] =
@@ -495,6 +583,7 @@ int main(void)
     X_TEST(test_system_registry_equal_order_uses_registration_order),
     X_TEST(test_system_registry_mutation_rejected_while_started),
     X_TEST(test_system_registry_clear_while_stopped),
+    X_TEST(test_system_registry_parallel_waves),
   };
 
   return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);
@@ -11,6 +11,9 @@
 #include <stdx/stdx_log.h>
 #include <stdx/stdx_math.h>
 #include <component/ldk_transform.h>
+#include <module/ldk_ecs.h>
+#include <module/ldk_scenegraph.h>
+#include <module/ldk_jobs.h>
 
 static int s_entity_eq(LDKEntity a, LDKEntity b)
 {
@@ -56,12 +59,310 @@ static int test_transform_parent_value_semantics(void)
   return 0;
 }
 
+static int s_world_position_eq(LDKEntity entity, float x, float y, float z)
+{
+  Mat4 world_matrix;
+  Vec3 position;
+
+  if (!ldk_transform_get_world_matrix(entity, &world_matrix))
+  {
+    return 0;
+  }
+
+  position = mat4_mul_point(world_matrix, vec3_make(0.0f, 0.0f, 0.0f));
+  return float_eq(position.x, x) && float_eq(position.y, y) && float_eq(position.z, z);
+}
+
+static int test_transform_scenegraph_update(void)
+{
+  LDKECS* world = ldk_ecs_world_create(64, 1);
+  LDKECS* previous = NULL;
+  LDKTransform* transform_a = NULL;
+  LDKTransform* transform_c = NULL;
+  LDKTransform* transform_d = NULL;
+  LDKEntity a;
+  LDKEntity b;
+  LDKEntity c;
+  LDKEntity d;
+
+  ASSERT_TRUE(world != NULL);
+  previous = ldk_ecs_world_bind(world);
+
+  // c and d exist before their future ancestors, so reparenting moves them after a and b
+  c = ldk_ecs_entity_create();
+  d = ldk_ecs_entity_create();
+  a = ldk_ecs_entity_create();
+  b = ldk_ecs_entity_create();
+  ASSERT_TRUE(ldk_transform_set_parent(d, c));
+  ASSERT_TRUE(ldk_transform_set_parent(b, a));
+  ASSERT_TRUE(ldk_scenegraph_set_parent(c, b));
+  ASSERT_TRUE(ldk_transform_set_local_position(a, vec3_make(1.0f, 0.0f, 0.0f)));
+  ASSERT_TRUE(ldk_transform_set_local_position(b, vec3_make(0.0f, 2.0f, 0.0f)));
+  ASSERT_TRUE(ldk_transform_set_local_position(c, vec3_make(0.0f, 0.0f, 3.0f)));
+  ASSERT_TRUE(ldk_transform_set_local_position(d, vec3_make(1.0f, 1.0f, 1.0f)));
+
+  // Reparenting kept the node array valid without a rebuild
+  ASSERT_TRUE(!world->scenegraph.rebuild);
+  ASSERT_TRUE(world->scenegraph.live_count == 4);
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  ASSERT_TRUE(s_world_position_eq(c, 1.0f, 2.0f, 3.0f));
+  ASSERT_TRUE(s_world_position_eq(d, 2.0f, 3.0f, 4.0f));
+
+  ASSERT_TRUE(ldk_transform_set_local_position(a, vec3_make(5.0f, 0.0f, 0.0f)));
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  ASSERT_TRUE(s_world_position_eq(d, 6.0f, 3.0f, 4.0f));
+
+  ASSERT_TRUE(ldk_transform_set_parent(c, x_handle_null()));
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  ASSERT_TRUE(s_world_position_eq(c, 0.0f, 0.0f, 3.0f));
+  ASSERT_TRUE(s_world_position_eq(d, 1.0f, 1.0f, 4.0f));
+
+  // Destroying b orphans c
+  ASSERT_TRUE(ldk_transform_set_parent(c, b));
+  ldk_ecs_entity_destroy(b);
+  ASSERT_TRUE(ldk_ecs_entity_destroy_flush() == 1);
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  ASSERT_TRUE(world->scenegraph.live_count == 3);
+  ASSERT_TRUE(x_handle_is_null(ldk_transform_get_parent(c)));
+  ASSERT_TRUE(s_world_position_eq(c, 0.0f, 0.0f, 3.0f));
+
+  // Links written behind the scenegraph are picked up by a rebuild once invalidated
+  transform_a = (LDKTransform*)ldk_ecs_component_get(a, LDK_COMPONENT_TYPE_TRANSFORM);
+  transform_c = (LDKTransform*)ldk_ecs_component_get(c, LDK_COMPONENT_TYPE_TRANSFORM);
+  transform_d = (LDKTransform*)ldk_ecs_component_get(d, LDK_COMPONENT_TYPE_TRANSFORM);
+  transform_c->first_child = x_handle_null();
+  transform_d->parent = a;
+  transform_a->first_child = d;
+  transform_d->flags |= LDK_TRANSFORM_FLAG_WORLD_DIRTY;
+  ldk_scenegraph_invalidate(&world->scenegraph);
+
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  ASSERT_TRUE(!world->scenegraph.rebuild);
+  ASSERT_TRUE(s_world_position_eq(d, 6.0f, 1.0f, 1.0f));
+
+  ldk_ecs_world_bind(previous);
+  ldk_ecs_world_destroy(world);
+  return 0;
+}
+
+static int test_transform_scenegraph_dirty_list(void)
+{
+  enum { ROOT_COUNT = 100 };
+  LDKECS* world = ldk_ecs_world_create(256, 1);
+  LDKECS* previous = NULL;
+  LDKEntity roots[ROOT_COUNT];
+  LDKEntity children[ROOT_COUNT];
+  LDKScenegraphStats stats;
+  u32 i = 0;
+
+  ASSERT_TRUE(world != NULL);
+  previous = ldk_ecs_world_bind(world);
+
+  for (i = 0; i < ROOT_COUNT; ++i)
+  {
+    roots[i] = ldk_ecs_entity_create();
+    children[i] = ldk_ecs_entity_create();
+    ASSERT_TRUE(ldk_transform_set_parent(children[i], roots[i]));
+    ASSERT_TRUE(ldk_transform_set_local_position(children[i], vec3_make(0.0f, 1.0f, 0.0f)));
+  }
+
+  // New transforms are all queued, so the first update visits every node
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  stats = ldk_scenegraph_stats_get();
+  ASSERT_TRUE(stats.full_pass);
+  ASSERT_TRUE(stats.matrices_updated == ROOT_COUNT * 2);
+
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  stats = ldk_scenegraph_stats_get();
+  ASSERT_TRUE(!stats.full_pass);
+  ASSERT_TRUE(stats.dirty_count == 0 && stats.matrices_updated == 0);
+
+  // Only the subtrees of the moved roots are recomputed
+  ASSERT_TRUE(ldk_transform_set_local_position(roots[3], vec3_make(3.0f, 0.0f, 0.0f)));
+  ASSERT_TRUE(ldk_transform_set_local_position(roots[7], vec3_make(7.0f, 0.0f, 0.0f)));
+  ASSERT_TRUE(ldk_transform_set_local_position(roots[7], vec3_make(8.0f, 0.0f, 0.0f)));
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  stats = ldk_scenegraph_stats_get();
+  ASSERT_TRUE(!stats.full_pass);
+  ASSERT_TRUE(stats.dirty_count == 2 && stats.matrices_updated == 4);
+  ASSERT_TRUE(s_world_position_eq(children[3], 3.0f, 1.0f, 0.0f));
+  ASSERT_TRUE(s_world_position_eq(children[7], 8.0f, 1.0f, 0.0f));
+  ASSERT_TRUE(s_world_position_eq(children[4], 0.0f, 1.0f, 0.0f));
+
+  // A queued child below a queued parent is computed once
+  ASSERT_TRUE(ldk_transform_mark_dirty(children[5]));
+  ASSERT_TRUE(ldk_transform_mark_dirty(roots[5]));
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  stats = ldk_scenegraph_stats_get();
+  ASSERT_TRUE(stats.dirty_count == 2 && stats.matrices_updated == 2);
+
+  // Destroyed entities left on the list are skipped
+  ASSERT_TRUE(ldk_transform_mark_dirty(roots[9]));
+  ldk_ecs_entity_destroy(children[9]);
+  ldk_ecs_entity_destroy(roots[9]);
+  ASSERT_TRUE(ldk_ecs_entity_destroy_flush() == 2);
+  ASSERT_TRUE(ldk_scenegraph_update(0.0f));
+  stats = ldk_scenegraph_stats_get();
+  ASSERT_TRUE(!stats.full_pass && stats.matrices_updated == 0);
+
+  ldk_ecs_world_bind(previous);
+  ldk_ecs_world_destroy(world);
+  return 0;
+}
+
+static int test_transform_scenegraph_parallel(void)
+{
+  enum { ROOT_COUNT = 1000 };
+  LDKECS* world = ldk_ecs_world_create(1024, 1);
+  LDKECS* previous = NULL;
+  LDKJobSystem jobs;
+  LDKEntity roots[ROOT_COUNT];
+  LDKEntity leaves[ROOT_COUNT][2];
+  u32 i = 0;
+
+  ASSERT_TRUE(world != NULL);
+  ASSERT_TRUE(ldk_jobs_initialize(&jobs, 4));
+  previous = ldk_ecs_world_bind(world);
+
+  // Every root gets two children with one child each. Odd roots are created
+  // after their descendants, so reparenting moves those subtrees
+  for (i = 0; i < ROOT_COUNT; ++i)
+  {
+    LDKEntity root = (i & 1) ? x_handle_null() : ldk_ecs_entity_create();
+    LDKEntity child_a = ldk_ecs_entity_create();
+    LDKEntity child_b = ldk_ecs_entity_create();
+    LDKEntity leaf_a = ldk_ecs_entity_create();
+    LDKEntity leaf_b = ldk_ecs_entity_create();
+
+    ASSERT_TRUE(ldk_transform_set_parent(leaf_a, child_a));
+    ASSERT_TRUE(ldk_transform_set_parent(leaf_b, child_b));
+    root = (i & 1) ? ldk_ecs_entity_create() : root;
+    ASSERT_TRUE(ldk_transform_set_parent(child_a, root));
+    ASSERT_TRUE(ldk_transform_set_parent(child_b, root));
+    ASSERT_TRUE(ldk_transform_set_local_position(root, vec3_make((float)i, 0.0f, 0.0f)));
+    ASSERT_TRUE(ldk_transform_set_local_position(child_a, vec3_make(0.0f, 1.0f, 0.0f)));
+    ASSERT_TRUE(ldk_transform_set_local_position(child_b, vec3_make(0.0f, 0.0f, 1.0f)));
+    ASSERT_TRUE(ldk_transform_set_local_position(leaf_a, vec3_make(0.0f, 1.0f, 0.0f)));
+    ASSERT_TRUE(ldk_transform_set_local_position(leaf_b, vec3_make(0.0f, 1.0f, 0.0f)));
+    roots[i] = root;
+    leaves[i][0] = leaf_a;
+    leaves[i][1] = leaf_b;
+  }
+
+  ASSERT_TRUE(world->scenegraph.live_count >= LDK_SCENEGRAPH_PARALLEL_MIN);
+  ASSERT_TRUE(ldk_scenegraph_update_world(&world->scenegraph, &world->entity, &world->component, &jobs));
+
+  // The pass ran by depth level
+  ASSERT_TRUE(!world->scenegraph.levels_dirty);
+  ASSERT_TRUE(x_array_count(world->scenegraph.level_ends) == 3);
+
+  for (i = 0; i < ROOT_COUNT; ++i)
+  {
+    ASSERT_TRUE(s_world_position_eq(leaves[i][0], (float)i, 2.0f, 0.0f));
+    ASSERT_TRUE(s_world_position_eq(leaves[i][1], (float)i, 1.0f, 1.0f));
+  }
+
+  // Moved roots reach their leaves, the others keep their matrices
+  for (i = 0; i < ROOT_COUNT; i += 3)
+  {
+    ASSERT_TRUE(ldk_transform_set_local_position(roots[i], vec3_make((float)i, 5.0f, 0.0f)));
+  }
+
+  ASSERT_TRUE(ldk_scenegraph_update_world(&world->scenegraph, &world->entity, &world->component, &jobs));
+  for (i = 0; i < ROOT_COUNT; ++i)
+  {
+    float y = (i % 3) == 0 ? 5.0f : 0.0f;
+
+    ASSERT_TRUE(s_world_position_eq(leaves[i][0], (float)i, y + 2.0f, 0.0f));
+    ASSERT_TRUE(s_world_position_eq(leaves[i][1], (float)i, y + 1.0f, 1.0f));
+  }
+
+  ldk_ecs_world_bind(previous);
+  ldk_ecs_world_destroy(world);
+  ldk_jobs_terminate(&jobs);
+  return 0;
+}
+
+static int test_transform_scenegraph_compose(void)
+{
+  enum { COUNT = 11 };
+  float position[3][COUNT];
+  float rotation[4][COUNT];
+  float scale[3][COUNT];
+  const Mat4* parent_world[COUNT];
+  Mat4* world[COUNT];
+  Mat4 results[COUNT];
+  Mat4 parents[2];
+  LDKScenegraphCompose batch;
+  u32 i = 0;
+  u32 j = 0;
+
+  parents[0] = mat4_compose(vec3_make(1.0f, -2.0f, 3.0f), quat_axis_angle(vec3_make(0.0f, 1.0f, 0.0f), 0.5f),
+      vec3_make(2.0f, 2.0f, 2.0f));
+  parents[1] = mat4_compose(vec3_make(-4.0f, 0.5f, 0.0f), quat_axis_angle(vec3_make(1.0f, 0.0f, 0.0f), -1.2f),
+      vec3_make(1.0f, 0.5f, 3.0f));
+
+  // An odd count covers the scalar tail, unnormalized and zero rotations the normalization
+  for (i = 0; i < COUNT; ++i)
+  {
+    Quat q = quat_axis_angle(vec3_norm(vec3_make(1.0f, (float)i, 2.0f)), 0.3f * (float)i);
+    float length = 1.0f + 0.25f * (float)(i % 3);
+
+    position[0][i] = (float)i;
+    position[1][i] = -0.5f * (float)i;
+    position[2][i] = 2.0f;
+    rotation[0][i] = i == 7 ? 0.0f : q.x * length;
+    rotation[1][i] = i == 7 ? 0.0f : q.y * length;
+    rotation[2][i] = i == 7 ? 0.0f : q.z * length;
+    rotation[3][i] = i == 7 ? 0.0f : q.w * length;
+    scale[0][i] = 1.0f + 0.1f * (float)i;
+    scale[1][i] = 0.5f;
+    scale[2][i] = 2.0f - 0.1f * (float)i;
+    parent_world[i] = (i % 3) == 0 ? NULL : &parents[i % 2];
+    world[i] = &results[i];
+  }
+
+  for (i = 0; i < 3; ++i)
+  {
+    batch.position[i] = position[i];
+    batch.scale[i] = scale[i];
+  }
+
+  for (i = 0; i < 4; ++i)
+  {
+    batch.rotation[i] = rotation[i];
+  }
+
+  batch.parent_world = parent_world;
+  batch.world = world;
+  ldk_scenegraph_compose(&batch, COUNT);
+
+  for (i = 0; i < COUNT; ++i)
+  {
+    Mat4 local_matrix = mat4_compose(vec3_make(position[0][i], position[1][i], position[2][i]),
+        quat_make(rotation[0][i], rotation[1][i], rotation[2][i], rotation[3][i]),
+        vec3_make(scale[0][i], scale[1][i], scale[2][i]));
+    Mat4 expected = parent_world[i] ? mat4_mul(*parent_world[i], local_matrix) : local_matrix;
+
+    for (j = 0; j < 16; ++j)
+    {
+      ASSERT_TRUE(float_eq(results[i].m[j], expected.m[j]));
+    }
+  }
+
+  return 0;
+}
+
 int main(void)
 {
   STDXTestCase tests[] =
   {
     X_TEST(test_transform_make_default),
     X_TEST(test_transform_parent_value_semantics),
+    X_TEST(test_transform_scenegraph_update),
+    X_TEST(test_transform_scenegraph_dirty_list),
+    X_TEST(test_transform_scenegraph_parallel),
+    X_TEST(test_transform_scenegraph_compose),
   };
 
   return x_tests_run(tests, sizeof(tests) / sizeof(tests[0]), NULL);